@@ -5,7 +5,8 @@
 
 /* splits a leaf node */
 
-AM_SplitLeaf(fileDesc,pageBuf,pageNum,attrLength,recId,value,status,index,key)
+AM_SplitLeaf(fileDesc,pageBuf,pageNum,attrLength,recId,value,status,index,key,
+	     payload)
 int fileDesc; /* file descriptor */
 char *pageBuf; /* pointer to buffer */
 int *pageNum; /* pagenumber of new leaf created */
@@ -16,6 +17,7 @@ char *value; /* attribute value for insert */
 int status; /* Whether key was found or not in the tree */
 int index; /* place where key is to be inserted */
 char *key; /* returns the key to be filled in the parent */
+char *payload; /* stored with recId in a covering index */
 {
 
 	AM_LEAFHEADER head,temphead; /* local header */
@@ -26,6 +28,13 @@ char *key; /* returns the key to be filled in the parent */
 								    allocated */
 	int errVal; 
 	int tempPageNum,tempPageNum1;/* pagenumbers for pages to be allocated */
+	int half; /* number of keys left on the first page */
+	int isRoot; /* whether the leaf being split is the root */
+	AM_INDEX *indexp; /* the open index */
+
+	if (*pageBuf == 'L')
+		return(AM_VarSplitLeaf(fileDesc,pageBuf,pageNum,attrLength,recId,
+				       value,status,index,key));
 
 	/* initialise pointers to headers */
 	header = &head;
@@ -34,30 +43,45 @@ char *key; /* returns the key to be filled in the parent */
 	/* copy header from buffer */
 	bcopy(pageBuf,header,AM_sl);
 
-	/* compact half the keys into temporary page */
-	AM_Compact(1,(header->numKeys)/2,pageBuf,tempPage,header);
+	indexp = AM_GetIndex(fileDesc);
+	if (indexp == NULL) return(AM_Errno);
+	isRoot = ((*pageNum) == indexp->rootPageNum);
+
+	/* keys staying on the left page: half, but an append to the rightmost
+	leaf leaves AM_RightSplitPct percent behind so that ascending inserts
+	do not strand half-empty leaves */
+	half = (header->numKeys)/2;
+	if (index > header->numKeys && header->nextLeafPage == AM_NULL_PAGE)
+	{
+		half = (header->numKeys * AM_RightSplitPct) / 100;
+		if (half < 1) half = 1;
+		if (half > header->numKeys) half = header->numKeys;
+	}
+
+	/* compact the left keys into temporary page */
+	AM_Compact(1,half,pageBuf,tempPage,header);
 
-	/* Allocate a new page for the other half of the leaf*/
-	errVal = PF_AllocPage(fileDesc,&tempPageNum,&tempPageBuf);
+	/* Allocate a new page for the right keys of the leaf*/
+	errVal = AM_NewPage(fileDesc,&tempPageNum,&tempPageBuf);
 	AM_Check;
 
-	/* compact the other half keys */
-	AM_Compact((header->numKeys)/2 + 1,header->numKeys
+	/* compact the right keys */
+	AM_Compact(half + 1,header->numKeys
 			      ,pageBuf,tempPageBuf,header);
 
 	/*check where key has to be inserted */
-	if (index <= ((header->numKeys)/2))
+	if (index <= half)
 	{
 		/*value to be inserted is in first half */
 		errVal = AM_InsertintoLeaf(tempPage,attrLength,value,recId,
-					   index,status);
+					   index,status,payload);
 	}
 	else
 	{
 		/* value to be inserted in second half */
-		index = index - ((header->numKeys)/2);
+		index = index - half;
 		errVal = AM_InsertintoLeaf(tempPageBuf,attrLength,value,
-					   recId,index,status);
+					   recId,index,status,payload);
 	}
 
 	/* change the next leafpage of first half of leaf to second half */
@@ -72,16 +96,17 @@ char *key; /* returns the key to be filled in the parent */
 
 
 	/*check if the split page is root */
-	if ((*pageNum) == AM_RootPageNum)
+	if (isRoot)
 	{
 		/* the page being split is the root*/
 		/* Allocate a new page for another leaf as a new root has 
 		to be created*/
-		errVal = PF_AllocPage(fileDesc,&tempPageNum1,&tempPageBuf1);
+		errVal = AM_NewPage(fileDesc,&tempPageNum1,&tempPageBuf1);
 		AM_Check;
 
-		AM_LeftPageNum = tempPageNum1; /* this will remain the 
+		indexp->leftPageNum = tempPageNum1; /* this will remain the 
 							   leftmost page hence*/
+		indexp->height++;
 
 		/* copy the old first half(actually the root) into a new page */ 
 		bcopy(pageBuf,tempPageBuf1,PF_PAGE_SIZE);
@@ -93,14 +118,27 @@ char *key; /* returns the key to be filled in the parent */
 		AM_Check;
 	}
 
+	/* the new leaf follows the left half, wherever that now is */
+	bcopy(tempPageBuf,tempheader,AM_sl);
+	tempheader->prevLeafPage = isRoot ? tempPageNum1 : *pageNum;
+	bcopy(tempheader,tempPageBuf,AM_sl);
+
 	errVal = PF_UnfixPage(fileDesc,*pageNum,TRUE);
 	AM_Check;
 
 	errVal = PF_UnfixPage(fileDesc,tempPageNum,TRUE);
 	AM_Check;
 
-	if ((*pageNum) == AM_RootPageNum)
+	errVal = AM_SetPrevLeaf(fileDesc,tempheader->nextLeafPage,tempPageNum);
+	if (errVal < 0) return(errVal);
+
+	if (isRoot)
+	{
+		/* the root page stays put; record the new leftmost leaf */
+		errVal = AM_WriteMeta(fileDesc,indexp);
+		if (errVal < 0) return(errVal);
 		return(FALSE);
+	}
 	else
 	{
 		*pageNum = tempPageNum;
@@ -108,13 +146,36 @@ char *key; /* returns the key to be filled in the parent */
 	}
 }
 
+/* Makes prevNum the predecessor of leaf pageNum, if there is such a leaf */
+AM_SetPrevLeaf(fileDesc,pageNum,prevNum)
+int fileDesc;
+int pageNum;
+int prevNum;
+
+{
+	char *pageBuf;
+	AM_LEAFHEADER head;
+	int errVal;
+
+	if (pageNum == AM_NULL_PAGE) return(AME_OK);
+	errVal = PF_GetThisPage(fileDesc,pageNum,&pageBuf);
+	AM_Check;
+	bcopy(pageBuf,&head,AM_sl);
+	head.prevLeafPage = prevNum;
+	bcopy(&head,pageBuf,AM_sl);
+	errVal = PF_UnfixPage(fileDesc,pageNum,TRUE);
+	AM_Check;
+	return(AME_OK);
+}
+
 /* Adds to the parent(on top of the path stack) attribute value and page Number*/
-AM_AddtoParent(fileDesc,pageNum,value,attrLength)
+AM_AddtoParent(fileDesc,pageNum,value,attrLength,stack)
 int fileDesc;
 int pageNum; /* page Number to be added to parent */
 char *value; /*  pointer to attribute value to be added - 
                  gives back the attribute value to be added to it's parent*/
 int attrLength;
+AM_STACK *stack; /* path of the insert */
 
 {
 	char tempPage[PF_PAGE_SIZE];/* temporary page for manipulating page */
@@ -127,19 +188,24 @@ int attrLength;
 
 	char *pageBuf,*pageBuf1,*pageBuf2;
 	AM_INTHEADER head,*header;
+	AM_INDEX *indexp; /* the open index */
 
 
 	/* initialise header */
 	header = &head;
 	/* Get the top of stack values for the page number of the parent 
 						 and offset of the key */
-	AM_topofStack(&pageNumber,&offset);
-	AM_PopStack();
+	AM_topofStack(stack,&pageNumber,&offset);
+	AM_PopStack(stack);
 
 	/* Get the parent node */
 	errVal = PF_GetThisPage(fileDesc,pageNumber,&pageBuf);
 	AM_Check;
 
+	if (*pageBuf == 'I')
+		return(AM_VarAddtoParent(fileDesc,pageNumber,pageBuf,offset,value,
+					 pageNum,attrLength,stack));
+
 	/* copy the header from buffer */
 	bcopy(pageBuf,header,AM_sint);
 
@@ -159,7 +225,7 @@ int attrLength;
 	else
 	{
 		/* not enough room for another key */ 
-		errVal = PF_AllocPage(fileDesc,&pageNum1,&pageBuf1);
+		errVal = AM_NewPage(fileDesc,&pageNum1,&pageBuf1);
 		AM_Check;
 
 		/* split the internal node */
@@ -167,10 +233,12 @@ int attrLength;
 					 value,pageNum,offset);
 
 		/* check if page being split is root */
-		if (pageNumber == AM_RootPageNum)
+		indexp = AM_GetIndex(fileDesc);
+		if (indexp == NULL) return(AM_Errno);
+		if (pageNumber == indexp->rootPageNum)
 		{
 			/* allocate a new page for a new root */
-			errVal = PF_AllocPage(fileDesc,&pageNum2,&pageBuf2);
+			errVal = AM_NewPage(fileDesc,&pageNum2,&pageBuf2);
 			AM_Check;
 
 			/* copy the first half into another buffer */
@@ -190,7 +258,9 @@ int attrLength;
 			errVal = PF_UnfixPage(fileDesc,pageNum2,TRUE);
 			AM_Check;
 
-			return(AME_OK);
+			/* the tree grew a level under the same root page */
+			indexp->height++;
+			return(AM_WriteMeta(fileDesc,indexp));
 		}
 		else
 		{
@@ -205,7 +275,7 @@ int attrLength;
 			/* recursive call to add to the parent of this 
 			internal node*/
 			errVal =  AM_AddtoParent(fileDesc,pageNum1,value,
-						 attrLength);
+						 attrLength,stack);
 			AM_Check;
 		}
 	}
@@ -331,6 +401,391 @@ int pageNum,offset;
 
 }
 
+/* Rebalances a leaf that a delete left less than AM_MergePct percent full,
+with its sibling under the parent on top of the path stack: the right one of
+the two moves into the left one if both fit a page and goes back to the file,
+otherwise they share their keys evenly. The leaf comes fixed and is unfixed */
+AM_MergeLeaf(fileDesc,pageNum,pageBuf,attrLength,stack)
+int fileDesc;
+int pageNum; /* the leaf */
+char *pageBuf; /* its buffer */
+int attrLength;
+AM_STACK *stack; /* path of the delete */
+
+{
+	char tempPage[PF_PAGE_SIZE],tempPage1[PF_PAGE_SIZE];/* the two leaves
+							compacted */
+	char *parentBuf,*siblingBuf,*leftBuf,*rightBuf;
+	AM_INTHEADER ihead,*iheader;
+	AM_LEAFHEADER lhead,rhead,*lheader,*rheader;
+	int parentNum; /* parent of the leaf - got from stack */
+	int offset; /* child of the parent that is the leaf */
+	int sep; /* key of the parent between the two leaves */
+	int leftNum,rightNum,siblingNum;
+	int nextLeaf; /* leaf after the pair */
+	int prevLeaf; /* leaf before it */
+	int recSize;
+	int used,bytes,best,half,i,k;
+	int moved; /* whether keys changed leaves */
+	AM_INDEX *indexp;
+	int errVal;
+
+	iheader = &ihead;
+	lheader = &lhead;
+	rheader = &rhead;
+
+	indexp = AM_GetIndex(fileDesc);
+	if (indexp == NULL) 
+	{
+		PF_UnfixPage(fileDesc,pageNum,TRUE);
+		return(AM_Errno);
+	}
+
+	AM_topofStack(stack,&parentNum,&offset);
+	AM_PopStack(stack);
+	errVal = PF_GetThisPage(fileDesc,parentNum,&parentBuf);
+	if (errVal != PFE_OK)
+	{
+		PF_UnfixPage(fileDesc,pageNum,TRUE);
+		AM_Check;
+	}
+	bcopy(parentBuf,iheader,AM_sint);
+	if (iheader->numKeys == 0)
+	{
+		/* no sibling */
+		errVal = PF_UnfixPage(fileDesc,pageNum,TRUE);
+		AM_Check;
+		errVal = PF_UnfixPage(fileDesc,parentNum,FALSE);
+		AM_Check;
+		return(AME_OK);
+	}
+
+	/* pair the leaf with its right sibling, or its left one if it is
+	the last child */
+	recSize = attrLength + AM_si;
+	sep = (offset < iheader->numKeys) ? offset + 1 : offset;
+	bcopy(parentBuf + AM_sint + (sep - 1)*recSize,(char *)&leftNum,AM_si);
+	bcopy(parentBuf + AM_sint + sep*recSize,(char *)&rightNum,AM_si);
+	siblingNum = (leftNum == pageNum) ? rightNum : leftNum;
+	errVal = PF_GetThisPage(fileDesc,siblingNum,&siblingBuf);
+	if (errVal != PFE_OK)
+	{
+		PF_UnfixPage(fileDesc,pageNum,TRUE);
+		PF_UnfixPage(fileDesc,parentNum,FALSE);
+		AM_Check;
+	}
+	leftBuf = (leftNum == pageNum) ? pageBuf : siblingBuf;
+	rightBuf = (leftNum == pageNum) ? siblingBuf : pageBuf;
+
+	/* compact both */
+	bcopy(leftBuf,lheader,AM_sl);
+	bcopy(rightBuf,rheader,AM_sl);
+	nextLeaf = rheader->nextLeafPage;
+	prevLeaf = lheader->prevLeafPage;
+	AM_Compact(1,lheader->numKeys,leftBuf,tempPage,lheader);
+	AM_Compact(1,rheader->numKeys,rightBuf,tempPage1,rheader);
+	bcopy(tempPage,lheader,AM_sl);
+	bcopy(tempPage1,rheader,AM_sl);
+	used = AM_LeafUsed(lheader) + AM_LeafUsed(rheader);
+
+	if (used <= PF_PAGE_SIZE - AM_sl)
+	{
+		/* merge the right leaf into the left one */
+		AM_LeafAppend(1,rheader->numKeys,tempPage1,tempPage);
+		bcopy(tempPage,lheader,AM_sl);
+		lheader->nextLeafPage = nextLeaf;
+		bcopy(lheader,tempPage,AM_sl);
+		bcopy(tempPage,leftBuf,PF_PAGE_SIZE);
+
+		errVal = PF_UnfixPage(fileDesc,leftNum,TRUE);
+		AM_Check;
+		errVal = PF_UnfixPage(fileDesc,rightNum,FALSE);
+		AM_Check;
+		errVal = PF_DisposePage(fileDesc,rightNum);
+		AM_Check;
+		errVal = AM_SetPrevLeaf(fileDesc,nextLeaf,leftNum);
+		if (errVal < 0) return(errVal);
+		if (indexp->rightPageNum == rightNum)
+			indexp->rightPageNum = AM_NULL_PAGE;
+
+		/* drop the separator and the right leaf from the parent */
+		return(AM_DeleteFromParent(fileDesc,parentNum,parentBuf,sep,
+					   attrLength,stack));
+	}
+
+	/* too much for one page: the first k keys of the two go left, with
+	the bytes on either side as near half as can be */
+	half = used / 2;
+	bytes = 0;
+	best = 1;
+	k = 0;
+	for (i = 1; i < lheader->numKeys + rheader->numKeys; i++)
+	{
+		if (i <= lheader->numKeys)
+			bytes += AM_EntryBytes(tempPage,i,lheader);
+		else
+			bytes += AM_EntryBytes(tempPage1,i - lheader->numKeys,
+					       rheader);
+		if (k == 0 || abs(bytes - half) < best)
+		{
+			best = abs(bytes - half);
+			k = i;
+		}
+	}
+
+	moved = (k != lheader->numKeys);
+	if (moved)
+	{
+		if (k < lheader->numKeys)
+		{
+			AM_Compact(1,k,tempPage,leftBuf,lheader);
+			AM_Compact(k + 1,lheader->numKeys,tempPage,rightBuf,
+				   lheader);
+			AM_LeafAppend(1,rheader->numKeys,tempPage1,rightBuf);
+		}
+		else
+		{
+			AM_Compact(1,lheader->numKeys,tempPage,leftBuf,lheader);
+			AM_LeafAppend(1,k - lheader->numKeys,tempPage1,leftBuf);
+			AM_Compact(k - lheader->numKeys + 1,rheader->numKeys,
+				   tempPage1,rightBuf,rheader);
+		}
+
+		/* relink, as the headers came along with the keys */
+		bcopy(leftBuf,lheader,AM_sl);
+		lheader->nextLeafPage = rightNum;
+		lheader->prevLeafPage = prevLeaf;
+		bcopy(lheader,leftBuf,AM_sl);
+		bcopy(rightBuf,rheader,AM_sl);
+		rheader->nextLeafPage = nextLeaf;
+		rheader->prevLeafPage = leftNum;
+		bcopy(rheader,rightBuf,AM_sl);
+
+		/* the right leaf's first key separates the two */
+		bcopy(rightBuf + AM_sl,parentBuf + AM_sint + AM_si + 
+		      (sep - 1)*recSize,attrLength);
+	}
+
+	errVal = PF_UnfixPage(fileDesc,pageNum,TRUE);
+	AM_Check;
+	errVal = PF_UnfixPage(fileDesc,siblingNum,moved);
+	AM_Check;
+	errVal = PF_UnfixPage(fileDesc,parentNum,moved);
+	AM_Check;
+	return(AME_OK);
+}
+
+
+/* Bytes taken by key index of a fixed leaf and its recId list */
+AM_EntryBytes(pageBuf,index,header)
+char *pageBuf;
+int index;
+AM_LEAFHEADER *header;
+
+{
+	short nextRec;
+	int bytes;
+
+	bytes = header->attrLength + AM_ss;
+	bcopy(pageBuf + AM_sl + (index - 1)*bytes + header->attrLength,
+	      (char *)&nextRec,AM_ss);
+	while (nextRec != AM_NULL)
+	{
+		bytes += AM_RecIdSize(header);
+		bcopy(pageBuf + nextRec + AM_si,(char *)&nextRec,AM_ss);
+	}
+	return(bytes);
+}
+
+
+/* Removes key sep and the child after it from an internal node, which
+comes fixed and is unfixed. A root left with one child hands its page to the
+child, and any other node left less than AM_MergePct percent full is merged
+or rebalanced with a sibling */
+AM_DeleteFromParent(fileDesc,pageNum,pageBuf,sep,attrLength,stack)
+int fileDesc;
+int pageNum;
+char *pageBuf;
+int sep; /* key to be removed, from 1 */
+int attrLength;
+AM_STACK *stack; /* path above the node */
+
+{
+	AM_INTHEADER head,*header;
+	AM_INDEX *indexp;
+	char *childBuf;
+	int childNum;
+	int recSize;
+	int i;
+	int errVal;
+
+	header = &head;
+	bcopy(pageBuf,header,AM_sint);
+	recSize = attrLength + AM_si;
+
+	/* shift the keys after it to the left */
+	for (i = sep; i < header->numKeys; i++)
+		bcopy(pageBuf + AM_sint + AM_si + i*recSize,pageBuf + AM_sint +
+		      AM_si + (i - 1)*recSize,recSize);
+	header->numKeys--;
+	bcopy(header,pageBuf,AM_sint);
+
+	indexp = AM_GetIndex(fileDesc);
+	if (indexp == NULL) 
+	{
+		PF_UnfixPage(fileDesc,pageNum,TRUE);
+		return(AM_Errno);
+	}
+
+	if (pageNum == indexp->rootPageNum)
+	{
+		if (header->numKeys > 0)
+		{
+			errVal = PF_UnfixPage(fileDesc,pageNum,TRUE);
+			AM_Check;
+			return(AME_OK);
+		}
+
+		/* the tree loses a level; the root page stays put and the
+		child's page goes back to the file */
+		bcopy(pageBuf + AM_sint,(char *)&childNum,AM_si);
+		errVal = PF_GetThisPage(fileDesc,childNum,&childBuf);
+		if (errVal != PFE_OK)
+		{
+			PF_UnfixPage(fileDesc,pageNum,TRUE);
+			AM_Check;
+		}
+		bcopy(childBuf,pageBuf,PF_PAGE_SIZE);
+		errVal = PF_UnfixPage(fileDesc,childNum,FALSE);
+		AM_Check;
+		errVal = PF_DisposePage(fileDesc,childNum);
+		AM_Check;
+		if (AM_IsLeaf(pageBuf))
+			indexp->leftPageNum = pageNum;
+		indexp->rightPageNum = AM_NULL_PAGE;
+		indexp->height--;
+		errVal = PF_UnfixPage(fileDesc,pageNum,TRUE);
+		AM_Check;
+		return(AM_WriteMeta(fileDesc,indexp));
+	}
+
+	if (AM_MergePct > 0 && 
+	    header->numKeys * 100 < header->maxKeys * AM_MergePct)
+		return(AM_MergeIntNode(fileDesc,pageNum,pageBuf,attrLength,
+				       stack));
+
+	errVal = PF_UnfixPage(fileDesc,pageNum,TRUE);
+	AM_Check;
+	return(AME_OK);
+}
+
+
+/* AM_MergeLeaf for an internal node: the separator in the parent comes down
+between the keys of the two nodes, and if they are too many for one node the
+middle one of them goes back up */
+AM_MergeIntNode(fileDesc,pageNum,pageBuf,attrLength,stack)
+int fileDesc;
+int pageNum;
+char *pageBuf;
+int attrLength;
+AM_STACK *stack;
+
+{
+	char tempPage[2*PF_PAGE_SIZE];/* keys and children of both nodes */
+	char *parentBuf,*siblingBuf,*leftBuf,*rightBuf;
+	AM_INTHEADER head,lhead,rhead,*header,*lheader,*rheader;
+	int parentNum,offset,sep;
+	int leftNum,rightNum,siblingNum;
+	int recSize;
+	int length,numKeys,half;
+	int errVal;
+
+	header = &head;
+	lheader = &lhead;
+	rheader = &rhead;
+
+	AM_topofStack(stack,&parentNum,&offset);
+	AM_PopStack(stack);
+	errVal = PF_GetThisPage(fileDesc,parentNum,&parentBuf);
+	if (errVal != PFE_OK)
+	{
+		PF_UnfixPage(fileDesc,pageNum,TRUE);
+		AM_Check;
+	}
+	bcopy(parentBuf,header,AM_sint);
+	if (header->numKeys == 0)
+	{
+		errVal = PF_UnfixPage(fileDesc,pageNum,TRUE);
+		AM_Check;
+		errVal = PF_UnfixPage(fileDesc,parentNum,FALSE);
+		AM_Check;
+		return(AME_OK);
+	}
+
+	recSize = attrLength + AM_si;
+	sep = (offset < header->numKeys) ? offset + 1 : offset;
+	bcopy(parentBuf + AM_sint + (sep - 1)*recSize,(char *)&leftNum,AM_si);
+	bcopy(parentBuf + AM_sint + sep*recSize,(char *)&rightNum,AM_si);
+	siblingNum = (leftNum == pageNum) ? rightNum : leftNum;
+	errVal = PF_GetThisPage(fileDesc,siblingNum,&siblingBuf);
+	if (errVal != PFE_OK)
+	{
+		PF_UnfixPage(fileDesc,pageNum,TRUE);
+		PF_UnfixPage(fileDesc,parentNum,FALSE);
+		AM_Check;
+	}
+	leftBuf = (leftNum == pageNum) ? pageBuf : siblingBuf;
+	rightBuf = (leftNum == pageNum) ? siblingBuf : pageBuf;
+	bcopy(leftBuf,lheader,AM_sint);
+	bcopy(rightBuf,rheader,AM_sint);
+
+	/* left children and keys, the separator, right children and keys */
+	length = AM_si + lheader->numKeys*recSize;
+	bcopy(leftBuf + AM_sint,tempPage,length);
+	bcopy(parentBuf + AM_sint + AM_si + (sep - 1)*recSize,tempPage + length,
+	      attrLength);
+	bcopy(rightBuf + AM_sint,tempPage + length + attrLength,
+	      AM_si + rheader->numKeys*recSize);
+	numKeys = lheader->numKeys + 1 + rheader->numKeys;
+
+	if (numKeys <= lheader->maxKeys)
+	{
+		/* all in the left node */
+		bcopy(tempPage,leftBuf + AM_sint,AM_si + numKeys*recSize);
+		lheader->numKeys = numKeys;
+		bcopy(lheader,leftBuf,AM_sint);
+
+		errVal = PF_UnfixPage(fileDesc,leftNum,TRUE);
+		AM_Check;
+		errVal = PF_UnfixPage(fileDesc,rightNum,FALSE);
+		AM_Check;
+		errVal = PF_DisposePage(fileDesc,rightNum);
+		AM_Check;
+		return(AM_DeleteFromParent(fileDesc,parentNum,parentBuf,sep,
+					   attrLength,stack));
+	}
+
+	/* half the keys left, the next one up, the rest right */
+	half = numKeys/2;
+	bcopy(tempPage,leftBuf + AM_sint,AM_si + half*recSize);
+	lheader->numKeys = half;
+	bcopy(lheader,leftBuf,AM_sint);
+	bcopy(tempPage + AM_si + half*recSize,parentBuf + AM_sint + AM_si + 
+	      (sep - 1)*recSize,attrLength);
+	bcopy(tempPage + AM_si + half*recSize + attrLength,rightBuf + AM_sint,
+	      AM_si + (numKeys - half - 1)*recSize);
+	rheader->numKeys = numKeys - half - 1;
+	bcopy(rheader,rightBuf,AM_sint);
+
+	errVal = PF_UnfixPage(fileDesc,leftNum,TRUE);
+	AM_Check;
+	errVal = PF_UnfixPage(fileDesc,rightNum,TRUE);
+	AM_Check;
+	errVal = PF_UnfixPage(fileDesc,parentNum,TRUE);
+	AM_Check;
+	return(AME_OK);
+}
+
 bcopy(char* s1, char *s2, int nbytes)
 {
 memcpy(s2,s1,nbytes);
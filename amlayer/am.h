@@ -1,9 +1,12 @@
 #include <stdlib.h>
 
+typedef long long AM_RID; /* recId of a wide index: page and slot */
+
 typedef struct am_leafheader
 	{
 		char pageType;
 		int nextLeafPage;
+		int prevLeafPage; /* AM_NULL_PAGE for the leftmost leaf */
 		short recIdPtr;
 		short keyPtr;
 		short freeListPtr;
@@ -11,6 +14,9 @@ typedef struct am_leafheader
 		short attrLength;
 		short numKeys;
 		short maxKeys;
+		short payloadLength; /* bytes stored after each recId's next
+					pointer: the high half of a wide recId,
+					then the covered columns */
 	}  AM_LEAFHEADER; /* Header for a leaf page */
 
 typedef struct am_intheader 
@@ -21,17 +27,227 @@ typedef struct am_intheader
 		short attrLength;
 	}	AM_INTHEADER ; /* Header for an internal node */
 
-extern int AM_RootPageNum; /* The page number of the root */
-extern int AM_LeftPageNum; /* The page Number of the leftmost leaf */
-extern int AM_Errno; /* last error in AM layer */
+typedef struct am_vleafheader
+	{
+		AM_LEAFHEADER h; /* pageType 'L'; maxKeys is unused */
+		short prefixLen; /* bytes every key on the page starts with */
+		short garbage; /* bytes of deleted entries not yet reclaimed */
+	}	AM_VLEAFHEADER; /* Header for a leaf of variable-length keys */
+
+typedef struct am_vintheader
+	{
+		AM_INTHEADER h; /* pageType 'I'; maxKeys is unused */
+		short prefixLen; /* bytes every separator starts with */
+		short heapPtr; /* start of the entries at the end of the page */
+	}	AM_VINTHEADER; /* Header for an internal node of variable-length
+			  keys */
+
+typedef struct am_postheader
+	{
+		char pageType; /* 'p' */
+		int nextPage; /* AM_NULL_PAGE for the last page of the list */
+		int listPage; /* first page of the list */
+		short numRids;
+		short bytes; /* bytes of recIds after the header */
+		unsigned int lastRid; /* largest recId on the page */
+	}	AM_POSTHEADER; /* Header for a page of a posting list: recIds of
+			  one key in ascending order, each a varint of its
+			  difference from the one before */
+
+typedef struct am_hashmeta
+	{
+		char pageType; /* 'h' */
+		int magic; /* AM_META_MAGIC */
+		char attrType;
+		short attrLength;
+		short depth; /* global depth: the directory has 1 << depth entries */
+		short numDirPages; /* their page numbers follow the header */
+	}	AM_HASHMETA; /* page 0 of a hash index file */
+
+typedef struct am_bucketheader
+	{
+		char pageType; /* 'b' */
+		int nextPage; /* overflow page, AM_NULL_PAGE if none */
+		short depth; /* local depth: low bits of the hash its keys share */
+		short numEntries; /* key,recId pairs after the header */
+		short attrLength;
+	}	AM_BUCKETHEADER; /* Header for a bucket page of a hash index */
+
+typedef struct am_filterheader
+	{
+		char pageType; /* 'F' */
+		int nextPage; /* AM_NULL_PAGE for the last page of the filter */
+	}	AM_FILTERHEADER; /* Header for a page of the Bloom filter of an
+			  index, AM_FILTERPERPAGE blocks of AM_FILTERBLOCK
+			  bytes after it */
+
+typedef struct am_iterator
+	{
+		int (*next)(); /* next(state,value,&recId,payload): 1 for a
+				  pair, 0 at the end, < 0 on error; payload
+				  matters only for a covering index, and
+				  recId is an AM_RID for a wide one */
+		char *state;
+	}	AM_ITERATOR; /* source of (key,recId) pairs for AM_BulkLoad */
+
+typedef struct am_treestats
+	{
+		int height; /* levels, counting the leaves */
+		int leafPages;
+		int intPages;
+		int numKeys; /* distinct keys */
+		int numRecIds;
+		int leafBytes; /* bytes used in leaves, headers included */
+		int postPages; /* pages of posting lists */
+		int filterPages; /* pages of the Bloom filter */
+	}	AM_TREESTATS;
+
+typedef struct am_hashstats
+	{
+		int depth; /* global depth */
+		int dirPages;
+		int buckets;
+		int overflowPages;
+		int numEntries;
+	}	AM_HASHSTATS;
+
+# define AM_MAXCOLS 8 /* columns of a composite key */
+
+typedef struct am_keydesc
+	{
+		int numCols;
+		char colType[AM_MAXCOLS]; /* 'i', 'f' or 'c' */
+		short colLength[AM_MAXCOLS]; /* 4 for 'i' or 'f', 1-255 for 'c' */
+	}	AM_KEYDESC; /* columns of a composite ('k') key, leading first */
+
+typedef struct am_metapage
+	{
+		char pageType; /* 'm' */
+		int magic; /* AM_META_MAGIC */
+		int rootPageNum;
+		int leftPageNum; /* leftmost leaf */
+		int height; /* levels, counting the leaves */
+		char attrType;
+		short attrLength;
+		AM_KEYDESC keyDesc; /* columns of a 'k' key */
+		short payloadLength; /* bytes of covered columns per entry */
+		short ridLength; /* bytes of a recId: 4, or 8 for AM_RIDs */
+		int filterMagic; /* AM_FILTER_MAGIC if the fields below are
+				    set: meta pages before them have junk;
+				    AM_FILTER_STALE if the filter's pages
+				    may lack keys inserted since */
+		int filterPage; /* first page of the Bloom filter */
+		int filterBlocks; /* its blocks, 0 if there is none */
+		short filterProbes; /* bits a key sets in its block */
+	}	AM_METAPAGE; /* page 0 of an index file */
+
+# define AM_STACKLOCAL 16 /* levels an AM_STACK holds without malloc */
+
+typedef struct am_stackentry
+	{
+		int pageNumber; /* internal node */
+		int offset; /* child followed */
+	}	AM_STACKENTRY;
+
+typedef struct am_stack
+	{
+		int top; /* last entry in use, -1 if none */
+		int size; /* entries entry has room for */
+		AM_STACKENTRY *entry; /* local, or malloc'd past AM_STACKLOCAL */
+		AM_STACKENTRY local[AM_STACKLOCAL];
+	}	AM_STACK; /* path from the root to a leaf, one per insert or delete */
+
+typedef struct am_index
+	{
+		int serial; /* PF_FileSerial of the file this entry describes,
+			       0 if none */
+		int hasMeta; /* FALSE for files created before the meta page */
+		int rootPageNum;
+		int leftPageNum;
+		int rightPageNum; /* cached rightmost leaf, AM_NULL_PAGE if none */
+		int height;
+		char attrType; /* 0 if unknown */
+		int attrLength;
+		AM_KEYDESC keyDesc; /* columns of a 'k' key */
+		int payloadLength; /* 0 unless a covering index */
+		int ridLength; /* AM_si, or AM_sr for a wide index */
+		int hashed; /* TRUE for a hash index (amhash.c) */
+		int hashDepth; /* its global depth */
+		int *hashDir; /* its directory, the bucket pages of the
+				 1 << hashDepth hash values; malloc'd */
+		int filterBlocks; /* blocks of its Bloom filter, 0 if it has
+				     none (amfilter.c) */
+		int filterProbes; /* bits a key sets in its block */
+		int filterPage; /* the filter's first page */
+		int *filterPages; /* all its pages, in order; malloc'd */
+		unsigned char *filter; /* its blocks; malloc'd */
+		int filterDirty; /* TRUE if inserts set bits that are not on
+				    its pages yet */
+	}	AM_INDEX; /* in-memory state of an open index, one per PF fd */
+
+extern AM_INDEX AM_indexTable[]; /* indexed by PF file descriptor */
+extern AM_INDEX *AM_GetIndex(); /* handle for an open index file */
+extern char *AM_LeafKey(); /* key of a leaf entry, either format */
+extern char *AM_IntKey(); /* separator of an internal node, either format */
+extern AM_RID AM_NodeRid(); /* the recId of a recId node */
+extern __thread int AM_Errno; /* last error in AM layer, per thread */
+extern int AM_FillFactor; /* percent of a page AM_BulkLoad fills */
+extern int AM_AppendCache; /* use the cached rightmost leaf for appends */
+extern int AM_SearchKernels; /* search int, float and composite nodes
+				with the branchless rank kernels */
+extern int AM_RightSplitPct; /* percent of keys a rightmost leaf keeps when
+				an append splits it */
+extern int AM_MergePct; /* a delete that leaves a node less full than this
+			   percent merges or rebalances it with a sibling;
+			   0 never does */
+extern int AM_PrefetchLeaves; /* leaves a scan asks the PF layer to read
+				 ahead of it, up to AM_MAXPREFETCH; 0 none */
+extern int AM_PostingMin; /* recIds of a key in a fixed leaf of int recIds
+			     and no payload past which they move to a
+			     posting list; 0 never */
+extern int AM_FilterBitsPerKey; /* filter bits AM_BuildFilter allows a key */
+extern unsigned int AM_HashValue(); /* hash of a key, equal for equal keys */
 
 # define AM_Check if (errVal != PFE_OK) {AM_Errno = AME_PF; return(AME_PF) ;}
 # define AM_si sizeof(int)
 # define AM_ss sizeof(short)
 # define AM_sl sizeof(AM_LEAFHEADER)
 # define AM_sint sizeof(AM_INTHEADER)
+# define AM_svl sizeof(AM_VLEAFHEADER)
+# define AM_svint sizeof(AM_VINTHEADER)
+# define AM_sp sizeof(AM_POSTHEADER)
+# define AM_POSTLIST -1 /* recId of the first node of a key whose recIds are
+		in a posting list; the second and last node holds its first
+		page */
+# define AM_MAXPOSTRIDS (PF_PAGE_SIZE - AM_sp) /* recIds of a posting page,
+		at least a byte apiece */
+# define AM_shm sizeof(AM_HASHMETA)
+# define AM_sb sizeof(AM_BUCKETHEADER)
+# define AM_MAXDIRPAGES ((PF_PAGE_SIZE - AM_shm)/AM_si) /* directory pages
+		the meta page of a hash index has room for */
+# define AM_DIRENTRIES ((PF_PAGE_SIZE - AM_si)/AM_si) /* entries of a
+		directory page, after its type */
+# define AM_MAXHASHDEPTH 15 /* global depth of the largest directory that
+		fits AM_MAXDIRPAGES pages */
+# define AM_sfh sizeof(AM_FILTERHEADER)
+# define AM_FILTERBLOCK 64 /* bytes of a filter block: a key's bits all fall
+		in one, a cache line */
+# define AM_FILTERPERPAGE ((PF_PAGE_SIZE - AM_sfh)/AM_FILTERBLOCK)
+# define AM_MAXPROBES 16 /* bits a key sets at most */
+# define AM_RecIdSize(header) (AM_si + AM_ss + (header)->payloadLength)
+		/* a recId node of a fixed leaf: recId (the low half of a
+		wide one), next, payload */
+# define AM_LeafUsed(header) ((header)->keyPtr - AM_sl + PF_PAGE_SIZE - \
+		(header)->recIdPtr - (header)->numinfreeList*AM_RecIdSize(header))
+		/* bytes of keys and live recId nodes in a fixed leaf */
+# define AM_IsLeaf(pageBuf) (*(pageBuf) == 'l' || *(pageBuf) == 'L')
 # define AM_sc sizeof(char)
 # define AM_sf sizeof(float)
+# define AM_sr sizeof(AM_RID)
+# define AM_RidMake(page,slot) (((AM_RID)(page) << 16) | ((slot) & 0xFFFF))
+# define AM_RidPage(rid) ((int)((rid) >> 16))
+# define AM_RidSlot(rid) ((int)((rid) & 0xFFFF))
+		/* 32 bit page and 16 bit slot, 48 bits in all */
 # define AM_NOT_FOUND 0 /* Key is not in tree */
 # define AM_FOUND 1 /* Key is in tree */
 # define AM_NULL 0 /* Null pointer for lists in a page */
@@ -50,8 +266,17 @@ extern int AM_Errno; /* last error in AM layer */
 # define LESS_THAN_EQUAL 4
 # define GREATER_THAN_EQUAL 5
 # define NOT_EQUAL 6
-# define MAXSCANS 20
+# define BETWEEN 7 /* AM_OpenRangeScan */
 # define AM_MAXATTRLENGTH 256
+# define AM_MAXPAYLOAD 255 /* bytes of covered columns per entry */
+# define AM_MAXPREFETCH 32 /* most leaves a scan reads ahead */
+# define AM_MAXINDEXES 20 /* open index files, as many as the PF file table */
+# define AM_META_PAGE 0 /* page number of the meta page */
+# define AM_META_MAGIC 0x414d4958
+# define AM_FILTER_MAGIC 0x414d4246
+# define AM_FILTER_STALE 0x414d4253 /* a filter left dirty: not to be used */
+# define AM_FMT_FIXED 0 /* keys stored at attrLength bytes */
+# define AM_FMT_VAR 1 /* 'c' keys stored at their length, prefix compressed */
 
 
 # define AME_OK 0
@@ -66,3 +291,8 @@ extern int AM_Errno; /* last error in AM layer */
 # define AME_INVALIDATTRTYPE -9
 # define AME_FD -10
 # define AME_INVALIDVALUE -11
+# define AME_INDEXNOTEMPTY -12
+# define AME_UNSORTED -13
+# define AME_NOMEM -14
+# define AME_NOTINDEX -15
+# define AME_NOTSUPPORTED -16
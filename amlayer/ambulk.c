@@ -0,0 +1,548 @@
+# include <stdio.h>
+# include <stdlib.h>
+# include "am.h"
+# include "pf.h"
+
+
+/* one entry of the level being built: a node and the smallest key under it */
+typedef struct am_bulkentry
+	{
+		int pageNum;
+		char key[AM_MAXATTRLENGTH];
+	} AM_BULKENTRY;
+
+
+/* adds an entry to a growable array of level entries */
+static AM_BulkAppend(level,numEntries,capacity,pageNum,key,attrLength)
+AM_BULKENTRY **level;
+int *numEntries;
+int *capacity;
+int pageNum;
+char *key;
+int attrLength;
+
+{
+	AM_BULKENTRY *temp;
+
+	if (*numEntries == *capacity)
+	{
+		*capacity = (*capacity == 0) ? 64 : 2 * (*capacity);
+		temp = (AM_BULKENTRY *) realloc(*level,
+				(*capacity) * sizeof(AM_BULKENTRY));
+		if (temp == NULL) return(AME_NOMEM);
+		*level = temp;
+	}
+	(*level)[*numEntries].pageNum = pageNum;
+	bcopy(key,(*level)[*numEntries].key,attrLength);
+	(*numEntries)++;
+	return(AME_OK);
+}
+
+
+/* Initialises an empty leaf page */
+static AM_BulkInitLeaf(pageBuf,header,attrLength,maxKeys)
+char *pageBuf;
+AM_LEAFHEADER *header;
+int attrLength;
+int maxKeys;
+
+{
+	header->pageType = 'l';
+	header->nextLeafPage = AM_NULL_PAGE;
+	header->prevLeafPage = AM_NULL_PAGE;
+	header->recIdPtr = PF_PAGE_SIZE;
+	header->keyPtr = AM_sl;
+	header->freeListPtr = AM_NULL;
+	header->numinfreeList = 0;
+	header->attrLength = attrLength;
+	header->numKeys = 0;
+	header->maxKeys = maxKeys;
+	header->payloadLength = 0;
+	bcopy(header,pageBuf,AM_sl);
+}
+
+
+/* Writes the internal nodes of the level above the numEntries nodes in
+level, packing at most keysPerNode keys into each. The parent entries are
+returned in upper. If the level fits in one node it is written into the
+root page (rootNum, fixed in rootBuf) instead of a new page. */
+static AM_BulkBuildLevel(fileDesc,level,numEntries,upper,numUpper,capUpper,
+			 attrLength,keysPerNode,maxKeys,rootNum,rootBuf)
+int fileDesc;
+AM_BULKENTRY *level;
+int numEntries;
+AM_BULKENTRY **upper;
+int *numUpper;
+int *capUpper;
+int attrLength;
+int keysPerNode;
+int maxKeys;
+int rootNum;
+char *rootBuf;
+
+{
+	AM_INTHEADER head,*header;
+	char *pageBuf;
+	int pageNum;
+	int recSize;
+	int numNodes; /* nodes on this level */
+	int first; /* index of first child of the current node */
+	int numChildren;
+	int i,errVal;
+
+	header = &head;
+	recSize = attrLength + AM_si;
+
+	numNodes = (numEntries + keysPerNode) / (keysPerNode + 1);
+	*numUpper = 0;
+	for (first = 0; first < numEntries; first += numChildren)
+	{
+		numChildren = keysPerNode + 1;
+		if (first + numChildren > numEntries)
+			numChildren = numEntries - first;
+		/* every internal node needs a key: leave the last node two
+		children by taking one from this node */
+		if ((numEntries - first - numChildren) == 1)
+			numChildren--;
+
+		if (numNodes == 1)
+		{
+			pageBuf = rootBuf;
+			pageNum = rootNum;
+		}
+		else
+		{
+			errVal = PF_AllocPage(fileDesc,&pageNum,&pageBuf);
+			AM_Check;
+		}
+
+		header->pageType = 'i';
+		header->numKeys = numChildren - 1;
+		header->maxKeys = maxKeys;
+		header->attrLength = attrLength;
+		bcopy(header,pageBuf,AM_sint);
+		bcopy((char *)&level[first].pageNum,pageBuf + AM_sint,AM_si);
+		for (i = 1; i < numChildren; i++)
+		{
+			bcopy(level[first + i].key,pageBuf + AM_sint + AM_si +
+			      (i - 1)*recSize,attrLength);
+			bcopy((char *)&level[first + i].pageNum,pageBuf +
+			      AM_sint + i*recSize,AM_si);
+		}
+
+		if (numNodes != 1)
+		{
+			errVal = PF_UnfixPage(fileDesc,pageNum,TRUE);
+			AM_Check;
+		}
+		errVal = AM_BulkAppend(upper,numUpper,capUpper,pageNum,
+				       level[first].key,attrLength);
+		if (errVal != AME_OK) return(errVal);
+	}
+	return(AME_OK);
+}
+
+
+/* Loads a var index (AM_FMT_VAR), a covering or a wide index by appending
+the sorted pairs one at a time: each goes straight into the rightmost leaf,
+which splits leaving AM_FillFactor percent of its bytes behind. The iterator
+of a covering index also fills in the payload of each pair, and that of a
+wide index returns an AM_RID rather than an int */
+static AM_BulkInsert(fileDesc,attrType,attrLength,iterator,indexp)
+int fileDesc;
+char attrType;
+int attrLength;
+AM_ITERATOR *iterator;
+AM_INDEX *indexp;
+
+{
+	char value[AM_MAXATTRLENGTH]; /* key from the iterator */
+	char payload[AM_MAXPAYLOAD]; /* its payload */
+	char lastKey[AM_MAXATTRLENGTH]; /* previous key */
+	int recId;
+	AM_RID rid;
+	int wide; /* the iterator returns AM_RIDs */
+	int payloadLength; /* bytes of payload */
+	int haveKey;
+	int got,errVal;
+	int rightSplitPct; /* the caller's AM_RightSplitPct */
+
+	rightSplitPct = AM_RightSplitPct;
+	AM_RightSplitPct = AM_FillFactor;
+	haveKey = FALSE;
+	wide = (indexp->ridLength == AM_sr);
+	payloadLength = indexp->payloadLength;
+	bzero(payload,payloadLength);
+	while ((got = (*iterator->next)(iterator->state,value,
+			wide ? (int *)&rid : &recId,payload)) > 0)
+	{
+		if (haveKey && AM_Compare(lastKey,attrType,attrLength,value) < 0)
+		{
+			got = AME_UNSORTED;
+			break;
+		}
+		if (!wide) rid = recId;
+		errVal = AM_InsertEntryRid(fileDesc,attrType,attrLength,value,
+					   rid,payloadLength > 0 ?
+					   payload : (char *)NULL);
+		if (errVal != AME_OK)
+		{
+			got = errVal;
+			break;
+		}
+		bcopy(value,lastKey,attrLength);
+		haveKey = TRUE;
+	}
+	AM_RightSplitPct = rightSplitPct;
+	if (got < 0)
+	{
+		AM_Errno = got;
+		return(got);
+	}
+	return(AME_OK);
+}
+
+
+/* finishes a bottom-up load: writes the meta page, and sets up the filter
+of the index afresh if it has one, as the loaded keys bypassed it; a load
+by inserts does the same, for the filter to fit the keys loaded */
+static AM_BulkDone(fileDesc,indexp)
+int fileDesc;
+AM_INDEX *indexp;
+
+{
+	int errVal;
+
+	errVal = AM_WriteMeta(fileDesc,indexp);
+	if ((errVal != AME_OK) || (indexp->filterBlocks == 0)) return(errVal);
+	return(AM_BuildFilter(fileDesc,0));
+}
+
+
+/* Builds the tree bottom-up from (key,recId) pairs supplied in sorted order
+by iterator->next. Leaves are filled to AM_FillFactor percent and written
+out in order, then each internal level is built from the one below. The
+index must be empty; the root stays on the page the meta page names. */
+AM_BulkLoad(fileDesc,attrType,attrLength,iterator)
+int fileDesc; /* file Descriptor */
+char attrType; /* 'i' or 'c' or 'f' */
+int attrLength; /* 4 for 'i' or 'f', 1-255 for 'c' */
+AM_ITERATOR *iterator; /* source of sorted (key,recId) pairs */
+
+{
+	char *rootBuf; /* the root page, fixed throughout */
+	char *pageBuf; /* the leaf being filled */
+	int rootNum,pageNum,newPageNum;
+	char *newPageBuf;
+	AM_LEAFHEADER head,*header;
+	AM_BULKENTRY *level,*upper,*temp; /* entries of the level being built
+					     and of the one above it */
+	int numLevel,capLevel,numUpper,capUpper;
+	char value[AM_MAXATTRLENGTH]; /* key from the iterator */
+	char lastKey[AM_MAXATTRLENGTH]; /* previous key */
+	int recId;
+	int haveKey; /* a key has been seen */
+	int maxKeys;
+	int recSize;
+	int budget; /* bytes of a leaf the fill factor lets us use */
+	int need;
+	int keysPerNode;
+	int errVal,got;
+	int newLeaf; /* the current leaf is full */
+	int moveKey; /* the last key moves to the new leaf */
+	int moved[PF_PAGE_SIZE / (AM_si + AM_ss)]; /* its recIds */
+	int numMoved;
+	short nextRec;
+	short null = AM_NULL;
+	AM_INDEX *indexp; /* the open index */
+	int runLength; /* recIds of the last key in its list of nodes */
+	int *post,*grown; /* recIds of the last key gathered for a posting
+			     list */
+	int numPost,capPost;
+
+	/* check the parameters */
+	if ((attrType != 'c') && (attrType != 'f') && (attrType != 'i') &&
+	    (attrType != 'k'))
+		{
+		 AM_Errno = AME_INVALIDATTRTYPE;
+		 return(AME_INVALIDATTRTYPE);
+                }
+
+	if (fileDesc < 0)
+		{
+		 AM_Errno = AME_FD;
+		 return(AME_FD);
+                }
+
+	header = &head;
+
+	indexp = AM_GetIndex(fileDesc);
+	if (indexp == NULL) return(AM_Errno);
+	if (indexp->hashed)
+	{
+		AM_Errno = AME_NOTSUPPORTED;
+		return(AME_NOTSUPPORTED);
+	}
+
+	/* the root must be an empty leaf */
+	rootNum = indexp->rootPageNum;
+	errVal = PF_GetThisPage(fileDesc,rootNum,&rootBuf);
+	AM_Check;
+	bcopy(rootBuf,header,AM_sl);
+	if (!AM_IsLeaf(rootBuf) || header->numKeys != 0)
+	{
+		PF_UnfixPage(fileDesc,rootNum,FALSE);
+		AM_Errno = AME_INDEXNOTEMPTY;
+		return(AME_INDEXNOTEMPTY);
+	}
+	if (header->attrLength != attrLength)
+	{
+		PF_UnfixPage(fileDesc,rootNum,FALSE);
+		AM_Errno = AME_INVALIDATTRLENGTH;
+		return(AME_INVALIDATTRLENGTH);
+	}
+	if (header->pageType == 'L' || header->payloadLength > 0)
+	{
+		errVal = PF_UnfixPage(fileDesc,rootNum,FALSE);
+		AM_Check;
+		errVal = AM_BulkInsert(fileDesc,attrType,attrLength,iterator,
+				       indexp);
+		if ((errVal != AME_OK) || (indexp->filterBlocks == 0))
+			return(errVal);
+		return(AM_BuildFilter(fileDesc,0));
+	}
+	maxKeys = header->maxKeys;
+	recSize = attrLength + AM_ss;
+
+	budget = ((PF_PAGE_SIZE - AM_sl) * AM_FillFactor) / 100;
+	keysPerNode = (maxKeys * AM_FillFactor) / 100;
+	if (keysPerNode < 1) keysPerNode = 1;
+
+	level = upper = NULL;
+	numLevel = capLevel = numUpper = capUpper = 0;
+	haveKey = FALSE;
+	post = NULL;
+	numPost = capPost = runLength = 0;
+
+	/* the first leaf */
+	errVal = PF_AllocPage(fileDesc,&pageNum,&pageBuf);
+	if (errVal != PFE_OK)
+	{
+		PF_UnfixPage(fileDesc,rootNum,FALSE);
+		AM_Errno = AME_PF;
+		return(AME_PF);
+	}
+	AM_BulkInitLeaf(pageBuf,header,attrLength,maxKeys);
+
+	while ((got = (*iterator->next)(iterator->state,value,&recId)) > 0)
+	{
+		if (recId == AM_POSTLIST)
+		{
+			got = AME_INVALIDVALUE;
+			break;
+		}
+
+		/* a repeated key only adds to its recId list, which past
+		AM_PostingMin recIds is gathered for a posting list */
+		if (haveKey && AM_Compare(lastKey,attrType,attrLength,value) == 0)
+		{
+			if (numPost == 0 && (AM_PostingMin <= 0 ||
+			    runLength < AM_PostingMin || runLength < 2))
+				need = AM_si + AM_ss;
+			else
+			{
+				if (numPost + runLength + 1 > capPost)
+				{
+					capPost = 2*(numPost + runLength + 1);
+					grown = (int *)realloc((char *)post,
+							       capPost*AM_si);
+					if (grown == NULL) { got = AME_NOMEM; break; }
+					post = grown;
+				}
+				if (numPost == 0)
+				{
+					/* take the list off the leaf; its nodes
+					are the last made */
+					bcopy(pageBuf + header->keyPtr - AM_ss,
+					      (char *)&nextRec,AM_ss);
+					while (nextRec != AM_NULL)
+					{
+						bcopy(pageBuf + nextRec,
+						      (char *)&post[numPost++],AM_si);
+						bcopy(pageBuf + nextRec + AM_si,
+						      (char *)&nextRec,AM_ss);
+					}
+					header->recIdPtr += runLength*(AM_si + AM_ss);
+					bcopy((char *)&null,pageBuf + header->keyPtr -
+					      AM_ss,AM_ss);
+					runLength = 0;
+				}
+				post[numPost++] = recId;
+				continue;
+			}
+		}
+		else
+		{
+			if (haveKey &&
+			    AM_Compare(lastKey,attrType,attrLength,value) < 0)
+			{
+				got = AME_UNSORTED;
+				break;
+			}
+			if (numPost > 0)
+			{
+				got = AM_PostLoad(fileDesc,pageBuf,header,post,
+						  numPost);
+				if (got < 0) break;
+				numPost = 0;
+			}
+			need = recSize + AM_si + AM_ss;
+			runLength = 0;
+		}
+
+		/* start a new leaf if this one is full; a key whose recId list
+		no longer fits moves to the new leaf with its list */
+		moveKey = FALSE;
+		if (header->numKeys > 0 && need == recSize + AM_si + AM_ss &&
+		   (PF_PAGE_SIZE - header->recIdPtr) +
+		   (header->keyPtr - AM_sl) + need > budget)
+			newLeaf = TRUE;
+		else if (header->recIdPtr - header->keyPtr < need)
+		{
+			if (need == recSize + AM_si + AM_ss || header->numKeys == 1)
+			{
+				/* a single key's list has outgrown a leaf */
+				got = AME_INTERROR;
+				break;
+			}
+			newLeaf = moveKey = TRUE;
+		}
+		else newLeaf = FALSE;
+
+		if (newLeaf)
+		{
+			if (moveKey)
+			{
+				/* the last key's nodes are the newest, so they lie
+				together at the bottom of the recId area */
+				numMoved = 0;
+				bcopy(pageBuf + header->keyPtr - AM_ss,
+				      (char *)&nextRec,AM_ss);
+				while (nextRec != AM_NULL)
+				{
+					bcopy(pageBuf + nextRec,
+					      (char *)&moved[numMoved++],AM_si);
+					bcopy(pageBuf + nextRec + AM_si,
+					      (char *)&nextRec,AM_ss);
+				}
+				header->recIdPtr += numMoved * (AM_si + AM_ss);
+				header->keyPtr -= recSize;
+				header->numKeys--;
+			}
+			errVal = PF_AllocPage(fileDesc,&newPageNum,&newPageBuf);
+			if (errVal != PFE_OK) { got = AME_PF; break; }
+			header->nextLeafPage = newPageNum;
+			bcopy(header,pageBuf,AM_sl);
+			errVal = AM_BulkAppend(&level,&numLevel,&capLevel,pageNum,
+					       pageBuf + AM_sl,attrLength);
+			if (errVal != AME_OK) { got = errVal; break; }
+			errVal = PF_UnfixPage(fileDesc,pageNum,TRUE);
+			if (errVal != PFE_OK) { got = AME_PF; break; }
+			AM_BulkInitLeaf(newPageBuf,header,attrLength,maxKeys);
+			header->prevLeafPage = pageNum;
+			bcopy(header,newPageBuf,AM_sl);
+			pageNum = newPageNum;
+			pageBuf = newPageBuf;
+			if (moveKey)
+			{
+				/* rebuild the list in its original order */
+				bcopy(lastKey,pageBuf + header->keyPtr,attrLength);
+				bcopy((char *)&null,pageBuf + header->keyPtr +
+				      attrLength,AM_ss);
+				header->keyPtr += recSize;
+				header->numKeys++;
+				while (numMoved > 0)
+					AM_InsertToLeafFound(pageBuf,moved[--numMoved],
+							     1,header,(char *)NULL);
+			}
+		}
+
+		if (need != AM_si + AM_ss)
+		{
+			/* a new key with an empty list */
+			bcopy(value,pageBuf + header->keyPtr,attrLength);
+			bcopy((char *)&null,pageBuf + header->keyPtr + attrLength,
+			      AM_ss);
+			header->keyPtr += recSize;
+			header->numKeys++;
+		}
+		AM_InsertToLeafFound(pageBuf,recId,header->numKeys,header,
+				     (char *)NULL);
+		bcopy(header,pageBuf,AM_sl);
+		runLength++;
+
+		bcopy(value,lastKey,attrLength);
+		haveKey = TRUE;
+	}
+	if (got == 0 && numPost > 0)
+		got = AM_PostLoad(fileDesc,pageBuf,header,post,numPost);
+	free(post);
+
+	if (got < 0)
+	{
+		PF_UnfixPage(fileDesc,pageNum,TRUE);
+		PF_UnfixPage(fileDesc,rootNum,FALSE);
+		free(level);
+		AM_Errno = got;
+		return(got);
+	}
+
+	/* the last leaf */
+	errVal = AM_BulkAppend(&level,&numLevel,&capLevel,pageNum,
+			       pageBuf + AM_sl,attrLength);
+	if (numLevel == 1)
+	{
+		/* everything fits in one leaf: it becomes the root */
+		bcopy(pageBuf,rootBuf,PF_PAGE_SIZE);
+		errVal = PF_UnfixPage(fileDesc,pageNum,FALSE);
+		AM_Check;
+		errVal = PF_DisposePage(fileDesc,pageNum);
+		AM_Check;
+		free(level);
+		errVal = PF_UnfixPage(fileDesc,rootNum,TRUE);
+		AM_Check;
+		indexp->leftPageNum = rootNum;
+		indexp->rightPageNum = rootNum;
+		indexp->height = 1;
+		return(AM_BulkDone(fileDesc,indexp));
+	}
+	errVal = PF_UnfixPage(fileDesc,pageNum,TRUE);
+	AM_Check;
+	indexp->leftPageNum = level[0].pageNum;
+	indexp->rightPageNum = pageNum;
+	indexp->height = 1;
+
+	/* internal levels, until one node (the root) remains */
+	while (numLevel > 1)
+	{
+		errVal = AM_BulkBuildLevel(fileDesc,level,numLevel,&upper,
+				&numUpper,&capUpper,attrLength,keysPerNode,
+				maxKeys,rootNum,rootBuf);
+		if (errVal != AME_OK)
+		{
+			PF_UnfixPage(fileDesc,rootNum,TRUE);
+			free(level); free(upper);
+			AM_Errno = errVal;
+			return(errVal);
+		}
+		indexp->height++;
+		temp = level; level = upper; upper = temp;
+		numLevel = numUpper;
+		errVal = capLevel; capLevel = capUpper; capUpper = errVal;
+	}
+
+	free(level); free(upper);
+	errVal = PF_UnfixPage(fileDesc,rootNum,TRUE);
+	AM_Check;
+	return(AM_BulkDone(fileDesc,indexp));
+}
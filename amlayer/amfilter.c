@@ -0,0 +1,437 @@
+# include <stdio.h>
+# include <stdlib.h>
+# include "am.h"
+# include "pf.h"
+
+/* Bloom filters of B+ tree indexes, which let an equality lookup of a key
+that is not in the index stop before the descent from the root. A filter
+is blocked: a key's hash picks one block of AM_FILTERBLOCK bytes and sets
+filterProbes bits in it, so that a lookup tests a single cache line. The
+blocks live on a chain of 'F' pages whose first page is in the meta page,
+and in memory, in the index's AM_INDEX entry, while the index is open. An
+insert sets its key's bits in memory only, so the filter stays right as
+the index grows, though its false positives grow too, and AM_CloseIndex
+writes the blocks back to their pages. Until it does, the meta page calls
+the filter stale: the first insert that sets bits in a filter just read or
+written has its caller write the meta page, so that a file closed with
+PF_CloseFile, or reopened under the same descriptor, has its filter dropped
+by AM_GetIndex rather than rule out the keys inserted since. Bits are set with an atomic OR and read with acquire loads, so a
+lookup of AM_LookupLatched sees the bits of every key it can find, with no
+latch on the filter. Deletes leave the bits set.
+AM_BuildFilter sizes a filter for the keys an index has and sets their
+bits afresh; AM_BulkLoad calls it when the index has a filter. */
+
+
+/* Returns the block of a key whose hash is h in the filter of indexp and
+stores the bits it sets in that block at bits */
+static AM_FilterProbe(indexp,h,bits)
+AM_INDEX *indexp;
+unsigned int h;
+int *bits; /* room for filterProbes */
+
+{
+	unsigned int g,step;
+	int i;
+
+	/* the high bits pick the block, a remix of them the bits in it */
+	g = h*0x9e3779b1u;
+	g ^= g >> 15;
+	g *= 0x2c1b3c6du;
+	g ^= g >> 12;
+	step = (g >> 16) | 1;
+	for (i = 0; i < indexp->filterProbes; i++)
+		bits[i] = (g + i*step) % (AM_FILTERBLOCK*8);
+	return((int)(((unsigned long long)h*indexp->filterBlocks) >> 32));
+}
+
+
+/* TRUE if value is surely not a key of the index indexp: it has a filter,
+and one of the bits of value is clear in it */
+AM_FilterMiss(indexp,attrType,attrLength,value)
+AM_INDEX *indexp;
+char attrType;
+int attrLength;
+char *value;
+
+{
+	int bits[AM_MAXPROBES];
+	unsigned char *block;
+	int i;
+
+	if (indexp->filterBlocks == 0) return(FALSE);
+	block = indexp->filter + AM_FILTERBLOCK*AM_FilterProbe(indexp,
+			AM_HashValue(attrType,attrLength,value),bits);
+	for (i = 0; i < indexp->filterProbes; i++)
+		if (!(__atomic_load_n(&block[bits[i] >> 3],__ATOMIC_ACQUIRE) &
+		      (1 << (bits[i] & 7))))
+			return(TRUE);
+	return(FALSE);
+}
+
+
+/* Sets the bits of value in the filter of an index, if it has one, in
+memory; AM_FilterFlush writes them to its pages. Returns TRUE if this
+made the filter dirty, and the caller must then write the meta page with
+AM_WriteMeta to mark the filter stale, else AME_OK. Threads of
+AM_InsertEntryLatched may call it at once: one of them gets TRUE */
+AM_FilterAdd(indexp,attrType,attrLength,value)
+AM_INDEX *indexp;
+char attrType;
+int attrLength;
+char *value;
+
+{
+	int bits[AM_MAXPROBES];
+	unsigned char *block;
+	int i;
+
+	if (indexp->filterBlocks == 0) return(AME_OK);
+	block = indexp->filter + AM_FILTERBLOCK*AM_FilterProbe(indexp,
+			AM_HashValue(attrType,attrLength,value),bits);
+	for (i = 0; i < indexp->filterProbes; i++)
+		__atomic_fetch_or(&block[bits[i] >> 3],1 << (bits[i] & 7),
+				  __ATOMIC_RELEASE);
+	if (__atomic_load_n(&indexp->filterDirty,__ATOMIC_RELAXED))
+		return(AME_OK);
+	return(__atomic_exchange_n(&indexp->filterDirty,TRUE,__ATOMIC_RELAXED) ?
+	       AME_OK : TRUE);
+}
+
+
+/* Writes the blocks of the filter of an index to its pages, if inserts
+changed them since they were last written, and the meta page that says
+they are current */
+AM_FilterFlush(fileDesc,indexp)
+int fileDesc;
+AM_INDEX *indexp;
+
+{
+	char *pageBuf;
+	int numPages;
+	int i,num;
+	int errVal;
+
+	if ((indexp->filterBlocks == 0) || !indexp->filterDirty)
+		return(AME_OK);
+	numPages = (indexp->filterBlocks + AM_FILTERPERPAGE - 1)/
+		   AM_FILTERPERPAGE;
+	for (i = 0; i < numPages; i++)
+	{
+		errVal = PF_GetThisPage(fileDesc,indexp->filterPages[i],&pageBuf);
+		AM_Check;
+		num = (i == numPages - 1) ?
+		      indexp->filterBlocks - i*AM_FILTERPERPAGE : AM_FILTERPERPAGE;
+		bcopy((char *)(indexp->filter + i*AM_FILTERPERPAGE*AM_FILTERBLOCK),
+		      pageBuf + AM_sfh,num*AM_FILTERBLOCK);
+		errVal = PF_UnfixPage(fileDesc,indexp->filterPages[i],TRUE);
+		AM_Check;
+	}
+	indexp->filterDirty = FALSE;
+	return(AM_WriteMeta(fileDesc,indexp));
+}
+
+
+/* Reads the filter of an index, numBlocks blocks on the pages chained from
+firstPage, into its entry index */
+AM_FilterLoad(fileDesc,index,firstPage,numBlocks,probes)
+int fileDesc;
+AM_INDEX *index;
+int firstPage;
+int numBlocks;
+int probes;
+
+{
+	AM_FILTERHEADER head;
+	char *pageBuf;
+	int numPages;
+	int pageNum;
+	int i,num;
+
+	if ((probes < 1) || (probes > AM_MAXPROBES))
+	{
+		AM_Errno = AME_NOTINDEX;
+		return(AME_NOTINDEX);
+	}
+	numPages = (numBlocks + AM_FILTERPERPAGE - 1)/AM_FILTERPERPAGE;
+	index->filter = (unsigned char *)malloc(numBlocks*AM_FILTERBLOCK);
+	index->filterPages = (int *)malloc(numPages*AM_si);
+	if ((index->filter == NULL) || (index->filterPages == NULL))
+	{
+		AM_Errno = AME_NOMEM;
+		return(AME_NOMEM);
+	}
+
+	pageNum = firstPage;
+	for (i = 0; i < numPages; i++)
+	{
+		if ((pageNum == AM_NULL_PAGE) ||
+		    (PF_GetThisPage(fileDesc,pageNum,&pageBuf) != PFE_OK))
+		{
+			AM_Errno = AME_PF;
+			return(AME_PF);
+		}
+		bcopy(pageBuf,&head,AM_sfh);
+		num = (i == numPages - 1) ? numBlocks - i*AM_FILTERPERPAGE :
+					    AM_FILTERPERPAGE;
+		bcopy(pageBuf + AM_sfh,
+		      (char *)(index->filter + i*AM_FILTERPERPAGE*AM_FILTERBLOCK),
+		      num*AM_FILTERBLOCK);
+		index->filterPages[i] = pageNum;
+		PF_UnfixPage(fileDesc,pageNum,FALSE);
+		if (head.pageType != 'F')
+		{
+			AM_Errno = AME_NOTINDEX;
+			return(AME_NOTINDEX);
+		}
+		pageNum = head.nextPage;
+	}
+	index->filterBlocks = numBlocks;
+	index->filterProbes = probes;
+	index->filterPage = firstPage;
+	index->filterDirty = FALSE;
+	return(AME_OK);
+}
+
+
+/* frees the pages of the filter of an index and forgets it, in memory; the
+caller writes the meta page */
+AM_FilterFree(fileDesc,indexp)
+int fileDesc;
+AM_INDEX *indexp;
+
+{
+	int numPages;
+	int i;
+	int errVal;
+
+	numPages = (indexp->filterBlocks + AM_FILTERPERPAGE - 1)/
+		   AM_FILTERPERPAGE;
+	for (i = 0; i < numPages; i++)
+	{
+		errVal = PF_DisposePage(fileDesc,indexp->filterPages[i]);
+		AM_Check;
+	}
+	if (indexp->filter != NULL) free((char *)indexp->filter);
+	if (indexp->filterPages != NULL) free((char *)indexp->filterPages);
+	indexp->filter = NULL;
+	indexp->filterPages = NULL;
+	indexp->filterBlocks = 0;
+	indexp->filterProbes = 0;
+	indexp->filterPage = AM_NULL_PAGE;
+	indexp->filterDirty = FALSE;
+	return(AME_OK);
+}
+
+
+/* checks that an index can have a filter, returning it or NULL with
+AM_Errno set */
+static AM_INDEX *AM_FilterIndex(fileDesc)
+int fileDesc;
+
+{
+	AM_INDEX *indexp;
+
+	indexp = AM_GetIndex(fileDesc);
+	if (indexp == NULL) return(NULL);
+
+	/* a legacy file has no meta page to keep it in, and a hash index
+	reads a single bucket anyway */
+	if (!indexp->hasMeta || indexp->hashed)
+	{
+		AM_Errno = AME_NOTSUPPORTED;
+		return(NULL);
+	}
+	return(indexp);
+}
+
+
+/* Gives the index fileDesc a Bloom filter, or a new one in place of the
+one it has, of AM_FilterBitsPerKey bits for each of numKeys keys, or of the
+keys the index has if there are more, with the bits of all those keys
+set. Open scans of the index are not disturbed */
+AM_BuildFilter(fileDesc,numKeys)
+int fileDesc;
+int numKeys; /* keys the filter is for, 0 for those of the index */
+
+{
+	AM_INDEX *indexp;
+	AM_FILTERHEADER head;
+	int *recIds;
+	char *keys;
+	char last[AM_MAXATTRLENGTH]; /* the last key counted */
+	int haveLast;
+	unsigned int *hashes; /* of the distinct keys */
+	int numHashes,maxHashes;
+	int scanDesc;
+	int got;
+	int bitsPerKey;
+	long bits;
+	unsigned int *more;
+	int numBlocks,numPages;
+	int probe[AM_MAXPROBES];
+	unsigned char *block;
+	char *pageBuf;
+	int pageNum;
+	int i,j;
+	int errVal;
+
+	indexp = AM_FilterIndex(fileDesc);
+	if (indexp == NULL) return(AM_Errno);
+	if (numKeys < 0)
+	{
+		AM_Errno = AME_INVALIDVALUE;
+		return(AME_INVALIDVALUE);
+	}
+
+	/* the distinct keys of the index, in order, kept as hashes */
+	recIds = (int *)malloc(AM_MAXPOSTRIDS*AM_si);
+	keys = malloc(AM_MAXPOSTRIDS*indexp->attrLength);
+	maxHashes = AM_MAXPOSTRIDS;
+	hashes = (unsigned int *)malloc(maxHashes*AM_si);
+	if ((recIds == NULL) || (keys == NULL) || (hashes == NULL))
+	{
+		if (recIds != NULL) free((char *)recIds);
+		if (keys != NULL) free(keys);
+		if (hashes != NULL) free((char *)hashes);
+		AM_Errno = AME_NOMEM;
+		return(AME_NOMEM);
+	}
+	numHashes = 0;
+	haveLast = FALSE;
+	scanDesc = AM_OpenIndexScan(fileDesc,indexp->attrType,indexp->attrLength,
+				    ALL,(char *)NULL);
+	errVal = scanDesc;
+	while ((scanDesc >= 0) &&
+	       ((got = AM_FindNextEntries(scanDesc,recIds,keys,
+					  AM_MAXPOSTRIDS)) > 0))
+	{
+		for (i = 0; i < got; i++)
+		{
+			if (haveLast &&
+			    (AM_Compare(last,indexp->attrType,indexp->attrLength,
+					keys + i*indexp->attrLength) == 0))
+				continue;
+			if (numHashes == maxHashes)
+			{
+				more = (unsigned int *)realloc((char *)hashes,
+							   2*maxHashes*AM_si);
+				if (more == NULL)
+				{
+					got = AME_NOMEM;
+					break;
+				}
+				hashes = more;
+				maxHashes *= 2;
+			}
+			hashes[numHashes++] = AM_HashValue(indexp->attrType,
+				indexp->attrLength,keys + i*indexp->attrLength);
+			bcopy(keys + i*indexp->attrLength,last,indexp->attrLength);
+			haveLast = TRUE;
+		}
+		if (got < 0) break;
+	}
+	if (scanDesc >= 0)
+	{
+		errVal = (got == AME_EOF) ? AME_OK : got;
+		AM_CloseIndexScan(scanDesc);
+	}
+	free((char *)recIds);
+	free(keys);
+	if (errVal < 0)
+	{
+		free((char *)hashes);
+		AM_Errno = errVal;
+		return(errVal);
+	}
+
+	/* sized for the keys, a page at least; a probe per 0.69 bits a key */
+	if (numKeys < numHashes) numKeys = numHashes;
+	bitsPerKey = (AM_FilterBitsPerKey < 1) ? 1 : AM_FilterBitsPerKey;
+	bits = (long)numKeys*bitsPerKey;
+	numBlocks = (bits + AM_FILTERBLOCK*8 - 1)/(AM_FILTERBLOCK*8);
+	if (numBlocks < AM_FILTERPERPAGE) numBlocks = AM_FILTERPERPAGE;
+	numPages = (numBlocks + AM_FILTERPERPAGE - 1)/AM_FILTERPERPAGE;
+
+	/* the old filter goes, and the new one is made in memory */
+	if (indexp->filterBlocks > 0)
+	{
+		errVal = AM_FilterFree(fileDesc,indexp);
+		if (errVal != AME_OK)
+		{
+			free((char *)hashes);
+			return(errVal);
+		}
+	}
+	indexp->filter = (unsigned char *)calloc(numBlocks,AM_FILTERBLOCK);
+	indexp->filterPages = (int *)malloc(numPages*AM_si);
+	if ((indexp->filter == NULL) || (indexp->filterPages == NULL))
+	{
+		free((char *)hashes);
+		AM_Errno = AME_NOMEM;
+		return(AME_NOMEM);
+	}
+	indexp->filterBlocks = numBlocks;
+	indexp->filterProbes = (bitsPerKey*69 + 50)/100;
+	if (indexp->filterProbes < 1) indexp->filterProbes = 1;
+	if (indexp->filterProbes > AM_MAXPROBES)
+		indexp->filterProbes = AM_MAXPROBES;
+	for (i = 0; i < numHashes; i++)
+	{
+		block = indexp->filter + AM_FILTERBLOCK*
+			AM_FilterProbe(indexp,hashes[i],probe);
+		for (j = 0; j < indexp->filterProbes; j++)
+			block[probe[j] >> 3] |= 1 << (probe[j] & 7);
+	}
+	free((char *)hashes);
+
+	/* its pages, allocated first so that each can name the next */
+	for (i = 0; i < numPages; i++)
+	{
+		errVal = PF_AllocPage(fileDesc,&indexp->filterPages[i],&pageBuf);
+		if (errVal == PFE_OK)
+			errVal = PF_UnfixPage(fileDesc,indexp->filterPages[i],TRUE);
+		if (errVal != PFE_OK)
+		{
+			/* no filter rather than half of one */
+			indexp->filterBlocks = 0;
+			AM_Errno = AME_PF;
+			return(AME_PF);
+		}
+	}
+	for (i = 0; i < numPages; i++)
+	{
+		pageNum = indexp->filterPages[i];
+		errVal = PF_GetThisPage(fileDesc,pageNum,&pageBuf);
+		AM_Check;
+		head.pageType = 'F';
+		head.nextPage = (i < numPages - 1) ? indexp->filterPages[i + 1] :
+						     AM_NULL_PAGE;
+		bcopy(&head,pageBuf,AM_sfh);
+		j = (i == numPages - 1) ? numBlocks - i*AM_FILTERPERPAGE :
+					  AM_FILTERPERPAGE;
+		bcopy((char *)(indexp->filter + i*AM_FILTERPERPAGE*AM_FILTERBLOCK),
+		      pageBuf + AM_sfh,j*AM_FILTERBLOCK);
+		errVal = PF_UnfixPage(fileDesc,pageNum,TRUE);
+		AM_Check;
+	}
+	indexp->filterPage = indexp->filterPages[0];
+	indexp->filterDirty = FALSE;
+	return(AM_WriteMeta(fileDesc,indexp));
+}
+
+
+/* Removes the Bloom filter of an index, freeing its pages */
+AM_DropFilter(fileDesc)
+int fileDesc;
+
+{
+	AM_INDEX *indexp;
+	int errVal;
+
+	indexp = AM_FilterIndex(fileDesc);
+	if (indexp == NULL) return(AM_Errno);
+	if (indexp->filterBlocks == 0) return(AME_OK);
+	errVal = AM_FilterFree(fileDesc,indexp);
+	if (errVal != AME_OK) return(errVal);
+	return(AM_WriteMeta(fileDesc,indexp));
+}
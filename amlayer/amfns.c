@@ -2,6 +2,10 @@
 # include "pf.h"
 # include "am.h"
 
+static AM_MakeIndex();
+static AM_CreatePayloadIndex();
+static AM_InsertNode();
+
 
 
 /* Creates a secondary idex file called fileName.indexNo */
@@ -11,17 +15,23 @@ int indexNo;/*number of this index for file */
 char attrType;/* 'c' for char ,'i' for int ,'f' for float */
 int attrLength; /* 4 for 'i' or 'f', 1-255 for 'c' */
 
-
 {
-	char *pageBuf; /* buffer for holding a page */
-	char indexfName[AM_MAX_FNAME_LENGTH]; /* String to store the indexed
-					 files name with extension           */
-	int pageNum; /* page number of the root page(also the first page) */
-	int fileDesc; /* file Descriptor */
-	int errVal;
-	int maxKeys;/* Maximum keys that can be held on one internal page */
-	AM_LEAFHEADER head,*header;
+	return(AM_CreateIndexEx(fileName,indexNo,attrType,attrLength,
+				AM_FMT_FIXED));
+}
+
+
+/* Creates an index whose pages store keys in format: AM_FMT_FIXED, or
+AM_FMT_VAR for 'c' keys kept at their own length (see amvar.c) */
+AM_CreateIndexEx(fileName,indexNo,attrType,attrLength,format)
+char *fileName;/* Name of indexed file */
+int indexNo;/*number of this index for file */
+char attrType;/* 'c' for char ,'i' for int ,'f' for float */
+int attrLength; /* 4 for 'i' or 'f', 1-255 for 'c' */
+int format; /* AM_FMT_FIXED or AM_FMT_VAR */
+
 
+{
 	/* Check the parameters */
 	if ((attrType != 'c') && (attrType != 'f') && (attrType != 'i'))
 		{
@@ -41,7 +51,151 @@ int attrLength; /* 4 for 'i' or 'f', 1-255 for 'c' */
 			 AM_Errno = AME_INVALIDATTRLENGTH;
 			 return(AME_INVALIDATTRLENGTH);
                         }
-	
+
+	if ((format != AM_FMT_FIXED) && (format != AM_FMT_VAR))
+		{
+		 AM_Errno = AME_INVALIDVALUE;
+		 return(AME_INVALIDVALUE);
+		}
+
+	if ((format == AM_FMT_VAR) && (attrType != 'c'))
+		{
+		 AM_Errno = AME_INVALIDATTRTYPE;
+		 return(AME_INVALIDATTRTYPE);
+		}
+
+	return(AM_MakeIndex(fileName,indexNo,attrType,attrLength,format,
+			    (AM_KEYDESC *)NULL,0,AM_si));
+}
+
+
+/* Creates a covering index: each entry also stores payloadLength bytes of
+other columns of its record, given to AM_InsertEntryPayload and returned by
+AM_FindNextEntryPayload, so that a scan needing only those columns does not
+fetch the records */
+AM_CreateCoveringIndex(fileName,indexNo,attrType,attrLength,payloadLength)
+char *fileName;/* Name of indexed file */
+int indexNo;/*number of this index for file */
+char attrType;/* 'c' for char ,'i' for int ,'f' for float */
+int attrLength; /* 4 for 'i' or 'f', 1-255 for 'c' */
+int payloadLength; /* bytes stored with each recId */
+
+{
+	if (payloadLength < 1)
+		{
+		 AM_Errno = AME_INVALIDVALUE;
+		 return(AME_INVALIDVALUE);
+		}
+	return(AM_CreatePayloadIndex(fileName,indexNo,attrType,attrLength,
+				     payloadLength,AM_si));
+}
+
+
+/* Creates a wide index, whose recIds are AM_RIDs rather than ints: heap
+files of more than 65536 pages need them. It is also covering if
+payloadLength is not 0. Entries go in with AM_InsertEntryRid and come back
+from AM_FindNextRid */
+AM_CreateWideIndex(fileName,indexNo,attrType,attrLength,payloadLength)
+char *fileName;/* Name of indexed file */
+int indexNo;/*number of this index for file */
+char attrType;/* 'c' for char ,'i' for int ,'f' for float */
+int attrLength; /* 4 for 'i' or 'f', 1-255 for 'c' */
+int payloadLength; /* bytes stored with each recId, may be 0 */
+
+{
+	return(AM_CreatePayloadIndex(fileName,indexNo,attrType,attrLength,
+				     payloadLength,AM_sr));
+}
+
+
+/* checks the parameters of a covering or wide index and creates it */
+static AM_CreatePayloadIndex(fileName,indexNo,attrType,attrLength,
+			     payloadLength,ridLength)
+char *fileName;
+int indexNo;
+char attrType;
+int attrLength;
+int payloadLength;
+int ridLength; /* AM_si or AM_sr */
+
+{
+	if ((attrType != 'c') && (attrType != 'f') && (attrType != 'i'))
+		{
+		 AM_Errno = AME_INVALIDATTRTYPE;
+		 return(AME_INVALIDATTRTYPE);
+                 }
+
+	if ((attrLength < 1) || (attrLength > 255) ||
+	    ((attrLength != 4) && (attrType != 'c')))
+		{
+		 AM_Errno = AME_INVALIDATTRLENGTH;
+		 return(AME_INVALIDATTRLENGTH);
+                }
+
+	/* a leaf must still hold a few entries of new keys */
+	if ((payloadLength < 0) || (payloadLength > AM_MAXPAYLOAD) ||
+	    4*(attrLength + AM_ss + ridLength + AM_ss + payloadLength) >
+	    PF_PAGE_SIZE - AM_sl)
+		{
+		 AM_Errno = AME_INVALIDVALUE;
+		 return(AME_INVALIDVALUE);
+		}
+
+	return(AM_MakeIndex(fileName,indexNo,attrType,attrLength,AM_FMT_FIXED,
+			    (AM_KEYDESC *)NULL,payloadLength,ridLength));
+}
+
+
+/* Creates an index on several columns. Its keys are 'k' keys: the columns
+encoded by AM_EncodeKey into one string that compares with memcmp (see
+amkey.c) */
+AM_CreateCompositeIndex(fileName,indexNo,keyDesc)
+char *fileName;/* Name of indexed file */
+int indexNo;/*number of this index for file */
+AM_KEYDESC *keyDesc; /* the columns, leading first */
+
+{
+	int attrLength;
+
+	attrLength = AM_KeyLength(keyDesc,keyDesc == NULL ? 0 :
+				  keyDesc->numCols);
+	if (attrLength < 0) return(attrLength);
+	if (attrLength > 255)
+		{
+		 AM_Errno = AME_INVALIDATTRLENGTH;
+		 return(AME_INVALIDATTRLENGTH);
+                }
+	return(AM_MakeIndex(fileName,indexNo,'k',attrLength,AM_FMT_FIXED,
+			    keyDesc,0,AM_si));
+}
+
+
+/* creates the file of an index with checked parameters */
+static AM_MakeIndex(fileName,indexNo,attrType,attrLength,format,keyDesc,
+		   payloadLength,ridLength)
+char *fileName;/* Name of indexed file */
+int indexNo;/*number of this index for file */
+char attrType;
+int attrLength;
+int format; /* AM_FMT_FIXED or AM_FMT_VAR */
+AM_KEYDESC *keyDesc; /* columns of a 'k' key, else NULL */
+int payloadLength; /* bytes stored with each recId, fixed format only */
+int ridLength; /* AM_si, or AM_sr for AM_RIDs; fixed format only */
+
+{
+	char *pageBuf; /* buffer for holding a page */
+	char indexfName[AM_MAX_FNAME_LENGTH]; /* String to store the indexed
+					 files name with extension           */
+	int pageNum; /* page number of the root page */
+	int metaPageNum; /* page number of the meta page */
+	char *metaBuf;
+	AM_METAPAGE meta;
+	int fileDesc; /* file Descriptor */
+	int errVal;
+	int maxKeys;/* Maximum keys that can be held on one internal page */
+	AM_LEAFHEADER head,*header;
+	AM_VLEAFHEADER vhead;
+
 	header = &head;
 	
 	/* Get the filename with extension and create a paged file by that name*/
@@ -57,6 +211,10 @@ int attrLength; /* 4 for 'i' or 'f', 1-255 for 'c' */
 	   return(AME_PF);
           }
 
+	/* allocate the meta page; it is filled in once the root exists */
+	errVal = PF_AllocPage(fileDesc,&metaPageNum,&metaBuf);
+	AM_Check;
+
 	/* allocate a new page for the root */
 	errVal = PF_AllocPage(fileDesc,&pageNum,&pageBuf);
 	AM_Check;
@@ -64,12 +222,14 @@ int attrLength; /* 4 for 'i' or 'f', 1-255 for 'c' */
 	/* initialise the header */
 	header->pageType = 'l';
 	header->nextLeafPage = AM_NULL_PAGE;
+	header->prevLeafPage = AM_NULL_PAGE;
 	header->recIdPtr = PF_PAGE_SIZE;
 	header->keyPtr = AM_sl;
 	header->freeListPtr = AM_NULL;
 	header->numinfreeList = 0;
 	header->attrLength = attrLength;
 	header->numKeys = 0;
+	header->payloadLength = (ridLength - AM_si) + payloadLength;
 	/* the maximum keys in an internal node- has to be even always*/
 	maxKeys = (PF_PAGE_SIZE - AM_sint - AM_si)/(AM_si + attrLength);
 	if (( maxKeys % 2) != 0) 
@@ -78,16 +238,47 @@ int attrLength; /* 4 for 'i' or 'f', 1-255 for 'c' */
 		header->maxKeys = maxKeys;
 	/* copy the header onto the page */
 	bcopy(header,pageBuf,AM_sl);
+
+	if (format == AM_FMT_VAR)
+	{
+		/* an empty var leaf: no prefix and no slots */
+		header->pageType = 'L';
+		header->keyPtr = AM_svl;
+		header->maxKeys = 0;
+		bcopy(header,&vhead.h,AM_sl);
+		vhead.prefixLen = 0;
+		vhead.garbage = 0;
+		bcopy(&vhead,pageBuf,AM_svl);
+	}
 	
 	errVal = PF_UnfixPage(fileDesc,pageNum,TRUE);
 	AM_Check;
+
+	/* the root is also the leftmost leaf of a one level tree */
+	meta.pageType = 'm';
+	meta.magic = AM_META_MAGIC;
+	meta.rootPageNum = pageNum;
+	meta.leftPageNum = pageNum;
+	meta.height = 1;
+	meta.attrType = attrType;
+	meta.attrLength = attrLength;
+	bzero((char *)&meta.keyDesc,sizeof(AM_KEYDESC));
+	if (keyDesc != NULL)
+		meta.keyDesc = *keyDesc;
+	meta.payloadLength = payloadLength;
+	meta.ridLength = ridLength;
+	meta.filterMagic = AM_FILTER_MAGIC;
+	meta.filterPage = AM_NULL_PAGE;
+	meta.filterBlocks = 0;
+	meta.filterProbes = 0;
+	bcopy(&meta,metaBuf,sizeof(AM_METAPAGE));
+
+	errVal = PF_UnfixPage(fileDesc,metaPageNum,TRUE);
+	AM_Check;
 	
 	/* Close the file */
 	errVal = PF_CloseFile(fileDesc);
 	AM_Check;
-	
-	/* initialise the root page and the leftmost page numbers */
-	AM_RootPageNum = pageNum;
 	return(AME_OK);
 }
 
@@ -117,6 +308,20 @@ int attrLength; /* 4 for 'i' or 'f' , 1-255 for 'c' */
 char *value;/* Value of key whose corr recId is to be deleted */
 int recId; /* id of the record to delete */
 
+{
+	return(AM_DeleteEntryRid(fileDesc,attrType,attrLength,value,
+				 (AM_RID)recId));
+}
+
+
+/* AM_DeleteEntry for a recId of a wide index */
+AM_DeleteEntryRid(fileDesc,attrType,attrLength,value,rid)
+int fileDesc; /* file Descriptor */
+char attrType; /* 'c' , 'i' or 'f' */
+int attrLength; /* 4 for 'i' or 'f' , 1-255 for 'c' */
+char *value;/* Value of key whose corr recId is to be deleted */
+AM_RID rid; /* id of the record to delete */
+
 {
 	char *pageBuf;/* buffer to hold the page */
 	int pageNum; /* page Number of the page in buffer */
@@ -128,14 +333,18 @@ int recId; /* id of the record to delete */
 	char *currRecPtr;/* pointer to the current record in the list */
 	AM_LEAFHEADER head,*header;/* header of the page */
 	int recSize; /* length of key,ptr pair for a leaf */
-	int tempRec; /* holds the recId of the current record */
 	int errVal; /* holds the return value of functions called within 
 				                            this function */
 	int i; /* loop index */
+	AM_INDEX *indexp; /* the open index */
+	AM_STACK stack; /* path from the root to the leaf */
+	int listPage; /* first page of the key's posting list */
+	int empty; /* the posting list lost its last recId */
 
 
 	/* check the parameters */
-	if ((attrType != 'c') && (attrType != 'f') && (attrType != 'i'))
+	if ((attrType != 'c') && (attrType != 'f') && (attrType != 'i') &&
+	    (attrType != 'k'))
 		{
 		 AM_Errno = AME_INVALIDATTRTYPE;
 		 return(AME_INVALIDATTRTYPE);
@@ -153,17 +362,38 @@ int recId; /* id of the record to delete */
 		 return(AME_FD);
                 }
 
+	indexp = AM_GetIndex(fileDesc);
+	if (indexp == NULL) return(AM_Errno);
+
+	/* a narrow index holds only recIds that fit an int */
+	if ((indexp->ridLength != AM_sr) && (rid != (int)rid))
+		{
+		 AM_Errno = AME_NOTFOUND;
+		 return(AME_NOTFOUND);
+                }
+	if (indexp->hashed)
+		return(AM_HashDelete(fileDesc,attrType,attrLength,value,(int)rid));
+
+	/* a key the filter rules out is not there to delete */
+	if (AM_FilterMiss(indexp,attrType,attrLength,value))
+	{
+		AM_Errno = AME_NOTFOUND;
+		return(AME_NOTFOUND);
+	}
+
 	/* initialise the header */
 	header = &head;
 	
 	/* find the pagenumber and the index of the key to be deleted if it is
 	there */
+	AM_InitStack(&stack);
 	status = AM_Search(fileDesc,attrType,attrLength,value,&pageNum,
-			   &pageBuf,&index);
+			   &pageBuf,&index,&stack);
 	
 	/* check if return value is an error */
 	if (status < 0) 
 		{
+		 AM_EmptyStack(&stack);
 		 AM_Errno = status;
 		 return(status);
                 }
@@ -171,22 +401,52 @@ int recId; /* id of the record to delete */
 	/* The key is not in the tree */
 	if (status == AM_NOT_FOUND) 
 		{
+		 PF_UnfixPage(fileDesc,pageNum,FALSE);
+		 AM_EmptyStack(&stack);
 		 AM_Errno = AME_NOTFOUND;
 		 return(AME_NOTFOUND);
                 }
 	
+	if (*pageBuf == 'L')
+	{
+		errVal = AM_VarDeleteFromLeaf(pageBuf,index,(int)rid);
+		PF_UnfixPage(fileDesc,pageNum,errVal == AME_OK);
+		AM_EmptyStack(&stack);
+		AM_Errno = errVal;
+		return(errVal);
+	}
+
 	bcopy(pageBuf,header,AM_sl);
 	recSize = attrLength + AM_ss;
 	currRecPtr = pageBuf + AM_sl + (index - 1)*recSize + attrLength;
 	bcopy(currRecPtr,&nextRec,AM_ss);
+
+	/* a posting list is searched in its pages; the leaf changes only when
+	the list empties, and its two nodes go to the free list */
+	listPage = AM_PostList(pageBuf,nextRec);
+	if (listPage != AM_NULL_PAGE)
+	{
+		errVal = AM_PostRemove(fileDesc,listPage,(int)rid,&empty);
+		if (errVal != AME_OK || !empty)
+		{
+			PF_UnfixPage(fileDesc,pageNum,FALSE);
+			AM_EmptyStack(&stack);
+			AM_Errno = errVal;
+			return(errVal);
+		}
+		bcopy(pageBuf + nextRec + AM_si,&temp,AM_ss);
+		bcopy(&header->freeListPtr,pageBuf + temp + AM_si,AM_ss);
+		header->freeListPtr = nextRec;
+		header->numinfreeList += 2;
+		temp = AM_NULL;
+		bcopy(&temp,currRecPtr,AM_ss);
+	}
 	
 	/* search the list for recId */
-	while(nextRec != 0)
+	else while(nextRec != 0)
 	{
-		bcopy(pageBuf + nextRec,&tempRec,AM_si);
-		
 		/* found the recId to be deleted */
-		if (recId == tempRec)
+		if (AM_NodeRid(pageBuf + nextRec,indexp->ridLength) == rid)
 		{
 			/* Delete recId */
 			bcopy(pageBuf + nextRec + AM_si,currRecPtr,AM_ss);
@@ -205,8 +465,10 @@ int recId; /* id of the record to delete */
 	}
 	
 	/* if end of list reached then key not in tree */
-	if (nextRec == AM_NULL)
+	if (listPage == AM_NULL_PAGE && nextRec == AM_NULL)
 		{
+		 PF_UnfixPage(fileDesc,pageNum,FALSE);
+		 AM_EmptyStack(&stack);
 		 AM_Errno = AME_NOTFOUND;
 		 return(AME_NOTFOUND);
                 }
@@ -226,10 +488,22 @@ int recId; /* id of the record to delete */
 	/* copy the header onto the buffer */
 	bcopy(header,pageBuf,AM_sl);
 	
+	/* a leaf gone too empty is merged with or fed by its sibling */
+	if (AM_MergePct > 0 && pageNum != indexp->rootPageNum &&
+	    AM_LeafUsed(header)*100 < (PF_PAGE_SIZE - AM_sl)*AM_MergePct &&
+	    !AM_IndexScanned(fileDesc))
+	{
+		errVal = AM_MergeLeaf(fileDesc,pageNum,pageBuf,attrLength,
+				      &stack);
+		AM_EmptyStack(&stack);
+		AM_Errno = errVal;
+		return(errVal);
+	}
+
 	errVal = PF_UnfixPage(fileDesc,pageNum,TRUE);
 	
 	/* empty the stack so that it is set for next amlayer call */
-	AM_EmptyStack();
+	AM_EmptyStack(&stack);
 	  {
 	   AM_Errno = AME_OK;
 	   return(AME_OK);
@@ -251,6 +525,91 @@ int attrLength; /* 4 for 'i' or 'f', 1-255 for 'c' */
 char *value; /* value to be inserted */ 
 int recId; /* recId to be inserted */
 
+{
+	return(AM_InsertEntryRid(fileDesc,attrType,attrLength,value,
+				 (AM_RID)recId,(char *)NULL));
+}
+
+
+/* Inserts a value,recId pair and the payload stored with it in a covering
+index; a NULL payload stores zeros */
+AM_InsertEntryPayload(fileDesc,attrType,attrLength,value,recId,payload)
+int fileDesc; /* file Descriptor */
+char attrType; /* 'i' or 'c' or 'f' */
+int attrLength; /* 4 for 'i' or 'f', 1-255 for 'c' */
+char *value; /* value to be inserted */ 
+int recId; /* recId to be inserted */
+char *payload; /* payloadLength bytes of the index, or NULL */
+
+{
+	return(AM_InsertEntryRid(fileDesc,attrType,attrLength,value,
+				 (AM_RID)recId,payload));
+}
+
+
+/* Inserts a value,rid pair with its payload. A wide index keeps the whole
+rid; any other index only a rid that fits an int */
+AM_InsertEntryRid(fileDesc,attrType,attrLength,value,rid,payload)
+int fileDesc; /* file Descriptor */
+char attrType; /* 'i' or 'c' or 'f' */
+int attrLength; /* 4 for 'i' or 'f', 1-255 for 'c' */
+char *value; /* value to be inserted */ 
+AM_RID rid; /* recId to be inserted */
+char *payload; /* payloadLength bytes of the index, or NULL */
+
+{
+	char ext[AM_si + AM_MAXPAYLOAD]; /* what follows the next pointer */
+	int high; /* high half of rid */
+	AM_INDEX *indexp; /* the open index */
+
+	indexp = AM_GetIndex(fileDesc);
+	if (indexp == NULL) return(AM_Errno);
+
+	if (indexp->hashed)
+	{
+		if (rid != (int)rid)
+			{
+			 AM_Errno = AME_INVALIDVALUE;
+			 return(AME_INVALIDVALUE);
+			}
+		return(AM_HashInsert(fileDesc,attrType,attrLength,value,
+				     (int)rid));
+	}
+
+	if (indexp->ridLength != AM_sr)
+	{
+		/* AM_POSTLIST marks a posting list in a list of recIds */
+		if ((rid != (int)rid) ||
+		    (rid == AM_POSTLIST && indexp->payloadLength == 0))
+			{
+			 AM_Errno = AME_INVALIDVALUE;
+			 return(AME_INVALIDVALUE);
+			}
+		return(AM_InsertNode(fileDesc,attrType,attrLength,value,
+				     (int)rid,payload));
+	}
+
+	/* the high half goes ahead of the covered columns */
+	high = (int)(rid >> 32);
+	bcopy((char *)&high,ext,AM_si);
+	if (payload != NULL)
+		bcopy(payload,ext + AM_si,indexp->payloadLength);
+	else
+		bzero(ext + AM_si,indexp->payloadLength);
+	return(AM_InsertNode(fileDesc,attrType,attrLength,value,(int)rid,ext));
+}
+
+
+/* inserts a value,recId pair whose node ends in ext, the bytes stored after
+its next pointer */
+static AM_InsertNode(fileDesc,attrType,attrLength,value,recId,ext)
+int fileDesc; /* file Descriptor */
+char attrType; /* 'i' or 'c' or 'f' */
+int attrLength; /* 4 for 'i' or 'f', 1-255 for 'c' */
+char *value; /* value to be inserted */ 
+int recId; /* low half of the recId */
+char *ext; /* the leaf's payloadLength bytes, or NULL for zeros */
+
 {
 	char *pageBuf; /* buffer to hold page */
 	int pageNum; /* page number of the page in buffer */
@@ -262,10 +621,14 @@ int recId; /* recId to be inserted */
 	int errVal; /* return value of functions within this function */
 	char key[AM_MAXATTRLENGTH]; /* holds the attribute to be passed 
 						  back to the parent */
+	AM_LEAFHEADER lhead; /* header of the leaf inserted into */
+	AM_INDEX *indexp; /* the open index */
+	AM_STACK stack; /* path from the root to the leaf */
 
 	
 	/* check the parameters */
-	if ((attrType != 'c') && (attrType != 'f') && (attrType != 'i'))
+	if ((attrType != 'c') && (attrType != 'f') && (attrType != 'i') &&
+	    (attrType != 'k'))
 		{
 		 AM_Errno = AME_INVALIDATTRTYPE;
 		 return(AME_INVALIDATTRTYPE);
@@ -282,39 +645,66 @@ int recId; /* recId to be inserted */
 		 AM_Errno = AME_FD;
 		 return(AME_FD);
                 }
+
+	indexp = AM_GetIndex(fileDesc);
+	if (indexp == NULL) return(AM_Errno);
+
+	/* the key goes into the filter before it can be found; the first
+	key to dirty the filter marks it stale on the meta page */
+	errVal = AM_FilterAdd(indexp,attrType,attrLength,value);
+	if (errVal == TRUE) errVal = AM_WriteMeta(fileDesc,indexp);
+	if (errVal != AME_OK) return(errVal);
 	
-	
+	/* appends to the end of the tree skip the descent */
+	inserted = AM_RightAppend(fileDesc,indexp,attrType,attrLength,value,recId,
+				  ext);
+	if (inserted < 0)
+	{
+		AM_Errno = inserted;
+		return(inserted);
+	}
+	if (inserted == TRUE) return(AME_OK);
+
 	/* Search the leaf for the key */
+	AM_InitStack(&stack);
 	status = AM_Search(fileDesc,attrType,attrLength,value,&pageNum,
-			   &pageBuf,&index);
+			   &pageBuf,&index,&stack);
 
 
 	
 	/* check if there is an error */
 	if (status < 0) 
 	{ 
-		AM_EmptyStack();
+		AM_EmptyStack(&stack);
 		AM_Errno = status;
 		return(status);
 	}
 	
-	/* Insert into leaf the key,recId pair */
-	inserted = AM_InsertintoLeaf(pageBuf,attrLength,value,recId,index,
-				     status);
+	/* Insert into leaf the key,recId pair, or into its posting list */
+	inserted = (status == AM_FOUND) ?
+		   AM_PostInsert(fileDesc,pageBuf,index,recId) : FALSE;
+	if (inserted == FALSE)
+		inserted = AM_InsertintoLeaf(pageBuf,attrLength,value,recId,
+					     index,status,ext);
 
 	/* if key has been inserted then done */
 	if (inserted == TRUE) 
 	{
+		/* remember the rightmost leaf for later appends */
+		bcopy(pageBuf,&lhead,AM_sl);
+		if (lhead.nextLeafPage == AM_NULL_PAGE)
+			indexp->rightPageNum = pageNum;
 		errVal = PF_UnfixPage(fileDesc,pageNum,TRUE);
+		AM_EmptyStack(&stack);
 		AM_Check;
-		AM_EmptyStack();
 		return(AME_OK);
 	}
 	
 	/* check if there is any error */
 	if (inserted < 0) 
 	{
-		AM_EmptyStack();
+		PF_UnfixPage(fileDesc,pageNum,FALSE);
+		AM_EmptyStack(&stack);
 		AM_Errno = inserted;
 		return(inserted);
 	}
@@ -322,14 +712,17 @@ int recId; /* recId to be inserted */
 	/* if not inserted then have to split */
 	if (inserted == FALSE)
 	{
+		/* the split may move the rightmost leaf */
+		indexp->rightPageNum = AM_NULL_PAGE;
+
 		/* Split the leaf page */
 		addtoparent = AM_SplitLeaf(fileDesc,pageBuf,&pageNum,
-			     attrLength,recId,value, status,index,key);
+			     attrLength,recId,value, status,index,key,ext);
 		
 		/* check for errors */
 		if (addtoparent < 0) 
 		{
-			AM_EmptyStack();
+			AM_EmptyStack(&stack);
 			{
 			 AM_Errno = addtoparent;
 			 return(addtoparent);
@@ -339,16 +732,17 @@ int recId; /* recId to be inserted */
 		/* if key has to be added to the parent */
 		if (addtoparent == TRUE)
 		{
-			errVal = AM_AddtoParent(fileDesc,pageNum,key,attrLength);
+			errVal = AM_AddtoParent(fileDesc,pageNum,key,attrLength,
+						&stack);
 			if (errVal < 0)
 			{
-				AM_EmptyStack();
+				AM_EmptyStack(&stack);
 				AM_Errno = errVal;
 				return(errVal);
 			}
 		}
 	}
-	AM_EmptyStack();
+	AM_EmptyStack(&stack);
 	return(AME_OK);
 }
 
@@ -366,7 +760,12 @@ static char *AMerrormsg[] = {
 "Scan Table is full",
 "Invalid Attribute Type",
 "Invalid file Descriptor",
-"Invalid value to Delete or Insert Entry"
+"Invalid value to Delete or Insert Entry",
+"Bulk load into a non-empty index",
+"Bulk load keys not in sorted order",
+"Out of memory",
+"Not an index file",
+"Operation not supported on this index"
 };
 
 
@@ -1,6 +1,13 @@
 # include "am.h"
 
-int AM_RootPageNum = 0;
-int AM_LeftPageNum = 0;
-int AM_Errno;
+__thread int AM_Errno;
+int AM_FillFactor = 100;
+int AM_AppendCache = 1;
+int AM_RightSplitPct = 100;
+int AM_SearchKernels = 1;
+int AM_MergePct = 40;
+int AM_PrefetchLeaves = 8;
+int AM_PostingMin = 64;
+int AM_FilterBitsPerKey = 10;
 
+AM_INDEX AM_indexTable[AM_MAXINDEXES];
@@ -0,0 +1,712 @@
+# include <stdio.h>
+# include <stdlib.h>
+# include "am.h"
+# include "pf.h"
+
+/* Hash indexes, for lookups by equality only, by extendible hashing. Page 0
+is an 'h' meta page with the global depth and the pages of the directory;
+the directory, 1 << depth bucket page numbers indexed by the low bits of a
+key's hash, is also kept in memory in the index's AM_INDEX entry, so that a
+lookup fixes only the pages of its bucket. A bucket page holds key,recId
+pairs unsorted, and the local depth of the bucket: how many low bits of the
+hash its keys all share. An insert into a full bucket splits it on its
+next bit, first doubling the directory if the bucket's depth is the global
+one; doubling writes only the new half of the directory, a copy of the
+old, on pages after the old ones. A bucket whose keys cannot be told apart
+in AM_MAXHASHDEPTH bits, or that has overflowed once, grows a chain of
+overflow pages instead. Deletes free emptied overflow pages but do not
+merge buckets or halve the directory. */
+
+/* the i-th key,recId pair of a bucket page */
+# define AM_BucketEntry(pageBuf,i,attrLength) \
+		((pageBuf) + AM_sb + (i)*((attrLength) + AM_si))
+
+
+/* Returns the hash of a key: FNV-1a over its bytes, those of a 'c' key up
+to its first null as AM_Compare sees them, then mixed so that the low bits
+depend on all of them */
+unsigned int AM_HashValue(attrType,attrLength,value)
+char attrType;
+int attrLength;
+char *value;
+
+{
+	unsigned int h;
+	float f;
+	int i;
+
+	if (attrType == 'f')
+	{
+		/* -0.0 is equal to 0.0 */
+		bcopy(value,(char *)&f,AM_sf);
+		if (f == 0.0) f = 0.0;
+		value = (char *)&f;
+	}
+	h = 2166136261u;
+	for (i = 0; i < attrLength; i++)
+	{
+		if ((attrType == 'c') && (value[i] == '\0')) break;
+		h = (h ^ (unsigned char)value[i])*16777619u;
+	}
+	h ^= h >> 16;
+	h *= 0x85ebca6bu;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35u;
+	h ^= h >> 16;
+	return(h);
+}
+
+
+/* checks the arguments of a call on a hash index against it */
+static AM_HashCheck(indexp,attrType,attrLength,value)
+AM_INDEX *indexp;
+char attrType;
+int attrLength;
+char *value;
+
+{
+	if (attrType != indexp->attrType)
+	{
+		AM_Errno = AME_INVALIDATTRTYPE;
+		return(AME_INVALIDATTRTYPE);
+	}
+	if (attrLength != indexp->attrLength)
+	{
+		AM_Errno = AME_INVALIDATTRLENGTH;
+		return(AME_INVALIDATTRLENGTH);
+	}
+	if (value == NULL)
+	{
+		AM_Errno = AME_INVALIDVALUE;
+		return(AME_INVALIDVALUE);
+	}
+	return(AME_OK);
+}
+
+
+/* Creates a hash index fileName.indexNo: a meta page, one directory page
+and one empty bucket of depth 0 */
+AM_CreateHashIndex(fileName,indexNo,attrType,attrLength)
+char *fileName;/* Name of indexed file */
+int indexNo;/*number of this index for file */
+char attrType;/* 'c' for char ,'i' for int ,'f' for float */
+int attrLength; /* 4 for 'i' or 'f', 1-255 for 'c' */
+
+{
+	char indexfName[AM_MAX_FNAME_LENGTH];
+	int fileDesc;
+	int metaPageNum,dirPageNum,bucketPageNum;
+	char *metaBuf,*dirBuf,*bucketBuf;
+	AM_HASHMETA meta;
+	AM_BUCKETHEADER head;
+	int errVal;
+
+	if ((attrType != 'c') && (attrType != 'f') && (attrType != 'i'))
+	{
+		AM_Errno = AME_INVALIDATTRTYPE;
+		return(AME_INVALIDATTRTYPE);
+	}
+	if ((attrLength < 1) || (attrLength > 255) ||
+	    ((attrLength != 4) && (attrType != 'c')))
+	{
+		AM_Errno = AME_INVALIDATTRLENGTH;
+		return(AME_INVALIDATTRLENGTH);
+	}
+
+	sprintf(indexfName,"%s.%d",fileName,indexNo);
+	errVal = PF_CreateFile(indexfName);
+	AM_Check;
+	fileDesc = PF_OpenFile(indexfName);
+	if (fileDesc < 0)
+	{
+		AM_Errno = AME_PF;
+		return(AME_PF);
+	}
+
+	/* the meta page is page 0 */
+	errVal = PF_AllocPage(fileDesc,&metaPageNum,&metaBuf);
+	AM_Check;
+	errVal = PF_AllocPage(fileDesc,&dirPageNum,&dirBuf);
+	AM_Check;
+	errVal = PF_AllocPage(fileDesc,&bucketPageNum,&bucketBuf);
+	AM_Check;
+
+	head.pageType = 'b';
+	head.nextPage = AM_NULL_PAGE;
+	head.depth = 0;
+	head.numEntries = 0;
+	head.attrLength = attrLength;
+	bcopy(&head,bucketBuf,AM_sb);
+	errVal = PF_UnfixPage(fileDesc,bucketPageNum,TRUE);
+	AM_Check;
+
+	*dirBuf = 'd';
+	bcopy((char *)&bucketPageNum,dirBuf + AM_si,AM_si);
+	errVal = PF_UnfixPage(fileDesc,dirPageNum,TRUE);
+	AM_Check;
+
+	meta.pageType = 'h';
+	meta.magic = AM_META_MAGIC;
+	meta.attrType = attrType;
+	meta.attrLength = attrLength;
+	meta.depth = 0;
+	meta.numDirPages = 1;
+	bcopy(&meta,metaBuf,AM_shm);
+	bcopy((char *)&dirPageNum,metaBuf + AM_shm,AM_si);
+	errVal = PF_UnfixPage(fileDesc,metaPageNum,TRUE);
+	AM_Check;
+
+	errVal = PF_CloseFile(fileDesc);
+	AM_Check;
+	return(AME_OK);
+}
+
+
+/* Loads the state of a hash index from its meta page, pageBuf, which is
+fixed and is unfixed here, and its directory pages */
+AM_HashLoad(fileDesc,pageBuf,index)
+int fileDesc;
+char *pageBuf; /* page 0 */
+AM_INDEX *index;
+
+{
+	AM_HASHMETA meta;
+	int *dir;
+	int size; /* directory entries */
+	int dirPage;
+	char *dirBuf;
+	int i,num;
+	int errVal;
+
+	bcopy(pageBuf,&meta,AM_shm);
+	if (meta.magic != AM_META_MAGIC)
+	{
+		PF_UnfixPage(fileDesc,AM_META_PAGE,FALSE);
+		AM_Errno = AME_NOTINDEX;
+		return(AME_NOTINDEX);
+	}
+	size = 1 << meta.depth;
+	dir = (int *)malloc(size*AM_si);
+	if (dir == NULL)
+	{
+		PF_UnfixPage(fileDesc,AM_META_PAGE,FALSE);
+		AM_Errno = AME_NOMEM;
+		return(AME_NOMEM);
+	}
+	for (i = 0; i < size; i += num)
+	{
+		bcopy(pageBuf + AM_shm + (i/AM_DIRENTRIES)*AM_si,(char *)&dirPage,
+		      AM_si);
+		num = (size - i < AM_DIRENTRIES) ? size - i : AM_DIRENTRIES;
+		if (PF_GetThisPage(fileDesc,dirPage,&dirBuf) != PFE_OK)
+		{
+			free((char *)dir);
+			PF_UnfixPage(fileDesc,AM_META_PAGE,FALSE);
+			AM_Errno = AME_PF;
+			return(AME_PF);
+		}
+		bcopy(dirBuf + AM_si,(char *)(dir + i),num*AM_si);
+		PF_UnfixPage(fileDesc,dirPage,FALSE);
+	}
+	errVal = PF_UnfixPage(fileDesc,AM_META_PAGE,FALSE);
+	if (errVal != PFE_OK)
+	{
+		free((char *)dir);
+		AM_Errno = AME_PF;
+		return(AME_PF);
+	}
+
+	index->hasMeta = TRUE;
+	index->rootPageNum = AM_NULL_PAGE;
+	index->leftPageNum = AM_NULL_PAGE;
+	index->height = 0;
+	index->attrType = meta.attrType;
+	index->attrLength = meta.attrLength;
+	index->keyDesc.numCols = 0;
+	index->payloadLength = 0;
+	index->ridLength = AM_si;
+	index->hashed = TRUE;
+	index->hashDepth = meta.depth;
+	index->hashDir = dir;
+	return(AME_OK);
+}
+
+
+/* points the directory entries first, first + step, ... at pageNum, in
+memory and on the directory pages */
+static AM_HashSetDir(fileDesc,indexp,first,step,pageNum)
+int fileDesc;
+AM_INDEX *indexp;
+int first;
+int step;
+int pageNum;
+
+{
+	char *metaBuf,*dirBuf;
+	int dirNum; /* directory page fixed, -1 if none */
+	int dirPage; /* its page number, AM_NULL_PAGE if none */
+	int size;
+	int i;
+	int errVal;
+
+	errVal = PF_GetThisPage(fileDesc,AM_META_PAGE,&metaBuf);
+	AM_Check;
+	size = 1 << indexp->hashDepth;
+	dirNum = -1;
+	dirPage = AM_NULL_PAGE;
+	for (i = first; i < size; i += step)
+	{
+		indexp->hashDir[i] = pageNum;
+		if (i/AM_DIRENTRIES != dirNum)
+		{
+			if (dirPage != AM_NULL_PAGE)
+			{
+				errVal = PF_UnfixPage(fileDesc,dirPage,TRUE);
+				AM_Check;
+			}
+			dirNum = i/AM_DIRENTRIES;
+			bcopy(metaBuf + AM_shm + dirNum*AM_si,(char *)&dirPage,AM_si);
+			errVal = PF_GetThisPage(fileDesc,dirPage,&dirBuf);
+			AM_Check;
+		}
+		bcopy((char *)&pageNum,dirBuf + AM_si + (i % AM_DIRENTRIES)*AM_si,
+		      AM_si);
+	}
+	if (dirPage != AM_NULL_PAGE)
+	{
+		errVal = PF_UnfixPage(fileDesc,dirPage,TRUE);
+		AM_Check;
+	}
+	errVal = PF_UnfixPage(fileDesc,AM_META_PAGE,FALSE);
+	AM_Check;
+	return(AME_OK);
+}
+
+
+/* Doubles the directory: the new half, a copy of the old, goes on the
+directory pages after the old entries, new ones as needed */
+static AM_HashDouble(fileDesc,indexp)
+int fileDesc;
+AM_INDEX *indexp;
+
+{
+	AM_HASHMETA meta;
+	char *metaBuf,*dirBuf;
+	int *dir;
+	int size; /* entries before doubling */
+	int dirNum,dirPage;
+	int i,off,num;
+	int errVal;
+
+	size = 1 << indexp->hashDepth;
+	dir = (int *)realloc((char *)indexp->hashDir,2*size*AM_si);
+	if (dir == NULL)
+	{
+		AM_Errno = AME_NOMEM;
+		return(AME_NOMEM);
+	}
+	bcopy((char *)dir,(char *)(dir + size),size*AM_si);
+	indexp->hashDir = dir;
+
+	errVal = PF_GetThisPage(fileDesc,AM_META_PAGE,&metaBuf);
+	AM_Check;
+	bcopy(metaBuf,&meta,AM_shm);
+	for (i = size; i < 2*size; i += num)
+	{
+		dirNum = i/AM_DIRENTRIES;
+		off = i % AM_DIRENTRIES;
+		num = (2*size - i < AM_DIRENTRIES - off) ? 2*size - i :
+							     AM_DIRENTRIES - off;
+		if (dirNum < meta.numDirPages)
+		{
+			bcopy(metaBuf + AM_shm + dirNum*AM_si,(char *)&dirPage,AM_si);
+			errVal = PF_GetThisPage(fileDesc,dirPage,&dirBuf);
+			AM_Check;
+		}
+		else
+		{
+			errVal = PF_AllocPage(fileDesc,&dirPage,&dirBuf);
+			AM_Check;
+			*dirBuf = 'd';
+			bcopy((char *)&dirPage,metaBuf + AM_shm + dirNum*AM_si,AM_si);
+			meta.numDirPages++;
+		}
+		bcopy((char *)(dir + i),dirBuf + AM_si + off*AM_si,num*AM_si);
+		errVal = PF_UnfixPage(fileDesc,dirPage,TRUE);
+		AM_Check;
+	}
+	meta.depth++;
+	bcopy(&meta,metaBuf,AM_shm);
+	errVal = PF_UnfixPage(fileDesc,AM_META_PAGE,TRUE);
+	AM_Check;
+	indexp->hashDepth++;
+	return(AME_OK);
+}
+
+
+/* Splits the bucket at pageNum, found at directory entry slot, whose depth
+is below the global depth: the pairs whose hash has its next bit set move
+to a new bucket, and the entries that have that bit set point there */
+static AM_HashSplit(fileDesc,indexp,pageNum,slot)
+int fileDesc;
+AM_INDEX *indexp;
+int pageNum;
+int slot;
+
+{
+	char *pageBuf,*newBuf;
+	int newPage;
+	AM_BUCKETHEADER head,newHead;
+	int entryLength;
+	int bit; /* the bit the split is on */
+	int kept;
+	char *entry;
+	int i;
+	int errVal;
+
+	errVal = PF_GetThisPage(fileDesc,pageNum,&pageBuf);
+	AM_Check;
+	bcopy(pageBuf,&head,AM_sb);
+	errVal = PF_AllocPage(fileDesc,&newPage,&newBuf);
+	AM_Check;
+	entryLength = head.attrLength + AM_si;
+	bit = 1 << head.depth;
+
+	newHead.pageType = 'b';
+	newHead.nextPage = AM_NULL_PAGE;
+	newHead.depth = head.depth + 1;
+	newHead.numEntries = 0;
+	newHead.attrLength = head.attrLength;
+	kept = 0;
+	for (i = 0; i < head.numEntries; i++)
+	{
+		entry = AM_BucketEntry(pageBuf,i,head.attrLength);
+		if (AM_HashValue(indexp->attrType,head.attrLength,entry) & bit)
+			bcopy(entry,AM_BucketEntry(newBuf,newHead.numEntries++,
+					head.attrLength),entryLength);
+		else
+		{
+			if (kept != i)
+				bcopy(entry,AM_BucketEntry(pageBuf,kept,head.attrLength),
+				      entryLength);
+			kept++;
+		}
+	}
+	head.numEntries = kept;
+	head.depth++;
+	bcopy(&head,pageBuf,AM_sb);
+	bcopy(&newHead,newBuf,AM_sb);
+	errVal = PF_UnfixPage(fileDesc,pageNum,TRUE);
+	AM_Check;
+	errVal = PF_UnfixPage(fileDesc,newPage,TRUE);
+	AM_Check;
+
+	return(AM_HashSetDir(fileDesc,indexp,(slot & (bit - 1)) | bit,2*bit,
+			     newPage));
+}
+
+
+/* TRUE if every pair of a bucket page has a hash equal to h in its low
+AM_MAXHASHDEPTH bits, so that no split can part them */
+static AM_HashSame(pageBuf,head,attrType,h)
+char *pageBuf;
+AM_BUCKETHEADER *head;
+char attrType;
+unsigned int h;
+
+{
+	unsigned int mask;
+	int i;
+
+	mask = (1 << AM_MAXHASHDEPTH) - 1;
+	for (i = 0; i < head->numEntries; i++)
+		if ((AM_HashValue(attrType,head->attrLength,
+			AM_BucketEntry(pageBuf,i,head->attrLength)) ^ h) & mask)
+			return(FALSE);
+	return(TRUE);
+}
+
+
+/* Inserts a value,recId pair into a hash index */
+AM_HashInsert(fileDesc,attrType,attrLength,value,recId)
+int fileDesc;
+char attrType;
+int attrLength;
+char *value;
+int recId;
+
+{
+	AM_INDEX *indexp;
+	AM_BUCKETHEADER head,newHead;
+	char *pageBuf,*newBuf;
+	int pageNum,newPage,nextPage;
+	unsigned int h;
+	int maxEntries;
+	int slot;
+	int overflow; /* TRUE: the pair goes on the bucket's chain */
+	char *entry;
+	int errVal;
+
+	indexp = AM_GetIndex(fileDesc);
+	if (indexp == NULL) return(AM_Errno);
+	errVal = AM_HashCheck(indexp,attrType,attrLength,value);
+	if (errVal != AME_OK) return(errVal);
+
+	h = AM_HashValue(attrType,attrLength,value);
+	maxEntries = (PF_PAGE_SIZE - AM_sb)/(attrLength + AM_si);
+
+	/* split the bucket until the pair fits, if splits can make room */
+	for (;;)
+	{
+		slot = h & ((1 << indexp->hashDepth) - 1);
+		pageNum = indexp->hashDir[slot];
+		errVal = PF_GetThisPage(fileDesc,pageNum,&pageBuf);
+		AM_Check;
+		bcopy(pageBuf,&head,AM_sb);
+		overflow = (head.nextPage != AM_NULL_PAGE);
+		if (overflow || (head.numEntries < maxEntries)) break;
+		if ((head.depth >= AM_MAXHASHDEPTH) ||
+		    AM_HashSame(pageBuf,&head,attrType,h))
+		{
+			overflow = TRUE;
+			break;
+		}
+		errVal = PF_UnfixPage(fileDesc,pageNum,FALSE);
+		AM_Check;
+		if (head.depth == indexp->hashDepth)
+		{
+			errVal = AM_HashDouble(fileDesc,indexp);
+			if (errVal != AME_OK) return(errVal);
+		}
+		errVal = AM_HashSplit(fileDesc,indexp,pageNum,slot);
+		if (errVal != AME_OK) return(errVal);
+	}
+
+	/* the first page of the chain with room, or a new page at its end */
+	if (overflow)
+	{
+		while ((head.numEntries >= maxEntries) &&
+		       (head.nextPage != AM_NULL_PAGE))
+		{
+			nextPage = head.nextPage;
+			errVal = PF_UnfixPage(fileDesc,pageNum,FALSE);
+			AM_Check;
+			pageNum = nextPage;
+			errVal = PF_GetThisPage(fileDesc,pageNum,&pageBuf);
+			AM_Check;
+			bcopy(pageBuf,&head,AM_sb);
+		}
+		if (head.numEntries >= maxEntries)
+		{
+			errVal = PF_AllocPage(fileDesc,&newPage,&newBuf);
+			AM_Check;
+			newHead.pageType = 'b';
+			newHead.nextPage = AM_NULL_PAGE;
+			newHead.depth = head.depth;
+			newHead.numEntries = 0;
+			newHead.attrLength = attrLength;
+			head.nextPage = newPage;
+			bcopy(&head,pageBuf,AM_sb);
+			errVal = PF_UnfixPage(fileDesc,pageNum,TRUE);
+			AM_Check;
+			pageNum = newPage;
+			pageBuf = newBuf;
+			head = newHead;
+		}
+	}
+
+	entry = AM_BucketEntry(pageBuf,head.numEntries,attrLength);
+	bcopy(value,entry,attrLength);
+	bcopy((char *)&recId,entry + attrLength,AM_si);
+	head.numEntries++;
+	bcopy(&head,pageBuf,AM_sb);
+	errVal = PF_UnfixPage(fileDesc,pageNum,TRUE);
+	AM_Check;
+	return(AME_OK);
+}
+
+
+/* Deletes a value,recId pair from a hash index. An overflow page it
+empties leaves the chain and the file, unless a scan is open */
+AM_HashDelete(fileDesc,attrType,attrLength,value,recId)
+int fileDesc;
+char attrType;
+int attrLength;
+char *value;
+int recId;
+
+{
+	AM_INDEX *indexp;
+	AM_BUCKETHEADER head,prevHead;
+	char *pageBuf,*prevBuf;
+	int pageNum,prevPage;
+	int entryLength;
+	char *entry;
+	int rid;
+	int i;
+	int errVal;
+
+	indexp = AM_GetIndex(fileDesc);
+	if (indexp == NULL) return(AM_Errno);
+	errVal = AM_HashCheck(indexp,attrType,attrLength,value);
+	if (errVal != AME_OK) return(errVal);
+
+	entryLength = attrLength + AM_si;
+	pageNum = indexp->hashDir[AM_HashValue(attrType,attrLength,value) &
+				  ((1 << indexp->hashDepth) - 1)];
+	prevPage = AM_NULL_PAGE;
+	while (pageNum != AM_NULL_PAGE)
+	{
+		errVal = PF_GetThisPage(fileDesc,pageNum,&pageBuf);
+		AM_Check;
+		bcopy(pageBuf,&head,AM_sb);
+		for (i = 0; i < head.numEntries; i++)
+		{
+			entry = AM_BucketEntry(pageBuf,i,attrLength);
+			bcopy(entry + attrLength,(char *)&rid,AM_si);
+			if ((rid == recId) &&
+			    (AM_Compare(entry,attrType,attrLength,value) == 0))
+				break;
+		}
+		if (i < head.numEntries)
+		{
+			/* the last pair fills the hole */
+			head.numEntries--;
+			if (i < head.numEntries)
+				bcopy(AM_BucketEntry(pageBuf,head.numEntries,attrLength),
+				      entry,entryLength);
+			bcopy(&head,pageBuf,AM_sb);
+			errVal = PF_UnfixPage(fileDesc,pageNum,TRUE);
+			AM_Check;
+			if ((head.numEntries > 0) || (prevPage == AM_NULL_PAGE) ||
+			    AM_IndexScanned(fileDesc))
+				return(AME_OK);
+
+			errVal = PF_GetThisPage(fileDesc,prevPage,&prevBuf);
+			AM_Check;
+			bcopy(prevBuf,&prevHead,AM_sb);
+			prevHead.nextPage = head.nextPage;
+			bcopy(&prevHead,prevBuf,AM_sb);
+			errVal = PF_UnfixPage(fileDesc,prevPage,TRUE);
+			AM_Check;
+			errVal = PF_DisposePage(fileDesc,pageNum);
+			AM_Check;
+			return(AME_OK);
+		}
+		prevPage = pageNum;
+		pageNum = head.nextPage;
+		errVal = PF_UnfixPage(fileDesc,prevPage,FALSE);
+		AM_Check;
+	}
+	AM_Errno = AME_NOTFOUND;
+	return(AME_NOTFOUND);
+}
+
+
+/* Returns the bucket page of value in a hash index, the first a lookup
+reads, or an error */
+AM_HashBucket(indexp,attrType,attrLength,value)
+AM_INDEX *indexp;
+char attrType;
+int attrLength;
+char *value;
+
+{
+	int errVal;
+
+	errVal = AM_HashCheck(indexp,attrType,attrLength,value);
+	if (errVal != AME_OK) return(errVal);
+	return(indexp->hashDir[AM_HashValue(attrType,attrLength,value) &
+			       ((1 << indexp->hashDepth) - 1)]);
+}
+
+
+/* Stores at rids the recIds of value on the bucket page pageNum, and in
+*nextPage the page of the chain after it; returns how many there are */
+AM_HashRead(fileDesc,pageNum,attrType,value,rids,nextPage)
+int fileDesc;
+int pageNum;
+char attrType;
+char *value;
+int *rids; /* room for a page of recIds */
+int *nextPage;
+
+{
+	AM_BUCKETHEADER head;
+	char *pageBuf;
+	char *entry;
+	int num;
+	int i;
+	int errVal;
+
+	errVal = PF_GetThisPage(fileDesc,pageNum,&pageBuf);
+	AM_Check;
+	bcopy(pageBuf,&head,AM_sb);
+	num = 0;
+	for (i = 0; i < head.numEntries; i++)
+	{
+		entry = AM_BucketEntry(pageBuf,i,head.attrLength);
+		if (AM_Compare(entry,attrType,head.attrLength,value) == 0)
+			bcopy(entry + head.attrLength,(char *)&rids[num++],AM_si);
+	}
+	*nextPage = head.nextPage;
+	errVal = PF_UnfixPage(fileDesc,pageNum,FALSE);
+	AM_Check;
+	return(num);
+}
+
+
+/* Fills in stats for a hash index: its depth, pages and pairs */
+AM_HashStats(fileDesc,stats)
+int fileDesc;
+AM_HASHSTATS *stats;
+
+{
+	AM_INDEX *indexp;
+	AM_BUCKETHEADER head;
+	char *pageBuf;
+	int pageNum,nextPage;
+	int size;
+	int i;
+	int errVal;
+
+	indexp = AM_GetIndex(fileDesc);
+	if (indexp == NULL) return(AM_Errno);
+	if (!indexp->hashed)
+	{
+		AM_Errno = AME_NOTSUPPORTED;
+		return(AME_NOTSUPPORTED);
+	}
+	size = 1 << indexp->hashDepth;
+	stats->depth = indexp->hashDepth;
+	stats->dirPages = (size + AM_DIRENTRIES - 1)/AM_DIRENTRIES;
+	stats->buckets = 0;
+	stats->overflowPages = 0;
+	stats->numEntries = 0;
+	for (i = 0; i < size; i++)
+	{
+		/* a bucket of depth d is counted at the first of its entries,
+		the one below 1 << d */
+		pageNum = indexp->hashDir[i];
+		errVal = PF_GetThisPage(fileDesc,pageNum,&pageBuf);
+		AM_Check;
+		bcopy(pageBuf,&head,AM_sb);
+		errVal = PF_UnfixPage(fileDesc,pageNum,FALSE);
+		AM_Check;
+		if (i >= (1 << head.depth)) continue;
+		stats->buckets++;
+		stats->numEntries += head.numEntries;
+		while (head.nextPage != AM_NULL_PAGE)
+		{
+			nextPage = head.nextPage;
+			errVal = PF_GetThisPage(fileDesc,nextPage,&pageBuf);
+			AM_Check;
+			bcopy(pageBuf,&head,AM_sb);
+			errVal = PF_UnfixPage(fileDesc,nextPage,FALSE);
+			AM_Check;
+			stats->overflowPages++;
+			stats->numEntries += head.numEntries;
+		}
+	}
+	return(AME_OK);
+}
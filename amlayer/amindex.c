@@ -0,0 +1,289 @@
+# include <stdio.h>
+# include "am.h"
+# include "pf.h"
+
+/* Per-index state lives in AM_indexTable, one entry per PF file descriptor,
+and on disk in the meta page (page 0) of the index file, an 'h' page for a
+hash index (amhash.c). The Bloom filter of an index (amfilter.c) is read
+in with the meta page and written back by AM_CloseIndex; one the meta page
+calls stale is dropped instead. An entry is valid while its serial matches
+the one the PF layer gave the file when it was opened, so a descriptor
+reused for another file is loaded afresh. */
+
+
+/* frees what an entry of AM_indexTable has malloc'd */
+static AM_FreeIndex(index)
+AM_INDEX *index;
+
+{
+	if (index->hashDir != NULL)
+	{
+		free((char *)index->hashDir);
+		index->hashDir = NULL;
+	}
+	if (index->filter != NULL)
+	{
+		free((char *)index->filter);
+		index->filter = NULL;
+	}
+	if (index->filterPages != NULL)
+	{
+		free((char *)index->filterPages);
+		index->filterPages = NULL;
+	}
+	index->filterBlocks = 0;
+	index->filterDirty = FALSE;
+}
+
+
+/* loads the state of a file with no meta page: page 0 is the root and the
+leftmost leaf and the height are found by following first children */
+static AM_LoadLegacy(fileDesc,pageBuf,index)
+int fileDesc;
+char *pageBuf; /* page 0, fixed */
+AM_INDEX *index;
+
+{
+	int pageNum;
+	int childNum;
+	int errVal;
+	AM_LEAFHEADER lhead;
+	AM_INTHEADER ihead;
+
+	index->hasMeta = FALSE;
+	index->rootPageNum = 0;
+	index->height = 1;
+	index->attrType = 0;
+	index->keyDesc.numCols = 0;
+	index->payloadLength = 0;
+	index->ridLength = AM_si;
+	if (*pageBuf == 'l')
+	{
+		bcopy(pageBuf,&lhead,AM_sl);
+		index->attrLength = lhead.attrLength;
+	}
+	else
+	{
+		bcopy(pageBuf,&ihead,AM_sint);
+		index->attrLength = ihead.attrLength;
+	}
+	pageNum = 0;
+	while (*pageBuf != 'l')
+	{
+		bcopy(pageBuf + AM_sint,(char *)&childNum,AM_si);
+		errVal = PF_UnfixPage(fileDesc,pageNum,FALSE);
+		AM_Check;
+		pageNum = childNum;
+		errVal = PF_GetThisPage(fileDesc,pageNum,&pageBuf);
+		AM_Check;
+		index->height++;
+	}
+	index->leftPageNum = pageNum;
+	errVal = PF_UnfixPage(fileDesc,pageNum,FALSE);
+	AM_Check;
+	return(AME_OK);
+}
+
+
+/* returns the entry for an open index file, reading its meta page if the
+entry is stale, or NULL with AM_Errno set */
+AM_INDEX *AM_GetIndex(fileDesc)
+int fileDesc;
+
+{
+	AM_INDEX *index;
+	AM_METAPAGE meta;
+	char *pageBuf;
+	int serial;
+	int errVal;
+
+	if ((fileDesc < 0) || (fileDesc >= AM_MAXINDEXES))
+	{
+		AM_Errno = AME_FD;
+		return(NULL);
+	}
+	serial = PF_FileSerial(fileDesc);
+	if (serial <= 0)
+	{
+		AM_Errno = AME_FD;
+		return(NULL);
+	}
+	index = &AM_indexTable[fileDesc];
+	if (index->serial == serial)
+		return(index);
+
+	index->serial = 0;
+	index->hashed = FALSE;
+	AM_FreeIndex(index);
+	if (PF_GetThisPage(fileDesc,AM_META_PAGE,&pageBuf) != PFE_OK)
+	{
+		AM_Errno = AME_PF;
+		return(NULL);
+	}
+	if (*pageBuf == 'm')
+	{
+		bcopy(pageBuf,&meta,sizeof(AM_METAPAGE));
+		errVal = PF_UnfixPage(fileDesc,AM_META_PAGE,FALSE);
+		if (errVal != PFE_OK)
+		{
+			AM_Errno = AME_PF;
+			return(NULL);
+		}
+		if (meta.magic != AM_META_MAGIC)
+		{
+			AM_Errno = AME_NOTINDEX;
+			return(NULL);
+		}
+		index->hasMeta = TRUE;
+		index->rootPageNum = meta.rootPageNum;
+		index->leftPageNum = meta.leftPageNum;
+		index->height = meta.height;
+		index->attrType = meta.attrType;
+		index->attrLength = meta.attrLength;
+		index->keyDesc = meta.keyDesc;
+		index->payloadLength = meta.payloadLength;
+		index->ridLength = (meta.ridLength == AM_sr) ? AM_sr : AM_si;
+		if (((meta.filterMagic == AM_FILTER_MAGIC) ||
+		     (meta.filterMagic == AM_FILTER_STALE)) &&
+		    (meta.filterBlocks > 0))
+		{
+			if (AM_FilterLoad(fileDesc,index,meta.filterPage,
+					  meta.filterBlocks,meta.filterProbes) != AME_OK)
+				return(NULL);
+			/* one left dirty may lack keys: it goes, and
+			AM_BuildFilter makes a new one */
+			if ((meta.filterMagic == AM_FILTER_STALE) &&
+			    ((AM_FilterFree(fileDesc,index) != AME_OK) ||
+			     (AM_WriteMeta(fileDesc,index) != AME_OK)))
+				return(NULL);
+		}
+	}
+	else if (*pageBuf == 'h')
+	{
+		if (AM_HashLoad(fileDesc,pageBuf,index) != AME_OK)
+			return(NULL);
+	}
+	else if ((*pageBuf == 'l') || (*pageBuf == 'i'))
+	{
+		if (AM_LoadLegacy(fileDesc,pageBuf,index) != AME_OK)
+			return(NULL);
+	}
+	else
+	{
+		PF_UnfixPage(fileDesc,AM_META_PAGE,FALSE);
+		AM_Errno = AME_NOTINDEX;
+		return(NULL);
+	}
+	index->rightPageNum = AM_NULL_PAGE;
+	index->serial = serial;
+	return(index);
+}
+
+
+/* writes the root, leftmost leaf, height and filter of an index to its meta
+page */
+AM_WriteMeta(fileDesc,index)
+int fileDesc;
+AM_INDEX *index;
+
+{
+	AM_METAPAGE meta;
+	char *pageBuf;
+	int errVal;
+
+	/* files without a meta page keep their root at page 0 */
+	if (!index->hasMeta) return(AME_OK);
+
+	meta.pageType = 'm';
+	meta.magic = AM_META_MAGIC;
+	meta.rootPageNum = index->rootPageNum;
+	meta.leftPageNum = index->leftPageNum;
+	meta.height = index->height;
+	meta.attrType = index->attrType;
+	meta.attrLength = index->attrLength;
+	meta.keyDesc = index->keyDesc;
+	meta.payloadLength = index->payloadLength;
+	meta.ridLength = index->ridLength;
+	/* inserts of AM_InsertEntryLatched may be setting filterDirty */
+	meta.filterMagic = __atomic_load_n(&index->filterDirty,__ATOMIC_RELAXED) ?
+			   AM_FILTER_STALE : AM_FILTER_MAGIC;
+	meta.filterPage = index->filterPage;
+	meta.filterBlocks = index->filterBlocks;
+	meta.filterProbes = index->filterProbes;
+
+	errVal = PF_GetThisPage(fileDesc,AM_META_PAGE,&pageBuf);
+	AM_Check;
+	bcopy(&meta,pageBuf,sizeof(AM_METAPAGE));
+	errVal = PF_UnfixPage(fileDesc,AM_META_PAGE,TRUE);
+	AM_Check;
+	return(AME_OK);
+}
+
+
+/* returns the recId of the node at nodePtr; ridLength is AM_sr if it is
+wide, so that its high half follows the next pointer */
+AM_RID AM_NodeRid(nodePtr,ridLength)
+char *nodePtr;
+int ridLength;
+
+{
+	int low,high;
+
+	bcopy(nodePtr,(char *)&low,AM_si);
+	if (ridLength != AM_sr) return((AM_RID)low);
+	bcopy(nodePtr + AM_si + AM_ss,(char *)&high,AM_si);
+	return(((AM_RID)high << 32) | (unsigned int)low);
+}
+
+
+/* Opens the index fileName.indexNo and returns its file descriptor, which
+is the handle the other AM functions take */
+AM_OpenIndex(fileName,indexNo)
+char *fileName;
+int indexNo;
+
+{
+	char indexfName[AM_MAX_FNAME_LENGTH];
+	int fileDesc;
+
+	sprintf(indexfName,"%s.%d",fileName,indexNo);
+	fileDesc = PF_OpenFile(indexfName);
+	if (fileDesc < 0)
+	{
+		AM_Errno = AME_PF;
+		return(AME_PF);
+	}
+	if (AM_GetIndex(fileDesc) == NULL)
+	{
+		PF_CloseFile(fileDesc);
+		return(AM_Errno);
+	}
+	return(fileDesc);
+}
+
+
+/* Closes an index opened with AM_OpenIndex */
+AM_CloseIndex(fileDesc)
+int fileDesc;
+
+{
+	int errVal;
+
+	if ((fileDesc < 0) || (fileDesc >= AM_MAXINDEXES))
+	{
+		AM_Errno = AME_FD;
+		return(AME_FD);
+	}
+	/* the filter bits inserts set are written with the rest, and the
+	meta page says the filter is current again */
+	if (AM_indexTable[fileDesc].serial == PF_FileSerial(fileDesc))
+	{
+		errVal = AM_FilterFlush(fileDesc,&AM_indexTable[fileDesc]);
+		if (errVal != AME_OK) return(errVal);
+	}
+	AM_indexTable[fileDesc].serial = 0;
+	AM_FreeIndex(&AM_indexTable[fileDesc]);
+	errVal = PF_CloseFile(fileDesc);
+	AM_Check;
+	return(AME_OK);
+}
@@ -2,38 +2,116 @@
 # include "am.h"
 # include "pf.h"
 
+/* Inserts a key at or past the largest key of the tree straight into the
+cached rightmost leaf, without descending from the root. Returns TRUE if the
+key went in, FALSE if the caller must take the normal path (no cached leaf,
+key smaller than the leaf's last key, or the leaf must split) */
+AM_RightAppend(fileDesc,indexp,attrType,attrLength,value,recId,payload)
+int fileDesc;
+AM_INDEX *indexp; /* its rightPageNum is the cached leaf */
+char attrType;
+int attrLength;
+char *value;
+int recId;
+char *payload;
+
+{
+	char *pageBuf;
+	AM_LEAFHEADER head,*header;
+	char keyBuf[AM_MAXATTRLENGTH]; /* last key of a var leaf */
+	int index,status,compareVal;
+	int inserted;
+	int errVal;
+	int pageNum;
+
+	pageNum = indexp->rightPageNum;
+	if (!AM_AppendCache || pageNum == AM_NULL_PAGE) return(FALSE);
+	if (PF_GetThisPage(fileDesc,pageNum,&pageBuf) != PFE_OK)
+	{
+		indexp->rightPageNum = AM_NULL_PAGE;
+		return(FALSE);
+	}
+	header = &head;
+	bcopy(pageBuf,header,AM_sl);
+
+	/* only one leaf has no successor, so this check also catches a
+	stale cache */
+	if (!AM_IsLeaf(pageBuf) || header->nextLeafPage != AM_NULL_PAGE ||
+	    header->attrLength != attrLength || header->numKeys == 0)
+	{
+		indexp->rightPageNum = AM_NULL_PAGE;
+		errVal = PF_UnfixPage(fileDesc,pageNum,FALSE);
+		AM_Check;
+		return(FALSE);
+	}
+	compareVal = AM_Compare(AM_LeafKey(pageBuf,header->numKeys,keyBuf),
+				attrType,attrLength,value);
+	if (compareVal < 0)
+	{
+		errVal = PF_UnfixPage(fileDesc,pageNum,FALSE);
+		AM_Check;
+		return(FALSE);
+	}
+	if (compareVal == 0)
+	{
+		index = header->numKeys;
+		status = AM_FOUND;
+	}
+	else
+	{
+		index = header->numKeys + 1;
+		status = AM_NOT_FOUND;
+	}
+	inserted = (status == AM_FOUND) ?
+		   AM_PostInsert(fileDesc,pageBuf,index,recId) : FALSE;
+	if (inserted == FALSE)
+		inserted = AM_InsertintoLeaf(pageBuf,attrLength,value,recId,
+					     index,status,payload);
+	errVal = PF_UnfixPage(fileDesc,pageNum,inserted == TRUE);
+	if (inserted < 0) return(inserted);
+	AM_Check;
+	return(inserted == TRUE);
+}
+
 /* Inserts a key into a leaf node */
-AM_InsertintoLeaf(pageBuf,attrLength,value,recId,index,status)
+AM_InsertintoLeaf(pageBuf,attrLength,value,recId,index,status,payload)
 char *pageBuf;/* buffer where the leaf page resides */
 int attrLength;
 char *value;/* attribute value to be inserted*/
 int recId;/* recid of the attribute to be inserted */
 int index;/* index where key is to be inserted */
 int status;/* Whether key is a new key or an old key */
+char *payload;/* stored with recId in a covering index, NULL for zeros */
 
 {
 	int recSize;
+	int nodeSize;/* bytes of a recId node */
 	char tempPage[PF_PAGE_SIZE];
 	AM_LEAFHEADER head,*header;
 	int errVal;
 
 
+	if (*pageBuf == 'L')
+		return(AM_VarInsertintoLeaf(pageBuf,attrLength,value,recId,index,
+					    status));
+
 	/* initialise the header */
 	header = &head;
 	bcopy(pageBuf,header,AM_sl);
 
 	recSize = attrLength + AM_ss;
+	nodeSize = AM_RecIdSize(header);
 	if (status == AM_FOUND)
 		/* key is already present */ 
 	{
 		if (header->freeListPtr == 0)
-			if ((header->recIdPtr - header->keyPtr) <(AM_si + AM_ss))
+			if ((header->recIdPtr - header->keyPtr) < nodeSize)
 			{
 				/* no room for one more record */
 				return(FALSE);
 			}
 		/* insert into leaf - no need to split */
-		AM_InsertToLeafFound(pageBuf,recId,index,header);
+		AM_InsertToLeafFound(pageBuf,recId,index,header,payload);
 		bcopy(header,pageBuf,AM_sl);
 		return(TRUE);
 	}
@@ -41,13 +119,12 @@ int status;/* Whether key is a new key or an old key */
 	/* status == AM_NOTFOUND and so key is a new key */
 	if ((header->freeListPtr) == 0)
 		/* freelist empty */
-		if ((header->recIdPtr - header->keyPtr) < (AM_si + AM_ss 
-							     + recSize))
+		if ((header->recIdPtr - header->keyPtr) < (nodeSize + recSize))
 			return(FALSE);
 		else
 		{    
 			AM_InsertToLeafNotFound(pageBuf,value,recId,index,
-						header);
+						header,payload);
 			header->numKeys++;
 			bcopy(header,pageBuf,AM_sl);
 			return(TRUE);
@@ -55,14 +132,15 @@ int status;/* Whether key is a new key or an old key */
 	else /* freelist not empty */
 	if ((header->recIdPtr - header->keyPtr) > recSize)
 	{
-		AM_InsertToLeafNotFound(pageBuf,value,recId,index,header);
+		AM_InsertToLeafNotFound(pageBuf,value,recId,index,header,
+					payload);
 		header->numKeys++;
 		bcopy(header,pageBuf,AM_sl);
 		return(TRUE);
 	}
 	else /* no place in the middle */
-	if (((header->numinfreeList)*(AM_si + AM_ss) + header->recIdPtr -
-	    header->keyPtr) > (recSize + AM_si + AM_ss))
+	if (((header->numinfreeList)*nodeSize + header->recIdPtr -
+	    header->keyPtr) > (recSize + nodeSize))
 	/*there is enough space in the freelist and in the middle put together */
 	{
 		/* Compact the freelist so that we get enough space in the middle                   so that the new key can be inserted */
@@ -71,7 +149,8 @@ int status;/* Whether key is a new key or an old key */
 		bcopy(tempPage,pageBuf,PF_PAGE_SIZE);
 		bcopy(pageBuf,header,AM_sl);
 		/* Insert into leaf a new key - no need to split */
-		AM_InsertToLeafNotFound(pageBuf,value,recId,index,header);
+		AM_InsertToLeafNotFound(pageBuf,value,recId,index,header,
+					payload);
 		header->numKeys++;
 		bcopy(header,pageBuf,AM_sl);
 		return(TRUE);
@@ -82,11 +161,12 @@ int status;/* Whether key is a new key or an old key */
 
 
 /* Insert into leaf given the fact that the key is old */
-AM_InsertToLeafFound(pageBuf,recId,index,header)
+AM_InsertToLeafFound(pageBuf,recId,index,header,payload)
 char *pageBuf;
 int recId;
 int index;
 AM_LEAFHEADER *header;
+char *payload; /* header->payloadLength bytes, or NULL for zeros */
 
 {
 	int recSize;
@@ -96,7 +176,7 @@ AM_LEAFHEADER *header;
 	recSize = header->attrLength + AM_ss;
 	if ((header->freeListPtr) == 0)
 	{
-		header->recIdPtr = header->recIdPtr - AM_si - AM_ss;
+		header->recIdPtr = header->recIdPtr - AM_RecIdSize(header);
 		tempPtr = header->recIdPtr;
 	}
 	else 
@@ -120,16 +200,26 @@ AM_LEAFHEADER *header;
 
 	/* make the old head of list the second on list */
 	bcopy((char *)&oldhead,pageBuf + tempPtr+AM_si,AM_ss);
+
+	/* the covered columns follow the recId */
+	if (header->payloadLength > 0)
+		if (payload != NULL)
+			bcopy(payload,pageBuf + tempPtr + AM_si + AM_ss,
+			      header->payloadLength);
+		else
+			bzero(pageBuf + tempPtr + AM_si + AM_ss,
+			      header->payloadLength);
 }
 
 
 /* Insert to a leaf given that the key is new */
-AM_InsertToLeafNotFound(pageBuf,value,recId,index,header)
+AM_InsertToLeafNotFound(pageBuf,value,recId,index,header,payload)
 char *pageBuf;
 char *value;
 int recId;
 int index;
 AM_LEAFHEADER *header;
+char *payload;
 
 {
 	int recSize;
@@ -153,7 +243,7 @@ AM_LEAFHEADER *header;
 	       header->attrLength,AM_ss);
 	
 	/* Now insert as if key were old key */
-	AM_InsertToLeafFound(pageBuf,recId,index,header);
+	AM_InsertToLeafFound(pageBuf,recId,index,header,payload);
 }
 
 
@@ -168,53 +258,82 @@ char *pageBuf;
 char *tempPage;
 AM_LEAFHEADER *header;
 
+{
+	AM_LEAFHEADER temphead,*tempheader;
+
+	tempheader = &temphead;
+	bcopy(header,tempheader,AM_sl);
+
+	/* Initialise the header of an empty page and fill it */
+	tempheader->recIdPtr = PF_PAGE_SIZE;
+	tempheader->keyPtr = AM_sl;
+	tempheader->freeListPtr = 0;
+	tempheader->numinfreeList = 0;
+	tempheader->numKeys = 0;
+	bcopy(tempheader,tempPage,AM_sl);
+	AM_LeafAppend(low,high,pageBuf,tempPage);
+}
+
+
+/* Appends keys low to high of the leaf in pageBuf, with their recId lists, 
+after the keys of the leaf in tempPage, which has no freelist and room for 
+them. The two leaves share attrLength and payloadLength */
+AM_LeafAppend(low,high,pageBuf,tempPage)
+
+int low;
+int high;
+char *pageBuf;
+char *tempPage;
+
 {
 
 	short nextRec;
 	AM_LEAFHEADER temphead,*tempheader;
 	short recIdPtr;
 	int recSize;
+	int nodeSize; /* bytes of a recId node */
 	int i,j;
 	int offset1,offset2;
 
 	tempheader = &temphead;
-	bcopy(header,tempheader,AM_sl);
+	bcopy(tempPage,tempheader,AM_sl);
 	
-	recSize = header->attrLength + AM_ss;
-	recIdPtr = PF_PAGE_SIZE - AM_si - AM_ss ;
+	recSize = tempheader->attrLength + AM_ss;
+	nodeSize = AM_RecIdSize(tempheader);
+	recIdPtr = tempheader->recIdPtr - nodeSize;
+	offset2 = tempheader->keyPtr - recSize; /* an empty range adds no keys */
 
-	for (i = low, j = 1; i <= high; i++,j++)
+	for (i = low, j = tempheader->numKeys + 1; i <= high; i++,j++)
 	{
 		offset1 = (i - 1) * recSize + AM_sl;
 		offset2 = (j - 1) * recSize + AM_sl;
-		bcopy(pageBuf + offset1,tempPage + offset2,header->attrLength);
-		bcopy(pageBuf + offset1 + header->attrLength,(char *)&nextRec
-		      ,AM_ss);
-		bcopy((char *)&recIdPtr,tempPage + offset2 + header->attrLength,
-		       AM_ss);
+		bcopy(pageBuf + offset1,tempPage + offset2,
+		      tempheader->attrLength);
+		bcopy(pageBuf + offset1 + tempheader->attrLength,
+		      (char *)&nextRec,AM_ss);
+		bcopy((char *)&recIdPtr,tempPage + offset2 + 
+		      tempheader->attrLength,AM_ss);
 		while (nextRec != 0)
 		{
 			bcopy(pageBuf + nextRec,tempPage + recIdPtr,AM_si);
-			recIdPtr = recIdPtr - AM_si - AM_ss;
-			bcopy((char *)&recIdPtr,tempPage + recIdPtr + 2 * AM_si 
-			       + AM_ss,
+			bcopy(pageBuf + nextRec + AM_si + AM_ss,
+			      tempPage + recIdPtr + AM_si + AM_ss,
+			      tempheader->payloadLength);
+			recIdPtr = recIdPtr - nodeSize;
+			/* link the node just copied to the next one */
+			bcopy((char *)&recIdPtr,tempPage + recIdPtr + nodeSize
+			       + AM_si,
 			AM_ss);
 			bcopy(pageBuf + nextRec + AM_si,(char *)&nextRec,AM_ss);
 		}
-		bcopy((char *)&nextRec,tempPage + recIdPtr + 2 * AM_si + AM_ss,
+		bcopy((char *)&nextRec,tempPage + recIdPtr + nodeSize + AM_si,
 		      AM_ss);
 	}
 
-	/* Initialise the header appropriately */
-	tempheader->pageType = header->pageType;
-	tempheader->nextLeafPage = header->nextLeafPage;
-	tempheader->recIdPtr = recIdPtr + AM_si + AM_ss;
+	/* Update the header */
+	tempheader->recIdPtr = recIdPtr + nodeSize;
 	tempheader->keyPtr = offset2 + recSize;
-	tempheader->freeListPtr = 0;
-	tempheader->numinfreeList = 0;
-	tempheader->attrLength = header->attrLength;
-	tempheader->numKeys = high - low + 1;
-	tempheader->maxKeys = header->maxKeys;
+	tempheader->numKeys = tempheader->numKeys + high - low + 1;
 	bcopy(tempheader,tempPage,AM_sl);
 
 }
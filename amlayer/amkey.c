@@ -0,0 +1,155 @@
+# include <stdio.h>
+# include "am.h"
+# include "pf.h"
+
+/* Composite keys.
+
+An index on several columns stores one 'k' key per entry: the columns,
+leading first, each encoded so that the bytes of two keys compare with
+memcmp in the order of the column values:
+
+	'i'	4 bytes, big endian, sign bit flipped
+	'f'	4 bytes, big endian; the sign bit of a positive value is set,
+		every bit of a negative one is flipped. -0.0 is stored as 0.0
+	'c'	colLength bytes, the string padded with NULs
+
+A key is as long as its columns together, so the tree and the scans treat
+it as one fixed length attribute and never look at the columns. A key
+holding only its leading columns, the rest zero, is the smallest key with
+that prefix; AM_OpenPrefixScan starts there. */
+
+
+/* Returns the bytes of the first numCols columns of keyDesc, or an error
+if keyDesc is not a valid descriptor */
+AM_KeyLength(keyDesc,numCols)
+AM_KEYDESC *keyDesc;
+int numCols;
+
+{
+	int i;
+	int length;
+
+	if ((keyDesc == NULL) || (keyDesc->numCols < 1) ||
+	    (keyDesc->numCols > AM_MAXCOLS))
+	{
+		AM_Errno = AME_INVALIDVALUE;
+		return(AME_INVALIDVALUE);
+	}
+	if ((numCols < 0) || (numCols > keyDesc->numCols))
+	{
+		AM_Errno = AME_INVALIDVALUE;
+		return(AME_INVALIDVALUE);
+	}
+
+	length = 0;
+	for (i = 0; i < keyDesc->numCols; i++)
+	{
+		switch (keyDesc->colType[i])
+		{
+		case 'i' :
+		case 'f' :
+			if (keyDesc->colLength[i] != 4)
+			{
+				AM_Errno = AME_INVALIDATTRLENGTH;
+				return(AME_INVALIDATTRLENGTH);
+			}
+			break;
+		case 'c' :
+			if ((keyDesc->colLength[i] < 1) ||
+			    (keyDesc->colLength[i] > 255))
+			{
+				AM_Errno = AME_INVALIDATTRLENGTH;
+				return(AME_INVALIDATTRLENGTH);
+			}
+			break;
+		default :
+			AM_Errno = AME_INVALIDATTRTYPE;
+			return(AME_INVALIDATTRTYPE);
+		}
+		if (i < numCols)
+			length += keyDesc->colLength[i];
+	}
+	return(length);
+}
+
+
+/* stores the 32 bits of u most significant byte first */
+static AM_PutBigEndian(keyPtr,u)
+unsigned char *keyPtr;
+unsigned int u;
+
+{
+	keyPtr[0] = u >> 24;
+	keyPtr[1] = u >> 16;
+	keyPtr[2] = u >> 8;
+	keyPtr[3] = u;
+}
+
+
+/* Encodes the first numCols columns of a key of the composite index
+fileDesc into keyBuf, which must hold the whole key; the columns after
+them are zeroed. values[i] points to the value of column i: an int, a
+float or a string of up to colLength bytes. Returns the bytes encoded,
+which is the prefix length to pass to AM_OpenPrefixScan */
+AM_EncodeKey(fileDesc,values,numCols,keyBuf)
+int fileDesc;
+char **values;
+int numCols;
+char *keyBuf;
+
+{
+	AM_INDEX *indexp;
+	AM_KEYDESC *keyDesc;
+	char *keyPtr;
+	int length;
+	int i,j;
+	int intVal;
+	float floatVal;
+	unsigned int u;
+
+	indexp = AM_GetIndex(fileDesc);
+	if (indexp == NULL) return(AM_Errno);
+	if (indexp->attrType != 'k')
+	{
+		AM_Errno = AME_INVALIDATTRTYPE;
+		return(AME_INVALIDATTRTYPE);
+	}
+	keyDesc = &indexp->keyDesc;
+	length = AM_KeyLength(keyDesc,numCols);
+	if (length < 0) return(length);
+	if ((values == NULL && numCols > 0) || keyBuf == NULL)
+	{
+		AM_Errno = AME_INVALIDVALUE;
+		return(AME_INVALIDVALUE);
+	}
+
+	keyPtr = keyBuf;
+	for (i = 0; i < numCols; i++)
+	{
+		switch (keyDesc->colType[i])
+		{
+		case 'i' :
+			bcopy(values[i],(char *)&intVal,AM_si);
+			AM_PutBigEndian(keyPtr,(unsigned int)intVal ^ 0x80000000u);
+			break;
+		case 'f' :
+			bcopy(values[i],(char *)&floatVal,AM_sf);
+			if (floatVal == 0.0) floatVal = 0.0;
+			bcopy((char *)&floatVal,(char *)&u,AM_sf);
+			if (u & 0x80000000u) u = ~u;
+			else u |= 0x80000000u;
+			AM_PutBigEndian(keyPtr,u);
+			break;
+		case 'c' :
+			for (j = 0; j < keyDesc->colLength[i] &&
+			     values[i][j] != '\0'; j++)
+				keyPtr[j] = values[i][j];
+			for (; j < keyDesc->colLength[i]; j++)
+				keyPtr[j] = '\0';
+			break;
+		}
+		keyPtr += keyDesc->colLength[i];
+	}
+	bzero(keyPtr,indexp->attrLength - length);
+	return(length);
+}
@@ -0,0 +1,707 @@
+# include <stdio.h>
+# include <pthread.h>
+# include <sched.h>
+# include "am.h"
+# include "pf.h"
+
+/* Inserts and lookups that many threads can run at once on one index.
+
+They work on pages latched with PF_LatchPage, after PF_SetThreaded(TRUE),
+and descend by latch crabbing: a lookup latches the child shared before it
+lets go of the parent. An insert first tries the same descent and latches
+only the leaf exclusive, which it may do once it holds its parent shared,
+since a split of the leaf needs the parent exclusive. If the leaf is full
+it starts again from the root with exclusive latches, letting go of the
+ancestors above every internal node with room for one more key, and then
+splits with AM_SplitLeaf and AM_AddtoParent as AM_InsertEntry does. Latches
+are taken top down and, among leaves, left to right, so operations never
+wait on each other in a cycle. One split runs at a time; lookups and
+inserts into other leaves go on meanwhile. An operation that finds no
+free buffer while it holds latches lets go of them and starts over. A
+split allocates every page it may need, one for the leaf, one for each
+full ancestor it holds and one more if the root splits, before it changes
+any; if the pool has no room for them it lets all of them go and starts
+over, so a split is done whole or not at all.
+
+Only indexes of fixed length keys and int recIds can be used; the index is
+opened and closed, scanned and deleted from by one thread only. The
+posting list of a key is written under the exclusive latch of its leaf,
+and read under a shared one with each of its pages latched shared, since
+other readers of the key may be at the same page. No page is fixed with
+PF_GetThisPage while it may be latched shared (see pf.h): descents latch
+every node, nodes of variable length keys are refused before they are
+searched, hashed indexes and their overflow buckets are refused outright,
+the Bloom filter is probed in memory, and a split or a meta page write
+fixes only pages it holds exclusive. */
+
+# define AM_LATCHRETRY 1 /* out of buffers: let go of everything and
+			    start over */
+
+static pthread_mutex_t AM_splitMutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* pages AM_LatchSplit allocated for the split under way, handed out by
+AM_NewPage; filled and used under AM_splitMutex */
+static int *AM_sparePage;
+static char **AM_spareBuf;
+static int AM_numSpare,AM_maxSpare;
+
+
+/* checks the header of a latched page and says whether it is a leaf */
+static AM_LatchCheck(pageBuf,attrLength)
+char *pageBuf;
+int attrLength;
+
+{
+	AM_LEAFHEADER lhead;
+	AM_INTHEADER ihead;
+
+	if (*pageBuf == 'L' || *pageBuf == 'I')
+		return(AME_NOTSUPPORTED);
+	if (*pageBuf == 'l')
+	{
+		bcopy(pageBuf,&lhead,AM_sl);
+		if (lhead.attrLength != attrLength)
+			return(AME_INVALIDATTRLENGTH);
+		return(TRUE);
+	}
+	bcopy(pageBuf,&ihead,AM_sint);
+	if (ihead.attrLength != attrLength)
+		return(AME_INVALIDATTRLENGTH);
+	return(FALSE);
+}
+
+
+/* what a PF error in the middle of a descent means: AM_LATCHRETRY if the
+buffers ran out, so that the caller lets go of its latches and starts
+over (see PF_LatchPage) */
+static AM_LatchError(errVal)
+int errVal;
+
+{
+	if (errVal == PFE_NOBUF) return(AM_LATCHRETRY);
+	AM_Errno = AME_PF;
+	return(AME_PF);
+}
+
+
+/* Descends to the leaf where value is or belongs, holding the latch of a
+child before letting go of its parent. The leaf is left latched, exclusive
+if exclusive is TRUE, the rest shared. Returns AM_LATCHRETRY, with nothing
+latched, if it ran out of buffers on the way */
+static AM_LatchDescend(fileDesc,indexp,attrType,attrLength,value,exclusive,
+		       pageNum,pageBuf)
+int fileDesc;
+AM_INDEX *indexp;
+char attrType;
+int attrLength;
+char *value;
+int exclusive;
+int *pageNum; /* the leaf */
+char **pageBuf;
+
+{
+	AM_INTHEADER ihead;
+	int errVal;
+	int isLeaf;
+	int childNum;
+	int index;
+	char *childBuf;
+
+	for (;;)
+	{
+		*pageNum = indexp->rootPageNum;
+		errVal = PF_LatchPage(fileDesc,*pageNum,pageBuf,FALSE);
+		if (errVal != PFE_OK) return(AM_LatchError(errVal));
+		isLeaf = AM_LatchCheck(*pageBuf,attrLength);
+		if (isLeaf < 0)
+		{
+			PF_UnlatchPage(fileDesc,*pageNum,FALSE);
+			return(isLeaf);
+		}
+		if (!isLeaf || !exclusive) break;
+
+		/* the root is the leaf: latch it again, exclusive, unless it
+		split in between */
+		errVal = PF_UnlatchPage(fileDesc,*pageNum,FALSE);
+		if (errVal == PFE_OK)
+			errVal = PF_LatchPage(fileDesc,*pageNum,pageBuf,TRUE);
+		if (errVal != PFE_OK) return(AM_LatchError(errVal));
+		if (**pageBuf == 'l') return(AME_OK);
+		errVal = PF_UnlatchPage(fileDesc,*pageNum,FALSE);
+		if (errVal != PFE_OK) return(AM_LatchError(errVal));
+	}
+
+	while (!isLeaf)
+	{
+		bcopy(*pageBuf,&ihead,AM_sint);
+		childNum = AM_BinSearch(*pageBuf,attrType,attrLength,value,
+					&index,&ihead);
+		errVal = PF_LatchPage(fileDesc,childNum,&childBuf,FALSE);
+		if (errVal != PFE_OK)
+		{
+			PF_UnlatchPage(fileDesc,*pageNum,FALSE);
+			return(AM_LatchError(errVal));
+		}
+		isLeaf = AM_LatchCheck(childBuf,attrLength);
+		if (isLeaf == TRUE && exclusive)
+		{
+			/* nobody can split the leaf while we hold the parent */
+			errVal = PF_UnlatchPage(fileDesc,childNum,FALSE);
+			if (errVal == PFE_OK)
+				errVal = PF_LatchPage(fileDesc,childNum,&childBuf,
+						      TRUE);
+			if (errVal != PFE_OK)
+			{
+				PF_UnlatchPage(fileDesc,*pageNum,FALSE);
+				return(AM_LatchError(errVal));
+			}
+		}
+		errVal = PF_UnlatchPage(fileDesc,*pageNum,FALSE);
+		*pageNum = childNum;
+		*pageBuf = childBuf;
+		if (isLeaf < 0)
+		{
+			PF_UnlatchPage(fileDesc,*pageNum,FALSE);
+			return(isLeaf);
+		}
+		if (errVal != PFE_OK)
+		{
+			PF_UnlatchPage(fileDesc,*pageNum,FALSE);
+			return(AM_LatchError(errVal));
+		}
+	}
+	return(AME_OK);
+}
+
+
+/* a page for a split: one AM_LatchSplit set aside if there is any, else a
+new one from PF_AllocPage. AM_SplitLeaf and AM_AddtoParent get their pages
+here */
+AM_NewPage(fileDesc,pageNum,pageBuf)
+int fileDesc;
+int *pageNum;
+char **pageBuf;
+
+{
+	if (AM_numSpare > 0)
+	{
+		AM_numSpare--;
+		*pageNum = AM_sparePage[AM_numSpare];
+		*pageBuf = AM_spareBuf[AM_numSpare];
+		return(PFE_OK);
+	}
+	return(PF_AllocPage(fileDesc,pageNum,pageBuf));
+}
+
+
+/* gives back the pages set aside that the split did not use */
+static AM_FreeSpare(fileDesc)
+int fileDesc;
+
+{
+	int errVal;
+	int retval;
+
+	retval = AME_OK;
+	while (AM_numSpare > 0)
+	{
+		AM_numSpare--;
+		errVal = PF_UnfixPage(fileDesc,AM_sparePage[AM_numSpare],FALSE);
+		if (errVal == PFE_OK)
+			errVal = PF_DisposePage(fileDesc,
+						AM_sparePage[AM_numSpare]);
+		if (errVal != PFE_OK) retval = AME_PF;
+	}
+	return(retval);
+}
+
+
+/* allocates count pages for AM_NewPage to hand out. Returns AM_LATCHRETRY,
+with none set aside, if the buffers ran out */
+static AM_SetSpare(fileDesc,count)
+int fileDesc;
+int count;
+
+{
+	int errVal;
+	int *pages;
+	char **bufs;
+
+	if (count > AM_maxSpare)
+	{
+		pages = (int *)realloc(AM_sparePage,count*AM_si);
+		if (pages != NULL) AM_sparePage = pages;
+		bufs = (char **)realloc(AM_spareBuf,count*sizeof(char *));
+		if (bufs != NULL) AM_spareBuf = bufs;
+		if (pages == NULL || bufs == NULL)
+		{
+			AM_Errno = AME_NOMEM;
+			return(AME_NOMEM);
+		}
+		AM_maxSpare = count;
+	}
+	while (AM_numSpare < count)
+	{
+		errVal = PF_AllocPage(fileDesc,&AM_sparePage[AM_numSpare],
+				      &AM_spareBuf[AM_numSpare]);
+		if (errVal != PFE_OK)
+		{
+			AM_FreeSpare(fileDesc);
+			return(AM_LatchError(errVal));
+		}
+		AM_numSpare++;
+	}
+	return(AME_OK);
+}
+
+
+/* lets go of the pages on held, last latched first */
+static AM_LatchRelease(fileDesc,held,dirty)
+int fileDesc;
+AM_STACK *held;
+int dirty;
+
+{
+	int errVal;
+	int retval;
+
+	retval = AME_OK;
+	for (; held->top >= 0; held->top--)
+	{
+		errVal = PF_UnlatchPage(fileDesc,
+					held->entry[held->top].pageNumber,dirty);
+		if (errVal != PFE_OK) retval = AME_PF;
+	}
+	AM_EmptyStack(held);
+	return(retval);
+}
+
+
+/* The insert of a key into a full leaf: descends again with exclusive
+latches, keeping those of the nodes a split may reach, and splits. Every
+page the split writes is latched, or allocated, before the first of them
+changes, so running out of buffers never leaves it half done. Called with
+AM_splitMutex held. Returns AM_LATCHRETRY if it ran out of buffers before
+it changed anything */
+static AM_LatchSplit(fileDesc,indexp,attrType,attrLength,value,recId)
+int fileDesc;
+AM_INDEX *indexp;
+char attrType;
+int attrLength;
+char *value;
+int recId;
+
+{
+	AM_STACK stack; /* the path, as AM_AddtoParent wants it */
+	AM_STACK held; /* pages latched, root side first */
+	AM_INTHEADER ihead;
+	AM_LEAFHEADER lhead;
+	char key[AM_MAXATTRLENGTH]; /* key going to the parent */
+	char *pageBuf;
+	int pageNum;
+	int nextPage;
+	int index;
+	int status;
+	int isLeaf;
+	int inserted;
+	int fullNodes; /* full internal nodes held: each splits */
+	int rootSplits; /* whether the root is one of them */
+	int newPages; /* pages the split allocates */
+	int errVal;
+
+	AM_InitStack(&stack);
+	AM_InitStack(&held);
+	pageNum = indexp->rootPageNum;
+	errVal = PF_LatchPage(fileDesc,pageNum,&pageBuf,TRUE);
+	if (errVal != PFE_OK) return(AM_LatchError(errVal));
+	AM_PushStack(&held,pageNum,0);
+	fullNodes = 0;
+	rootSplits = FALSE;
+	while ((isLeaf = AM_LatchCheck(pageBuf,attrLength)) == FALSE)
+	{
+		bcopy(pageBuf,&ihead,AM_sint);
+		if (ihead.numKeys == ihead.maxKeys)
+		{
+			fullNodes++;
+			if (pageNum == indexp->rootPageNum) rootSplits = TRUE;
+		}
+		nextPage = AM_BinSearch(pageBuf,attrType,attrLength,value,
+					&index,&ihead);
+		errVal = AM_PushStack(&stack,pageNum,index);
+		if (errVal < 0) goto fail;
+		pageNum = nextPage;
+		errVal = PF_LatchPage(fileDesc,pageNum,&pageBuf,TRUE);
+		if (errVal != PFE_OK)
+		{
+			errVal = AM_LatchError(errVal);
+			goto fail;
+		}
+
+		/* a node with room for one more key stops a split from going
+		further up */
+		bcopy(pageBuf,&ihead,AM_sint);
+		if (*pageBuf == 'i' && ihead.numKeys < ihead.maxKeys)
+		{
+			errVal = AM_LatchRelease(fileDesc,&held,FALSE);
+			if (errVal < 0)
+			{
+				PF_UnlatchPage(fileDesc,pageNum,FALSE);
+				goto fail;
+			}
+			fullNodes = 0;
+			rootSplits = FALSE;
+		}
+		errVal = AM_PushStack(&held,pageNum,0);
+		if (errVal < 0)
+		{
+			PF_UnlatchPage(fileDesc,pageNum,FALSE);
+			goto fail;
+		}
+	}
+	if (isLeaf < 0)
+	{
+		errVal = isLeaf;
+		goto fail;
+	}
+
+	/* another insert may have split the leaf since it was found full */
+	bcopy(pageBuf,&lhead,AM_sl);
+	status = AM_SearchLeaf(pageBuf,attrType,attrLength,value,&index,&lhead);
+	inserted = (status == AM_FOUND) ?
+		   AM_PostInsert(fileDesc,pageBuf,index,recId) : FALSE;
+	if (inserted == FALSE)
+		inserted = AM_InsertintoLeaf(pageBuf,attrLength,value,recId,
+					     index,status,(char *)NULL);
+	if (inserted < 0)
+	{
+		errVal = inserted;
+		goto fail;
+	}
+	if (inserted == TRUE)
+	{
+		/* only the leaf, on top of held, changed */
+		AM_EmptyStack(&stack);
+		errVal = PF_UnlatchPage(fileDesc,pageNum,TRUE);
+		held.top--;
+		if (AM_LatchRelease(fileDesc,&held,FALSE) < 0 || errVal != PFE_OK)
+			return(AME_PF);
+		return(AME_OK);
+	}
+
+	/* the split sets the back-link of the next leaf too */
+	if (lhead.nextLeafPage != AM_NULL_PAGE)
+	{
+		errVal = PF_LatchPage(fileDesc,lhead.nextLeafPage,&pageBuf,TRUE);
+		if (errVal != PFE_OK)
+		{
+			errVal = AM_LatchError(errVal);
+			goto fail;
+		}
+		errVal = AM_PushStack(&held,lhead.nextLeafPage,0);
+		if (errVal < 0)
+		{
+			PF_UnlatchPage(fileDesc,lhead.nextLeafPage,FALSE);
+			goto fail;
+		}
+	}
+
+	/* a new root, from a split of the leaf or of the root above it,
+	is recorded on the meta page, which nobody else latches */
+	if (pageNum == indexp->rootPageNum) rootSplits = TRUE;
+	if (rootSplits && indexp->hasMeta)
+	{
+		errVal = PF_LatchPage(fileDesc,AM_META_PAGE,&pageBuf,TRUE);
+		if (errVal != PFE_OK)
+		{
+			errVal = AM_LatchError(errVal);
+			goto fail;
+		}
+		errVal = AM_PushStack(&held,AM_META_PAGE,0);
+		if (errVal < 0)
+		{
+			PF_UnlatchPage(fileDesc,AM_META_PAGE,FALSE);
+			goto fail;
+		}
+	}
+
+	/* the new leaf, a new node for each full node, and one more for the
+	half of the root that moves out of it */
+	newPages = 1 + fullNodes + (rootSplits ? 1 : 0);
+	errVal = AM_SetSpare(fileDesc,newPages);
+	if (errVal < 0) goto fail;
+
+	/* AM_SplitLeaf and AM_AddtoParent fix what they change; we hold the
+	latch of every such page, and the new pages are in the spares */
+	errVal = PF_GetThisPage(fileDesc,pageNum,&pageBuf);
+	if (errVal != PFE_OK)
+	{
+		errVal = AME_PF;
+		goto fail;
+	}
+	indexp->rightPageNum = AM_NULL_PAGE;
+	errVal = AM_SplitLeaf(fileDesc,pageBuf,&pageNum,attrLength,recId,value,
+			      status,index,key,(char *)NULL);
+	if (errVal == TRUE)
+		errVal = AM_AddtoParent(fileDesc,pageNum,key,attrLength,&stack);
+	if (errVal < 0) goto fail;
+
+	/* the pages changed were marked dirty as they were unfixed */
+	AM_EmptyStack(&stack);
+	errVal = AM_FreeSpare(fileDesc);
+	if (AM_LatchRelease(fileDesc,&held,FALSE) < 0) errVal = AME_PF;
+	return(errVal);
+
+fail:
+	AM_EmptyStack(&stack);
+	AM_FreeSpare(fileDesc);
+	AM_LatchRelease(fileDesc,&held,FALSE);
+	return(errVal);
+}
+
+
+/* checks the arguments of a latched call, returning the index or NULL with
+AM_Errno set */
+static AM_INDEX *AM_LatchIndex(fileDesc,attrType,value)
+int fileDesc;
+char attrType;
+char *value;
+
+{
+	AM_INDEX *indexp;
+
+	if ((attrType != 'c') && (attrType != 'f') && (attrType != 'i') &&
+	    (attrType != 'k'))
+	{
+		AM_Errno = AME_INVALIDATTRTYPE;
+		return(NULL);
+	}
+	if (value == NULL)
+	{
+		AM_Errno = AME_INVALIDVALUE;
+		return(NULL);
+	}
+	indexp = AM_GetIndex(fileDesc);
+	if (indexp == NULL) return(NULL);
+	if ((indexp->ridLength == AM_sr) || indexp->hashed)
+	{
+		AM_Errno = AME_NOTSUPPORTED;
+		return(NULL);
+	}
+	return(indexp);
+}
+
+
+/* marks the filter of an index stale on its meta page, for the insert
+that dirtied it; the caller holds no latch, so the meta latch is waited
+for rather than given up */
+static AM_LatchStale(fileDesc,indexp)
+int fileDesc;
+AM_INDEX *indexp;
+
+{
+	char *pageBuf;
+	int errVal;
+
+	if (!indexp->hasMeta) return(AME_OK);
+	errVal = PF_LatchPage(fileDesc,AM_META_PAGE,&pageBuf,TRUE);
+	if (errVal != PFE_OK) return(AME_PF);
+	errVal = AM_WriteMeta(fileDesc,indexp);
+	if (PF_UnlatchPage(fileDesc,AM_META_PAGE,FALSE) != PFE_OK)
+		return(AME_PF);
+	return(errVal);
+}
+
+
+/* Inserts a value,recId pair like AM_InsertEntry; any number of threads
+may call it at once on an index */
+AM_InsertEntryLatched(fileDesc,attrType,attrLength,value,recId)
+int fileDesc;
+char attrType;
+int attrLength;
+char *value;
+int recId;
+
+{
+	AM_INDEX *indexp;
+	AM_LEAFHEADER lhead;
+	char *pageBuf;
+	int pageNum;
+	int index;
+	int status;
+	int inserted;
+	int errVal;
+
+	indexp = AM_LatchIndex(fileDesc,attrType,value);
+	if (indexp == NULL) return(AM_Errno);
+	if (recId == AM_POSTLIST && indexp->payloadLength == 0)
+	{
+		AM_Errno = AME_INVALIDVALUE;
+		return(AME_INVALIDVALUE);
+	}
+
+	/* its bits are set before the key can be found */
+	errVal = AM_FilterAdd(indexp,attrType,attrLength,value);
+	if (errVal == TRUE) errVal = AM_LatchStale(fileDesc,indexp);
+	if (errVal != AME_OK)
+	{
+		AM_Errno = errVal;
+		return(errVal);
+	}
+
+	while ((errVal = AM_LatchDescend(fileDesc,indexp,attrType,attrLength,
+					 value,TRUE,&pageNum,&pageBuf)) ==
+	       AM_LATCHRETRY)
+		sched_yield();
+	if (errVal < 0)
+	{
+		AM_Errno = errVal;
+		return(errVal);
+	}
+	bcopy(pageBuf,&lhead,AM_sl);
+	status = AM_SearchLeaf(pageBuf,attrType,attrLength,value,&index,&lhead);
+	inserted = (status == AM_FOUND) ?
+		   AM_PostInsert(fileDesc,pageBuf,index,recId) : FALSE;
+	if (inserted == FALSE)
+		inserted = AM_InsertintoLeaf(pageBuf,attrLength,value,recId,
+					     index,status,(char *)NULL);
+	errVal = PF_UnlatchPage(fileDesc,pageNum,inserted == TRUE);
+	if (inserted < 0)
+	{
+		AM_Errno = inserted;
+		return(inserted);
+	}
+	AM_Check;
+	if (inserted == TRUE) return(AME_OK);
+
+	/* the leaf must split */
+	for (;;)
+	{
+		pthread_mutex_lock(&AM_splitMutex);
+		errVal = AM_LatchSplit(fileDesc,indexp,attrType,attrLength,value,
+				       recId);
+		pthread_mutex_unlock(&AM_splitMutex);
+		if (errVal != AM_LATCHRETRY) break;
+		sched_yield();
+	}
+	if (errVal < 0)
+	{
+		AM_Errno = errVal;
+		return(errVal);
+	}
+	return(AME_OK);
+}
+
+
+/* copies at most maxRecIds recIds of the posting list starting at listPage
+to recIds, and how many it has to numRecIds. Its pages are latched shared
+in turn, as other readers of the key may be at them; returns AM_LATCHRETRY
+if the buffers ran out, for the caller to let go of the leaf and start
+over */
+static AM_LatchPosting(fileDesc,listPage,recIds,maxRecIds,numRecIds)
+int fileDesc;
+int listPage;
+int *recIds;
+int maxRecIds;
+int *numRecIds;
+
+{
+	AM_POSTHEADER head;
+	int rids[AM_MAXPOSTRIDS];
+	char *pageBuf;
+	int pageNum;
+	int num,i;
+	int errVal;
+
+	*numRecIds = 0;
+	for (pageNum = listPage; pageNum != AM_NULL_PAGE; pageNum = head.nextPage)
+	{
+		errVal = PF_LatchPage(fileDesc,pageNum,&pageBuf,FALSE);
+		if (errVal != PFE_OK) return(AM_LatchError(errVal));
+		bcopy(pageBuf,&head,AM_sp);
+		num = AM_PostDecode(pageBuf,rids);
+		errVal = PF_UnlatchPage(fileDesc,pageNum,FALSE);
+		if (errVal != PFE_OK) return(AM_LatchError(errVal));
+		for (i = 0; i < num; i++,(*numRecIds)++)
+			if (*numRecIds < maxRecIds)
+				recIds[*numRecIds] = rids[i];
+	}
+	return(AME_OK);
+}
+
+
+/* Looks value up and stores at most maxRecIds of its recIds at recIds;
+returns how many it has, 0 if value is not in the index. Any number of
+threads may call it at once on an index, inserting with
+AM_InsertEntryLatched meanwhile */
+AM_LookupLatched(fileDesc,attrType,attrLength,value,recIds,maxRecIds)
+int fileDesc;
+char attrType;
+int attrLength;
+char *value;
+int *recIds;
+int maxRecIds;
+
+{
+	AM_INDEX *indexp;
+	AM_LEAFHEADER lhead;
+	char *pageBuf;
+	int pageNum;
+	int index;
+	int numRecIds;
+	short nextRec;
+	int listPage;
+	int status;
+	int errVal;
+
+	indexp = AM_LatchIndex(fileDesc,attrType,value);
+	if (indexp == NULL) return(AM_Errno);
+	if (AM_FilterMiss(indexp,attrType,attrLength,value)) return(0);
+
+	for (;;)
+	{
+		while ((errVal = AM_LatchDescend(fileDesc,indexp,attrType,
+						 attrLength,value,FALSE,&pageNum,
+						 &pageBuf)) == AM_LATCHRETRY)
+			sched_yield();
+		if (errVal < 0)
+		{
+			AM_Errno = errVal;
+			return(errVal);
+		}
+		bcopy(pageBuf,&lhead,AM_sl);
+		numRecIds = 0;
+		status = AME_OK;
+		if (AM_SearchLeaf(pageBuf,attrType,attrLength,value,&index,
+				  &lhead) == AM_FOUND)
+		{
+			nextRec = AM_LeafHead(pageBuf,index);
+			listPage = AM_PostList(pageBuf,nextRec);
+			if (listPage != AM_NULL_PAGE)
+			{
+				/* the leaf latch keeps the list as it is */
+				status = AM_LatchPosting(fileDesc,listPage,recIds,
+							 maxRecIds,&numRecIds);
+				nextRec = AM_NULL;
+			}
+			while (nextRec != AM_NULL)
+			{
+				if (numRecIds < maxRecIds)
+					bcopy(pageBuf + nextRec,
+					      (char *)&recIds[numRecIds],AM_si);
+				numRecIds++;
+				bcopy(pageBuf + nextRec + AM_si,(char *)&nextRec,
+				      AM_ss);
+			}
+		}
+		errVal = PF_UnlatchPage(fileDesc,pageNum,FALSE);
+		if (status != AM_LATCHRETRY || errVal != PFE_OK) break;
+		sched_yield();
+	}
+	if (status < 0)
+	{
+		AM_Errno = status;
+		return(status);
+	}
+	AM_Check;
+	return(numRecIds);
+}
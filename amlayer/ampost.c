@@ -0,0 +1,536 @@
+# include <stdio.h>
+# include <stdlib.h>
+# include "am.h"
+# include "pf.h"
+
+/* Posting lists. A key of a fixed leaf with int recIds and no payload
+keeps its recIds in the leaf as a list of nodes until it has AM_PostingMin
+of them; the next insert moves them to a posting list, pages of their own
+holding the recIds in ascending order, each stored as a varint of its
+difference from the one before. The key's list in the leaf is left with
+two nodes, one with recId AM_POSTLIST and one with the first page of the
+posting list, so that splits, merges and compaction of the leaf carry it
+about like any other list. The pages of a list are chained in recId
+order; a page that fills up splits in two, a page other than the first
+that empties is freed, and the whole list is freed with its last recId,
+when the key leaves the leaf. */
+
+
+/* compares two recIds for qsort, as unsigned */
+static AM_PostCmp(a,b)
+char *a;
+char *b;
+
+{
+	unsigned int x,y;
+
+	x = *(unsigned int *)a;
+	y = *(unsigned int *)b;
+	return((x > y) - (x < y));
+}
+
+
+/* bytes of the varint of delta */
+static AM_VarintSize(delta)
+unsigned int delta;
+
+{
+	int len;
+
+	for (len = 1; delta >= 0x80; len++)
+		delta >>= 7;
+	return(len);
+}
+
+
+/* Returns how many of the sorted recIds rids[0..num-1], num > 0, fit in
+room bytes, the first stored whole */
+static AM_PostFit(rids,num,room)
+int *rids;
+int num;
+int room;
+
+{
+	unsigned int prev;
+	int i;
+
+	prev = 0;
+	for (i = 0; i < num; i++)
+	{
+		room -= AM_VarintSize((unsigned int)rids[i] - prev);
+		if (room < 0) break;
+		prev = rids[i];
+	}
+	return(i);
+}
+
+
+/* Writes the sorted recIds rids[0..num-1], num > 0, into a posting page
+with the header in head, which gets their count, bytes and last recId */
+static AM_PostWrite(pageBuf,head,rids,num)
+char *pageBuf;
+AM_POSTHEADER *head;
+int *rids;
+int num;
+
+{
+	unsigned char *p;
+	unsigned int prev,delta;
+	int i;
+
+	p = (unsigned char *)pageBuf + AM_sp;
+	prev = 0;
+	for (i = 0; i < num; i++)
+	{
+		delta = (unsigned int)rids[i] - prev;
+		prev = rids[i];
+		while (delta >= 0x80)
+		{
+			*p++ = (delta & 0x7f) | 0x80;
+			delta >>= 7;
+		}
+		*p++ = delta;
+	}
+	head->pageType = 'p';
+	head->numRids = num;
+	head->bytes = p - (unsigned char *)pageBuf - AM_sp;
+	head->lastRid = prev;
+	bcopy(head,pageBuf,AM_sp);
+}
+
+
+/* Decodes the recIds of a posting page into rids, which has room for
+AM_MAXPOSTRIDS; returns how many there are */
+AM_PostDecode(pageBuf,rids)
+char *pageBuf;
+int *rids;
+
+{
+	AM_POSTHEADER head;
+	unsigned char *p,*end;
+	unsigned int rid,delta;
+	int shift,num;
+
+	bcopy(pageBuf,&head,AM_sp);
+	p = (unsigned char *)pageBuf + AM_sp;
+	end = p + head.bytes;
+	rid = 0;
+	for (num = 0; p < end; num++)
+	{
+		delta = 0;
+		for (shift = 0; *p & 0x80; shift += 7)
+			delta |= (unsigned int)(*p++ & 0x7f) << shift;
+		delta |= (unsigned int)*p++ << shift;
+		rid += delta;
+		rids[num] = rid;
+	}
+	return(num);
+}
+
+
+/* First page of the posting list of the recId list starting at node
+nextRec of a leaf, or AM_NULL_PAGE if it is a list of nodes */
+AM_PostList(pageBuf,nextRec)
+char *pageBuf;
+int nextRec;
+
+{
+	AM_LEAFHEADER head;
+	int recId;
+	short second;
+
+	if (nextRec == AM_NULL || *pageBuf != 'l') return(AM_NULL_PAGE);
+	bcopy(pageBuf + nextRec,(char *)&recId,AM_si);
+	if (recId != AM_POSTLIST) return(AM_NULL_PAGE);
+	bcopy(pageBuf,&head,AM_sl);
+	if (head.payloadLength != 0) return(AM_NULL_PAGE);
+	bcopy(pageBuf + nextRec + AM_si,(char *)&second,AM_ss);
+	bcopy(pageBuf + second,(char *)&recId,AM_si);
+	return(recId);
+}
+
+
+/* Writes the sorted recIds rids[0..num-1], num > 0, to a new posting list
+whose first page is returned in listPage; the pages are filled up */
+AM_PostCreate(fileDesc,rids,num,listPage)
+int fileDesc;
+int *rids;
+int num;
+int *listPage;
+
+{
+	AM_POSTHEADER head;
+	char *pageBuf,*nextBuf;
+	int pageNum,nextNum;
+	int count;
+	int errVal;
+
+	errVal = PF_AllocPage(fileDesc,&pageNum,&pageBuf);
+	AM_Check;
+	*listPage = pageNum;
+	for (;;)
+	{
+		count = AM_PostFit(rids,num,PF_PAGE_SIZE - AM_sp);
+		head.nextPage = AM_NULL_PAGE;
+		head.listPage = *listPage;
+		AM_PostWrite(pageBuf,&head,rids,count);
+		rids += count;
+		num -= count;
+		if (num > 0)
+		{
+			errVal = PF_AllocPage(fileDesc,&nextNum,&nextBuf);
+			if (errVal != PFE_OK)
+			{
+				PF_UnfixPage(fileDesc,pageNum,TRUE);
+				AM_Errno = AME_PF;
+				return(AME_PF);
+			}
+			head.nextPage = nextNum;
+			bcopy(&head,pageBuf,AM_sp);
+		}
+		errVal = PF_UnfixPage(fileDesc,pageNum,TRUE);
+		AM_Check;
+		if (num == 0) return(AME_OK);
+		pageNum = nextNum;
+		pageBuf = nextBuf;
+	}
+}
+
+
+/* Reads page pageNum of the posting list starting at listPage: its recIds
+go to rids, which has room for AM_MAXPOSTRIDS, and the next page of the
+list to nextPage. Returns the number of recIds, or AME_NOTFOUND if the page
+is no longer in the list */
+AM_PostRead(fileDesc,listPage,pageNum,rids,nextPage)
+int fileDesc;
+int listPage;
+int pageNum;
+int *rids;
+int *nextPage;
+
+{
+	AM_POSTHEADER head;
+	char *pageBuf;
+	int num;
+	int errVal;
+
+	errVal = PF_GetThisPage(fileDesc,pageNum,&pageBuf);
+	if (errVal == PFE_INVALIDPAGE || errVal == PFE_PAGEFREE)
+		return(AME_NOTFOUND);
+	AM_Check;
+	bcopy(pageBuf,&head,AM_sp);
+	if (head.pageType != 'p' || head.listPage != listPage)
+		num = AME_NOTFOUND;
+	else
+	{
+		num = AM_PostDecode(pageBuf,rids);
+		*nextPage = head.nextPage;
+	}
+	errVal = PF_UnfixPage(fileDesc,pageNum,FALSE);
+	AM_Check;
+	return(num);
+}
+
+
+/* Counts the recIds and the pages of the posting list starting at
+listPage from the page headers; returns the recIds */
+AM_PostCount(fileDesc,listPage,numPages)
+int fileDesc;
+int listPage;
+int *numPages;
+
+{
+	AM_POSTHEADER head;
+	char *pageBuf;
+	int pageNum;
+	int num;
+	int errVal;
+
+	num = 0;
+	for (pageNum = listPage; pageNum != AM_NULL_PAGE; pageNum = head.nextPage)
+	{
+		errVal = PF_GetThisPage(fileDesc,pageNum,&pageBuf);
+		AM_Check;
+		bcopy(pageBuf,&head,AM_sp);
+		errVal = PF_UnfixPage(fileDesc,pageNum,FALSE);
+		AM_Check;
+		num += head.numRids;
+		(*numPages)++;
+	}
+	return(num);
+}
+
+
+/* Adds recId to the posting list starting at listPage, on the first page
+whose last recId is not below it, or the last page. A full page splits in
+half, except that a recId past the end of the list starts a new last page,
+so that recIds inserted in file order fill their pages */
+static AM_PostAdd(fileDesc,listPage,recId)
+int fileDesc;
+int listPage;
+int recId;
+
+{
+	AM_POSTHEADER head,newHead;
+	char *pageBuf,*newBuf;
+	int rids[AM_MAXPOSTRIDS + 1];
+	int pageNum,newNum;
+	int num,keep,i;
+	int errVal;
+
+	pageNum = listPage;
+	for (;;)
+	{
+		errVal = PF_GetThisPage(fileDesc,pageNum,&pageBuf);
+		AM_Check;
+		bcopy(pageBuf,&head,AM_sp);
+		if (head.nextPage == AM_NULL_PAGE ||
+		    (head.numRids > 0 && (unsigned int)recId <= head.lastRid))
+			break;
+		errVal = PF_UnfixPage(fileDesc,pageNum,FALSE);
+		AM_Check;
+		pageNum = head.nextPage;
+	}
+
+	num = AM_PostDecode(pageBuf,rids);
+	for (i = num; i > 0 && (unsigned int)rids[i - 1] > (unsigned int)recId;
+	     i--)
+		rids[i] = rids[i - 1];
+	rids[i] = recId;
+	num++;
+	if (AM_PostFit(rids,num,PF_PAGE_SIZE - AM_sp) == num)
+	{
+		AM_PostWrite(pageBuf,&head,rids,num);
+		errVal = PF_UnfixPage(fileDesc,pageNum,TRUE);
+		AM_Check;
+		return(AME_OK);
+	}
+
+	/* split the page */
+	if (i == num - 1 && head.nextPage == AM_NULL_PAGE)
+		keep = num - 1;
+	else
+		keep = num / 2;
+	errVal = PF_AllocPage(fileDesc,&newNum,&newBuf);
+	if (errVal != PFE_OK)
+	{
+		PF_UnfixPage(fileDesc,pageNum,FALSE);
+		AM_Errno = AME_PF;
+		return(AME_PF);
+	}
+	newHead.nextPage = head.nextPage;
+	newHead.listPage = listPage;
+	AM_PostWrite(newBuf,&newHead,rids + keep,num - keep);
+	head.nextPage = newNum;
+	AM_PostWrite(pageBuf,&head,rids,keep);
+	errVal = PF_UnfixPage(fileDesc,newNum,TRUE);
+	AM_Check;
+	errVal = PF_UnfixPage(fileDesc,pageNum,TRUE);
+	AM_Check;
+	return(AME_OK);
+}
+
+
+/* Frees the pages of the posting list starting at listPage */
+static AM_PostFree(fileDesc,listPage)
+int fileDesc;
+int listPage;
+
+{
+	AM_POSTHEADER head;
+	char *pageBuf;
+	int pageNum;
+	int errVal;
+
+	for (pageNum = listPage; pageNum != AM_NULL_PAGE; pageNum = head.nextPage)
+	{
+		errVal = PF_GetThisPage(fileDesc,pageNum,&pageBuf);
+		AM_Check;
+		bcopy(pageBuf,&head,AM_sp);
+		errVal = PF_UnfixPage(fileDesc,pageNum,FALSE);
+		AM_Check;
+		errVal = PF_DisposePage(fileDesc,pageNum);
+		AM_Check;
+	}
+	return(AME_OK);
+}
+
+
+/* Removes recId from the posting list starting at listPage. empty is set
+if that was its last recId, in which case the list has been freed */
+AM_PostRemove(fileDesc,listPage,recId,empty)
+int fileDesc;
+int listPage;
+int recId;
+int *empty;
+
+{
+	AM_POSTHEADER head,prevHead;
+	char *pageBuf,*prevBuf;
+	int rids[AM_MAXPOSTRIDS];
+	int pageNum,prevNum;
+	int num,i;
+	int errVal;
+
+	*empty = FALSE;
+	prevNum = AM_NULL_PAGE;
+	pageNum = listPage;
+	for (;;)
+	{
+		errVal = PF_GetThisPage(fileDesc,pageNum,&pageBuf);
+		AM_Check;
+		bcopy(pageBuf,&head,AM_sp);
+		if (head.numRids > 0 && (unsigned int)recId <= head.lastRid)
+			break;
+		errVal = PF_UnfixPage(fileDesc,pageNum,FALSE);
+		AM_Check;
+		if (head.nextPage == AM_NULL_PAGE)
+			return(AME_NOTFOUND);
+		prevNum = pageNum;
+		pageNum = head.nextPage;
+	}
+
+	num = AM_PostDecode(pageBuf,rids);
+	for (i = 0; i < num && rids[i] != recId; i++)
+		;
+	if (i == num)
+	{
+		errVal = PF_UnfixPage(fileDesc,pageNum,FALSE);
+		AM_Check;
+		return(AME_NOTFOUND);
+	}
+	for (num--; i < num; i++)
+		rids[i] = rids[i + 1];
+
+	if (num > 0)
+	{
+		/* dropping a recId never lengthens the varints */
+		AM_PostWrite(pageBuf,&head,rids,num);
+		errVal = PF_UnfixPage(fileDesc,pageNum,TRUE);
+		AM_Check;
+		return(AME_OK);
+	}
+
+	if (pageNum == listPage)
+	{
+		/* the first page stays while the list has other pages */
+		head.numRids = head.bytes = 0;
+		bcopy(&head,pageBuf,AM_sp);
+		errVal = PF_UnfixPage(fileDesc,pageNum,TRUE);
+		AM_Check;
+		if (head.nextPage != AM_NULL_PAGE) return(AME_OK);
+		*empty = TRUE;
+		return(AM_PostFree(fileDesc,listPage));
+	}
+
+	/* unlink the empty page from the one before */
+	errVal = PF_UnfixPage(fileDesc,pageNum,FALSE);
+	AM_Check;
+	errVal = PF_GetThisPage(fileDesc,prevNum,&prevBuf);
+	AM_Check;
+	bcopy(prevBuf,&prevHead,AM_sp);
+	prevHead.nextPage = head.nextPage;
+	bcopy(&prevHead,prevBuf,AM_sp);
+	errVal = PF_UnfixPage(fileDesc,prevNum,TRUE);
+	AM_Check;
+	errVal = PF_DisposePage(fileDesc,pageNum);
+	AM_Check;
+	if (prevNum == listPage && prevHead.numRids == 0 &&
+	    prevHead.nextPage == AM_NULL_PAGE)
+	{
+		*empty = TRUE;
+		return(AM_PostFree(fileDesc,listPage));
+	}
+	return(AME_OK);
+}
+
+
+/* Puts recId into the list of key index of a leaf, found there, if that
+is a posting list or becomes one: a list of nodes with AM_PostingMin recIds
+or more moves to a new posting list, and the leaf keeps the first two nodes
+to name it. Returns TRUE if recId went in, FALSE if it is for the leaf's
+list of nodes, < 0 on error. The leaf is changed only when a list moves */
+AM_PostInsert(fileDesc,pageBuf,index,recId)
+int fileDesc;
+char *pageBuf; /* fixed leaf */
+int index;
+int recId;
+
+{
+	AM_LEAFHEADER head;
+	int rids[PF_PAGE_SIZE / (AM_si + AM_ss) + 1];
+	int listPage;
+	int num,errVal;
+	short first,second,nextRec,oldhead;
+	int postList = AM_POSTLIST;
+
+	if (*pageBuf != 'l') return(FALSE);
+	first = AM_LeafHead(pageBuf,index);
+	listPage = AM_PostList(pageBuf,first);
+	if (listPage != AM_NULL_PAGE)
+		return((errVal = AM_PostAdd(fileDesc,listPage,recId)) < 0 ?
+		       errVal : TRUE);
+
+	bcopy(pageBuf,&head,AM_sl);
+	if (AM_PostingMin <= 0 || head.payloadLength != 0) return(FALSE);
+	num = 0;
+	for (nextRec = first; nextRec != AM_NULL && num <= AM_PostingMin; )
+	{
+		bcopy(pageBuf + nextRec,(char *)&rids[num++],AM_si);
+		bcopy(pageBuf + nextRec + AM_si,(char *)&nextRec,AM_ss);
+	}
+	if (num < AM_PostingMin || num < 2) return(FALSE);
+	while (nextRec != AM_NULL)
+	{
+		bcopy(pageBuf + nextRec,(char *)&rids[num++],AM_si);
+		bcopy(pageBuf + nextRec + AM_si,(char *)&nextRec,AM_ss);
+	}
+	rids[num++] = recId;
+	qsort((char *)rids,num,AM_si,AM_PostCmp);
+	errVal = AM_PostCreate(fileDesc,rids,num,&listPage);
+	if (errVal < 0) return(errVal);
+
+	/* the first node marks the list and the second names its first page;
+	the others go to the free list */
+	bcopy(pageBuf + first + AM_si,(char *)&second,AM_ss);
+	bcopy(pageBuf + second + AM_si,(char *)&nextRec,AM_ss);
+	bcopy((char *)&postList,pageBuf + first,AM_si);
+	bcopy((char *)&listPage,pageBuf + second,AM_si);
+	oldhead = AM_NULL;
+	bcopy((char *)&oldhead,pageBuf + second + AM_si,AM_ss);
+	while (nextRec != AM_NULL)
+	{
+		oldhead = head.freeListPtr;
+		head.freeListPtr = nextRec;
+		head.numinfreeList++;
+		bcopy(pageBuf + nextRec + AM_si,(char *)&nextRec,AM_ss);
+		bcopy((char *)&oldhead,pageBuf + head.freeListPtr + AM_si,AM_ss);
+	}
+	bcopy(&head,pageBuf,AM_sl);
+	return(TRUE);
+}
+
+
+/* Makes a posting list of rids[0..num-1], in any order, for the last key
+of a leaf being built by AM_BulkLoad, whose list is empty */
+AM_PostLoad(fileDesc,pageBuf,header,rids,num)
+int fileDesc;
+char *pageBuf;
+AM_LEAFHEADER *header;
+int *rids;
+int num;
+
+{
+	int listPage;
+	int errVal;
+
+	qsort((char *)rids,num,AM_si,AM_PostCmp);
+	errVal = AM_PostCreate(fileDesc,rids,num,&listPage);
+	if (errVal < 0) return(errVal);
+	AM_InsertToLeafFound(pageBuf,listPage,header->numKeys,header,
+			     (char *)NULL);
+	AM_InsertToLeafFound(pageBuf,AM_POSTLIST,header->numKeys,header,
+			     (char *)NULL);
+	bcopy(header,pageBuf,AM_sl);
+	return(AME_OK);
+}
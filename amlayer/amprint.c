@@ -8,24 +8,22 @@ char attrType;
 {
 int tempPageint;
 int i;
-int recSize;
+char keyBuf[AM_MAXATTRLENGTH];
 AM_INTHEADER *header;
 
 
 header = (AM_INTHEADER *) calloc(1,AM_sint);
 bcopy(pageBuf,header,AM_sint);
-recSize = header->attrLength + AM_si;
 printf("PAGETYPE %c\n",header->pageType);
 printf("NUMKEYS %d\n",header->numKeys);
 printf("MAXKEYS %d\n",header->maxKeys);
 printf("ATTRLENGTH %d\n",header->attrLength);
-bcopy(pageBuf + AM_sint,&tempPageint,AM_si);
+tempPageint = AM_IntChild(pageBuf,0);
 printf("FIRSTPAGE is %d\n",tempPageint);
 for(i = 1 ; i <= (header->numKeys);i++)
   {
-   AM_PrintAttr(pageBuf + (i-1)*recSize + AM_sint + AM_si,attrType,
-                 header->attrLength);
-   bcopy(pageBuf + i*recSize + AM_sint,&tempPageint,AM_si);
+   AM_PrintAttr(AM_IntKey(pageBuf,i,keyBuf),attrType,header->attrLength);
+   tempPageint = AM_IntChild(pageBuf,i);
    printf("NEXTPAGE is %d\n",tempPageint);
   }
 }
@@ -38,16 +36,15 @@ char attrType;
 {
 short nextRec;
 int i;
-int recSize;
 int recId;
-int offset1;
+char keyBuf[AM_MAXATTRLENGTH];
 AM_LEAFHEADER *header;
 
 header = (AM_LEAFHEADER *) calloc(1,AM_sl);
 bcopy(pageBuf,header,AM_sl);
-recSize = header->attrLength + AM_ss;
 printf("PAGETYPE %c\n",header->pageType);
 printf("NEXTLEAFPAGE %d\n",header->nextLeafPage);
+printf("PREVLEAFPAGE %d\n",header->prevLeafPage);
 /*printf("RECIDPTR %d\n",header->recIdPtr);
 printf("KEYPTR %d\n",header->keyPtr);
 printf("FREELISTPTR %d\n",header->freeListPtr);
@@ -57,9 +54,13 @@ printf("MAXKEYS %d\n",header->maxKeys);*/
 printf("NUMKEYS %d\n",header->numKeys);
 for (i = 1; i <= header->numKeys; i++)
   {
-  offset1 = (i - 1) * recSize + AM_sl;
-  AM_PrintAttr(pageBuf + AM_sl + (i-1)*recSize,attrType,header->attrLength);
-  bcopy(pageBuf + offset1 + header->attrLength,(char *)&nextRec,AM_ss);
+  AM_PrintAttr(AM_LeafKey(pageBuf,i,keyBuf),attrType,header->attrLength);
+  nextRec = AM_LeafHead(pageBuf,i);
+  if (AM_PostList(pageBuf,nextRec) != AM_NULL_PAGE)
+    {
+    printf("POSTING LIST at page %d\n",AM_PostList(pageBuf,nextRec));
+    nextRec = 0;
+    }
   while (nextRec != 0)
     {
     bcopy(pageBuf + nextRec,(char *)&recId,AM_si);
@@ -89,8 +90,9 @@ AM_LEAFHEADER *header;
 
 value = malloc(AM_si);
 bcopy(&min,value,AM_si);
-printf("%d PAGE \n",AM_LeftPageNum);
-PF_GetThisPage(fileDesc,AM_LeftPageNum,&pageBuf);
+pageNum = AM_GetIndex(fileDesc)->leftPageNum;
+printf("%d PAGE \n",pageNum);
+PF_GetThisPage(fileDesc,pageNum,&pageBuf);
 header = (AM_LEAFHEADER *) calloc(1,AM_sl);
 bcopy(pageBuf,header,AM_sl);
 while(header->nextLeafPage != -1)
@@ -119,19 +121,21 @@ char attrType;
 {
 short nextRec;
 int i;
-int recSize;
 int recId;
-int offset1;
+char keyBuf[AM_MAXATTRLENGTH];
 AM_LEAFHEADER *header;
 
 header = (AM_LEAFHEADER *) calloc(1,AM_sl);
 bcopy(pageBuf,header,AM_sl);
-recSize = header->attrLength + AM_ss;
 for (i = 1; i <= header->numKeys; i++)
   {
-  offset1 = (i - 1) * recSize + AM_sl;
-  AM_PrintAttr(pageBuf + AM_sl + (i-1)*recSize,attrType,header->attrLength);
-  bcopy(pageBuf + offset1 + header->attrLength,(char *)&nextRec,AM_ss);
+  AM_PrintAttr(AM_LeafKey(pageBuf,i,keyBuf),attrType,header->attrLength);
+  nextRec = AM_LeafHead(pageBuf,i);
+  if (AM_PostList(pageBuf,nextRec) != AM_NULL_PAGE)
+    {
+    printf("POSTING LIST at page %d\n",AM_PostList(pageBuf,nextRec));
+    nextRec = 0;
+    }
   while (nextRec != 0)
     {
     bcopy(pageBuf + nextRec,(char *)&recId,AM_si);
@@ -151,6 +155,7 @@ int attrLength;
 int bufint;
 float buffloat;
 char *bufstr;
+int i;
 
 switch(attrType)
   {
@@ -172,6 +177,13 @@ switch(attrType)
                free(bufstr);
 	       break;
               }
+   case 'k' : {
+               printf("ATTRIBUTE is ");
+               for (i = 0; i < attrLength; i++)
+                 printf("%02x",(unsigned char)bufPtr[i]);
+               printf("\n");
+	       break;
+              }
    }
 }
 
@@ -187,7 +199,6 @@ int errVal;
 AM_INTHEADER *header;
 char *tempPage;
 char *pageBuf;
-int recSize;
 int i;
 
 printf("GETTING PAGE = %d\n",pageNum);
@@ -195,7 +206,7 @@ errVal = PF_GetThisPage(fileDesc,pageNum,&pageBuf);
 tempPage = malloc(PF_PAGE_SIZE);
 bcopy(pageBuf,tempPage,PF_PAGE_SIZE);
 errVal = PF_UnfixPage(fileDesc,pageNum,FALSE);
-if (*tempPage == 'l')
+if (AM_IsLeaf(tempPage))
   {
    printf("PAGENUM = %d\n",pageNum);
    AM_PrintLeafKeys(tempPage,attrType);
@@ -203,13 +214,114 @@ if (*tempPage == 'l')
   }
 header = (AM_INTHEADER *)calloc(1,AM_sint);
 bcopy(tempPage,header,AM_sint);
-recSize = header->attrLength + AM_si;
 for(i = 1; i <= (header->numKeys + 1); i++)
   {
-   bcopy(tempPage + AM_sint + (i-1)*recSize,&nextPage,AM_si);
+   nextPage = AM_IntChild(tempPage,i - 1);
    AM_PrintTree(fileDesc,nextPage,attrType);
   }
 printf("PAGENUM = %d",pageNum);
 AM_PrintIntNode(tempPage,attrType);
 }
 
+/* Accumulates page and key counts for the subtree at pageNum into stats.
+depth is the level of pageNum, the root being 1. */
+static AM_SubtreeStats(fileDesc,pageNum,depth,stats)
+int fileDesc;
+int pageNum;
+int depth;
+AM_TREESTATS *stats;
+
+{
+int nextPage;
+int errVal;
+AM_INTHEADER inthead;
+AM_VLEAFHEADER leafhead;
+char *pageBuf;
+char *tempPage;
+short nextRec;
+int listPage,count;
+int i;
+
+errVal = PF_GetThisPage(fileDesc,pageNum,&pageBuf);
+AM_Check;
+tempPage = malloc(PF_PAGE_SIZE);
+bcopy(pageBuf,tempPage,PF_PAGE_SIZE);
+errVal = PF_UnfixPage(fileDesc,pageNum,FALSE);
+if (errVal != PFE_OK)
+  {
+   free(tempPage);
+   AM_Errno = AME_PF;
+   return(AME_PF);
+  }
+if (AM_IsLeaf(tempPage))
+  {
+   bcopy(tempPage,&leafhead,AM_svl);
+   if (depth > stats->height) stats->height = depth;
+   stats->leafPages++;
+   stats->numKeys += leafhead.h.numKeys;
+   stats->leafBytes += PF_PAGE_SIZE - (leafhead.h.recIdPtr - leafhead.h.keyPtr)
+                       - leafhead.h.numinfreeList*AM_RecIdSize(&leafhead.h);
+   /* deleted entries of a var leaf are not in use either */
+   if (*tempPage == 'L') stats->leafBytes -= leafhead.garbage;
+   for (i = 1; i <= leafhead.h.numKeys; i++)
+     {
+      nextRec = AM_LeafHead(tempPage,i);
+      listPage = AM_PostList(tempPage,nextRec);
+      if (listPage != AM_NULL_PAGE)
+        {
+         count = AM_PostCount(fileDesc,listPage,&stats->postPages);
+         if (count < 0)
+           {
+            free(tempPage);
+            return(count);
+           }
+         stats->numRecIds += count;
+         nextRec = 0;
+        }
+      while (nextRec != 0)
+        {
+         stats->numRecIds++;
+         bcopy(tempPage + nextRec + AM_si,(char *)&nextRec,AM_ss);
+        }
+     }
+   free(tempPage);
+   return(AME_OK);
+  }
+stats->intPages++;
+bcopy(tempPage,&inthead,AM_sint);
+for(i = 1; i <= (inthead.numKeys + 1); i++)
+  {
+   nextPage = AM_IntChild(tempPage,i - 1);
+   errVal = AM_SubtreeStats(fileDesc,nextPage,depth + 1,stats);
+   if (errVal != AME_OK)
+     {
+      free(tempPage);
+      return(errVal);
+     }
+  }
+free(tempPage);
+return(AME_OK);
+}
+
+/* Fills stats with page and key counts for the whole index */
+AM_TreeStats(fileDesc,stats)
+int fileDesc;
+AM_TREESTATS *stats;
+
+{
+AM_INDEX *indexp;
+
+indexp = AM_GetIndex(fileDesc);
+if (indexp == NULL) return(AM_Errno);
+if (indexp->hashed)
+ {
+  AM_Errno = AME_NOTSUPPORTED;
+  return(AME_NOTSUPPORTED);
+ }
+stats->height = stats->leafPages = stats->intPages = 0;
+stats->numKeys = stats->numRecIds = stats->leafBytes = 0;
+stats->postPages = 0;
+stats->filterPages = (indexp->filterBlocks + AM_FILTERPERPAGE - 1)/
+		     AM_FILTERPERPAGE;
+return(AM_SubtreeStats(fileDesc,indexp->rootPageNum,1,stats));
+}
@@ -1,10 +1,12 @@
 
 # include <stdio.h>
+# include <stdlib.h>
+# include <string.h>
 # include "am.h"
 # include "pf.h"
 
 /* The structure of the scan Table */
-struct {
+typedef struct {
          int fileDesc;
          int op;
          int attrType;
@@ -18,7 +20,134 @@ struct {
          int lastpageNum;
          short lastIndex;
          int status;
-       } AM_scanTable[MAXSCANS];
+         short prefixLength; /* > 0: keys must start with prefix */
+         char prefix[AM_MAXATTRLENGTH];
+         short payloadLength; /* bytes after the next pointer of the last
+                                 entry */
+         char payload[AM_si + AM_MAXPAYLOAD]; /* and those bytes */
+         short ridLength; /* AM_sr: the payload starts with the high half
+                             of the recId */
+         short keyLength; /* 0 until an entry is returned */
+         char key[AM_MAXATTRLENGTH]; /* key of the last entry returned */
+         short desc; /* TRUE: keys in descending order, stopping before
+                        lastpageNum, lastIndex */
+         int nextFree; /* FREE entries: the next free entry, or -1 */
+         int pfParent; /* parent of the leaves in pfPages */
+         short pfChild; /* child number in pfParent of pfPages[0] */
+         short pfPos; /* pfPages[pfPos] is the leaf being scanned */
+         short pfCount; /* leaves in pfPages, 0 if none */
+         short pfEnd; /* TRUE: pfPages ends at the last child of pfParent
+                         or the last leaf of the scan */
+         int pfPages[AM_MAXPREFETCH + 1]; /* leaves in scan order, those
+                                              after pfPos read ahead */
+         int postList; /* first page of the posting list being read,
+                          AM_NULL_PAGE if none */
+         int postPage; /* its page postRids was read from */
+         int postStarted; /* TRUE once a recId of it is returned */
+         int postLast; /* the last recId returned from it */
+         short postCount; /* recIds in postRids */
+         short postPos; /* the next of them to return */
+         int *postRids; /* AM_MAXPOSTRIDS recIds, of a posting list page or
+                           a hash bucket page, malloc'd when first needed
+                           and kept with the entry */
+         short hashed; /* TRUE: a scan of a hash index, which reads the
+                          recIds of its key, kept in key, from each page of
+                          the bucket into postRids */
+         short hashLength; /* the length of that key */
+         int hashPage; /* the bucket page to read next, AM_NULL_PAGE after
+                          the last */
+       } AM_SCAN;
+
+/* The scan table grows by doubling; free entries are chained through
+nextFree so that opening and closing a scan take constant time */
+# define AM_MINSCANS 16
+static AM_SCAN *AM_scanTable = NULL;
+static int AM_numScans = 0; /* entries in AM_scanTable */
+static int AM_freeScan = -1; /* head of the free entries */
+static int AM_scansOpen[AM_MAXINDEXES]; /* open scans of each index */
+
+/* a descriptor returned by AM_ScanAlloc and not yet released */
+# define AM_ValidScan(scanDesc) ((scanDesc) >= 0 && \
+  (scanDesc) < AM_numScans && AM_scanTable[scanDesc].status != FREE)
+
+/* scans that stop at lastpageNum, lastIndex */
+# define AM_Bounded(scanDesc) ((AM_scanTable[scanDesc].op == LESS_THAN) || \
+  (AM_scanTable[scanDesc].op == LESS_THAN_EQUAL) || \
+  (AM_scanTable[scanDesc].op == BETWEEN))
+
+static AM_ScanNext();
+static AM_ScanPrev();
+static AM_ScanPrefetch();
+static AM_ScanPosting();
+static AM_ScanHash();
+
+
+/* takes a free entry of the scan table for fileDesc, growing the table if
+there is none */
+static AM_ScanAlloc(fileDesc)
+int fileDesc;
+
+{
+int scanDesc;
+int size;
+AM_SCAN *table;
+
+if (AM_freeScan < 0)
+  {
+   size = (AM_numScans == 0) ? AM_MINSCANS : 2*AM_numScans;
+   table = (AM_SCAN *)realloc((char *)AM_scanTable,size*sizeof(AM_SCAN));
+   if (table == NULL)
+     {
+      AM_Errno = AME_NOMEM;
+      return(AME_NOMEM);
+     }
+   AM_scanTable = table;
+   for (scanDesc = size - 1; scanDesc >= AM_numScans; scanDesc--)
+     {
+      AM_scanTable[scanDesc].status = FREE;
+      AM_scanTable[scanDesc].postRids = NULL;
+      AM_scanTable[scanDesc].nextFree = AM_freeScan;
+      AM_freeScan = scanDesc;
+     }
+   AM_numScans = size;
+  }
+scanDesc = AM_freeScan;
+AM_freeScan = AM_scanTable[scanDesc].nextFree;
+AM_scanTable[scanDesc].fileDesc = fileDesc;
+AM_scanTable[scanDesc].postList = AM_NULL_PAGE;
+AM_scansOpen[fileDesc]++;
+return(scanDesc);
+}
+
+
+/* mallocs the recId buffer of a scan entry unless it has one */
+static AM_ScanBuffer(scanDesc)
+int scanDesc;
+
+{
+if (AM_scanTable[scanDesc].postRids == NULL)
+ {
+  AM_scanTable[scanDesc].postRids = (int *)malloc(AM_MAXPOSTRIDS*AM_si);
+  if (AM_scanTable[scanDesc].postRids == NULL)
+   {
+    AM_Errno = AME_NOMEM;
+    return(AME_NOMEM);
+   }
+ }
+return(AME_OK);
+}
+
+
+/* returns an entry to the free list */
+static AM_ScanRelease(scanDesc)
+int scanDesc;
+
+{
+AM_scansOpen[AM_scanTable[scanDesc].fileDesc]--;
+AM_scanTable[scanDesc].status = FREE;
+AM_scanTable[scanDesc].nextFree = AM_freeScan;
+AM_freeScan = scanDesc;
+}
 
 
 /* Opens an index scan */
@@ -35,11 +164,13 @@ int scanDesc; /* index into scan table */
 int status; /* whether value is found or not in the tree */
 int index; /* index of value in leaf */
 int pageNum;/* page number of leaf page where value is found */
-int recSize; /* size of key,ptr pair in leaf */
 char *pageBuf; /* buffer for page */
 int errVal; /* return value of functions */
 AM_LEAFHEADER head,*header; /* local header */
 int searchpageNum;
+int leftPageNum; /* leftmost leaf of the tree */
+char *leftBuf; /* buffer of the leftmost leaf */
+AM_INDEX *indexp; /* the open index */
 
 
 
@@ -50,7 +181,8 @@ if (fileDesc < 0)
    return(AME_FD);
   }
 
-if ((attrType != 'i') && (attrType != 'c') && (attrType != 'f'))
+if ((attrType != 'i') && (attrType != 'c') && (attrType != 'f') &&
+    (attrType != 'k'))
   {
   AM_Errno = AME_INVALIDATTRTYPE;
   return(AME_INVALIDATTRTYPE);
@@ -59,66 +191,104 @@ if ((attrType != 'i') && (attrType != 'c') && (attrType != 'f'))
 /* initialise header */
 header = &head;
 
-/* find a vacant place in the scan table */
-for (scanDesc = 0; scanDesc <  MAXSCANS;scanDesc++)
-  if (AM_scanTable[scanDesc].status == FREE) break;
+/* the leftmost leaf comes from the index's meta page */
+indexp = AM_GetIndex(fileDesc);
+if (indexp == NULL)
+   return(AM_Errno);
+leftPageNum = indexp->leftPageNum;
 
-/* scan table is full */
-if (scanDesc > MAXSCANS - 1) 
- {
- AM_Errno = AME_SCAN_TAB_FULL;
- return(AME_SCAN_TAB_FULL);
- }
+/* a hash index has equality scans only */
+if (indexp->hashed && ((op != EQUAL) || (value == NULL)))
+  {
+   AM_Errno = AME_INVALID_OP_TO_SCAN;
+   return(AME_INVALID_OP_TO_SCAN);
+  }
 
-/* there is room */
+/* take an entry of the scan table */
+scanDesc = AM_ScanAlloc(fileDesc);
+if (scanDesc < 0)
+   return(scanDesc);
 AM_scanTable[scanDesc].status = FIRST;
 AM_scanTable[scanDesc].attrType = attrType;
+AM_scanTable[scanDesc].prefixLength = 0;
+AM_scanTable[scanDesc].payloadLength = 0;
+AM_scanTable[scanDesc].keyLength = 0;
+AM_scanTable[scanDesc].desc = FALSE;
+AM_scanTable[scanDesc].pfCount = 0;
+AM_scanTable[scanDesc].pfPos = 0;
+AM_scanTable[scanDesc].ridLength = indexp->ridLength;
+AM_scanTable[scanDesc].hashed = indexp->hashed;
 
-/* initialise AM_LeftPageNum */
-AM_LeftPageNum = GetLeftPageNum(fileDesc);
+/* the bucket of value in a hash index */
+if (indexp->hashed)
+  {
+   pageNum = AM_HashBucket(indexp,attrType,attrLength,value);
+   if ((pageNum < 0) || (AM_ScanBuffer(scanDesc) != AME_OK))
+     {
+      AM_ScanRelease(scanDesc);
+      return(AM_Errno);
+     }
+   AM_scanTable[scanDesc].op = EQUAL;
+   AM_scanTable[scanDesc].hashPage = pageNum;
+   AM_scanTable[scanDesc].hashLength = attrLength;
+   AM_scanTable[scanDesc].postCount = AM_scanTable[scanDesc].postPos = 0;
+   bcopy(value,AM_scanTable[scanDesc].key,attrLength);
+   return(scanDesc);
+  }
 
 /* scan of all keys */
 if (value == NULL)
   {
    AM_scanTable[scanDesc].fileDesc = fileDesc;
    AM_scanTable[scanDesc].op = ALL;
-   AM_scanTable[scanDesc].nextpageNum = AM_LeftPageNum;
+   AM_scanTable[scanDesc].nextpageNum = leftPageNum;
    AM_scanTable[scanDesc].nextIndex = 1;
    AM_scanTable[scanDesc].actindex = 1;
-   errVal = PF_GetThisPage(fileDesc,AM_LeftPageNum,&pageBuf);
+   errVal = PF_GetThisPage(fileDesc,leftPageNum,&pageBuf);
    AM_Check;
-   bcopy(pageBuf + AM_sl + attrLength,&AM_scanTable[scanDesc].nextRecIdPtr,AM_ss);
-   errVal = PF_UnfixPage(fileDesc,AM_LeftPageNum,FALSE);
+   AM_scanTable[scanDesc].nextRecIdPtr = AM_LeafHead(pageBuf,1);
+   errVal = PF_UnfixPage(fileDesc,leftPageNum,FALSE);
    AM_Check;
    return(scanDesc);
   }
+
+/* a key the filter rules out has no match, and needs no descent */
+if ((op == EQUAL) && AM_FilterMiss(indexp,attrType,attrLength,value))
+  {
+   AM_scanTable[scanDesc].op = EQUAL;
+   AM_scanTable[scanDesc].status = OVER;
+   return(scanDesc);
+  }
   
 /* search for the pagenumber and index of value */
-status = AM_Search(fileDesc,attrType,attrLength,value,&pageNum,&pageBuf,&index);
+status = AM_Search(fileDesc,attrType,attrLength,value,&pageNum,&pageBuf,&index,
+		   (AM_STACK *)NULL);
 searchpageNum = pageNum;
 /* check for errors */
 if (status < 0) 
-  { AM_scanTable[scanDesc].status = FREE;
+  { AM_ScanRelease(scanDesc);
     AM_Errno = status;
     return(status);
   }
 
 bcopy(pageBuf,header,AM_sl);
-recSize = attrLength + AM_ss;
 AM_scanTable[scanDesc].fileDesc = fileDesc;
 AM_scanTable[scanDesc].op = op;
+/* the leftmost leaf is already fixed if it is the one searched; pageBuf
+may move on to the next leaf below */
+leftBuf = pageBuf;
 
 /* value is not in leaf but if inserted will have to be inserted after the last
 key */
 if (index > header->numKeys) 
   if (header->nextLeafPage != AM_NULL_PAGE)
   {
-  errVal = PF_GetThisPage(fileDesc,header->nextLeafPage,&pageBuf);
+  pageNum = header->nextLeafPage;
+  errVal = PF_GetThisPage(fileDesc,pageNum,&pageBuf);
   AM_Check;
   bcopy(pageBuf,header,AM_sl);
-  errVal = PF_UnfixPage(fileDesc,header->nextLeafPage,FALSE);
+  errVal = PF_UnfixPage(fileDesc,pageNum,FALSE);
   AM_Check;
-  pageNum = header->nextLeafPage;
   index = 1;
   }
   else 
@@ -142,8 +312,7 @@ switch(op)
                   AM_scanTable[scanDesc].nextpageNum = pageNum;
                   AM_scanTable[scanDesc].nextIndex = index;
                   AM_scanTable[scanDesc].actindex = index;
-                  bcopy(pageBuf + AM_sl + (index - 1)*recSize + attrLength,
-                          &AM_scanTable[scanDesc].nextRecIdPtr,AM_ss);
+                  AM_scanTable[scanDesc].nextRecIdPtr = AM_LeafHead(pageBuf,index);
                   AM_scanTable[scanDesc].lastpageNum  = pageNum;
                   AM_scanTable[scanDesc].lastIndex  = index;
                  }
@@ -151,18 +320,17 @@ switch(op)
                }
   case LESS_THAN : 
                {
-                AM_scanTable[scanDesc].nextpageNum = AM_LeftPageNum;
+                AM_scanTable[scanDesc].nextpageNum = leftPageNum;
                 AM_scanTable[scanDesc].nextIndex = 1;
                 AM_scanTable[scanDesc].actindex = 1;
-                if (searchpageNum != AM_LeftPageNum)
-		 { errVal = PF_GetThisPage(fileDesc,AM_LeftPageNum,&pageBuf);
+                if (searchpageNum != leftPageNum)
+		 { errVal = PF_GetThisPage(fileDesc,leftPageNum,&leftBuf);
                   AM_Check;
                  }
-                bcopy(pageBuf + AM_sl + attrLength,
-                        &AM_scanTable[scanDesc].nextRecIdPtr,AM_ss);
-                if (searchpageNum != AM_LeftPageNum)
+                AM_scanTable[scanDesc].nextRecIdPtr = AM_LeafHead(leftBuf,1);
+                if (searchpageNum != leftPageNum)
 		 {
-		  errVal = PF_UnfixPage(fileDesc,AM_LeftPageNum,FALSE);
+		  errVal = PF_UnfixPage(fileDesc,leftPageNum,FALSE);
                   AM_Check;
                  }
                 AM_scanTable[scanDesc].lastpageNum  = pageNum;
@@ -177,8 +345,7 @@ switch(op)
                    AM_scanTable[scanDesc].nextpageNum = pageNum;
                    AM_scanTable[scanDesc].nextIndex = index + 1;
                    AM_scanTable[scanDesc].actindex = index + 1;
-                   bcopy(pageBuf + AM_sl + (index)*recSize + attrLength,
-                             &AM_scanTable[scanDesc].nextRecIdPtr,AM_ss);
+                   AM_scanTable[scanDesc].nextRecIdPtr = AM_LeafHead(pageBuf,index + 1);
                   }
                  else
                    /* got to start from next leaf page */
@@ -189,8 +356,7 @@ switch(op)
                    AM_scanTable[scanDesc].actindex = 1;
                    errVal =PF_GetThisPage(fileDesc,header->nextLeafPage,&pageBuf);
                    AM_Check;
-                   bcopy(pageBuf + AM_sl + attrLength,
-                           &AM_scanTable[scanDesc].nextRecIdPtr,AM_ss);
+                   AM_scanTable[scanDesc].nextRecIdPtr = AM_LeafHead(pageBuf,1);
                    errVal = PF_UnfixPage(fileDesc,header->nextLeafPage,FALSE);
                    AM_Check;
                    }
@@ -201,25 +367,23 @@ switch(op)
                    AM_scanTable[scanDesc].nextpageNum = pageNum;
                    AM_scanTable[scanDesc].nextIndex = index ;
                    AM_scanTable[scanDesc].actindex = index;
-                   bcopy(pageBuf + AM_sl + (index - 1)*recSize + attrLength,
-                              &AM_scanTable[scanDesc].nextRecIdPtr,AM_ss);
+                   AM_scanTable[scanDesc].nextRecIdPtr = AM_LeafHead(pageBuf,index);
                  }
                 break;
                }
   case LESS_THAN_EQUAL :
                {
-               AM_scanTable[scanDesc].nextpageNum = AM_LeftPageNum;
+               AM_scanTable[scanDesc].nextpageNum = leftPageNum;
                AM_scanTable[scanDesc].nextIndex = 1;
                AM_scanTable[scanDesc].actindex = 1;
-                if (searchpageNum != AM_LeftPageNum)
-		 { errVal = PF_GetThisPage(fileDesc,AM_LeftPageNum,&pageBuf);
+                if (searchpageNum != leftPageNum)
+		 { errVal = PF_GetThisPage(fileDesc,leftPageNum,&leftBuf);
                   AM_Check;
                  }
-               bcopy(pageBuf + AM_sl + attrLength,
-                                 &AM_scanTable[scanDesc].nextRecIdPtr,AM_ss);
-               if (searchpageNum != AM_LeftPageNum)
+               AM_scanTable[scanDesc].nextRecIdPtr = AM_LeafHead(leftBuf,1);
+               if (searchpageNum != leftPageNum)
 		 {
-		  errVal = PF_UnfixPage(fileDesc,AM_LeftPageNum,FALSE);
+		  errVal = PF_UnfixPage(fileDesc,leftPageNum,FALSE);
                   AM_Check;
                  }		   
                AM_scanTable[scanDesc].lastpageNum  = pageNum;
@@ -235,35 +399,49 @@ switch(op)
                 AM_scanTable[scanDesc].nextpageNum = pageNum;
                 AM_scanTable[scanDesc].nextIndex = index;
                 AM_scanTable[scanDesc].actindex = index;
-                bcopy(pageBuf + AM_sl + (index - 1)*recSize + attrLength,
-                        &AM_scanTable[scanDesc].nextRecIdPtr,   AM_ss);
+                AM_scanTable[scanDesc].nextRecIdPtr = AM_LeafHead(pageBuf,index);
                 break;
                }
   case NOT_EQUAL :
                {
                if(status == AM_FOUND)
                 {
-                AM_scanTable[scanDesc].nextpageNum = AM_LeftPageNum;
+                AM_scanTable[scanDesc].nextpageNum = leftPageNum;
                 AM_scanTable[scanDesc].nextIndex = 1;
                 AM_scanTable[scanDesc].actindex = 1;
-                if (searchpageNum != AM_LeftPageNum)
+                if (searchpageNum != leftPageNum)
 		  {
-		  errVal = PF_GetThisPage(fileDesc,AM_LeftPageNum,&pageBuf);
+		  errVal = PF_GetThisPage(fileDesc,leftPageNum,&leftBuf);
                   AM_Check;
 		  }
-                bcopy(pageBuf + AM_sl + attrLength,
-                              &AM_scanTable[scanDesc].nextRecIdPtr,   AM_ss);
-                if (searchpageNum != AM_LeftPageNum)
-		 { errVal = PF_UnfixPage(fileDesc,AM_LeftPageNum,FALSE);
+                AM_scanTable[scanDesc].nextRecIdPtr = AM_LeafHead(leftBuf,1);
+                if (searchpageNum != leftPageNum)
+		 { errVal = PF_UnfixPage(fileDesc,leftPageNum,FALSE);
                   AM_Check;
                  }
                 }
                else 
+                {
+                /* nothing to skip: every entry qualifies */
                 AM_scanTable[scanDesc].pageNum = AM_NULL_PAGE;
+                AM_scanTable[scanDesc].nextpageNum = leftPageNum;
+                AM_scanTable[scanDesc].nextIndex = 1;
+                AM_scanTable[scanDesc].actindex = 1;
+                if (searchpageNum != leftPageNum)
+		  {
+		  errVal = PF_GetThisPage(fileDesc,leftPageNum,&leftBuf);
+                  AM_Check;
+		  }
+                AM_scanTable[scanDesc].nextRecIdPtr = AM_LeafHead(leftBuf,1);
+                if (searchpageNum != leftPageNum)
+		 { errVal = PF_UnfixPage(fileDesc,leftPageNum,FALSE);
+                  AM_Check;
+                 }
+                }
                break;
                }
   default : {
-             AM_scanTable[scanDesc].status = FREE;
+             AM_ScanRelease(scanDesc);
 	     AM_Errno = AME_INVALID_OP_TO_SCAN;
 	     return(AME_INVALID_OP_TO_SCAN);
              break;
@@ -275,22 +453,300 @@ AM_Check;
 return(scanDesc);
 }
 
+/* Opens a scan of the keys whose first prefixLength bytes are those of
+value, in key order: the entries of a composite index ('k') that match
+its leading columns, as encoded by AM_EncodeKey, or the 'c' keys that
+start with a string */
+AM_OpenPrefixScan(fileDesc,attrType,attrLength,value,prefixLength)
+int fileDesc; /* file Descriptor */
+char attrType; /* 'k' or 'c' */
+int attrLength;
+char *value; /* its first prefixLength bytes are the prefix */
+int prefixLength;
+
+{
+int scanDesc;
+char key[AM_MAXATTRLENGTH]; /* smallest key with the prefix */
+
+if ((attrType != 'k') && (attrType != 'c'))
+  {
+  AM_Errno = AME_INVALIDATTRTYPE;
+  return(AME_INVALIDATTRTYPE);
+  }
+if ((value == NULL) || (prefixLength < 0) || (prefixLength > attrLength))
+  {
+  AM_Errno = AME_INVALIDVALUE;
+  return(AME_INVALIDVALUE);
+  }
+
+bcopy(value,key,prefixLength);
+bzero(key + prefixLength,attrLength - prefixLength);
+scanDesc = AM_OpenIndexScan(fileDesc,attrType,attrLength,GREATER_THAN_EQUAL,
+                            key);
+if (scanDesc < 0) return(scanDesc);
+AM_scanTable[scanDesc].prefixLength = prefixLength;
+bcopy(value,AM_scanTable[scanDesc].prefix,prefixLength);
+return(scanDesc);
+}
+
+/* Opens a scan of the keys from lo to hi in key order, each bound included
+if its flag is TRUE; a NULL bound leaves that end open. The leaf position
+of hi is found once here, and the scan stops there like a < or <= scan, so
+the entries are not compared with hi */
+AM_OpenRangeScan(fileDesc,attrType,attrLength,lo,loIncl,hi,hiIncl)
+int fileDesc; /* file Descriptor */
+char attrType;
+int attrLength;
+char *lo; /* smallest key, or NULL */
+int loIncl; /* TRUE for lo <= key, FALSE for lo < key */
+char *hi; /* largest key, or NULL */
+int hiIncl; /* TRUE for key <= hi, FALSE for key < hi */
+
+{
+int scanDesc;
+int status; /* whether hi is in the tree */
+int pageNum; /* leaf of hi, then of the first entry */
+int index;
+char *pageBuf;
+AM_LEAFHEADER head,*header;
+char keyBuf[AM_MAXATTRLENGTH];
+int compareVal;
+int errVal;
+
+if (lo == NULL)
+  scanDesc = AM_OpenIndexScan(fileDesc,attrType,attrLength,ALL,NULL);
+else
+  scanDesc = AM_OpenIndexScan(fileDesc,attrType,attrLength,
+               loIncl ? GREATER_THAN_EQUAL : GREATER_THAN,lo);
+if (scanDesc < 0 || hi == NULL || AM_scanTable[scanDesc].status == OVER)
+  return(scanDesc);
+
+/* the last entry, as for a < or <= scan */
+status = AM_Search(fileDesc,attrType,attrLength,hi,&pageNum,&pageBuf,&index,
+		   (AM_STACK *)NULL);
+if (status < 0)
+  {
+   AM_ScanRelease(scanDesc);
+   AM_Errno = status;
+   return(status);
+  }
+errVal = PF_UnfixPage(fileDesc,pageNum,FALSE);
+AM_Check;
+AM_scanTable[scanDesc].op = BETWEEN;
+AM_scanTable[scanDesc].lastpageNum = pageNum;
+if (status == AM_FOUND && hiIncl)
+  AM_scanTable[scanDesc].lastIndex = index;
+else
+  AM_scanTable[scanDesc].lastIndex = index - 1;
+
+/* the first entry may already be past hi, and then the scan would never
+reach the last one */
+header = &head;
+pageNum = AM_scanTable[scanDesc].nextpageNum;
+index = AM_scanTable[scanDesc].nextIndex;
+while (pageNum != AM_NULL_PAGE)
+  {
+   errVal = PF_GetThisPage(fileDesc,pageNum,&pageBuf);
+   AM_Check;
+   bcopy(pageBuf,header,AM_sl);
+   if (index <= header->numKeys)
+    {
+     compareVal = AM_Compare(AM_LeafKey(pageBuf,index,keyBuf),attrType,
+                             attrLength,hi);
+     if (compareVal < 0 || (compareVal == 0 && !hiIncl))
+       AM_scanTable[scanDesc].status = OVER;
+     errVal = PF_UnfixPage(fileDesc,pageNum,FALSE);
+     AM_Check;
+     break;
+    }
+   errVal = PF_UnfixPage(fileDesc,pageNum,FALSE);
+   AM_Check;
+   pageNum = header->nextLeafPage;
+   index = 1;
+  }
+return(scanDesc);
+}
+
+
+/* Opens a scan like AM_OpenIndexScan that returns the entries in
+descending key order, from the largest key that satisfies op downwards
+through the leaves' prevLeafPage links. An EQUAL scan has one key and is
+opened as usual */
+AM_OpenIndexScanDesc(fileDesc,attrType,attrLength,op,value)
+int fileDesc;
+char attrType;
+int attrLength;
+int op;
+char *value; /* NULL for all the keys */
+
+{
+int scanDesc;
+int status; /* whether value is in the tree */
+int index;
+int pageNum,nextPage;
+char *pageBuf;
+AM_LEAFHEADER head,*header;
+AM_INTHEADER ihead;
+AM_INDEX *indexp;
+int errVal;
+
+if (value != NULL && op == EQUAL)
+  return(AM_OpenIndexScan(fileDesc,attrType,attrLength,op,value));
+if (value != NULL && (op < ALL || op > NOT_EQUAL))
+  {
+   AM_Errno = AME_INVALID_OP_TO_SCAN;
+   return(AME_INVALID_OP_TO_SCAN);
+  }
+
+/* a scan of all keys checks the arguments and takes the slot */
+scanDesc = AM_OpenIndexScan(fileDesc,attrType,attrLength,ALL,NULL);
+if (scanDesc < 0) return(scanDesc);
+AM_scanTable[scanDesc].desc = TRUE;
+AM_scanTable[scanDesc].op = (value == NULL) ? ALL : op;
+AM_scanTable[scanDesc].pageNum = AM_NULL_PAGE;
+AM_scanTable[scanDesc].lastpageNum = AM_NULL_PAGE;
+AM_scanTable[scanDesc].lastIndex = 0;
+header = &head;
+
+if (value != NULL)
+  {
+   status = AM_Search(fileDesc,attrType,attrLength,value,&pageNum,&pageBuf,
+                      &index,(AM_STACK *)NULL);
+   if (status < 0)
+     {
+      AM_ScanRelease(scanDesc);
+      AM_Errno = status;
+      return(status);
+     }
+   errVal = PF_UnfixPage(fileDesc,pageNum,FALSE);
+   AM_Check;
+
+   /* < and <= start left of value, the others stop there */
+   if (AM_scanTable[scanDesc].op == LESS_THAN ||
+       AM_scanTable[scanDesc].op == LESS_THAN_EQUAL)
+     {
+      if (AM_scanTable[scanDesc].op == LESS_THAN || status != AM_FOUND)
+        index--;
+      AM_scanTable[scanDesc].nextpageNum = pageNum;
+      AM_scanTable[scanDesc].nextIndex = index;
+      AM_scanTable[scanDesc].actindex = index;
+      return(scanDesc);
+     }
+   if (AM_scanTable[scanDesc].op == GREATER_THAN)
+     {
+      AM_scanTable[scanDesc].lastpageNum = pageNum;
+      AM_scanTable[scanDesc].lastIndex = (status == AM_FOUND) ? index + 1 : index;
+     }
+   else if (AM_scanTable[scanDesc].op == GREATER_THAN_EQUAL)
+     {
+      AM_scanTable[scanDesc].lastpageNum = pageNum;
+      AM_scanTable[scanDesc].lastIndex = index;
+     }
+   else if (status == AM_FOUND)
+     {
+      /* NOT_EQUAL skips value */
+      AM_scanTable[scanDesc].pageNum = pageNum;
+      AM_scanTable[scanDesc].index = index;
+     }
+  }
+
+/* the rest start at the last key of the tree: the cached rightmost leaf,
+if it is still the one without a successor, or else the leaf the last
+children lead to */
+indexp = AM_GetIndex(fileDesc);
+pageNum = indexp->rightPageNum;
+if (pageNum != AM_NULL_PAGE)
+  {
+   errVal = PF_GetThisPage(fileDesc,pageNum,&pageBuf);
+   AM_Check;
+   bcopy(pageBuf,header,AM_sl);
+   errVal = PF_UnfixPage(fileDesc,pageNum,FALSE);
+   AM_Check;
+   if (!AM_IsLeaf(pageBuf) || header->nextLeafPage != AM_NULL_PAGE)
+     pageNum = AM_NULL_PAGE;
+  }
+if (pageNum == AM_NULL_PAGE)
+  {
+   pageNum = indexp->rootPageNum;
+   errVal = PF_GetThisPage(fileDesc,pageNum,&pageBuf);
+   AM_Check;
+   while (!AM_IsLeaf(pageBuf))
+     {
+      bcopy(pageBuf,&ihead,AM_sint);
+      nextPage = AM_IntChild(pageBuf,ihead.numKeys);
+      errVal = PF_UnfixPage(fileDesc,pageNum,FALSE);
+      AM_Check;
+      pageNum = nextPage;
+      errVal = PF_GetThisPage(fileDesc,pageNum,&pageBuf);
+      AM_Check;
+     }
+   bcopy(pageBuf,header,AM_sl);
+   errVal = PF_UnfixPage(fileDesc,pageNum,FALSE);
+   AM_Check;
+  }
+AM_scanTable[scanDesc].nextpageNum = pageNum;
+AM_scanTable[scanDesc].nextIndex = header->numKeys;
+AM_scanTable[scanDesc].actindex = header->numKeys;
+return(scanDesc);
+}
+
+
+/* Copies the key of the entry the scan returned last into value, which
+must hold attrLength bytes. Returns AME_OK, or AME_EOF before the first
+entry */
+AM_ScanKey(scanDesc,value)
+int scanDesc;
+char *value;
+
+{
+if (!AM_ValidScan(scanDesc))
+  {
+   AM_Errno = AME_INVALID_SCANDESC;
+   return(AME_INVALID_SCANDESC);
+  }
+if (AM_scanTable[scanDesc].keyLength == 0)
+  return(AME_EOF);
+bcopy(AM_scanTable[scanDesc].key,value,AM_scanTable[scanDesc].keyLength);
+return(AME_OK);
+}
+
+
 /* returns the record id of the next record that satisfies the conditions
-specified for index scan associated with scanDesc */
+specified for index scan associated with scanDesc; of a wide index, only
+its low half */
 AM_FindNextEntry(scanDesc)
 int scanDesc;/* index scan descriptor */
 
+{
+int recId;
+int errVal;
+
+errVal = AM_ScanNext(scanDesc,&recId);
+if (errVal < 0) return(errVal);
+return(recId);
+}
+
+
+/* steps the scan scanDesc to its next entry: its recId goes in *recIdp and
+the bytes after its next pointer in the scan table. Returns AME_OK or an
+error such as AME_EOF */
+static AM_ScanNext(scanDesc,recIdp)
+int scanDesc;/* index scan descriptor */
+int *recIdp; /* the recId, the low half of a wide one */
+
 {
 int recId; /* recordId to be returned */
 char *pageBuf;/* buffer for page */
 int errVal;/* return value for functions */
 AM_LEAFHEADER head,*header; /* local header */
-int recSize;/* size of key,ptr pair for leaf */
+char keyBuf[AM_MAXATTRLENGTH]; /* a key of a var leaf */
 int compareVal; /* value returned by compare routine */
+int listPage; /* first page of the key's posting list */
+int more; /* what AM_ScanPosting returned */
 
 
 /* check if scanDesc is valid */
-if ((scanDesc < 0) || (scanDesc > MAXSCANS - 1))
+if (!AM_ValidScan(scanDesc))
   {
    AM_Errno = AME_INVALID_SCANDESC;
    return(AME_INVALID_SCANDESC);
@@ -300,6 +756,12 @@ if ((scanDesc < 0) || (scanDesc > MAXSCANS - 1))
 if (AM_scanTable[scanDesc].status == OVER)
       return(AME_EOF);
 
+if (AM_scanTable[scanDesc].hashed)
+  return(AM_ScanHash(scanDesc,recIdp));
+
+if (AM_scanTable[scanDesc].desc)
+  return(AM_ScanPrev(scanDesc,recIdp));
+
 if (AM_scanTable[scanDesc].nextpageNum == AM_NULL_PAGE)
  {
   AM_scanTable[scanDesc].status = OVER;
@@ -312,7 +774,6 @@ errVal = PF_GetThisPage(AM_scanTable[scanDesc].fileDesc
 AM_Check;
 
 bcopy(pageBuf,header,AM_sl);
-recSize = header->attrLength + AM_ss;
 
 errVal = PF_UnfixPage(AM_scanTable[scanDesc].fileDesc
            ,AM_scanTable[scanDesc].nextpageNum,FALSE);
@@ -327,6 +788,13 @@ while(header->numKeys == 0)
    }
   else
    {
+    /* a < or <= scan that ends at this empty page is done */
+    if (AM_Bounded(scanDesc) &&
+      (AM_scanTable[scanDesc].lastpageNum == AM_scanTable[scanDesc].nextpageNum))
+     {
+      AM_scanTable[scanDesc].status = OVER; 
+      return(AME_EOF);
+     }
     errVal = PF_GetThisPage(AM_scanTable[scanDesc].fileDesc,header->nextLeafPage,&pageBuf);
     AM_Check;
     errVal = PF_UnfixPage(AM_scanTable[scanDesc].fileDesc,header->nextLeafPage,FALSE);
@@ -335,16 +803,15 @@ while(header->numKeys == 0)
     AM_scanTable[scanDesc].nextIndex = 1;
     AM_scanTable[scanDesc].actindex = 1;
     bcopy(pageBuf,header,AM_sl);
-    bcopy(pageBuf + AM_sl +  (AM_scanTable[scanDesc].nextIndex-1)*recSize
-    + header->attrLength, &AM_scanTable[scanDesc].nextRecIdPtr,AM_ss);
+    AM_scanTable[scanDesc].nextRecIdPtr = AM_LeafHead(pageBuf,
+      AM_scanTable[scanDesc].nextIndex);
     AM_scanTable[scanDesc].status = FIRST;
    }
 
-/* if op is < or <= check if you are done - might have overshot while scanning
-empty pages*/
-if ((AM_scanTable[scanDesc].op == LESS_THAN) || 
-  (AM_scanTable[scanDesc].op == LESS_THAN_EQUAL))
- if ((AM_scanTable[scanDesc].lastpageNum <= AM_scanTable[scanDesc].nextpageNum)
+/* if op is < or <= check if you are done - the last key is before this
+page. Leaves are not numbered in key order, so only the page itself counts */
+if (AM_Bounded(scanDesc))
+ if ((AM_scanTable[scanDesc].lastpageNum == AM_scanTable[scanDesc].nextpageNum)
  && (AM_scanTable[scanDesc].lastIndex == 0))
  {
   AM_scanTable[scanDesc].status = OVER;
@@ -361,12 +828,18 @@ if (AM_scanTable[scanDesc].op == NOT_EQUAL)
          {
           AM_scanTable[scanDesc].nextIndex++;
           AM_scanTable[scanDesc].actindex++;
-          bcopy(pageBuf + AM_sl +  (AM_scanTable[scanDesc].nextIndex-1)*recSize
-          + header->attrLength, &AM_scanTable[scanDesc].nextRecIdPtr,AM_ss);
+          AM_scanTable[scanDesc].nextRecIdPtr = AM_LeafHead(pageBuf,
+      AM_scanTable[scanDesc].nextIndex);
+          /* the skipped key is not a deleted one */
+          bcopy(AM_LeafKey(pageBuf,AM_scanTable[scanDesc].nextIndex,keyBuf),
+      AM_scanTable[scanDesc].nextvalue,header->attrLength); 
          }
        else
           if (header->nextLeafPage == AM_NULL_PAGE)
+           {
+            AM_scanTable[scanDesc].status = OVER;
             return(AME_EOF); 
+           }
           else
            {
             AM_scanTable[scanDesc].nextpageNum = header->nextLeafPage;
@@ -375,53 +848,99 @@ if (AM_scanTable[scanDesc].op == NOT_EQUAL)
             errVal =PF_GetThisPage(AM_scanTable[scanDesc].fileDesc,
                   header->nextLeafPage,&pageBuf);
             AM_Check;
-            bcopy(pageBuf + AM_sl + header->attrLength,
-               &AM_scanTable[scanDesc].nextRecIdPtr,AM_ss);
+            AM_scanTable[scanDesc].nextRecIdPtr = AM_LeafHead(pageBuf,1);
+            bcopy(AM_LeafKey(pageBuf,1,keyBuf),
+      AM_scanTable[scanDesc].nextvalue,header->attrLength); 
             bcopy(pageBuf,header,AM_sl);
             errVal = PF_UnfixPage(AM_scanTable[scanDesc].fileDesc
-                ,header->nextLeafPage,FALSE);
+                ,AM_scanTable[scanDesc].nextpageNum,FALSE);
             AM_Check;
            }
 /* if not the first call to findnextentry , check if previous record has 
 been deleted */
 if (AM_scanTable[scanDesc].status != FIRST)
  {
-  compareVal = AM_Compare(pageBuf + (AM_scanTable[scanDesc].nextIndex - 1)
-                *recSize + AM_sl,AM_scanTable[scanDesc].attrType,
+  compareVal = AM_Compare(AM_LeafKey(pageBuf,AM_scanTable[scanDesc].nextIndex,
+                keyBuf),AM_scanTable[scanDesc].attrType,
 		header->attrLength,AM_scanTable[scanDesc].nextvalue);
   if (compareVal != 0)
    {
     /* prev record deleted */
     AM_scanTable[scanDesc].nextIndex--;
-    bcopy(pageBuf + AM_sl + (AM_scanTable[scanDesc].nextIndex -1)*recSize + 
-    header->attrLength, &AM_scanTable[scanDesc].nextRecIdPtr,AM_ss);
+    AM_scanTable[scanDesc].nextRecIdPtr = AM_LeafHead(pageBuf,
+      AM_scanTable[scanDesc].nextIndex);
    }
  }
 else 
   /* make the status busy - no more the first call */
   { AM_scanTable[scanDesc].status = BUSY;
-    bcopy(pageBuf + AM_sl + (AM_scanTable[scanDesc].nextIndex - 1)*recSize,
-    AM_scanTable[scanDesc].nextvalue, header->attrLength);
+    bcopy(AM_LeafKey(pageBuf,AM_scanTable[scanDesc].nextIndex,keyBuf),
+      AM_scanTable[scanDesc].nextvalue,header->attrLength);
   }
 
-/* copy the recId to be returned */
-bcopy(pageBuf + AM_scanTable[scanDesc].nextRecIdPtr,&recId,AM_si);
+/* a prefix scan is over at the first key without the prefix */
+if (AM_scanTable[scanDesc].prefixLength > 0)
+  if (memcmp(AM_LeafKey(pageBuf,AM_scanTable[scanDesc].nextIndex,keyBuf),
+    AM_scanTable[scanDesc].prefix,AM_scanTable[scanDesc].prefixLength) != 0)
+   {
+    AM_scanTable[scanDesc].status = OVER;
+    return(AME_EOF);
+   }
+
+/* keep its key for AM_ScanKey */
+AM_scanTable[scanDesc].keyLength = header->attrLength;
+bcopy(AM_LeafKey(pageBuf,AM_scanTable[scanDesc].nextIndex,keyBuf),
+  AM_scanTable[scanDesc].key,header->attrLength);
+
+/* copy the recId to be returned, and in a covering index its payload; the
+scan stays at a key with a posting list until its last recId */
+more = FALSE;
+listPage = AM_PostList(pageBuf,AM_scanTable[scanDesc].nextRecIdPtr);
+if (listPage != AM_NULL_PAGE)
+ {
+  more = AM_ScanPosting(scanDesc,listPage,&recId);
+  if ((more < 0) && (more != AME_EOF)) return(more);
+  /* the leaf may have left the buffer pool meanwhile */
+  errVal = PF_GetThisPage(AM_scanTable[scanDesc].fileDesc,
+     AM_scanTable[scanDesc].nextpageNum,&pageBuf);
+  AM_Check;
+  errVal = PF_UnfixPage(AM_scanTable[scanDesc].fileDesc,
+     AM_scanTable[scanDesc].nextpageNum,FALSE);
+  AM_Check;
+  AM_scanTable[scanDesc].payloadLength = 0;
+  if (more != TRUE)
+    AM_scanTable[scanDesc].nextRecIdPtr = 0;
+ }
+else
+ {
+  AM_scanTable[scanDesc].postList = AM_NULL_PAGE;
+  bcopy(pageBuf + AM_scanTable[scanDesc].nextRecIdPtr,&recId,AM_si);
+  AM_scanTable[scanDesc].payloadLength = header->payloadLength;
+  if (header->payloadLength > 0)
+    bcopy(pageBuf + AM_scanTable[scanDesc].nextRecIdPtr + AM_si + AM_ss,
+            AM_scanTable[scanDesc].payload,header->payloadLength);
 
-/* copy the place for next recId */
-bcopy(pageBuf + AM_scanTable[scanDesc].nextRecIdPtr + AM_si,
-          &AM_scanTable[scanDesc].nextRecIdPtr,AM_ss);
+  /* copy the place for next recId */
+  bcopy(pageBuf + AM_scanTable[scanDesc].nextRecIdPtr + AM_si,
+            &AM_scanTable[scanDesc].nextRecIdPtr,AM_ss);
+ }
 
 
 /* check if this keys list is over */
 if (AM_scanTable[scanDesc].nextRecIdPtr == (short)0)
-   if ((AM_scanTable[scanDesc].nextIndex + 1) <= (header->numKeys))
+   /* a bounded scan that started on its last key ends with it */
+   if (AM_Bounded(scanDesc) && 
+     (AM_scanTable[scanDesc].lastpageNum == AM_scanTable[scanDesc].nextpageNum)
+     && (AM_scanTable[scanDesc].lastIndex == AM_scanTable[scanDesc].actindex))
+      AM_scanTable[scanDesc].status = OVER;
+   else if ((AM_scanTable[scanDesc].nextIndex + 1) <= (header->numKeys))
     {
      AM_scanTable[scanDesc].nextIndex++;
      AM_scanTable[scanDesc].actindex++;
-     bcopy(pageBuf + AM_sl + (AM_scanTable[scanDesc].nextIndex - 1)*recSize + 
-     header->attrLength , &AM_scanTable[scanDesc].nextRecIdPtr, AM_ss);
-     bcopy(pageBuf + AM_sl + (AM_scanTable[scanDesc].nextIndex -1 )*recSize,
-     AM_scanTable[scanDesc].nextvalue,header->attrLength); 
+     AM_scanTable[scanDesc].nextRecIdPtr = AM_LeafHead(pageBuf,
+      AM_scanTable[scanDesc].nextIndex);
+     bcopy(AM_LeafKey(pageBuf,AM_scanTable[scanDesc].nextIndex,keyBuf),
+      AM_scanTable[scanDesc].nextvalue,header->attrLength); 
     }
    else
     /* got to go to next page */
@@ -429,18 +948,20 @@ if (AM_scanTable[scanDesc].nextRecIdPtr == (short)0)
       AM_scanTable[scanDesc].status = OVER;
     else
      {
+      errVal = AM_ScanPrefetch(scanDesc,AM_scanTable[scanDesc].nextpageNum,
+                               header->nextLeafPage);
+      if (errVal < 0) return(errVal);
       AM_scanTable[scanDesc].nextpageNum = header->nextLeafPage;
       AM_scanTable[scanDesc].nextIndex =  1;
       AM_scanTable[scanDesc].actindex = 1;
       errVal =PF_GetThisPage(AM_scanTable[scanDesc].fileDesc,
         header->nextLeafPage,&pageBuf);
       AM_Check;
-      bcopy(pageBuf + AM_sl + header->attrLength,
-         &AM_scanTable[scanDesc].nextRecIdPtr,AM_ss);
+      AM_scanTable[scanDesc].nextRecIdPtr = AM_LeafHead(pageBuf,1);
       errVal = PF_UnfixPage(AM_scanTable[scanDesc].fileDesc
                 ,header->nextLeafPage,FALSE);
       AM_Check;
-      bcopy(pageBuf + AM_sl + (AM_scanTable[scanDesc].nextIndex -1 )*recSize,
+      bcopy(AM_LeafKey(pageBuf,AM_scanTable[scanDesc].nextIndex,keyBuf),
       AM_scanTable[scanDesc].nextvalue,header->attrLength); 
       bcopy(pageBuf,header,AM_sl);
      }
@@ -451,9 +972,9 @@ if (AM_scanTable[scanDesc].op == EQUAL)
     || (AM_scanTable[scanDesc].index != AM_scanTable[scanDesc].actindex))
      AM_scanTable[scanDesc].status = OVER;
 
-/* see if you are at the last record if op is < or <= */
-if ((AM_scanTable[scanDesc].op == LESS_THAN) || 
-  (AM_scanTable[scanDesc].op == LESS_THAN_EQUAL))
+/* see if you are at the last record if op is < or <= ; a scan that ran off
+the last leaf stays over */
+if (AM_Bounded(scanDesc) && (AM_scanTable[scanDesc].status != OVER))
    if ((AM_scanTable[scanDesc].lastpageNum == AM_scanTable[scanDesc].nextpageNum)
     && (AM_scanTable[scanDesc].lastIndex == AM_scanTable[scanDesc].actindex))
        AM_scanTable[scanDesc].status = LAST;
@@ -464,42 +985,628 @@ if ((AM_scanTable[scanDesc].op == LESS_THAN) ||
       if (AM_scanTable[scanDesc].status == LAST)
         AM_scanTable[scanDesc].status = OVER;
         
+/* a posting list emptied since the scan got to it has given no recId */
+if (more == AME_EOF)
+  return((AM_scanTable[scanDesc].status == OVER) ? AME_EOF :
+         AM_ScanNext(scanDesc,recIdp));
 
+*recIdp = recId;
+return(AME_OK);
+}
+
+
+/* AM_ScanNext for a descending scan. The position is the entry to return
+next; nextIndex 0 means the leaf is done, and status FIRST that the
+position is the head of a key's list not yet read */
+static AM_ScanPrev(scanDesc,recIdp)
+int scanDesc;
+int *recIdp;
+
+{
+int recId;
+int fileDesc,pageNum,prevNum;
+char *pageBuf;
+AM_LEAFHEADER head,*header;
+char keyBuf[AM_MAXATTRLENGTH];
+int listPage,more;
+int errVal;
+
+header = &head;
+fileDesc = AM_scanTable[scanDesc].fileDesc;
+pageNum = AM_scanTable[scanDesc].nextpageNum;
+errVal = PF_GetThisPage(fileDesc,pageNum,&pageBuf);
+AM_Check;
+bcopy(pageBuf,header,AM_sl);
+
+/* a key at or left of the position was deleted since the last call if
+nextIndex no longer holds the key kept; the keys moved left by one */
+if ((AM_scanTable[scanDesc].status != FIRST) &&
+    (AM_scanTable[scanDesc].nextIndex > 0))
+  if ((AM_scanTable[scanDesc].nextIndex > header->numKeys) ||
+      (AM_Compare(AM_LeafKey(pageBuf,AM_scanTable[scanDesc].nextIndex,keyBuf),
+        AM_scanTable[scanDesc].attrType,header->attrLength,
+        AM_scanTable[scanDesc].nextvalue) != 0))
+   {
+    AM_scanTable[scanDesc].nextIndex--;
+    AM_scanTable[scanDesc].actindex--;
+    AM_scanTable[scanDesc].status = FIRST;
+   }
+
+/* find the entry, going back a leaf past the start of one */
+for (;;)
+ {
+  if ((AM_scanTable[scanDesc].lastpageNum == pageNum) &&
+      (AM_scanTable[scanDesc].actindex < AM_scanTable[scanDesc].lastIndex))
+   {
+    AM_scanTable[scanDesc].status = OVER;
+    break;
+   }
+  if (AM_scanTable[scanDesc].nextIndex <= 0)
+   {
+    prevNum = header->prevLeafPage;
+    if (prevNum == AM_NULL_PAGE)
+     {
+      AM_scanTable[scanDesc].status = OVER;
+      break;
+     }
+    errVal = PF_UnfixPage(fileDesc,pageNum,FALSE);
+    AM_Check;
+    errVal = AM_ScanPrefetch(scanDesc,pageNum,prevNum);
+    if (errVal < 0) return(errVal);
+    pageNum = prevNum;
+    errVal = PF_GetThisPage(fileDesc,pageNum,&pageBuf);
+    AM_Check;
+    bcopy(pageBuf,header,AM_sl);
+    AM_scanTable[scanDesc].nextpageNum = pageNum;
+    AM_scanTable[scanDesc].nextIndex = header->numKeys;
+    AM_scanTable[scanDesc].actindex = header->numKeys;
+    AM_scanTable[scanDesc].status = FIRST;
+    continue;
+   }
+  if ((AM_scanTable[scanDesc].op == NOT_EQUAL) &&
+      (AM_scanTable[scanDesc].pageNum == pageNum) &&
+      (AM_scanTable[scanDesc].index == AM_scanTable[scanDesc].actindex))
+   {
+    AM_scanTable[scanDesc].nextIndex--;
+    AM_scanTable[scanDesc].actindex--;
+    AM_scanTable[scanDesc].status = FIRST;
+    continue;
+   }
+  if (AM_scanTable[scanDesc].status == FIRST)
+   {
+    AM_scanTable[scanDesc].status = BUSY;
+    AM_scanTable[scanDesc].nextRecIdPtr = AM_LeafHead(pageBuf,
+      AM_scanTable[scanDesc].nextIndex);
+    bcopy(AM_LeafKey(pageBuf,AM_scanTable[scanDesc].nextIndex,keyBuf),
+      AM_scanTable[scanDesc].nextvalue,header->attrLength);
+   }
+  break;
+ }
+if (AM_scanTable[scanDesc].status == OVER)
+ {
+  errVal = PF_UnfixPage(fileDesc,pageNum,FALSE);
+  AM_Check;
+  return(AME_EOF);
+ }
+
+/* the key, the recId and the payload, as AM_ScanNext */
+AM_scanTable[scanDesc].keyLength = header->attrLength;
+bcopy(AM_LeafKey(pageBuf,AM_scanTable[scanDesc].nextIndex,keyBuf),
+  AM_scanTable[scanDesc].key,header->attrLength);
+more = FALSE;
+listPage = AM_PostList(pageBuf,AM_scanTable[scanDesc].nextRecIdPtr);
+if (listPage != AM_NULL_PAGE)
+ {
+  more = AM_ScanPosting(scanDesc,listPage,&recId);
+  if ((more < 0) && (more != AME_EOF))
+   {
+    PF_UnfixPage(fileDesc,pageNum,FALSE);
+    return(more);
+   }
+  AM_scanTable[scanDesc].payloadLength = 0;
+  if (more != TRUE)
+    AM_scanTable[scanDesc].nextRecIdPtr = 0;
+ }
+else
+ {
+  AM_scanTable[scanDesc].postList = AM_NULL_PAGE;
+  bcopy(pageBuf + AM_scanTable[scanDesc].nextRecIdPtr,&recId,AM_si);
+  AM_scanTable[scanDesc].payloadLength = header->payloadLength;
+  if (header->payloadLength > 0)
+    bcopy(pageBuf + AM_scanTable[scanDesc].nextRecIdPtr + AM_si + AM_ss,
+            AM_scanTable[scanDesc].payload,header->payloadLength);
+  bcopy(pageBuf + AM_scanTable[scanDesc].nextRecIdPtr + AM_si,
+            &AM_scanTable[scanDesc].nextRecIdPtr,AM_ss);
+ }
+
+/* on to the next recId of the key, or to the key before it */
+if (AM_scanTable[scanDesc].nextRecIdPtr == (short)0)
+ {
+  AM_scanTable[scanDesc].nextIndex--;
+  AM_scanTable[scanDesc].actindex--;
+  if (AM_scanTable[scanDesc].nextIndex > 0)
+   {
+    AM_scanTable[scanDesc].nextRecIdPtr = AM_LeafHead(pageBuf,
+      AM_scanTable[scanDesc].nextIndex);
+    bcopy(AM_LeafKey(pageBuf,AM_scanTable[scanDesc].nextIndex,keyBuf),
+      AM_scanTable[scanDesc].nextvalue,header->attrLength);
+   }
+ }
+
+errVal = PF_UnfixPage(fileDesc,pageNum,FALSE);
+AM_Check;
+if (more == AME_EOF)
+  return(AM_ScanPrev(scanDesc,recIdp));
+*recIdp = recId;
+return(AME_OK);
+}
+
+
+/* Reads into postRids the recIds of the scan's posting list from postPage
+on, after postLast once one has been returned, going on to the next page
+if none are left on postPage; postCount is 0 at the end of the list. A
+page freed since it was read sends the scan back to the first */
+static AM_ScanPostFill(scanDesc)
+int scanDesc;
+
+{
+AM_SCAN *scan;
+int pageNum,nextPage;
+int num,pos;
+
+scan = &AM_scanTable[scanDesc];
+pageNum = scan->postPage;
+for (;;)
+ {
+  num = AM_PostRead(scan->fileDesc,scan->postList,pageNum,scan->postRids,
+                    &nextPage);
+  if ((num == AME_NOTFOUND) && (pageNum != scan->postList))
+   {
+    pageNum = scan->postList;
+    continue;
+   }
+  if (num < 0) return(num);
+  scan->postPage = pageNum;
+  pos = 0;
+  if (scan->postStarted)
+    while ((pos < num) &&
+           ((unsigned int)scan->postRids[pos] <= (unsigned int)scan->postLast))
+      pos++;
+  if ((pos < num) || (nextPage == AM_NULL_PAGE))
+   {
+    scan->postCount = num;
+    scan->postPos = pos;
+    if (pos == num) scan->postCount = scan->postPos = 0;
+    return(AME_OK);
+   }
+  pageNum = nextPage;
+ }
+}
+
+
+/* Returns in recIdp the next recId of the posting list starting at
+listPage, the list of the key the scan is at. Returns TRUE if more follow,
+FALSE if that was the last, AME_EOF if there was none left */
+static AM_ScanPosting(scanDesc,listPage,recIdp)
+int scanDesc;
+int listPage;
+int *recIdp;
+
+{
+AM_SCAN *scan;
+int errVal;
+
+scan = &AM_scanTable[scanDesc];
+errVal = AM_ScanBuffer(scanDesc);
+if (errVal < 0) return(errVal);
+if (scan->postList != listPage)
+ {
+  /* a key the scan has just got to */
+  scan->postList = scan->postPage = listPage;
+  scan->postStarted = FALSE;
+  scan->postCount = scan->postPos = 0;
+ }
+if (scan->postPos == scan->postCount)
+ {
+  errVal = AM_ScanPostFill(scanDesc);
+  if (errVal < 0) return(errVal);
+  if (scan->postCount == 0)
+   {
+    scan->postList = AM_NULL_PAGE;
+    return(AME_EOF);
+   }
+ }
+*recIdp = scan->postRids[scan->postPos++];
+scan->postLast = *recIdp;
+scan->postStarted = TRUE;
+
+/* the next page is read now to tell if this was the last */
+if (scan->postPos == scan->postCount)
+ {
+  errVal = AM_ScanPostFill(scanDesc);
+  if (errVal < 0) return(errVal);
+  if (scan->postCount == 0)
+   {
+    scan->postList = AM_NULL_PAGE;
+    return(FALSE);
+   }
+ }
+return(TRUE);
+}
+
+
+/* steps a scan of a hash index to the next recId of its key, reading the
+pages of the key's bucket until one has another */
+static AM_ScanHash(scanDesc,recIdp)
+int scanDesc;
+int *recIdp;
+
+{
+AM_SCAN *scan;
+AM_INDEX *indexp;
+int num;
+
+scan = &AM_scanTable[scanDesc];
+
+/* the bucket as of the first read: a split since the open may have moved
+the key to another */
+if (scan->status == FIRST)
+ {
+  indexp = AM_GetIndex(scan->fileDesc);
+  if (indexp == NULL) return(AM_Errno);
+  num = AM_HashBucket(indexp,scan->attrType,scan->hashLength,scan->key);
+  if (num < 0) return(num);
+  scan->hashPage = num;
+  scan->status = BUSY;
+ }
+while (scan->postPos == scan->postCount)
+ {
+  if (scan->hashPage == AM_NULL_PAGE)
+   {
+    scan->status = OVER;
+    return(AME_EOF);
+   }
+  num = AM_HashRead(scan->fileDesc,scan->hashPage,scan->attrType,scan->key,
+                    scan->postRids,&scan->hashPage);
+  if (num < 0) return(num);
+  scan->postCount = num;
+  scan->postPos = 0;
+ }
+*recIdp = scan->postRids[scan->postPos++];
+scan->payloadLength = 0;
+scan->keyLength = scan->hashLength;
+return(AME_OK);
+}
+
+
+/* Leaf read-ahead. A scan leaving a leaf asks the PF layer to start reading
+the AM_PrefetchLeaves leaves after the next one in its direction, taken from
+the child pointers of their parent, so that they are in memory by the time
+the scan gets to them. The leaves asked for are kept in pfPages; the parent
+is read again when fewer than half of them are left, and is found from the
+root, by the last key returned, when the scan moves under another parent */
+static AM_ScanPrefetch(scanDesc,pageNum,nextNum)
+int scanDesc;
+int pageNum; /* the leaf being left */
+int nextNum; /* the leaf the scan goes to */
+
+{
+AM_SCAN *scan;
+AM_INDEX *indexp;
+AM_INTHEADER ihead;
+char *pageBuf;
+int parentNum; /* parent of nextNum */
+int child; /* child number of nextNum in parentNum */
+int asked; /* leaves from nextNum on already read or asked for */
+int dir; /* 1 for an ascending scan, -1 for a descending one */
+int num; /* leaves to ask for */
+int level,index,count,leafNum,errVal;
+
+scan = &AM_scanTable[scanDesc];
+num = (AM_PrefetchLeaves < AM_MAXPREFETCH) ? AM_PrefetchLeaves : AM_MAXPREFETCH;
+if ((num <= 0) || (scan->op == EQUAL))
+  return(AME_OK);
+dir = scan->desc ? -1 : 1;
+
+if ((scan->pfPos + 1 < scan->pfCount) &&
+    (scan->pfPages[scan->pfPos + 1] == nextNum))
+  {
+   /* the scan goes on to the next leaf asked for */
+   scan->pfPos++;
+   asked = scan->pfCount - scan->pfPos;
+   if (scan->pfEnd || (2*(asked - 1) >= num))
+     return(AME_OK);
+   parentNum = scan->pfParent;
+   child = scan->pfChild + dir*scan->pfPos;
+   errVal = PF_GetThisPage(scan->fileDesc,parentNum,&pageBuf);
+   AM_Check;
+  }
+else
+  {
+   /* find the parent of the leaf being left */
+   scan->pfCount = 0;
+   asked = 1;
+   indexp = AM_GetIndex(scan->fileDesc);
+   if ((indexp == NULL) || (indexp->height < 2) || (scan->keyLength == 0))
+     return(AME_OK);
+   parentNum = indexp->rootPageNum;
+   for (level = indexp->height; ; level--)
+     {
+      errVal = PF_GetThisPage(scan->fileDesc,parentNum,&pageBuf);
+      AM_Check;
+      if (AM_IsLeaf(pageBuf))
+        {
+         errVal = PF_UnfixPage(scan->fileDesc,parentNum,FALSE);
+         AM_Check;
+         return(AME_OK);
+        }
+      bcopy(pageBuf,&ihead,AM_sint);
+      leafNum = AM_BinSearch(pageBuf,scan->attrType,ihead.attrLength,
+                             scan->key,&index,&ihead);
+      if (level <= 2) break;
+      errVal = PF_UnfixPage(scan->fileDesc,parentNum,FALSE);
+      AM_Check;
+      parentNum = leafNum;
+     }
+   child = index + dir;
+   if ((leafNum != pageNum) || (child < 0) || (child > ihead.numKeys) ||
+       (AM_IntChild(pageBuf,child) != nextNum))
+     {
+      /* nextNum is under another parent */
+      errVal = PF_UnfixPage(scan->fileDesc,parentNum,FALSE);
+      AM_Check;
+      return(AME_OK);
+     }
+  }
+
+/* the window: nextNum and up to num leaves after it */
+bcopy(pageBuf,&ihead,AM_sint);
+scan->pfParent = parentNum;
+scan->pfChild = child;
+scan->pfPos = 0;
+scan->pfEnd = FALSE;
+for (count = 0; count <= num; count++)
+  {
+   if ((child < 0) || (child > ihead.numKeys))
+     {
+      scan->pfEnd = TRUE;
+      break;
+     }
+   leafNum = AM_IntChild(pageBuf,child);
+   scan->pfPages[count] = leafNum;
+   /* the OS reads ahead by itself a leaf that follows the one before it
+   in the file, as a bulk loaded index's do */
+   if ((count >= asked) && (leafNum != scan->pfPages[count - 1] + 1))
+     PF_PrefetchPage(scan->fileDesc,leafNum);
+   if ((AM_Bounded(scanDesc) || scan->desc) &&
+       (leafNum == scan->lastpageNum))
+     {
+      scan->pfEnd = TRUE;
+      count++;
+      break;
+     }
+   child += dir;
+  }
+scan->pfCount = count;
+errVal = PF_UnfixPage(scan->fileDesc,parentNum,FALSE);
+AM_Check;
+return(AME_OK);
+}
+
+
+/* Copies the recIds (the low halves of a wide index's) of the scan's next
+entries into recIds and, if keys is not NULL, their keys into keys,
+attrLength bytes apiece, at most max of each. The entries of a leaf after
+the first are read under one fix of the page, and the general path of
+AM_FindNextEntry only handles the first entry of each leaf and the ends of
+the scan. Returns the number of entries, or AME_EOF when the scan is over */
+AM_FindNextEntries(scanDesc,recIds,keys,max)
+int scanDesc;/* index scan descriptor */
+int *recIds;
+char *keys;
+int max;
+
+{
+int count; /* entries returned so far */
+AM_SCAN *scan;
+int fileDesc,pageNum;
+char *pageBuf;
+AM_LEAFHEADER head,*header;
+char keyBuf[AM_MAXATTRLENGTH];
+char *key;
+short next;
+int errVal;
+
+header = &head;
+count = 0;
+while (count < max)
+ {
+  /* the general path: a new leaf, skips and the ends of the scan */
+  errVal = AM_ScanNext(scanDesc,&recIds[count]);
+  if (errVal == AME_EOF) break;
+  if (errVal < 0) return(errVal);
+  if (keys != NULL)
+    bcopy(AM_scanTable[scanDesc].key,
+          keys + count*AM_scanTable[scanDesc].keyLength,
+          AM_scanTable[scanDesc].keyLength);
+  count++;
+  if (AM_scanTable[scanDesc].status == OVER) break;
+
+  /* the rest of the posting list page read with that entry, all but its
+  last recId, which the general path returns to see if the list goes on */
+  scan = &AM_scanTable[scanDesc];
+  if (scan->postList != AM_NULL_PAGE)
+   {
+    while ((count < max) && (scan->postPos < scan->postCount - 1))
+     {
+      recIds[count] = scan->postRids[scan->postPos++];
+      if (keys != NULL)
+        bcopy(scan->key,keys + count*scan->keyLength,scan->keyLength);
+      count++;
+     }
+    scan->postLast = recIds[count - 1];
+    continue;
+   }
+
+  /* the rest of the recIds of the hash bucket page */
+  if (scan->hashed)
+   {
+    while ((count < max) && (scan->postPos < scan->postCount))
+     {
+      recIds[count] = scan->postRids[scan->postPos++];
+      if (keys != NULL)
+        bcopy(scan->key,keys + count*scan->keyLength,scan->keyLength);
+      count++;
+     }
+    continue;
+   }
+  if (AM_scanTable[scanDesc].desc) continue;
+
+  /* the rest of the leaf, up to its last entry */
+  fileDesc = AM_scanTable[scanDesc].fileDesc;
+  pageNum = AM_scanTable[scanDesc].nextpageNum;
+  errVal = PF_GetThisPage(fileDesc,pageNum,&pageBuf);
+  AM_Check;
+  bcopy(pageBuf,header,AM_sl);
+  while (count < max)
+   {
+    if (AM_scanTable[scanDesc].nextIndex > header->numKeys) break;
+    if (AM_PostList(pageBuf,AM_scanTable[scanDesc].nextRecIdPtr) !=
+        AM_NULL_PAGE)
+      break;
+    bcopy(pageBuf + AM_scanTable[scanDesc].nextRecIdPtr + AM_si,&next,AM_ss);
+    if ((next == 0) && (AM_scanTable[scanDesc].nextIndex == header->numKeys))
+      break;
+
+    /* the value a not equal scan skips is left to the general path */
+    if ((AM_scanTable[scanDesc].op == NOT_EQUAL) &&
+        (AM_scanTable[scanDesc].pageNum == pageNum) &&
+        (AM_scanTable[scanDesc].index == AM_scanTable[scanDesc].actindex))
+      break;
+
+    key = AM_LeafKey(pageBuf,AM_scanTable[scanDesc].nextIndex,keyBuf);
+    if ((AM_scanTable[scanDesc].prefixLength > 0) &&
+        (memcmp(key,AM_scanTable[scanDesc].prefix,
+                AM_scanTable[scanDesc].prefixLength) != 0))
+     {
+      AM_scanTable[scanDesc].status = OVER;
+      break;
+     }
+
+    bcopy(pageBuf + AM_scanTable[scanDesc].nextRecIdPtr,&recIds[count],AM_si);
+    if (keys != NULL)
+      bcopy(key,keys + count*header->attrLength,header->attrLength);
+    count++;
+    bcopy(key,AM_scanTable[scanDesc].key,header->attrLength);
+
+    /* on to the next recId of the key, or to the next key */
+    AM_scanTable[scanDesc].nextRecIdPtr = next;
+    if (next == 0)
+     {
+      AM_scanTable[scanDesc].nextIndex++;
+      AM_scanTable[scanDesc].actindex++;
+      AM_scanTable[scanDesc].nextRecIdPtr = AM_LeafHead(pageBuf,
+        AM_scanTable[scanDesc].nextIndex);
+      bcopy(AM_LeafKey(pageBuf,AM_scanTable[scanDesc].nextIndex,keyBuf),
+        AM_scanTable[scanDesc].nextvalue,header->attrLength);
+
+      /* an equal or bounded scan may end with the key just finished */
+      if ((AM_scanTable[scanDesc].op == EQUAL) &&
+          ((AM_scanTable[scanDesc].pageNum != pageNum) ||
+           (AM_scanTable[scanDesc].index != AM_scanTable[scanDesc].actindex)))
+        AM_scanTable[scanDesc].status = OVER;
+      if (AM_Bounded(scanDesc) && (AM_scanTable[scanDesc].lastpageNum == pageNum)
+        && (AM_scanTable[scanDesc].lastIndex < AM_scanTable[scanDesc].actindex))
+        AM_scanTable[scanDesc].status = OVER;
+      if (AM_scanTable[scanDesc].status == OVER) break;
+     }
+   }
+  errVal = PF_UnfixPage(fileDesc,pageNum,FALSE);
+  AM_Check;
+  if (AM_scanTable[scanDesc].status == OVER) break;
+ }
+
+if (count == 0) return(AME_EOF);
+return(count);
+}
+
+
+/* returns the next record id like AM_FindNextEntry and copies the payload
+stored with it in a covering index into payload, which must hold the
+index's payloadLength bytes */
+AM_FindNextEntryPayload(scanDesc,payload)
+int scanDesc;/* index scan descriptor */
+char *payload;
+
+{
+int recId;
+int extra; /* bytes of the recId ahead of the payload */
+
+recId = AM_FindNextEntry(scanDesc);
+if (recId >= 0 && payload != NULL)
+ {
+  extra = AM_scanTable[scanDesc].ridLength - AM_si;
+  bcopy(AM_scanTable[scanDesc].payload + extra,payload,
+          AM_scanTable[scanDesc].payloadLength - extra);
+ }
 return(recId);
 }
 
 
+/* steps the scan to its next entry and returns its whole recId in *rid and
+its payload in payload, if not NULL. Returns AME_OK, or AME_EOF when the
+scan is over. Works on every index; a wide one needs it */
+AM_FindNextRid(scanDesc,rid,payload)
+int scanDesc;/* index scan descriptor */
+AM_RID *rid;
+char *payload;
+
+{
+int recId;
+int high;
+int extra; /* bytes of the recId ahead of the payload */
+int errVal;
+
+errVal = AM_ScanNext(scanDesc,&recId);
+if (errVal < 0) return(errVal);
+extra = AM_scanTable[scanDesc].ridLength - AM_si;
+if (extra > 0)
+ {
+  bcopy(AM_scanTable[scanDesc].payload,(char *)&high,AM_si);
+  *rid = ((AM_RID)high << 32) | (unsigned int)recId;
+ }
+else
+  *rid = recId;
+if (payload != NULL)
+  bcopy(AM_scanTable[scanDesc].payload + extra,payload,
+          AM_scanTable[scanDesc].payloadLength - extra);
+return(AME_OK);
+}
+
+
+
 /* terminates an index scan */
 AM_CloseIndexScan(scanDesc)
 int scanDesc;/* scan Descriptor*/
 
 {
-if ((scanDesc < 0) || (scanDesc > MAXSCANS - 1))
+if (!AM_ValidScan(scanDesc))
   {
    AM_Errno = AME_INVALID_SCANDESC;
    return(AME_INVALID_SCANDESC);
   }
-AM_scanTable[scanDesc].status = FREE;
+AM_ScanRelease(scanDesc);
 return(AME_OK);
 }
 
 
-GetLeftPageNum(fileDesc)
+/* TRUE if a scan of the index is open. Deletes then leave the leaves where
+they are, since a scan may be positioned on any of them */
+AM_IndexScanned(fileDesc)
 int fileDesc;
 
 {
-char *pageBuf;
-int pageNum;
-int errVal;
-
-errVal = PF_GetFirstPage(fileDesc,&pageNum,&pageBuf);
-AM_Check;
-if (*pageBuf == 'l')
-  AM_LeftPageNum = pageNum;
-else
-  AM_LeftPageNum = 2;
-errVal = PF_UnfixPage(fileDesc,pageNum,FALSE);
-AM_Check;
-return(AM_LeftPageNum);
-
+if ((fileDesc < 0) || (fileDesc >= AM_MAXINDEXES))
+	return(FALSE);
+return(AM_scansOpen[fileDesc] > 0);
 }
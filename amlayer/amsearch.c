@@ -1,11 +1,13 @@
 # include <stdio.h>
+# include <string.h>
 # include "am.h"
 # include "pf.h"
 
 /* searches for a key in a binary tree - returns FOUND or NOTFOUND and
 returns the pagenumber and the offset where key is present or could 
-be inserted */
-AM_Search(fileDesc,attrType,attrLength,value,pageNum,pageBuf,indexPtr)
+be inserted. The internal nodes on the way are pushed onto stack unless it
+is NULL */
+AM_Search(fileDesc,attrType,attrLength,value,pageNum,pageBuf,indexPtr,stack)
 int fileDesc;
 char attrType;
 int attrLength;
@@ -14,6 +16,7 @@ int *pageNum; /* page number of page where key is present or can be inserted*/
 char **pageBuf; /* pointer to buffer in memory where leaf page corresponding                                                        to pageNum can be found */
 int *indexPtr; /* pointer to index in leaf where key is present or 
                                                             can be inserted */
+AM_STACK *stack; /* the path, for an insert or delete */
 
 {
 	int errVal;
@@ -21,16 +24,20 @@ int *indexPtr; /* pointer to index in leaf where key is present or
 	int retval; /* return value */
 	AM_LEAFHEADER lhead,*lheader; /* local pointer to leaf header */
 	AM_INTHEADER ihead,*iheader; /* local pointer to internal node header */
+	AM_INDEX *indexp; /* the open index */
 
         /* initialise the headeers */	
 	lheader = &lhead;
 	iheader = &ihead;
 
         /* get the root of the B+ tree */
-
-	errVal = PF_GetFirstPage(fileDesc,pageNum,pageBuf);
+	indexp = AM_GetIndex(fileDesc);
+	if (indexp == NULL) return(AM_Errno);
+	if (indexp->hashed) return(AME_NOTSUPPORTED);
+	*pageNum = indexp->rootPageNum;
+	errVal = PF_GetThisPage(fileDesc,*pageNum,pageBuf);
 	AM_Check;
-	if (**pageBuf == 'l' ) 
+	if (AM_IsLeaf(*pageBuf)) 
 		/* if root is a leaf page */
 	{
 		bcopy(*pageBuf,lheader,AM_sl);
@@ -45,7 +52,7 @@ int *indexPtr; /* pointer to index in leaf where key is present or
 			return(AME_INVALIDATTRLENGTH);
 	}
 	/* find the leaf at which key is present or can be inserted */
-	while ((**pageBuf) != 'l')
+	while (!AM_IsLeaf(*pageBuf))
 	{
 		/* find the next page to be followed */
 		nextPage = AM_BinSearch(*pageBuf,attrType,attrLength,value,
@@ -53,7 +60,15 @@ int *indexPtr; /* pointer to index in leaf where key is present or
 
 		/* push onto stack for backtracking and splitting nodes if 
 		needed later */
-		AM_PushStack(*pageNum,*indexPtr);
+		if (stack != NULL)
+		{
+			errVal = AM_PushStack(stack,*pageNum,*indexPtr);
+			if (errVal < 0)
+			{
+				PF_UnfixPage(fileDesc,*pageNum,FALSE);
+				return(errVal);
+			}
+		}
 
 		errVal = PF_UnfixPage(fileDesc,*pageNum,FALSE);
 		AM_Check;
@@ -65,7 +80,7 @@ int *indexPtr; /* pointer to index in leaf where key is present or
 		errVal = PF_GetThisPage(fileDesc,*pageNum,pageBuf);
 		AM_Check;
 
-		if (**pageBuf == 'l' ) 
+		if (AM_IsLeaf(*pageBuf)) 
 		{
 			/* if next page is a leaf */
 			bcopy(*pageBuf,lheader,AM_sl);
@@ -85,6 +100,87 @@ int *indexPtr; /* pointer to index in leaf where key is present or
 }
 
 
+/* Number of the n keys at keys, keys + stride, ... that are less than value
+(less than or equal to it if orEqual). The search halves the range without
+branching on the comparison, so the compiler can use conditional moves. */
+static AM_IntRank(keys,stride,n,value,orEqual)
+char *keys;
+int stride;
+int n;
+char *value;
+int orEqual;
+
+{
+	int base,half,key,val;
+
+	if (n == 0) return(0);
+	memcpy((char *)&val,value,AM_si);
+	base = 0;
+	while (n > 1)
+	{
+		half = n / 2;
+		memcpy((char *)&key,keys + (base + half)*stride,AM_si);
+		base += ((key < val) | (orEqual & (key == val))) ? half : 0;
+		n -= half;
+	}
+	memcpy((char *)&key,keys + base*stride,AM_si);
+	return(base + ((key < val) | (orEqual & (key == val))));
+}
+
+
+/* AM_IntRank for float keys */
+static AM_FloatRank(keys,stride,n,value,orEqual)
+char *keys;
+int stride;
+int n;
+char *value;
+int orEqual;
+
+{
+	int base,half;
+	float key,val;
+
+	if (n == 0) return(0);
+	memcpy((char *)&val,value,AM_sf);
+	base = 0;
+	while (n > 1)
+	{
+		half = n / 2;
+		memcpy((char *)&key,keys + (base + half)*stride,AM_sf);
+		base += ((key < val) | (orEqual & (key == val))) ? half : 0;
+		n -= half;
+	}
+	memcpy((char *)&key,keys + base*stride,AM_sf);
+	return(base + ((key < val) | (orEqual & (key == val))));
+}
+
+
+/* AM_IntRank for 'k' keys of attrLength bytes, compared with memcmp */
+static AM_KeyRank(keys,stride,n,value,attrLength,orEqual)
+char *keys;
+int stride;
+int n;
+char *value;
+int attrLength;
+int orEqual;
+
+{
+	int base,half,cmp;
+
+	if (n == 0) return(0);
+	base = 0;
+	while (n > 1)
+	{
+		half = n / 2;
+		cmp = memcmp(keys + (base + half)*stride,value,attrLength);
+		base += ((cmp < 0) | (orEqual & (cmp == 0))) ? half : 0;
+		n -= half;
+	}
+	cmp = memcmp(keys + base*stride,value,attrLength);
+	return(base + ((cmp < 0) | (orEqual & (cmp == 0))));
+}
+
+
 /* Finds the place (index) from where the next page to be followed is got*/
 AM_BinSearch(pageBuf,attrType,attrLength,value,indexPtr,header)
 char *pageBuf; /* buffer where the page is found */
@@ -100,7 +196,30 @@ AM_INTHEADER *header;
 	int recSize; /* size in bytes of a key,ptr pair */
 	int pageNum; /* page number of node to be followed along the B+ tree */
 
+	if (*pageBuf == 'I')
+		return(AM_VarBinSearch(pageBuf,attrLength,value,indexPtr));
+
 	recSize = AM_si  + attrLength;
+
+	/* int, float and composite keys: the child to follow is the number
+	of keys not greater than value */
+	if (AM_SearchKernels && (attrType == 'i' || attrType == 'f' ||
+	    attrType == 'k'))
+	{
+		if (attrType == 'i')
+			*indexPtr = AM_IntRank(pageBuf + AM_sint + AM_si,recSize,
+					       header->numKeys,value,TRUE);
+		else if (attrType == 'k')
+			*indexPtr = AM_KeyRank(pageBuf + AM_sint + AM_si,recSize,
+				       header->numKeys,value,attrLength,TRUE);
+		else
+			*indexPtr = AM_FloatRank(pageBuf + AM_sint + AM_si,
+				       recSize,header->numKeys,value,TRUE);
+		bcopy(pageBuf + AM_sint + (*indexPtr)*recSize,(char *)&pageNum,
+		      AM_si);
+		return(pageNum);
+	}
+
 	low = 1;
 	high = header->numKeys;
 
@@ -192,6 +311,9 @@ AM_LEAFHEADER *header;
 	int compareVal; /* result of comparison of key with value */
 	int recSize; /* size in bytes of a key,ptr pair */
 
+	if (*pageBuf == 'L')
+		return(AM_VarSearchLeaf(pageBuf,attrLength,value,indexPtr));
+
 	recSize = AM_ss + attrLength;
 	low = 1;
 	high = header->numKeys;
@@ -203,6 +325,26 @@ AM_LEAFHEADER *header;
 		return(AM_NOT_FOUND);
 	}
 
+	/* int, float and composite keys: the key goes after all smaller
+	keys */
+	if (AM_SearchKernels && (attrType == 'i' || attrType == 'f' ||
+	    attrType == 'k'))
+	{
+		if (attrType == 'i')
+			low = AM_IntRank(pageBuf + AM_sl,recSize,high,value,FALSE);
+		else if (attrType == 'k')
+			low = AM_KeyRank(pageBuf + AM_sl,recSize,high,value,
+					 attrLength,FALSE);
+		else
+			low = AM_FloatRank(pageBuf + AM_sl,recSize,high,value,
+					   FALSE);
+		*indexPtr = low + 1;
+		if (low < high && AM_Compare(pageBuf + AM_sl + low*recSize,
+		    attrType,attrLength,value) == 0)
+			return(AM_FOUND);
+		return(AM_NOT_FOUND);
+	}
+
 	while ((high - low ) > 1)
 	{
 		/* get the middle key */
@@ -323,9 +465,225 @@ int attrLength;
 		{
 			return(strncmp(valPtr,bufPtr,attrLength));
 		}
+	case 'k' : 
+		{
+			return(memcmp(valPtr,bufPtr,attrLength));
+		}
 	}
 }
 
 
 
 
+
+
+/* state shared by the nodes of one AM_LookupBatch */
+typedef struct am_batch
+	{
+		char *keys; /* numKeys keys of attrLength bytes */
+		int *order; /* key numbers, sorted by key */
+		char attrType;
+		int attrLength;
+		int (*callback)();
+		char *state;
+		int matches;
+		int ridLength; /* AM_sr for a wide index */
+	}	AM_BATCH;
+
+static AM_BATCH *AM_batchSort; /* the batch qsort is ordering */
+
+/* orders key numbers by key, ties by position */
+static int AM_BatchCompare(a,b)
+char *a,*b;
+
+{
+	int x,y,compareVal;
+
+	bcopy(a,(char *)&x,AM_si);
+	bcopy(b,(char *)&y,AM_si);
+	compareVal = AM_Compare(AM_batchSort->keys + y*AM_batchSort->attrLength,
+		AM_batchSort->attrType,AM_batchSort->attrLength,
+		AM_batchSort->keys + x*AM_batchSort->attrLength);
+	if (compareVal != 0) return(compareVal);
+	return((x > y) - (x < y));
+}
+
+
+/* Looks up the sorted keys order[low..high-1], all of which lie under
+pageNum. An internal node hands each run of keys that share a child to
+that child, so every page on the way is read once per batch. */
+static AM_BatchNode(fileDesc,pageNum,low,high,batch)
+int fileDesc;
+int pageNum;
+int low,high;
+AM_BATCH *batch;
+
+{
+	char page[PF_PAGE_SIZE]; /* copy of the node, unfixed at once */
+	char *pageBuf;
+	char *value;
+	char keyBuf[AM_MAXATTRLENGTH]; /* a separator of a var node */
+	AM_LEAFHEADER lhead;
+	AM_INTHEADER ihead;
+	int errVal;
+	int index,child,i,j;
+	short nextRec;
+	int recId;
+	int rids[AM_MAXPOSTRIDS]; /* a page of a posting list */
+	int listPage,postPage,nextPage,num;
+
+	errVal = PF_GetThisPage(fileDesc,pageNum,&pageBuf);
+	AM_Check;
+	bcopy(pageBuf,page,PF_PAGE_SIZE);
+	errVal = PF_UnfixPage(fileDesc,pageNum,FALSE);
+	AM_Check;
+
+	if (AM_IsLeaf(page))
+	{
+		bcopy(page,&lhead,AM_sl);
+		if (lhead.attrLength != batch->attrLength)
+			return(AME_INVALIDATTRLENGTH);
+		for (i = low; i < high; i++)
+		{
+			value = batch->keys + batch->order[i]*batch->attrLength;
+			if (AM_SearchLeaf(page,batch->attrType,batch->attrLength,
+				value,&index,&lhead) != AM_FOUND)
+				continue;
+			nextRec = AM_LeafHead(page,index);
+			listPage = AM_PostList(page,nextRec);
+			for (postPage = listPage; postPage != AM_NULL_PAGE;
+			     postPage = nextPage)
+			{
+				num = AM_PostRead(fileDesc,listPage,postPage,rids,
+						  &nextPage);
+				if (num < 0) return(num);
+				for (j = 0; j < num; j++)
+				{
+					batch->matches++;
+					errVal = (*batch->callback)(batch->state,
+						batch->order[i],rids[j],
+						(AM_RID)rids[j]);
+					if (errVal < 0) return(errVal);
+				}
+			}
+			if (listPage != AM_NULL_PAGE) continue;
+			while (nextRec != AM_NULL)
+			{
+				bcopy(page + nextRec,(char *)&recId,AM_si);
+				batch->matches++;
+				errVal = (*batch->callback)(batch->state,
+						batch->order[i],recId,
+						AM_NodeRid(page + nextRec,
+							   batch->ridLength));
+				if (errVal < 0) return(errVal);
+				bcopy(page + nextRec + AM_si,(char *)&nextRec,
+				      AM_ss);
+			}
+		}
+		return(AME_OK);
+	}
+
+	bcopy(page,&ihead,AM_sint);
+	if (ihead.attrLength != batch->attrLength)
+		return(AME_INVALIDATTRLENGTH);
+	for (i = low; i < high; i = j)
+	{
+		value = batch->keys + batch->order[i]*batch->attrLength;
+		child = AM_BinSearch(page,batch->attrType,batch->attrLength,
+				     value,&index,&ihead);
+
+		/* the following keys go the same way until one reaches the
+		separator to the right of this child */
+		for (j = i + 1; j < high && index < ihead.numKeys; j++)
+			if (AM_Compare(AM_IntKey(page,index + 1,keyBuf),
+			    batch->attrType,batch->attrLength,batch->keys + 
+			    batch->order[j]*batch->attrLength) >= 0)
+				break;
+		if (index == ihead.numKeys) j = high;
+
+		errVal = AM_BatchNode(fileDesc,child,i,j,batch);
+		if (errVal < 0) return(errVal);
+	}
+	return(AME_OK);
+}
+
+
+/* Looks up numKeys keys (packed attrLength bytes apart in keys) with one
+descent shared by all of them: the keys are sorted, each internal node is
+read once for the run of keys under it and each leaf at most once.
+callback(state,keyNum,recId,rid) is called for every match, keyNum being
+the key's position in keys and rid the whole AM_RID of a wide index; a
+negative return stops the lookup and is passed back. Returns the number of
+matches. */
+AM_LookupBatch(fileDesc,attrType,attrLength,keys,numKeys,callback,state)
+int fileDesc;
+char attrType; /* 'i' or 'c' or 'f' */
+int attrLength; /* 4 for 'i' or 'f' , 1-255 for 'c' */
+char *keys;
+int numKeys;
+int (*callback)();
+char *state; /* passed to callback */
+
+{
+	AM_BATCH batch;
+	AM_INDEX *indexp;
+	int errVal;
+	int i;
+	int n; /* keys the filter leaves */
+
+	if ((attrType != 'c') && (attrType != 'f') && (attrType != 'i') &&
+	    (attrType != 'k'))
+	{
+		AM_Errno = AME_INVALIDATTRTYPE;
+		return(AME_INVALIDATTRTYPE);
+	}
+	if ((keys == NULL && numKeys > 0) || numKeys < 0 || callback == NULL)
+	{
+		AM_Errno = AME_INVALIDVALUE;
+		return(AME_INVALIDVALUE);
+	}
+	indexp = AM_GetIndex(fileDesc);
+	if (indexp == NULL) return(AM_Errno);
+	if (indexp->hashed)
+	{
+		AM_Errno = AME_NOTSUPPORTED;
+		return(AME_NOTSUPPORTED);
+	}
+	if (numKeys == 0) return(0);
+
+	batch.order = (int *) malloc(numKeys*AM_si);
+	if (batch.order == NULL)
+	{
+		AM_Errno = AME_NOMEM;
+		return(AME_NOMEM);
+	}
+	/* the keys the filter rules out have no matches */
+	n = 0;
+	for (i = 0; i < numKeys; i++)
+		if (!AM_FilterMiss(indexp,attrType,attrLength,keys + i*attrLength))
+			batch.order[n++] = i;
+	if (n == 0)
+	{
+		free((char *)batch.order);
+		return(0);
+	}
+	batch.keys = keys;
+	batch.attrType = attrType;
+	batch.attrLength = attrLength;
+	batch.callback = callback;
+	batch.state = state;
+	batch.matches = 0;
+	batch.ridLength = indexp->ridLength;
+
+	AM_batchSort = &batch;
+	qsort((char *)batch.order,n,AM_si,AM_BatchCompare);
+
+	errVal = AM_BatchNode(fileDesc,indexp->rootPageNum,0,n,&batch);
+	free((char *)batch.order);
+	if (errVal < 0)
+	{
+		AM_Errno = errVal;
+		return(errVal);
+	}
+	return(batch.matches);
+}
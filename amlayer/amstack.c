@@ -1,44 +1,66 @@
 # include <stdio.h>
+# include <stdlib.h>
 # include "am.h"
 # include "pf.h"
 
-# define AM_MAXSTACK 50
+/* The path an insert or delete takes from the root to a leaf: each
+internal node and the child followed in it. Every operation keeps its own
+on its stack; the first AM_STACKLOCAL levels need no malloc. */
 
-struct
-    {
-     int pageNumber;
-     int offset;
-    } AM_Stack[AM_MAXSTACK];
+AM_InitStack(stack)
+AM_STACK *stack;
 
-int AM_topofStackPtr = -1;
+{
+stack->top = -1;
+stack->size = AM_STACKLOCAL;
+stack->entry = stack->local;
+}
 
-AM_PushStack(pageNum,offset)
+AM_PushStack(stack,pageNum,offset)
+AM_STACK *stack;
 int pageNum;
 int offset;
 
 {
-AM_topofStackPtr++;
-AM_Stack[AM_topofStackPtr].pageNumber  = pageNum;
-AM_Stack[AM_topofStackPtr].offset  = offset;
+AM_STACKENTRY *entry;
+
+if (stack->top + 1 == stack->size)
+  {
+   /* deeper than the path has room for */
+   entry = (AM_STACKENTRY *) malloc(2*stack->size*sizeof(AM_STACKENTRY));
+   if (entry == NULL) return(AME_NOMEM);
+   bcopy(stack->entry,entry,stack->size*sizeof(AM_STACKENTRY));
+   if (stack->entry != stack->local) free(stack->entry);
+   stack->entry = entry;
+   stack->size *= 2;
+  }
+stack->top++;
+stack->entry[stack->top].pageNumber  = pageNum;
+stack->entry[stack->top].offset  = offset;
+return(AME_OK);
 }
 
-AM_PopStack()
+AM_PopStack(stack)
+AM_STACK *stack;
 
 {
-AM_topofStackPtr--;
+stack->top--;
 }
 
-AM_topofStack(pageNum,offset)
+AM_topofStack(stack,pageNum,offset)
+AM_STACK *stack;
 int *pageNum;
 int *offset;
 {
-*pageNum = AM_Stack[AM_topofStackPtr].pageNumber ;
-*offset = AM_Stack[AM_topofStackPtr].offset ;
+*pageNum = stack->entry[stack->top].pageNumber ;
+*offset = stack->entry[stack->top].offset ;
 }
 
-AM_EmptyStack()
+/* done with the path: frees what AM_PushStack allocated */
+AM_EmptyStack(stack)
+AM_STACK *stack;
 
 {
-AM_topofStackPtr = -1;
+if (stack->entry != stack->local) free(stack->entry);
+AM_InitStack(stack);
 }
-
@@ -0,0 +1,981 @@
+# include <stdio.h>
+# include <string.h>
+# include "am.h"
+# include "pf.h"
+
+/* Variable-length char keys, for indexes created with AM_FMT_VAR.
+
+A leaf ('L') holds its header, the prefix every key on it starts with and
+one 2-byte slot per key, in key order, giving the offset of the key's
+entry. Entries and recId nodes share a heap growing down from the end of
+the page:
+	entry: [suffix length (1 byte)][suffix][head of the recId list (short)]
+	recId: [recId (int)][next (short)], as in fixed leaves
+A delete drops the slot and leaves the entry behind as garbage, so recId
+nodes do not move under an open scan; the page is rebuilt, reclaiming the
+garbage and recomputing the prefix, when an insert finds no room.
+
+An internal node ('I') holds its header, the prefix of its separators,
+the leftmost child and one slot per separator, the entries
+[suffix length][suffix][child] lying in a heap at the end of the page.
+Separators are the shortest prefix of the right leaf's first key that
+sorts above the left leaf's last key, so a node's fanout follows the
+lengths of the separators rather than attrLength.
+
+A key ends at its first NUL byte or after attrLength bytes, and keys are
+compared bytewise, which is the order strncmp gives fixed char keys. */
+
+/* most entries a page can hold, plus one being added */
+# define AM_VARMAXKEYS (PF_PAGE_SIZE / (AM_ss + AM_sc + AM_si) + 2)
+# define AM_VARMAXRECS (PF_PAGE_SIZE / (AM_si + AM_ss) + 2)
+
+/* a node decoded for a rebuild or a split */
+typedef struct am_varnode
+	{
+		int numKeys;
+		int attrLength;
+		int child0; /* internal: leftmost child */
+		unsigned char keyLen[AM_VARMAXKEYS];
+		char key[AM_VARMAXKEYS][AM_MAXATTRLENGTH]; /* whole keys */
+		int child[AM_VARMAXKEYS]; /* internal: child right of key i */
+		int firstRec[AM_VARMAXKEYS + 1]; /* leaf: key i's recIds are
+				recId[firstRec[i]] .. recId[firstRec[i+1] - 1],
+				head of the list first */
+		int recId[AM_VARMAXRECS];
+	}	AM_VARNODE;
+
+static AM_VARNODE AM_varNode; /* scratch of the update in progress */
+
+
+/* length of the key in value */
+static AM_VarKeyLen(value,attrLength)
+char *value;
+int attrLength;
+
+{
+	char *end;
+
+	end = memchr(value,'\0',attrLength);
+	return(end == NULL ? attrLength : end - value);
+}
+
+
+/* bytes two keys have in common at the front */
+static AM_VarCommon(key1,len1,key2,len2)
+char *key1,*key2;
+int len1,len2;
+
+{
+	int i;
+
+	for (i = 0; i < len1 && i < len2 && key1[i] == key2[i]; i++);
+	return(i);
+}
+
+
+/* compares value with key: < 0, 0 or > 0 as value sorts before, with or
+after it */
+static AM_VarCompare(value,valLen,key,keyLen)
+char *value,*key;
+int valLen,keyLen;
+
+{
+	int compareVal;
+
+	compareVal = memcmp(value,key,valLen < keyLen ? valLen : keyLen);
+	if (compareVal != 0) return(compareVal);
+	return(valLen - keyLen);
+}
+
+
+/* compares value with the prefix of a page: < 0 or > 0 if value sorts
+before or after every key starting with it, 0 if value starts with it */
+static AM_VarComparePrefix(value,valLen,prefix,prefixLen)
+char *value,*prefix;
+int valLen,prefixLen;
+
+{
+	int compareVal;
+
+	compareVal = memcmp(value,prefix,valLen < prefixLen ? valLen : prefixLen);
+	if (compareVal != 0) return(compareVal);
+	return(valLen < prefixLen ? -1 : 0);
+}
+
+
+/* offset of the entry of key index (1 based) of a leaf */
+static AM_VarLeafEntry(pageBuf,header,index)
+char *pageBuf;
+AM_VLEAFHEADER *header;
+int index;
+
+{
+	short entry;
+
+	bcopy(pageBuf + AM_svl + header->prefixLen + (index - 1)*AM_ss,
+	      (char *)&entry,AM_ss);
+	return(entry);
+}
+
+
+/* offset of the entry of separator index (1 based) of an internal node */
+static AM_VarIntEntry(pageBuf,header,index)
+char *pageBuf;
+AM_VINTHEADER *header;
+int index;
+
+{
+	short entry;
+
+	bcopy(pageBuf + AM_svint + header->prefixLen + AM_si +
+	      (index - 1)*AM_ss,(char *)&entry,AM_ss);
+	return(entry);
+}
+
+
+/* copies prefix and suffix into buf and pads it with NULs to attrLength */
+static AM_VarBuildKey(buf,prefix,prefixLen,suffix,suffixLen,attrLength)
+char *buf,*prefix,*suffix;
+int prefixLen,suffixLen,attrLength;
+
+{
+	bcopy(prefix,buf,prefixLen);
+	bcopy(suffix,buf + prefixLen,suffixLen);
+	memset(buf + prefixLen + suffixLen,0,attrLength - prefixLen - suffixLen);
+}
+
+
+/* Key index (1 based) of a leaf of either format: a pointer into a fixed
+page, or the key of a var page rebuilt in buf (AM_MAXATTRLENGTH bytes) */
+char *AM_LeafKey(pageBuf,index,buf)
+char *pageBuf;
+int index;
+char *buf;
+
+{
+	AM_VLEAFHEADER head;
+	int entry;
+
+	bcopy(pageBuf,&head,AM_svl);
+	if (*pageBuf != 'L')
+		return(pageBuf + AM_sl + (index - 1)*(head.h.attrLength + AM_ss));
+	if (index < 1 || index > head.h.numKeys)
+	{
+		memset(buf,0,head.h.attrLength);
+		return(buf);
+	}
+	entry = AM_VarLeafEntry(pageBuf,&head,index);
+	AM_VarBuildKey(buf,pageBuf + AM_svl,head.prefixLen,pageBuf + entry + 1,
+		       (unsigned char)pageBuf[entry],head.h.attrLength);
+	return(buf);
+}
+
+
+/* Head of the recId list of key index (1 based) of a leaf of either
+format */
+AM_LeafHead(pageBuf,index)
+char *pageBuf;
+int index;
+
+{
+	AM_VLEAFHEADER head;
+	int entry;
+	short nextRec;
+
+	bcopy(pageBuf,&head,AM_svl);
+	if (*pageBuf != 'L')
+	{
+		bcopy(pageBuf + AM_sl + (index - 1)*(head.h.attrLength + AM_ss) +
+		      head.h.attrLength,(char *)&nextRec,AM_ss);
+		return(nextRec);
+	}
+	if (index < 1 || index > head.h.numKeys) return(AM_NULL);
+	entry = AM_VarLeafEntry(pageBuf,&head,index);
+	bcopy(pageBuf + entry + 1 + (unsigned char)pageBuf[entry],
+	      (char *)&nextRec,AM_ss);
+	return(nextRec);
+}
+
+
+/* Separator index (1 based) of an internal node of either format, as
+AM_LeafKey */
+char *AM_IntKey(pageBuf,index,buf)
+char *pageBuf;
+int index;
+char *buf;
+
+{
+	AM_VINTHEADER head;
+	int entry;
+
+	bcopy(pageBuf,&head,AM_svint);
+	if (*pageBuf != 'I')
+		return(pageBuf + AM_sint + AM_si +
+		       (index - 1)*(head.h.attrLength + AM_si));
+	entry = AM_VarIntEntry(pageBuf,&head,index);
+	AM_VarBuildKey(buf,pageBuf + AM_svint,head.prefixLen,pageBuf + entry + 1,
+		       (unsigned char)pageBuf[entry],head.h.attrLength);
+	return(buf);
+}
+
+
+/* Child index (0 for the leftmost) of an internal node of either format */
+AM_IntChild(pageBuf,index)
+char *pageBuf;
+int index;
+
+{
+	AM_VINTHEADER head;
+	int entry;
+	int pageNum;
+
+	bcopy(pageBuf,&head,AM_svint);
+	if (*pageBuf != 'I')
+		bcopy(pageBuf + AM_sint + index*(head.h.attrLength + AM_si),
+		      (char *)&pageNum,AM_si);
+	else if (index == 0)
+		bcopy(pageBuf + AM_svint + head.prefixLen,(char *)&pageNum,AM_si);
+	else
+	{
+		entry = AM_VarIntEntry(pageBuf,&head,index);
+		bcopy(pageBuf + entry + 1 + (unsigned char)pageBuf[entry],
+		      (char *)&pageNum,AM_si);
+	}
+	return(pageNum);
+}
+
+
+/* AM_SearchLeaf for a var leaf */
+AM_VarSearchLeaf(pageBuf,attrLength,value,indexPtr)
+char *pageBuf;
+int attrLength;
+char *value;
+int *indexPtr;
+
+{
+	AM_VLEAFHEADER head;
+	int valLen;
+	int low,high,mid;
+	int entry;
+	int compareVal;
+
+	bcopy(pageBuf,&head,AM_svl);
+	valLen = AM_VarKeyLen(value,attrLength);
+	compareVal = AM_VarComparePrefix(value,valLen,pageBuf + AM_svl,
+					 head.prefixLen);
+	if (head.h.numKeys == 0 || compareVal < 0)
+	{
+		*indexPtr = 1;
+		return(AM_NOT_FOUND);
+	}
+	if (compareVal > 0)
+	{
+		*indexPtr = head.h.numKeys + 1;
+		return(AM_NOT_FOUND);
+	}
+
+	/* the first key not below value, comparing suffixes only */
+	value += head.prefixLen;
+	valLen -= head.prefixLen;
+	low = 1;
+	high = head.h.numKeys + 1;
+	while (low < high)
+	{
+		mid = (low + high) / 2;
+		entry = AM_VarLeafEntry(pageBuf,&head,mid);
+		if (AM_VarCompare(value,valLen,pageBuf + entry + 1,
+		    (unsigned char)pageBuf[entry]) > 0)
+			low = mid + 1;
+		else
+			high = mid;
+	}
+	*indexPtr = low;
+	if (low > head.h.numKeys) return(AM_NOT_FOUND);
+	entry = AM_VarLeafEntry(pageBuf,&head,low);
+	if (AM_VarCompare(value,valLen,pageBuf + entry + 1,
+	    (unsigned char)pageBuf[entry]) == 0)
+		return(AM_FOUND);
+	return(AM_NOT_FOUND);
+}
+
+
+/* AM_BinSearch for a var internal node */
+AM_VarBinSearch(pageBuf,attrLength,value,indexPtr)
+char *pageBuf;
+int attrLength;
+char *value;
+int *indexPtr;
+
+{
+	AM_VINTHEADER head;
+	int valLen;
+	int low,high,mid;
+	int entry;
+	int compareVal;
+
+	bcopy(pageBuf,&head,AM_svint);
+	valLen = AM_VarKeyLen(value,attrLength);
+	compareVal = AM_VarComparePrefix(value,valLen,pageBuf + AM_svint,
+					 head.prefixLen);
+	if (compareVal < 0)
+		low = 0;
+	else if (compareVal > 0)
+		low = head.h.numKeys;
+	else
+	{
+		/* the number of separators not above value */
+		value += head.prefixLen;
+		valLen -= head.prefixLen;
+		low = 0;
+		high = head.h.numKeys;
+		while (low < high)
+		{
+			mid = (low + high) / 2;
+			entry = AM_VarIntEntry(pageBuf,&head,mid + 1);
+			if (AM_VarCompare(value,valLen,pageBuf + entry + 1,
+			    (unsigned char)pageBuf[entry]) >= 0)
+				low = mid + 1;
+			else
+				high = mid;
+		}
+	}
+	*indexPtr = low;
+	return(AM_IntChild(pageBuf,low));
+}
+
+
+/* decodes a var leaf into node */
+static AM_VarDecodeLeaf(pageBuf,node)
+char *pageBuf;
+AM_VARNODE *node;
+
+{
+	AM_VLEAFHEADER head;
+	int i,len,entry;
+	int numRecs;
+	short nextRec;
+
+	bcopy(pageBuf,&head,AM_svl);
+	node->numKeys = head.h.numKeys;
+	node->attrLength = head.h.attrLength;
+	numRecs = 0;
+	for (i = 0; i < head.h.numKeys; i++)
+	{
+		entry = AM_VarLeafEntry(pageBuf,&head,i + 1);
+		len = (unsigned char)pageBuf[entry];
+		node->keyLen[i] = head.prefixLen + len;
+		bcopy(pageBuf + AM_svl,node->key[i],head.prefixLen);
+		bcopy(pageBuf + entry + 1,node->key[i] + head.prefixLen,len);
+		node->firstRec[i] = numRecs;
+		bcopy(pageBuf + entry + 1 + len,(char *)&nextRec,AM_ss);
+		while (nextRec != AM_NULL)
+		{
+			bcopy(pageBuf + nextRec,(char *)&node->recId[numRecs++],
+			      AM_si);
+			bcopy(pageBuf + nextRec + AM_si,(char *)&nextRec,AM_ss);
+		}
+	}
+	node->firstRec[head.h.numKeys] = numRecs;
+}
+
+
+/* decodes a var internal node into node */
+static AM_VarDecodeInt(pageBuf,node)
+char *pageBuf;
+AM_VARNODE *node;
+
+{
+	AM_VINTHEADER head;
+	int i,len,entry;
+
+	bcopy(pageBuf,&head,AM_svint);
+	node->numKeys = head.h.numKeys;
+	node->attrLength = head.h.attrLength;
+	bcopy(pageBuf + AM_svint + head.prefixLen,(char *)&node->child0,AM_si);
+	for (i = 0; i < head.h.numKeys; i++)
+	{
+		entry = AM_VarIntEntry(pageBuf,&head,i + 1);
+		len = (unsigned char)pageBuf[entry];
+		node->keyLen[i] = head.prefixLen + len;
+		bcopy(pageBuf + AM_svint,node->key[i],head.prefixLen);
+		bcopy(pageBuf + entry + 1,node->key[i] + head.prefixLen,len);
+		bcopy(pageBuf + entry + 1 + len,(char *)&node->child[i],AM_si);
+	}
+}
+
+
+/* prefix shared by keys low .. high-1 of a decoded node */
+static AM_VarNodePrefix(node,low,high)
+AM_VARNODE *node;
+int low,high;
+
+{
+	if (low >= high) return(0);
+	return(AM_VarCommon(node->key[low],node->keyLen[low],
+			    node->key[high - 1],node->keyLen[high - 1]));
+}
+
+
+/* bytes a leaf holding keys low .. high-1 of node takes */
+static AM_VarLeafBytes(node,low,high)
+AM_VARNODE *node;
+int low,high;
+
+{
+	int prefixLen,bytes,i;
+
+	prefixLen = AM_VarNodePrefix(node,low,high);
+	bytes = AM_svl + prefixLen;
+	for (i = low; i < high; i++)
+		bytes += AM_ss + AM_sc + node->keyLen[i] - prefixLen + AM_ss +
+			 (node->firstRec[i + 1] - node->firstRec[i])*(AM_si + AM_ss);
+	return(bytes);
+}
+
+
+/* bytes an internal node holding keys low .. high-1 of node takes */
+static AM_VarIntBytes(node,low,high)
+AM_VARNODE *node;
+int low,high;
+
+{
+	int prefixLen,bytes,i;
+
+	prefixLen = AM_VarNodePrefix(node,low,high);
+	bytes = AM_svint + prefixLen + AM_si;
+	for (i = low; i < high; i++)
+		bytes += AM_ss + AM_sc + node->keyLen[i] - prefixLen + AM_si;
+	return(bytes);
+}
+
+
+/* writes keys low .. high-1 of node as a var leaf between the leaves
+prevLeafPage and nextLeafPage; they must fit */
+static AM_VarPutLeaf(pageBuf,node,low,high,prevLeafPage,nextLeafPage)
+char *pageBuf;
+AM_VARNODE *node;
+int low,high;
+int prevLeafPage,nextLeafPage;
+
+{
+	AM_VLEAFHEADER head;
+	short recIdPtr,nextRec;
+	int prefixLen,len;
+	int i,j;
+
+	prefixLen = AM_VarNodePrefix(node,low,high);
+	bcopy(node->key[low],pageBuf + AM_svl,prefixLen);
+	recIdPtr = PF_PAGE_SIZE;
+	for (i = low; i < high; i++)
+	{
+		/* the list is written back to front so each node can link to
+		the one after it */
+		nextRec = AM_NULL;
+		for (j = node->firstRec[i + 1] - 1; j >= node->firstRec[i]; j--)
+		{
+			recIdPtr -= AM_si + AM_ss;
+			bcopy((char *)&node->recId[j],pageBuf + recIdPtr,AM_si);
+			bcopy((char *)&nextRec,pageBuf + recIdPtr + AM_si,AM_ss);
+			nextRec = recIdPtr;
+		}
+		len = node->keyLen[i] - prefixLen;
+		recIdPtr -= AM_sc + len + AM_ss;
+		pageBuf[recIdPtr] = len;
+		bcopy(node->key[i] + prefixLen,pageBuf + recIdPtr + 1,len);
+		bcopy((char *)&nextRec,pageBuf + recIdPtr + 1 + len,AM_ss);
+		bcopy((char *)&recIdPtr,pageBuf + AM_svl + prefixLen +
+		      (i - low)*AM_ss,AM_ss);
+	}
+
+	head.h.pageType = 'L';
+	head.h.nextLeafPage = nextLeafPage;
+	head.h.prevLeafPage = prevLeafPage;
+	head.h.recIdPtr = recIdPtr;
+	head.h.keyPtr = AM_svl + prefixLen + (high - low)*AM_ss;
+	head.h.freeListPtr = AM_NULL;
+	head.h.numinfreeList = 0;
+	head.h.attrLength = node->attrLength;
+	head.h.numKeys = high - low;
+	head.h.maxKeys = 0;
+	head.h.payloadLength = 0;
+	head.prefixLen = prefixLen;
+	head.garbage = 0;
+	bcopy(&head,pageBuf,AM_svl);
+}
+
+
+/* writes keys low .. high-1 of node, with child0 left of them, as a var
+internal node; they must fit */
+static AM_VarPutInt(pageBuf,node,low,high,child0)
+char *pageBuf;
+AM_VARNODE *node;
+int low,high;
+int child0;
+
+{
+	AM_VINTHEADER head;
+	short heapPtr;
+	int prefixLen,len;
+	int i;
+
+	prefixLen = AM_VarNodePrefix(node,low,high);
+	bcopy(node->key[low],pageBuf + AM_svint,prefixLen);
+	bcopy((char *)&child0,pageBuf + AM_svint + prefixLen,AM_si);
+	heapPtr = PF_PAGE_SIZE;
+	for (i = low; i < high; i++)
+	{
+		len = node->keyLen[i] - prefixLen;
+		heapPtr -= AM_sc + len + AM_si;
+		pageBuf[heapPtr] = len;
+		bcopy(node->key[i] + prefixLen,pageBuf + heapPtr + 1,len);
+		bcopy((char *)&node->child[i],pageBuf + heapPtr + 1 + len,AM_si);
+		bcopy((char *)&heapPtr,pageBuf + AM_svint + prefixLen + AM_si +
+		      (i - low)*AM_ss,AM_ss);
+	}
+
+	head.h.pageType = 'I';
+	head.h.numKeys = high - low;
+	head.h.maxKeys = 0;
+	head.h.attrLength = node->attrLength;
+	head.prefixLen = prefixLen;
+	head.heapPtr = heapPtr;
+	bcopy(&head,pageBuf,AM_svint);
+}
+
+
+/* makes pageBuf a var root with one separator, value, between two
+children; node is overwritten */
+static AM_VarFillRootPage(pageBuf,node,pageNum1,pageNum2,value,attrLength)
+char *pageBuf;
+AM_VARNODE *node;
+int pageNum1,pageNum2;
+char *value;
+int attrLength;
+
+{
+	node->numKeys = 1;
+	node->attrLength = attrLength;
+	node->keyLen[0] = AM_VarKeyLen(value,attrLength);
+	bcopy(value,node->key[0],node->keyLen[0]);
+	node->child[0] = pageNum2;
+	AM_VarPutInt(pageBuf,node,0,1,pageNum1);
+}
+
+
+/* adds (value,recId) to a decoded leaf at index (1 based) */
+static AM_VarNodeInsert(node,index,status,value,valLen,recId)
+AM_VARNODE *node;
+int index;
+int status; /* AM_FOUND if key index is value */
+char *value;
+int valLen;
+int recId;
+
+{
+	int i,r,n;
+
+	i = index - 1;
+	n = node->numKeys;
+	r = node->firstRec[i];
+	memmove(&node->recId[r + 1],&node->recId[r],
+		(node->firstRec[n] - r)*AM_si);
+	node->recId[r] = recId;
+	if (status == AM_FOUND)
+	{
+		for (r = i + 1; r <= n; r++)
+			node->firstRec[r]++;
+		return;
+	}
+	memmove(node->key[i + 1],node->key[i],(n - i)*AM_MAXATTRLENGTH);
+	memmove(&node->keyLen[i + 1],&node->keyLen[i],n - i);
+	for (r = n; r > i; r--)
+		node->firstRec[r + 1] = node->firstRec[r] + 1;
+	node->firstRec[i + 1] = node->firstRec[i] + 1;
+	node->keyLen[i] = valLen;
+	bcopy(value,node->key[i],valLen);
+	node->numKeys++;
+}
+
+
+/* Number of keys of a decoded leaf to leave on the left page: the first
+count whose entries reach pct percent of the bytes, then moved until both
+pages fit */
+static AM_VarSplitLeafAt(node,pct)
+AM_VARNODE *node;
+int pct;
+
+{
+	int n,k;
+	long total,target,sum;
+
+	n = node->numKeys;
+	if (n < 2) return(AME_INTERROR);
+	total = AM_VarLeafBytes(node,0,n);
+	target = (total * pct) / 100;
+	sum = AM_svl;
+	for (k = 1; k < n - 1; k++)
+	{
+		sum += AM_VarLeafBytes(node,k - 1,k) - AM_svl;
+		if (sum >= target) break;
+	}
+	while (k > 1 && AM_VarLeafBytes(node,0,k) > PF_PAGE_SIZE) k--;
+	while (k < n - 1 && AM_VarLeafBytes(node,k,n) > PF_PAGE_SIZE) k++;
+	if (AM_VarLeafBytes(node,0,k) > PF_PAGE_SIZE ||
+	    AM_VarLeafBytes(node,k,n) > PF_PAGE_SIZE)
+		return(AME_INTERROR);
+	return(k);
+}
+
+
+/* Separator of a decoded internal node that moves up when it splits: the
+left page keeps the ones before it, the right page those after it */
+static AM_VarSplitIntAt(node)
+AM_VARNODE *node;
+
+{
+	int n,m;
+	long total,sum;
+
+	n = node->numKeys;
+	if (n < 3) return(AME_INTERROR);
+	total = AM_VarIntBytes(node,0,n);
+	sum = AM_svint + AM_si;
+	for (m = 1; m < n - 2; m++)
+	{
+		sum += AM_VarIntBytes(node,m - 1,m) - AM_svint - AM_si;
+		if (sum >= total / 2) break;
+	}
+	while (m > 1 && AM_VarIntBytes(node,0,m) > PF_PAGE_SIZE) m--;
+	while (m < n - 2 && AM_VarIntBytes(node,m + 1,n) > PF_PAGE_SIZE) m++;
+	if (AM_VarIntBytes(node,0,m) > PF_PAGE_SIZE ||
+	    AM_VarIntBytes(node,m + 1,n) > PF_PAGE_SIZE)
+		return(AME_INTERROR);
+	return(m);
+}
+
+
+/* takes a recId node from the free list or the gap and puts it at the head
+of the list of key index; the caller has checked there is room */
+static AM_VarAddRecId(pageBuf,header,index,recId)
+char *pageBuf;
+AM_VLEAFHEADER *header;
+int index;
+int recId;
+
+{
+	short node,oldhead;
+	int headPtr,entry;
+
+	if (header->h.freeListPtr != AM_NULL)
+	{
+		node = header->h.freeListPtr;
+		header->h.numinfreeList--;
+		bcopy(pageBuf + node + AM_si,(char *)&header->h.freeListPtr,AM_ss);
+	}
+	else
+	{
+		header->h.recIdPtr -= AM_si + AM_ss;
+		node = header->h.recIdPtr;
+	}
+	entry = AM_VarLeafEntry(pageBuf,header,index);
+	headPtr = entry + 1 + (unsigned char)pageBuf[entry];
+	bcopy(pageBuf + headPtr,(char *)&oldhead,AM_ss);
+	bcopy((char *)&node,pageBuf + headPtr,AM_ss);
+	bcopy((char *)&recId,pageBuf + node,AM_si);
+	bcopy((char *)&oldhead,pageBuf + node + AM_si,AM_ss);
+}
+
+
+/* AM_InsertintoLeaf for a var leaf: TRUE if the pair went in, FALSE if the
+leaf must split */
+AM_VarInsertintoLeaf(pageBuf,attrLength,value,recId,index,status)
+char *pageBuf;
+int attrLength;
+char *value;
+int recId;
+int index;
+int status;
+
+{
+	AM_VLEAFHEADER head;
+	AM_VARNODE *node;
+	char *slots;
+	short entry;
+	short null = AM_NULL;
+	int valLen,suffixLen;
+
+	bcopy(pageBuf,&head,AM_svl);
+	valLen = AM_VarKeyLen(value,attrLength);
+	suffixLen = valLen - head.prefixLen;
+	if (status == AM_FOUND)
+	{
+		if (head.h.freeListPtr != AM_NULL ||
+		    head.h.recIdPtr - head.h.keyPtr >= AM_si + AM_ss)
+		{
+			AM_VarAddRecId(pageBuf,&head,index,recId);
+			bcopy(&head,pageBuf,AM_svl);
+			return(TRUE);
+		}
+	}
+	else if (suffixLen >= 0 &&
+		 memcmp(value,pageBuf + AM_svl,head.prefixLen) == 0 &&
+		 head.h.recIdPtr - head.h.keyPtr >= AM_ss + AM_sc + suffixLen +
+		 AM_ss + AM_si + AM_ss)
+	{
+		/* the key shares the prefix and its slot, entry and recId
+		node fit in the gap */
+		slots = pageBuf + AM_svl + head.prefixLen;
+		memmove(slots + index*AM_ss,slots + (index - 1)*AM_ss,
+			(head.h.numKeys - index + 1)*AM_ss);
+		head.h.keyPtr += AM_ss;
+		head.h.recIdPtr -= AM_sc + suffixLen + AM_ss;
+		entry = head.h.recIdPtr;
+		pageBuf[entry] = suffixLen;
+		bcopy(value + head.prefixLen,pageBuf + entry + 1,suffixLen);
+		bcopy((char *)&null,pageBuf + entry + 1 + suffixLen,AM_ss);
+		bcopy((char *)&entry,slots + (index - 1)*AM_ss,AM_ss);
+		head.h.numKeys++;
+		AM_VarAddRecId(pageBuf,&head,index,recId);
+		bcopy(&head,pageBuf,AM_svl);
+		return(TRUE);
+	}
+
+	/* rebuild the page with the pair, reclaiming garbage and free nodes
+	and recomputing the prefix */
+	node = &AM_varNode;
+	AM_VarDecodeLeaf(pageBuf,node);
+	AM_VarNodeInsert(node,index,status,value,valLen,recId);
+	if (AM_VarLeafBytes(node,0,node->numKeys) > PF_PAGE_SIZE)
+		return(FALSE);
+	AM_VarPutLeaf(pageBuf,node,0,node->numKeys,head.h.prevLeafPage,
+		      head.h.nextLeafPage);
+	return(TRUE);
+}
+
+
+/* AM_SplitLeaf for a var leaf. The separator passed up is cut to the
+shortest prefix of the right page's first key above the left page's last
+key. */
+AM_VarSplitLeaf(fileDesc,pageBuf,pageNum,attrLength,recId,value,status,index,
+		key)
+int fileDesc;
+char *pageBuf;
+int *pageNum;
+int attrLength;
+int recId;
+char *value;
+int status;
+int index;
+char *key;
+
+{
+	AM_VLEAFHEADER head;
+	AM_VARNODE *node;
+	char *tempPageBuf,*tempPageBuf1;
+	int tempPageNum,tempPageNum1;
+	int half,pct,len;
+	int isRoot;
+	int errVal;
+	AM_INDEX *indexp;
+
+	bcopy(pageBuf,&head,AM_svl);
+	indexp = AM_GetIndex(fileDesc);
+	if (indexp == NULL) return(AM_Errno);
+	isRoot = ((*pageNum) == indexp->rootPageNum);
+
+	/* as in AM_SplitLeaf an append to the rightmost leaf leaves
+	AM_RightSplitPct percent behind, here counted in bytes */
+	pct = 50;
+	if (index > head.h.numKeys && head.h.nextLeafPage == AM_NULL_PAGE)
+		pct = AM_RightSplitPct;
+
+	node = &AM_varNode;
+	AM_VarDecodeLeaf(pageBuf,node);
+	AM_VarNodeInsert(node,index,status,value,AM_VarKeyLen(value,attrLength),
+			 recId);
+	half = AM_VarSplitLeafAt(node,pct);
+	if (half < 0) return(half);
+
+	errVal = PF_AllocPage(fileDesc,&tempPageNum,&tempPageBuf);
+	AM_Check;
+	AM_VarPutLeaf(tempPageBuf,node,half,node->numKeys,*pageNum,
+		      head.h.nextLeafPage);
+	AM_VarPutLeaf(pageBuf,node,0,half,head.h.prevLeafPage,tempPageNum);
+
+	len = AM_VarCommon(node->key[half - 1],node->keyLen[half - 1],
+			   node->key[half],node->keyLen[half]) + 1;
+	bcopy(node->key[half],key,len);
+	memset(key + len,0,attrLength - len);
+
+	if (isRoot)
+	{
+		/* the root page stays put, its keys move to a new leaf */
+		errVal = PF_AllocPage(fileDesc,&tempPageNum1,&tempPageBuf1);
+		AM_Check;
+		indexp->leftPageNum = tempPageNum1;
+		indexp->height++;
+		bcopy(pageBuf,tempPageBuf1,PF_PAGE_SIZE);
+		AM_VarFillRootPage(pageBuf,node,tempPageNum1,tempPageNum,key,
+				   attrLength);
+		errVal = PF_UnfixPage(fileDesc,tempPageNum1,TRUE);
+		AM_Check;
+		bcopy(tempPageBuf,&head,AM_svl);
+		head.h.prevLeafPage = tempPageNum1;
+		bcopy(&head,tempPageBuf,AM_svl);
+	}
+
+	errVal = PF_UnfixPage(fileDesc,*pageNum,TRUE);
+	AM_Check;
+	errVal = PF_UnfixPage(fileDesc,tempPageNum,TRUE);
+	AM_Check;
+	errVal = AM_SetPrevLeaf(fileDesc,head.h.nextLeafPage,tempPageNum);
+	if (errVal < 0) return(errVal);
+
+	if (isRoot)
+	{
+		errVal = AM_WriteMeta(fileDesc,indexp);
+		if (errVal < 0) return(errVal);
+		return(FALSE);
+	}
+	*pageNum = tempPageNum;
+	return(TRUE);
+}
+
+
+/* AM_AddtoParent for a var internal node, fixed in pageBuf: adds value and
+the child pageNum right of child offset, splitting the node if they do not
+fit */
+AM_VarAddtoParent(fileDesc,pageNumber,pageBuf,offset,value,pageNum,attrLength,
+		  stack)
+int fileDesc;
+int pageNumber;
+char *pageBuf;
+int offset;
+char *value;
+int pageNum;
+int attrLength;
+AM_STACK *stack; /* path above the node */
+
+{
+	AM_VARNODE *node;
+	AM_INDEX *indexp;
+	char *pageBuf1,*pageBuf2;
+	int pageNum1,pageNum2;
+	int mid,n;
+	int errVal;
+
+	node = &AM_varNode;
+	AM_VarDecodeInt(pageBuf,node);
+	n = node->numKeys;
+	memmove(node->key[offset + 1],node->key[offset],
+		(n - offset)*AM_MAXATTRLENGTH);
+	memmove(&node->keyLen[offset + 1],&node->keyLen[offset],n - offset);
+	memmove(&node->child[offset + 1],&node->child[offset],
+		(n - offset)*AM_si);
+	node->keyLen[offset] = AM_VarKeyLen(value,attrLength);
+	bcopy(value,node->key[offset],node->keyLen[offset]);
+	node->child[offset] = pageNum;
+	node->numKeys++;
+
+	if (AM_VarIntBytes(node,0,node->numKeys) <= PF_PAGE_SIZE)
+	{
+		AM_VarPutInt(pageBuf,node,0,node->numKeys,node->child0);
+		errVal = PF_UnfixPage(fileDesc,pageNumber,TRUE);
+		AM_Check;
+		return(AME_OK);
+	}
+
+	mid = AM_VarSplitIntAt(node);
+	if (mid < 0)
+	{
+		PF_UnfixPage(fileDesc,pageNumber,FALSE);
+		return(mid);
+	}
+	errVal = PF_AllocPage(fileDesc,&pageNum1,&pageBuf1);
+	AM_Check;
+	AM_VarPutInt(pageBuf1,node,mid + 1,node->numKeys,node->child[mid]);
+
+	/* the middle separator moves up */
+	bcopy(node->key[mid],value,node->keyLen[mid]);
+	memset(value + node->keyLen[mid],0,attrLength - node->keyLen[mid]);
+
+	indexp = AM_GetIndex(fileDesc);
+	if (indexp == NULL) return(AM_Errno);
+	if (pageNumber == indexp->rootPageNum)
+	{
+		errVal = PF_AllocPage(fileDesc,&pageNum2,&pageBuf2);
+		AM_Check;
+		AM_VarPutInt(pageBuf2,node,0,mid,node->child0);
+		AM_VarFillRootPage(pageBuf,node,pageNum2,pageNum1,value,
+				   attrLength);
+		errVal = PF_UnfixPage(fileDesc,pageNumber,TRUE);
+		AM_Check;
+		errVal = PF_UnfixPage(fileDesc,pageNum1,TRUE);
+		AM_Check;
+		errVal = PF_UnfixPage(fileDesc,pageNum2,TRUE);
+		AM_Check;
+		indexp->height++;
+		return(AM_WriteMeta(fileDesc,indexp));
+	}
+
+	AM_VarPutInt(pageBuf,node,0,mid,node->child0);
+	errVal = PF_UnfixPage(fileDesc,pageNumber,TRUE);
+	AM_Check;
+	errVal = PF_UnfixPage(fileDesc,pageNum1,TRUE);
+	AM_Check;
+	return(AM_AddtoParent(fileDesc,pageNum1,value,attrLength,stack));
+}
+
+
+/* Deletes recId from the list of key index (1 based) of a var leaf,
+dropping the key when its list empties. Returns AME_OK or AME_NOTFOUND. */
+AM_VarDeleteFromLeaf(pageBuf,index,recId)
+char *pageBuf;
+int index;
+int recId;
+
+{
+	AM_VLEAFHEADER head;
+	char *slots;
+	int entry,len;
+	int headPtr,currPtr;
+	short nextRec;
+	int tempRec;
+
+	bcopy(pageBuf,&head,AM_svl);
+	entry = AM_VarLeafEntry(pageBuf,&head,index);
+	len = (unsigned char)pageBuf[entry];
+	headPtr = currPtr = entry + 1 + len;
+	bcopy(pageBuf + currPtr,(char *)&nextRec,AM_ss);
+	while (nextRec != AM_NULL)
+	{
+		bcopy(pageBuf + nextRec,(char *)&tempRec,AM_si);
+		if (tempRec == recId)
+		{
+			/* unlink the node and put it on the free list */
+			bcopy(pageBuf + nextRec + AM_si,pageBuf + currPtr,AM_ss);
+			bcopy((char *)&head.h.freeListPtr,pageBuf + nextRec + AM_si,
+			      AM_ss);
+			head.h.freeListPtr = nextRec;
+			head.h.numinfreeList++;
+			break;
+		}
+		currPtr = nextRec + AM_si;
+		bcopy(pageBuf + currPtr,(char *)&nextRec,AM_ss);
+	}
+	if (nextRec == AM_NULL) return(AME_NOTFOUND);
+
+	/* an empty list drops the key's slot; its entry becomes garbage */
+	bcopy(pageBuf + headPtr,(char *)&nextRec,AM_ss);
+	if (nextRec == AM_NULL)
+	{
+		slots = pageBuf + AM_svl + head.prefixLen;
+		memmove(slots + (index - 1)*AM_ss,slots + index*AM_ss,
+			(head.h.numKeys - index)*AM_ss);
+		head.h.numKeys--;
+		head.h.keyPtr -= AM_ss;
+		head.garbage += AM_sc + len + AM_ss;
+	}
+	bcopy(&head,pageBuf,AM_svl);
+	return(AME_OK);
+}
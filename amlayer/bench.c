@@ -0,0 +1,32 @@
+/* bench.c: the harness the amlayer benchmarks share; see bench.h */
+#include <stdio.h>
+#include <stdlib.h>
+#include "bench.h"
+
+void bench_init(void){
+    PF_Init();
+    if (!getenv("TOYDB_PF_BUFS")) PF_SetBufferPoolSize(50);
+}
+
+long bench_max_rec(void){
+    return getenv("MAX_REC")? atol(getenv("MAX_REC")) : 0;
+}
+
+int bench_open(const char *spfile){
+    int spfd = SP_Open(spfile);
+    if (spfd < 0) PF_PrintError((char*)spfile);
+    return spfd;
+}
+
+long bench_load(int spfd, int (*each)(char *state, SP_Record *r, SP_RID rid), char *state){
+    SP_Scan scan; SP_Record r; SP_RID rid; char buf[1024];
+    long max_rec = bench_max_rec(), n = 0;
+
+    SP_ScanOpen(spfd, &scan);
+    while ((max_rec == 0 || n < max_rec) && SP_ScanNext(&scan, &r, &rid, buf, sizeof(buf)) == PFE_OK){
+        if (each(state, &r, rid) != 0){ n = -1; break; }
+        n++;
+    }
+    SP_ScanClose(&scan);
+    return n;
+}
@@ -0,0 +1,58 @@
+/* bench.h: what the amlayer benchmarks share: the AM calls they make,
+   PF statistics, timing, recId packing and loading the students file.
+   It includes am.h, pf.h, testam.h and slotted.h itself, so a benchmark
+   includes it in their place. */
+#include <time.h>
+#include "am.h"
+#include "pf.h"
+#include "testam.h"
+#include "../pflayer/slotted.h"
+
+int AM_CreateIndex(char *fileName, int indexNo, char attrType, int attrLength);
+int AM_CreateIndexEx(char *fileName, int indexNo, char attrType, int attrLength, int format);
+int AM_CreateCompositeIndex(char *fileName, int indexNo, AM_KEYDESC *keyDesc);
+int AM_CreateCoveringIndex(char *fileName, int indexNo, char attrType, int attrLength, int payloadLength);
+int AM_EncodeKey(int fileDesc, char **values, int numCols, char *keyBuf);
+int AM_DestroyIndex(char *fileName, int indexNo);
+int AM_OpenIndex(char *fileName, int indexNo);
+int AM_CloseIndex(int fileDesc);
+int AM_InsertEntry(int fileDesc, char attrType, int attrLength, char *value, int recId);
+int AM_InsertEntryPayload(int fileDesc, char attrType, int attrLength, char *value, int recId, char *payload);
+int AM_InsertEntryLatched(int fileDesc, char attrType, int attrLength, char *value, int recId);
+int AM_DeleteEntry(int fileDesc, char attrType, int attrLength, char *value, int recId);
+int AM_BulkLoad(int fileDesc, char attrType, int attrLength, AM_ITERATOR *iterator);
+int AM_OpenIndexScan(int fileDesc, char attrType, int attrLength, int op, char *value);
+int AM_OpenPrefixScan(int fileDesc, char attrType, int attrLength, char *value, int prefixLength);
+int AM_FindNextEntry(int scanDesc);
+int AM_FindNextEntries(int scanDesc, int *recIds, char *keys, int max);
+int AM_FindNextEntryPayload(int scanDesc, char *payload);
+int AM_CloseIndexScan(int scanDesc);
+int AM_LookupBatch(int fileDesc, char attrType, int attrLength, char *keys, int numKeys, int (*callback)(), char *state);
+int AM_LookupLatched(int fileDesc, char attrType, int attrLength, char *value, int *recIds, int maxRecIds);
+int AM_BuildFilter(int fileDesc, int numKeys);
+int AM_TreeStats(int fileDesc, AM_TREESTATS *stats);
+void AM_PrintError(char *s);
+
+typedef struct PFStats {
+    long logical_reads, logical_writes, physical_reads, physical_writes, buffer_hits, buffer_misses;
+} PFStats;
+extern void PF_StatsReset();
+extern void PF_StatsGet(PFStats *out);
+extern int PF_SetBufferPoolSize(int n);
+extern void PF_SetThreaded(int on);
+
+/* a slotted-file RID as an AM recId: page in the high 16 bits, slot in the low */
+static inline int pack_rid(int page, int slot){ return ((page & 0xFFFF) << 16) | (slot & 0xFFFF); }
+static inline SP_RID unpack_rid(int r){ SP_RID rid; rid.page = (r >> 16) & 0xFFFF; rid.slot = r & 0xFFFF; return rid; }
+static inline unsigned long now_us(){ struct timespec ts; clock_gettime(CLOCK_MONOTONIC, &ts); return (unsigned long)ts.tv_sec*1000000ul + (unsigned long)(ts.tv_nsec/1000); }
+
+/* PF_Init, with a 50-buffer pool unless TOYDB_PF_BUFS asks otherwise */
+void bench_init(void);
+/* MAX_REC from the environment, 0 for no limit */
+long bench_max_rec(void);
+/* opens the students file, printing the PF error if it cannot */
+int bench_open(const char *spfile);
+/* hands each of the first MAX_REC records of spfd (all of them when it is
+   unset) to each(state, record, rid), which returns 0 to go on. Returns
+   the records handed over, or -1 when each gave up. */
+long bench_load(int spfd, int (*each)(char *state, SP_Record *r, SP_RID rid), char *state);
@@ -0,0 +1,202 @@
+/* bloombench.c: equality lookups on the roll_no index of the student file
+   of which MISS_PCT percent (default 90) are for roll numbers no student
+   has, as in an anti-join or a dedup check. Runs the same probes, one EQUAL
+   scan each and then one AM_LookupBatch, against an index without a Bloom
+   filter and one with, and reports the page fixes the filter saves, its
+   false positives and what it costs inserts. Then rebuilds the filter with
+   AM_BuildFilter and probes again after reopening the index, and checks
+   that keys inserted after that survive a close without AM_CloseIndex. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+
+typedef struct { int roll; int rid; } Row;
+
+static Row *rows; static long n, cap;
+static int maxroll;
+static int *rolls;			/* every row's roll_no, sorted */
+static int *probe, *want; static int nprobe, nmiss;
+static long *bcount;
+
+static int cmp_int(const void *a, const void *b){ int x = *(const int*)a, y = *(const int*)b; return (x > y) - (x < y); }
+
+/* rows with roll_no key */
+static int count_roll(int key){
+    long lo = 0, hi = n, m, c = 0;
+    while (lo < hi){ m = (lo + hi)/2; if (rolls[m] < key) lo = m + 1; else hi = m; }
+    while (lo + c < n && rolls[lo + c] == key) c++;
+    return (int)c;
+}
+
+static int load_row(char *state, SP_Record *r, SP_RID rid){
+    (void)state;
+    if (n == cap){ cap = cap? cap*2 : 8192; rows = (Row*)realloc(rows, cap*sizeof(Row)); if (!rows){ fprintf(stderr, "oom\n"); return -1; } }
+    rows[n].roll = (int)r->roll_no; rows[n].rid = pack_rid(rid.page, rid.slot);
+    if (rows[n].roll > maxroll) maxroll = rows[n].roll;
+    n++;
+    return 0;
+}
+
+static int count_match(char *state, int keyNum, int recId){ bcount[keyNum]++; return 0; }
+
+/* one EQUAL scan per probe; returns the page fixes, and the probes for
+   missing keys that fixed a page in *passed */
+static long run_probes(int fd, double *ms, long *bad, int *passed){
+    PFStats st; unsigned long t0; long lr = 0; int i, sd, got, rec;
+    *ms = 0.0; *passed = 0;
+    for (i = 0; i < nprobe; i++){
+        PF_StatsReset(); t0 = now_us();
+        sd = AM_OpenIndexScan(fd, 'i', sizeof(int), EQUAL, (char*)&probe[i]);
+        got = 0; while ((rec = AM_FindNextEntry(sd)) >= 0) got++;
+        AM_CloseIndexScan(sd);
+        *ms += (now_us()-t0)/1000.0; PF_StatsGet(&st);
+        lr += st.logical_reads;
+        if (got != want[i]) (*bad)++;
+        if (want[i] == 0 && st.logical_reads > 0) (*passed)++;
+    }
+    return lr;
+}
+
+/* every probe through one AM_LookupBatch; returns the page fixes */
+static long run_batch(int fd, double *ms, long *bad){
+    PFStats st; unsigned long t0; int i;
+    memset(bcount, 0, nprobe*sizeof(long));
+    PF_StatsReset(); t0 = now_us();
+    if (AM_LookupBatch(fd, 'i', sizeof(int), (char*)probe, nprobe, count_match, NULL) < 0){ AM_PrintError("batch"); (*bad)++; }
+    *ms = (now_us()-t0)/1000.0; PF_StatsGet(&st);
+    for (i = 0; i < nprobe; i++) if (bcount[i] != want[i]) (*bad)++;
+    return st.logical_reads;
+}
+
+/* an index on roll_no by inserts in file order, with a filter for n keys
+   first if filter; returns its descriptor */
+static int build(const char *idxbase, int indexNo, int filter, double *ms, PFStats *st){
+    int fd; long i; unsigned long t0;
+    AM_DestroyIndex((char*)idxbase, indexNo);
+    if (AM_CreateIndex((char*)idxbase, indexNo, 'i', sizeof(int)) != AME_OK){ AM_PrintError("create"); exit(1); }
+    fd = AM_OpenIndex((char*)idxbase, indexNo);
+    if (fd < 0){ AM_PrintError("open"); exit(1); }
+    if (filter && AM_BuildFilter(fd, (int)n) != AME_OK){ AM_PrintError("filter"); exit(1); }
+    PF_StatsReset(); t0 = now_us();
+    for (i = 0; i < n; i++)
+        if (AM_InsertEntry(fd, 'i', sizeof(int), (char*)&rows[i].roll, rows[i].rid) != AME_OK){ AM_PrintError("insert"); exit(1); }
+    *ms = (now_us()-t0)/1000.0; PF_StatsGet(st);
+    return fd;
+}
+
+int main(int argc, char **argv){
+    const char *spfile = (argc>1)? argv[1] : "../pflayer/students.spf";
+    const char *idxbase = (argc>2)? argv[2] : "studbloom";
+    int qnum = getenv("QNUM")? atoi(getenv("QNUM")) : 20000;
+    int miss_pct = getenv("MISS_PCT")? atoi(getenv("MISS_PCT")) : 90;
+    long bad = 0, plain_lr, filt_lr, plain_blr, filt_blr, again_lr;
+    int spfd, pfd, ffd, i, plain_pass, filt_pass, again_pass;
+    double plain_build, filt_build, plain_ms, filt_ms, plain_bms, filt_bms, again_ms, ms;
+    PFStats plain_st, filt_st, st; AM_TREESTATS ts; unsigned long t0;
+
+    if (getenv("FILTER_BITS")) AM_FilterBitsPerKey = atoi(getenv("FILTER_BITS")); /* bits a key gets in AM_BuildFilter */
+    bench_init();
+
+    if ((spfd = bench_open(spfile)) < 0) return 1;
+    if (bench_load(spfd, load_row, NULL) < 0) return 1;
+    SP_Close(spfd);
+    if (n == 0 || qnum <= 0){ fprintf(stderr, "no records or probes\n"); return 1; }
+    rolls = (int*)malloc(n*sizeof(int));
+    for (i = 0; i < n; i++) rolls[i] = rows[i].roll;
+    qsort(rolls, n, sizeof(int), cmp_int);
+
+    /* the probes: a missing roll_no from up to four times the largest, or
+       that of a random row */
+    nprobe = qnum;
+    probe = (int*)malloc(nprobe*sizeof(int)); want = (int*)malloc(nprobe*sizeof(int));
+    bcount = (long*)malloc(nprobe*sizeof(long));
+    srand(777);
+    for (i = 0; i < nprobe; i++){
+        if (rand() % 100 < miss_pct){
+            do probe[i] = rand() % (4*(maxroll + 1)); while (count_roll(probe[i]) > 0);
+            nmiss++;
+        } else
+            probe[i] = rows[rand() % n].roll;
+        want[i] = count_roll(probe[i]);
+    }
+    printf("Loaded %ld records from %s, %d probes, %d missing, filter %d bits/key\n", n, spfile, nprobe, nmiss, AM_FilterBitsPerKey);
+
+    /* the same index without and with a filter */
+    pfd = build(idxbase, 0, 0, &plain_build, &plain_st);
+    ffd = build(idxbase, 1, 1, &filt_build, &filt_st);
+    if (AM_TreeStats(ffd, &ts) != AME_OK){ AM_PrintError("tree stats"); return 1; }
+    printf("bloombench build: rows=%ld  no filter: %.2f ms lr=%ld lw=%ld  filter: %.2f ms lr=%ld lw=%ld  tree_pages=%d filter_pages=%d\n",
+        n, plain_build, plain_st.logical_reads, plain_st.logical_writes, filt_build, filt_st.logical_reads, filt_st.logical_writes,
+        ts.leafPages + ts.intPages + ts.postPages, ts.filterPages);
+
+    /* one scan a probe */
+    plain_lr = run_probes(pfd, &plain_ms, &bad, &plain_pass);
+    filt_lr = run_probes(ffd, &filt_ms, &bad, &filt_pass);
+    printf("bloombench scans: probes=%d missing=%d%%  no filter: %.4f ms/probe %.2f fixes/probe  filter: %.4f ms/probe %.2f fixes/probe  saved=%ld fixes (%.1f%%)  false_pos=%d of %d (%.2f%%)  check=%s\n",
+        nprobe, miss_pct, plain_ms/nprobe, (double)plain_lr/nprobe, filt_ms/nprobe, (double)filt_lr/nprobe,
+        plain_lr - filt_lr, plain_lr ? 100.0*(plain_lr - filt_lr)/plain_lr : 0.0,
+        filt_pass, nmiss, nmiss ? 100.0*filt_pass/nmiss : 0.0, bad == 0 ? "ok" : "BAD");
+
+    /* all of them in one batch */
+    plain_blr = run_batch(pfd, &plain_bms, &bad);
+    filt_blr = run_batch(ffd, &filt_bms, &bad);
+    printf("bloombench batch: no filter: %.2f ms lr=%ld  filter: %.2f ms lr=%ld  saved=%ld fixes  check=%s\n",
+        plain_bms, plain_blr, filt_bms, filt_blr, plain_blr - filt_blr, bad == 0 ? "ok" : "BAD");
+
+    /* a third of the rows out: their bits stay until the filter is rebuilt */
+    for (i = 0; i < n; i += 3){
+        if (AM_DeleteEntry(ffd, 'i', sizeof(int), (char*)&rows[i].roll, rows[i].rid) != AME_OK){ AM_PrintError("delete"); return 1; }
+        if (AM_DeleteEntry(pfd, 'i', sizeof(int), (char*)&rows[i].roll, rows[i].rid) != AME_OK){ AM_PrintError("delete"); return 1; }
+    }
+    for (i = 0; i < n; i++) rolls[i] = (i % 3) ? rows[i].roll : -1;
+    qsort(rolls, n, sizeof(int), cmp_int);
+    nmiss = 0;
+    for (i = 0; i < nprobe; i++){ want[i] = count_roll(probe[i]); nmiss += (want[i] == 0); }
+    PF_StatsReset(); t0 = now_us();
+    if (AM_BuildFilter(ffd, 0) != AME_OK){ AM_PrintError("rebuild"); return 1; }
+    ms = (now_us()-t0)/1000.0; PF_StatsGet(&st);
+    AM_TreeStats(ffd, &ts);
+
+    /* the rebuilt filter, read back from its pages */
+    AM_CloseIndex(ffd);
+    ffd = AM_OpenIndex((char*)idxbase, 1);
+    if (ffd < 0){ AM_PrintError("reopen"); return 1; }
+    plain_lr = run_probes(pfd, &plain_ms, &bad, &plain_pass);
+    again_lr = run_probes(ffd, &again_ms, &bad, &again_pass);
+    printf("bloombench rebuild: %.2f ms lr=%ld lw=%ld filter_pages=%d  after reopen: no filter %.2f fixes/probe  filter %.2f fixes/probe  false_pos=%d of %d  check=%s\n",
+        ms, st.logical_reads, st.logical_writes, ts.filterPages, (double)plain_lr/nprobe, (double)again_lr/nprobe,
+        again_pass, nmiss, bad == 0 ? "ok" : "BAD");
+
+    /* the deleted rows back in after the rebuild, then a close that skips
+       AM_CloseIndex: the filter on disk lacks them, so the reopen must not
+       trust it */
+    for (i = 0; i < n; i += 3)
+        if (AM_InsertEntry(ffd, 'i', sizeof(int), (char*)&rows[i].roll, rows[i].rid) != AME_OK){ AM_PrintError("reinsert"); return 1; }
+    PF_CloseFile(ffd);
+    ffd = AM_OpenIndex((char*)idxbase, 1);
+    if (ffd < 0){ AM_PrintError("reopen"); return 1; }
+    for (i = 0; i < n; i++) rolls[i] = rows[i].roll;
+    qsort(rolls, n, sizeof(int), cmp_int);
+    nmiss = 0;
+    for (i = 0; i < nprobe; i++){ want[i] = count_roll(probe[i]); nmiss += (want[i] == 0); }
+    {
+        long lost = 0; int got, sd;
+        for (i = 0; i < n; i += 3){
+            sd = AM_OpenIndexScan(ffd, 'i', sizeof(int), EQUAL, (char*)&rows[i].roll);
+            got = 0; while (AM_FindNextEntry(sd) >= 0) got++;
+            AM_CloseIndexScan(sd);
+            if (got != count_roll(rows[i].roll)) lost++;
+        }
+        again_lr = run_probes(ffd, &again_ms, &bad, &again_pass);
+        run_batch(ffd, &ms, &bad);
+        AM_TreeStats(ffd, &ts);
+        printf("bloombench unclosed: reinserted=%ld lost=%ld filter_pages=%d after reopen  check=%s\n",
+            (n + 2)/3, lost, ts.filterPages, (bad == 0 && lost == 0) ? "ok" : "BAD");
+    }
+
+    AM_CloseIndex(pfd); AM_CloseIndex(ffd);
+    AM_DestroyIndex((char*)idxbase, 0); AM_DestroyIndex((char*)idxbase, 1);
+    free(rows); free(rolls); free(probe); free(want); free(bcount);
+    return 0;
+}
@@ -0,0 +1,150 @@
+/* coverbench.c: roll_no range queries that count students by (dept, level),
+   answered from a plain roll_no index, which fetches every matching record
+   from the heap, and from a covering index whose entries also carry dept and
+   level, which never touches the heap. Reports heap fetches and logical
+   reads for each and checks both give the same counts. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+
+#define DEPTLEN 16
+#define LEVELLEN 4
+#define MAXGROUPS 64
+
+/* the payload of the covering index. The scan does not hand back keys, so
+   roll_no rides along to tell where the range ends */
+typedef struct { int roll; char dept[DEPTLEN]; char level[LEVELLEN]; } Cover;
+
+/* dept and level as strings: a byte more than the fields for the NUL */
+typedef struct { char dept[DEPTLEN+1]; char level[LEVELLEN+1]; long count; } Group;
+
+static void add_group(Group *g, int *ng, const char *dept, const char *level){
+    int i;
+    for (i = 0; i < *ng; i++)
+        if (strncmp(g[i].dept, dept, DEPTLEN) == 0 && strncmp(g[i].level, level, LEVELLEN) == 0){ g[i].count++; return; }
+    if (*ng == MAXGROUPS) return;
+    strncpy(g[*ng].dept, dept, sizeof(g[*ng].dept) - 1); g[*ng].dept[sizeof(g[*ng].dept) - 1] = '\0';
+    strncpy(g[*ng].level, level, sizeof(g[*ng].level) - 1); g[*ng].level[sizeof(g[*ng].level) - 1] = '\0';
+    g[*ng].count = 1; (*ng)++;
+}
+
+static long group_sum(Group *g, int ng){ long s = 0; int i; for (i = 0; i < ng; i++) s += g[i].count * (i + 1); return s; }
+
+/* the loaded roll_nos, recIds and payloads */
+static int *rolls, *rids; static Cover *covers; static long n, cap;
+static int minroll, maxroll;
+
+static int load_row(char *state, SP_Record *r, SP_RID rid){
+    (void)state;
+    if (n == cap){
+        cap = cap? cap*2 : 8192;
+        rolls = (int*)realloc(rolls, cap*sizeof(int)); rids = (int*)realloc(rids, cap*sizeof(int));
+        covers = (Cover*)realloc(covers, cap*sizeof(Cover));
+        if (!rolls || !rids || !covers){ fprintf(stderr, "oom\n"); return -1; }
+    }
+    rolls[n] = (int)r->roll_no;
+    rids[n] = pack_rid(rid.page, rid.slot);
+    memset(&covers[n], 0, sizeof(Cover));
+    covers[n].roll = rolls[n];
+    strncpy(covers[n].dept, r->dept ? r->dept : "", DEPTLEN);
+    strncpy(covers[n].level, r->level ? r->level : "", LEVELLEN);
+    if (n == 0 || rolls[n] < minroll) minroll = rolls[n];
+    if (n == 0 || rolls[n] > maxroll) maxroll = rolls[n];
+    n++;
+    return 0;
+}
+
+int main(int argc, char **argv){
+    const char *spfile = (argc>1)? argv[1] : "../pflayer/students.spf";
+    const char *idxbase = (argc>2)? argv[2] : "studcover";
+    int qnum = getenv("QNUM")? atoi(getenv("QNUM")) : 200;
+    int width = getenv("WIDTH")? atoi(getenv("WIDTH")) : 2000; /* roll_no values per range */
+    long i;
+    int plainfd, coverfd, spfd, sd, rec, q;
+    int *lo;
+    Cover c;
+    AM_TREESTATS ts; PFStats st; unsigned long t0;
+    double plain_ms, cover_ms;
+    long plain_lr, cover_lr, plain_fetch = 0, plain_rows = 0, cover_rows = 0, bad = 0;
+
+    bench_init();
+
+    if ((spfd = bench_open(spfile)) < 0) return 1;
+    if (bench_load(spfd, load_row, NULL) < 0) return 1;
+    printf("Loaded %ld records from %s, roll_no %d..%d\n", n, spfile, minroll, maxroll);
+    if (n == 0) return 0;
+
+    AM_DestroyIndex((char*)idxbase, 0);
+    AM_DestroyIndex((char*)idxbase, 1);
+    if (AM_CreateIndex((char*)idxbase, 0, INT_TYPE, sizeof(int)) != AME_OK){ AM_PrintError("create plain"); return 1; }
+    if (AM_CreateCoveringIndex((char*)idxbase, 1, INT_TYPE, sizeof(int), sizeof(Cover)) != AME_OK){ AM_PrintError("create covering"); return 1; }
+    plainfd = AM_OpenIndex((char*)idxbase, 0);
+    coverfd = AM_OpenIndex((char*)idxbase, 1);
+    if (plainfd < 0 || coverfd < 0){ AM_PrintError("open"); return 1; }
+    for (i = 0; i < n; i++){
+        if (AM_InsertEntry(plainfd, INT_TYPE, sizeof(int), (char*)&rolls[i], rids[i]) != AME_OK){ AM_PrintError("insert plain"); return 1; }
+        if (AM_InsertEntryPayload(coverfd, INT_TYPE, sizeof(int), (char*)&rolls[i], rids[i], (char*)&covers[i]) != AME_OK){ AM_PrintError("insert covering"); return 1; }
+    }
+    AM_TreeStats(plainfd, &ts);
+    printf("coverbench plain: height=%d leaf_pages=%d int_pages=%d recids=%d\n", ts.height, ts.leafPages, ts.intPages, ts.numRecIds);
+    AM_TreeStats(coverfd, &ts);
+    printf("coverbench covering: payload=%d bytes height=%d leaf_pages=%d int_pages=%d recids=%d\n",
+        (int)sizeof(Cover), ts.height, ts.leafPages, ts.intPages, ts.numRecIds);
+
+    lo = (int*)malloc(qnum*sizeof(int));
+    srand(2024);
+    for (q = 0; q < qnum; q++){
+        long span = (long)maxroll - minroll - width;
+        lo[q] = minroll + (span > 0 ? (int)((rand()/(double)RAND_MAX) * span) : 0);
+    }
+
+    /* plain index: every entry in range is fetched for its dept and level */
+    PF_StatsReset(); t0 = now_us();
+    {
+        long sum = 0;
+        for (q = 0; q < qnum; q++){
+            Group g[MAXGROUPS]; int ng = 0;
+            sd = AM_OpenIndexScan(plainfd, INT_TYPE, sizeof(int), GE_OP, (char*)&lo[q]);
+            if (sd < 0){ AM_PrintError("scan"); return 1; }
+            while ((rec = AM_FindNextEntry(sd)) >= 0){
+                SP_Record r; char buf[1024];
+                plain_fetch++;
+                if (SP_Get(spfd, unpack_rid(rec), &r, buf, sizeof(buf)) != PFE_OK){ bad++; continue; }
+                if (r.roll_no >= (long)lo[q] + width) break;
+                add_group(g, &ng, r.dept ? r.dept : "", r.level ? r.level : "");
+                plain_rows++;
+            }
+            AM_CloseIndexScan(sd);
+            sum += group_sum(g, ng);
+        }
+        plain_ms = (now_us()-t0)/1000.0; PF_StatsGet(&st); plain_lr = st.logical_reads;
+
+        /* covering index: the same groups from the payloads alone */
+        PF_StatsReset(); t0 = now_us();
+        for (q = 0; q < qnum; q++){
+            Group g[MAXGROUPS]; int ng = 0;
+            sd = AM_OpenIndexScan(coverfd, INT_TYPE, sizeof(int), GE_OP, (char*)&lo[q]);
+            if (sd < 0){ AM_PrintError("scan"); return 1; }
+            while ((rec = AM_FindNextEntryPayload(sd, (char*)&c)) >= 0){
+                if (c.roll >= lo[q] + width) break;
+                add_group(g, &ng, c.dept, c.level);
+                cover_rows++;
+            }
+            AM_CloseIndexScan(sd);
+            sum -= group_sum(g, ng);
+        }
+        cover_ms = (now_us()-t0)/1000.0; PF_StatsGet(&st); cover_lr = st.logical_reads;
+        if (sum != 0) bad++;
+    }
+
+    printf("coverbench range: queries=%d width=%d rows=%ld  plain: heap_fetches=%ld lr=%ld %.2f ms  covering: heap_fetches=0 lr=%ld %.2f ms  check=%s\n",
+        qnum, width, plain_rows, plain_fetch, plain_lr, plain_ms, cover_lr, cover_ms,
+        (bad == 0 && plain_rows == cover_rows) ? "ok" : "BAD");
+
+    AM_CloseIndex(plainfd);
+    AM_CloseIndex(coverfd);
+    SP_Close(spfd);
+    free(lo); free(rolls); free(rids); free(covers);
+    return 0;
+}
@@ -4,10 +4,13 @@
 #include <string.h>
 #include <errno.h>
 #include <unistd.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 #include "am.h"
 #include "pf.h"
 #include "testam.h"
 #include "../pflayer/slotted.h"
+#include "../pflayer/extsort.h"
 
 /* Missing AM prototypes in legacy headers */
 int AM_CreateIndex(char *fileName, int indexNo, char attrType, int attrLength);
@@ -15,7 +18,19 @@ int AM_DestroyIndex(char *fileName, int indexNo);
 int AM_InsertEntry(int fileDesc, char attrType, int attrLength, char *value, int recId);
 int AM_OpenIndexScan(int fileDesc, char attrType, int attrLength, int op, char *value);
 int AM_FindNextEntry(int scanDesc);
+int AM_FindNextEntries(int scanDesc, int *recIds, char *keys, int max);
+int AM_OpenIndexScanDesc(int fileDesc, char attrType, int attrLength, int op, char *value);
+int AM_OpenRangeScan(int fileDesc, char attrType, int attrLength, char *lo, int loIncl, char *hi, int hiIncl);
+int AM_ScanKey(int scanDesc, char *value);
 int AM_CloseIndexScan(int scanDesc);
+int AM_BulkLoad(int fileDesc, char attrType, int attrLength, AM_ITERATOR *iterator);
+int AM_TreeStats(int fileDesc, AM_TREESTATS *stats);
+int AM_OpenIndex(char *fileName, int indexNo);
+int AM_LookupBatch(int fileDesc, char attrType, int attrLength, char *keys, int numKeys, int (*callback)(), char *state);
+int AM_CloseIndex(int fileDesc);
+int AM_DeleteEntry(int fileDesc, char attrType, int attrLength, char *value, int recId);
+int AM_CreateHashIndex(char *fileName, int indexNo, char attrType, int attrLength);
+int AM_HashStats(int fileDesc, AM_HASHSTATS *stats);
 void AM_PrintError(char *s);
 
 /* Missing PF prototypes in legacy amlayer/pf.h */
@@ -44,6 +59,25 @@ static int cmp_pair(const void *a, const void *b){ const Pair *pa=(const Pair*)a
 
 static void stats_get(PFStats *st){ PF_StatsGet(st); }
 
+/* AM_BulkLoad iterator over the external sort's output */
+static int sorted_next(char *state, char *value, int *recId){
+    Pair p; int rc = ES_Next((ES_Sort*)state, &p);
+    if (rc != 1) return rc;
+    memcpy(value, &p.key, sizeof(int)); *recId = p.rid;
+    return 1;
+}
+
+/* AM_LookupBatch callback: counts matches */
+static int count_match(char *state, int keyNum, int recId){
+    (void)keyNum; (void)recId;
+    (*(long*)state)++;
+    return 0;
+}
+
+static const char *mode_name(int mode){
+    return mode==2? "build_bulk" : mode==1? "build_sorted" : "build_incremental";
+}
+
 static void print_stats_line(const char *mode, const char *op, long param, long n, const PFStats *st, double ms, FILE *csv){
     if (csv){
         fprintf(csv, "%s,%s,%ld,%ld,%ld,%ld,%ld,%ld,%ld,%.3f\n", mode, op, param, n,
@@ -65,6 +99,16 @@ static FILE* open_csv(const char *path, int write_header){
     return f;
 }
 
+/* drops a file's pages from the OS page cache, so that its next reads go to the disk */
+static void drop_os_cache(const char *fname){
+    int fd = open(fname, O_RDONLY); if (fd < 0) return;
+    fdatasync(fd);
+#ifdef POSIX_FADV_DONTNEED
+    posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+#endif
+    close(fd);
+}
+
 static void minmax_keys(Pair *pairs, long n, int *mink, int *maxk){
     if (n<=0){ *mink=0; *maxk=0; return; }
     int mn=pairs[0].key, mx=pairs[0].key; long i; for (i=1;i<n;i++){ if (pairs[i].key<mn) mn=pairs[i].key; if (pairs[i].key>mx) mx=pairs[i].key; } *mink=mn; *maxk=mx;
@@ -73,13 +117,29 @@ static void minmax_keys(Pair *pairs, long n, int *mink, int *maxk){
 int main(int argc, char **argv){
     const char *spfile = (argc>1)? argv[1] : "../pflayer/students.spf";
     const char *idxbase = (argc>2)? argv[2] : "student";
-    int mode = (argc>3)? atoi(argv[3]) : 0; /* 0=incremental, 1=sorted */
+    int mode = (argc>3)? atoi(argv[3]) : 0; /* 0=incremental, 1=sorted, 2=bulk load */
     const char *max_env = getenv("MAX_REC"); long max_rec = max_env? atol(max_env) : 0;
     const char *csv_path = getenv("CSV_OUT"); int csv_header = getenv("CSV_HEADER")? 1:0;
     int qnum = getenv("QNUM")? atoi(getenv("QNUM")) : 100;
     int rnum = getenv("RNUM")? atoi(getenv("RNUM")) : 50;      /* number of range queries */
-    int range_pct = getenv("RANGEPCT")? atoi(getenv("RANGEPCT")) : 10; /* percent of domain per range */
+    int batch = getenv("BATCH")? atoi(getenv("BATCH")) : 0;    /* keys per AM_LookupBatch call, 0 = all QNUM keys */
+    const char *range_pcts = getenv("RANGEPCT")? getenv("RANGEPCT") : "1,5,10,25"; /* percents of domain per range */
+    const char *topks = getenv("TOPK")? getenv("TOPK") : "1,10,100"; /* K of the top-K queries */
     const char *pol = getenv("POLICY"); /* LRU or MRU for index fd */
+    if (getenv("FILL")) AM_FillFactor = atoi(getenv("FILL")); /* bulk load leaf/node fill percent */
+    if (AM_FillFactor < 10 || AM_FillFactor > 100){ fprintf(stderr, "FILL must be 10..100\n"); return 1; }
+    if (getenv("RIGHT_SPLIT")) AM_RightSplitPct = atoi(getenv("RIGHT_SPLIT")); /* percent kept left by appends that split */
+    if (getenv("APPEND_CACHE")) AM_AppendCache = atoi(getenv("APPEND_CACHE")); /* 0 = always descend from the root */
+    if (getenv("MERGE_PCT")) AM_MergePct = atoi(getenv("MERGE_PCT")); /* leaf fill below which deletes merge, 0 = never */
+    int churn = getenv("CHURN")? atoi(getenv("CHURN")) : 1; /* delete half the keys at the end */
+    int scan_batch = getenv("SCAN_BATCH")? atoi(getenv("SCAN_BATCH")) : 256; /* recIds per AM_FindNextEntries call */
+    int cold_num = getenv("COLD")? atoi(getenv("COLD")) : 5; /* cold-cache range queries per RANGEPCT */
+    if (getenv("PREFETCH")) AM_PrefetchLeaves = atoi(getenv("PREFETCH")); /* leaves a scan reads ahead, 0 = none */
+    long churn_pages = 0; /* pages left in the tree after the churn */
+    int hash = getenv("HASH")? atoi(getenv("HASH")) : 1; /* also build a hash index on idxbase.1 and compare point lookups */
+    long tree_lr = 0, tree_pr = 0; double tree_ms = 0.0; int tree_found = 0; /* the tree's point_eq totals */
+    long sort_mem = getenv("SORT_MEM")? atol(getenv("SORT_MEM")) : 4L*1024*1024; /* bulk load sort budget, bytes */
+    const char *mname = mode_name(mode);
 
     PF_Init();
     const char *bufs = getenv("TOYDB_PF_BUFS");
@@ -104,60 +164,315 @@ int main(int argc, char **argv){
     AM_DestroyIndex((char*)idxbase, 0); /* ignore errors if not exists */
     AM_CreateIndex((char*)idxbase, 0, INT_TYPE, sizeof(int));
     {
-        char iname[128]; sprintf(iname, "%s.0", idxbase);
-        int ifd = PF_OpenFile(iname); if (ifd < 0){ PF_PrintError(); return 1; }
+        int ifd = AM_OpenIndex((char*)idxbase, 0); if (ifd < 0){ AM_PrintError("open index"); return 1; }
         if (pol && (pol[0]=='M' || pol[0]=='m')) PF_SetReplPolicy(ifd, PF_REPL_MRU); else PF_SetReplPolicy(ifd, PF_REPL_LRU);
 
         /* build */
         if (mode==1){ qsort(pairs, (unsigned long)n, (unsigned long)sizeof(Pair), cmp_pair); }
         PF_StatsReset(); unsigned long t0 = now_us();
-        {
+        if (mode==2){
+            /* sort within SORT_MEM (runs spill to PF temp files) and stream the merge into the load */
+            ES_Sort es; long i; AM_ITERATOR iter = { sorted_next, (char*)&es };
+            if (ES_Open(&es, sizeof(Pair), cmp_pair, sort_mem, idxbase) != PFE_OK){ fprintf(stderr, "sort open failed\n"); return 1; }
+            for (i=0;i<n;i++) if (ES_Put(&es, &pairs[i]) != PFE_OK){ fprintf(stderr, "sort failed\n"); return 1; }
+            if (ES_Finish(&es) != PFE_OK){ fprintf(stderr, "sort failed\n"); return 1; }
+            if (AM_BulkLoad(ifd, INT_TYPE, sizeof(int), &iter) != AME_OK){ AM_PrintError("bulk load"); return 1; }
+            printf("mode=%s sort mem=%ld runs=%d passes=%d temp_pages=%ld\n", mname, sort_mem, es.stats.runs, es.stats.passes, es.stats.pages_written);
+            ES_Close(&es);
+        } else {
             long i; for (i=0;i<n;i++){ int key = pairs[i].key; int recid = pairs[i].rid; int err = AM_InsertEntry(ifd, INT_TYPE, sizeof(int), (char*)&key, recid); if (err!=AME_OK){ AM_PrintError("insert"); break; } }
         }
         double ms = (now_us()-t0)/1000.0; PFStats st; stats_get(&st);
-        print_stats_line(mode? "build_sorted" : "build_incremental", "build", 0, n, &st, ms, csv);
+        print_stats_line(mname, "build", 0, n, &st, ms, csv);
+
+        /* tree shape: page count and leaf fill */
+        {
+            AM_TREESTATS ts;
+            if (AM_TreeStats(ifd, &ts) != AME_OK){ AM_PrintError("tree stats"); return 1; }
+            printf("mode=%s tree height=%d leaf_pages=%d int_pages=%d pages=%d keys=%d recids=%d leaf_fill=%.1f%% build_rate=%.0f keys/s\n",
+                mname, ts.height, ts.leafPages, ts.intPages, ts.leafPages+ts.intPages, ts.numKeys, ts.numRecIds,
+                ts.leafPages? 100.0*ts.leafBytes/((double)ts.leafPages*PF_PAGE_SIZE) : 0.0, ms > 0 ? n/(ms/1000.0) : 0.0);
+        }
 
         /* ALL-scan sanity */
         PF_StatsReset(); t0 = now_us();
-        { int hits=0; int sd = AM_OpenIndexScan(ifd, INT_TYPE, sizeof(int), EQ_OP, NULL); int rec; while ((rec=AM_FindNextEntry(sd))>=0) hits++; AM_CloseIndexScan(sd); }
-        ms = (now_us()-t0)/1000.0; stats_get(&st); print_stats_line(mode? "build_sorted" : "build_incremental", "scan_all", 0, n, &st, ms, csv);
+        {
+            long hits=0, bhits=0, sum=0, bsum=0; int lastkey, key, sorted=1; double bms;
+            int sd = AM_OpenIndexScan(ifd, INT_TYPE, sizeof(int), EQ_OP, NULL); int rec;
+            while ((rec=AM_FindNextEntry(sd))>=0){ hits++; sum += rec; }
+            AM_CloseIndexScan(sd);
+            ms = (now_us()-t0)/1000.0; stats_get(&st); print_stats_line(mname, "scan_all", 0, n, &st, ms, csv);
+
+            /* the same scan, scan_batch entries and keys per call */
+            if (scan_batch < 1) scan_batch = 1;
+            {
+                int *rids = (int*)malloc(scan_batch*sizeof(int)); int *keys = (int*)malloc(scan_batch*sizeof(int)); int got, j;
+                if (!rids || !keys){ fprintf(stderr,"oom\n"); return 1; }
+                PF_StatsReset(); t0 = now_us();
+                sd = AM_OpenIndexScan(ifd, INT_TYPE, sizeof(int), EQ_OP, NULL); lastkey = 0;
+                while ((got=AM_FindNextEntries(sd, rids, (char*)keys, scan_batch))>0)
+                    for (j=0;j<got;j++){ key = keys[j]; if (bhits && key < lastkey) sorted=0; lastkey = key; bhits++; bsum += rids[j]; }
+                AM_CloseIndexScan(sd);
+                bms = (now_us()-t0)/1000.0; stats_get(&st); print_stats_line(mname, "scan_all_batch", scan_batch, n, &st, bms, csv);
+                free(rids); free(keys);
+            }
+            printf("scan_all entries=%ld: FindNextEntry %.0f entries/s  FindNextEntries(%d) %.0f entries/s check=%s\n",
+                hits, ms > 0 ? hits/(ms/1000.0) : 0.0, scan_batch, bms > 0 ? bhits/(bms/1000.0) : 0.0,
+                (hits == bhits && sum == bsum && sorted) ? "ok" : "BAD");
+        }
 
         /* Point queries over sample */
         if (n>0 && qnum>0){
             int m = (qnum < n)? qnum : (int)n; int i;
             long tot_lr=0,tot_lw=0,tot_pr=0,tot_pw=0,tot_hit=0,tot_miss=0; double tot_ms=0.0; int found=0;
+            int *qkeys = (int*)malloc(m*sizeof(int)); if (!qkeys){ fprintf(stderr,"oom\n"); return 1; }
             srand(12345);
             for (i=0;i<m;i++){
                 int idx = (int)((rand()/(double)RAND_MAX) * (n-1)); if (idx<0) idx=0; if (idx>=(int)n) idx=(int)n-1;
-                int key = pairs[idx].key;
+                qkeys[i] = pairs[idx].key;
+            }
+            for (i=0;i<m;i++){
+                int key = qkeys[i];
                 PF_StatsReset(); t0 = now_us();
                 { int sd = AM_OpenIndexScan(ifd, INT_TYPE, sizeof(int), EQ_OP, (char*)&key); int rec; while ((rec=AM_FindNextEntry(sd))>=0){ found++; } AM_CloseIndexScan(sd); }
                 ms = (now_us()-t0)/1000.0; stats_get(&st);
                 tot_lr+=st.logical_reads; tot_lw+=st.logical_writes; tot_pr+=st.physical_reads; tot_pw+=st.physical_writes; tot_hit+=st.buffer_hits; tot_miss+=st.buffer_misses; tot_ms+=ms;
             }
             PFStats avg={ tot_lr/m, tot_lw/m, tot_pr/m, tot_pw/m, tot_hit/m, tot_miss/m };
-            print_stats_line(mode? "build_sorted" : "build_incremental", "point_eq", m, n, &avg, tot_ms/m, csv);
+            print_stats_line(mname, "point_eq", m, n, &avg, tot_ms/m, csv);
+            tree_lr = tot_lr; tree_pr = tot_pr; tree_ms = tot_ms; tree_found = found;
+
+            /* the same keys through AM_LookupBatch, BATCH keys per call; the
+               stats line is per call, param = keys per call */
+            {
+                int per = (batch > 0 && batch < m)? batch : m, calls = 0; long bfound = 0; double single_lr = (double)tot_lr/m, single_ms = tot_ms;
+                tot_lr=tot_lw=tot_pr=tot_pw=tot_hit=tot_miss=0; tot_ms=0.0;
+                for (i=0;i<m;i+=per){
+                    int cnt = (m-i < per)? m-i : per, got;
+                    PF_StatsReset(); t0 = now_us();
+                    got = AM_LookupBatch(ifd, INT_TYPE, sizeof(int), (char*)(qkeys+i), cnt, count_match, (char*)&bfound);
+                    ms = (now_us()-t0)/1000.0; stats_get(&st);
+                    if (got < 0){ AM_PrintError("lookup batch"); break; }
+                    tot_lr+=st.logical_reads; tot_lw+=st.logical_writes; tot_pr+=st.physical_reads; tot_pw+=st.physical_writes; tot_hit+=st.buffer_hits; tot_miss+=st.buffer_misses; tot_ms+=ms; calls++;
+                }
+                if (calls > 0){
+                    PFStats bavg={ tot_lr/calls, tot_lw/calls, tot_pr/calls, tot_pw/calls, tot_hit/calls, tot_miss/calls };
+                    print_stats_line(mname, "point_batch", per, n, &bavg, tot_ms/calls, csv);
+                    printf("mode=%s lookup keys=%d batch=%d single: %.0f lookups/s %.2f lr/key found=%d  batched: %.0f lookups/s %.2f lr/key found=%ld\n",
+                        mname, m, per, single_ms > 0 ? m/(single_ms/1000.0) : 0.0, single_lr, found,
+                        tot_ms > 0 ? m/(tot_ms/1000.0) : 0.0, (double)tot_lr/m, bfound);
+                }
+            }
+            free(qkeys);
+        }
+
+        /* Range queries [start, start+width] for each RANGEPCT of [min,max]:
+           a range scan that stops at the leaf position of the upper bound,
+           against a >= scan stopped by comparing each key */
+        if (n>0 && rnum>0){
+            int mn, mx; minmax_keys(pairs, n, &mn, &mx); int domain = (mx - mn + 1); if (domain<=0) domain = n;
+            const char *pp = range_pcts;
+            while (*pp){
+                int range_pct = atoi(pp);
+                while (*pp && *pp != ',') pp++;
+                if (*pp == ',') pp++;
+                if (range_pct <= 0) continue;
+                int width = (range_pct * domain) / 100; if (width<1) width=1;
+                int i; long tot_lr=0,tot_lw=0,tot_pr=0,tot_pw=0,tot_hit=0,tot_miss=0; double tot_ms=0.0, ge_ms=0.0, warm_ms=0.0; long total_hits=0, ge_hits=0, warm_hits=0;
+                srand(9876);
+                for (i=0;i<rnum;i++){
+                    int start = mn + (rand() % domain);
+                    int end = start + width;
+                    PF_StatsReset(); unsigned long t0 = now_us();
+                    { int sd = AM_OpenRangeScan(ifd, INT_TYPE, sizeof(int), (char*)&start, 1, (char*)&end, 1); int rec; while ((rec=AM_FindNextEntry(sd))>=0) total_hits++; AM_CloseIndexScan(sd); }
+                    double ms2 = (now_us()-t0)/1000.0; PFStats st2; stats_get(&st2);
+                    tot_lr+=st2.logical_reads; tot_lw+=st2.logical_writes; tot_pr+=st2.physical_reads; tot_pw+=st2.physical_writes; tot_hit+=st2.buffer_hits; tot_miss+=st2.buffer_misses; tot_ms+=ms2;
+                    t0 = now_us();
+                    { int sd = AM_OpenIndexScan(ifd, INT_TYPE, sizeof(int), GE_OP, (char*)&start); int rec, key; while ((rec=AM_FindNextEntry(sd))>=0){ AM_ScanKey(sd, (char*)&key); if (key > end) break; ge_hits++; } AM_CloseIndexScan(sd); }
+                    ge_ms += (now_us()-t0)/1000.0;
+                    /* again, with the pages as warm as for the >= scan */
+                    t0 = now_us();
+                    { int sd = AM_OpenRangeScan(ifd, INT_TYPE, sizeof(int), (char*)&start, 1, (char*)&end, 1); int rec; while ((rec=AM_FindNextEntry(sd))>=0) warm_hits++; AM_CloseIndexScan(sd); }
+                    warm_ms += (now_us()-t0)/1000.0;
+                }
+                PFStats avg={ tot_lr/rnum, tot_lw/rnum, tot_pr/rnum, tot_pw/rnum, tot_hit/rnum, tot_miss/rnum };
+                print_stats_line(mname, "range_ge_le", width, total_hits/rnum, &avg, tot_ms/rnum, csv);
+                printf("mode=%s range pct=%d width=%d rows/query=%ld  warm: range scan %.3f ms/query  >= scan + key check %.3f ms/query  check=%s\n",
+                    mname, range_pct, width, total_hits/rnum, warm_ms/rnum, ge_ms/rnum, (total_hits == ge_hits && total_hits == warm_hits) ? "ok" : "BAD");
+            }
         }
 
-        /* Range queries (RANGEPCT of [min,max]) */
-        if (n>0 && rnum>0 && range_pct>0){
-            int mn, mx; minmax_keys(pairs, n, &mn, &mx); int domain = (mx - mn + 1); if (domain<=0) domain = n; 
-            int width = (range_pct * domain) / 100; if (width<1) width=1;
-            int i; long tot_lr=0,tot_lw=0,tot_pr=0,tot_pw=0,tot_hit=0,tot_miss=0; double tot_ms=0.0; long total_hits=0;
-            srand(9876);
-            for (i=0;i<rnum;i++){
-                int start = mn + (rand() % domain);
-                int end = start + width;
-                PF_StatsReset(); unsigned long t0 = now_us();
-                { int sd = AM_OpenIndexScan(ifd, INT_TYPE, sizeof(int), GE_OP, (char*)&start); int rec; while ((rec=AM_FindNextEntry(sd))>=0){ if (rec > end) break; total_hits++; } AM_CloseIndexScan(sd); }
-                double ms2 = (now_us()-t0)/1000.0; PFStats st2; stats_get(&st2);
-                tot_lr+=st2.logical_reads; tot_lw+=st2.logical_writes; tot_pr+=st2.physical_reads; tot_pw+=st2.physical_writes; tot_hit+=st2.buffer_hits; tot_miss+=st2.buffer_misses; tot_ms+=ms2;
+        /* Cold range scans: before each query the index leaves the buffer
+           pool (closed and reopened) and the OS page cache, and the query
+           runs once without leaf read-ahead and once with PREFETCH leaves */
+        if (n>0 && cold_num>0){
+            int mn, mx; minmax_keys(pairs, n, &mn, &mx); int domain = (mx - mn + 1); if (domain<=0) domain = n;
+            int prefetch = AM_PrefetchLeaves; char fname[256];
+            const char *pp = range_pcts;
+            snprintf(fname, sizeof(fname), "%s.0", idxbase);
+            while (*pp){
+                int range_pct = atoi(pp), i, pass;
+                while (*pp && *pp != ',') pp++;
+                if (*pp == ',') pp++;
+                if (range_pct <= 0) continue;
+                int width = (range_pct * domain) / 100; if (width<1) width=1;
+                long tot[2][6] = {{0}}; double cold_ms[2] = {0.0, 0.0}; long cold_hits[2] = {0, 0};
+                srand(5555);
+                for (i=0;i<cold_num;i++){
+                    int start = mn + (rand() % domain);
+                    int end = start + width;
+                    for (pass=0;pass<2;pass++){
+                        AM_PrefetchLeaves = pass ? prefetch : 0;
+                        AM_CloseIndex(ifd); drop_os_cache(fname);
+                        ifd = AM_OpenIndex((char*)idxbase, 0); if (ifd < 0){ AM_PrintError("reopen index"); return 1; }
+                        if (pol && (pol[0]=='M' || pol[0]=='m')) PF_SetReplPolicy(ifd, PF_REPL_MRU); else PF_SetReplPolicy(ifd, PF_REPL_LRU);
+                        PF_StatsReset(); t0 = now_us();
+                        { int sd = AM_OpenRangeScan(ifd, INT_TYPE, sizeof(int), (char*)&start, 1, (char*)&end, 1); int rec; while ((rec=AM_FindNextEntry(sd))>=0) cold_hits[pass]++; AM_CloseIndexScan(sd); }
+                        cold_ms[pass] += (now_us()-t0)/1000.0; stats_get(&st);
+                        tot[pass][0]+=st.logical_reads; tot[pass][1]+=st.logical_writes; tot[pass][2]+=st.physical_reads; tot[pass][3]+=st.physical_writes; tot[pass][4]+=st.buffer_hits; tot[pass][5]+=st.buffer_misses;
+                    }
+                }
+                AM_PrefetchLeaves = prefetch;
+                for (pass=0;pass<2;pass++){
+                    PFStats avg={ tot[pass][0]/cold_num, tot[pass][1]/cold_num, tot[pass][2]/cold_num, tot[pass][3]/cold_num, tot[pass][4]/cold_num, tot[pass][5]/cold_num };
+                    print_stats_line(mname, pass ? "range_cold_prefetch" : "range_cold", width, cold_hits[pass]/cold_num, &avg, cold_ms[pass]/cold_num, csv);
+                }
+                printf("mode=%s range cold pct=%d width=%d rows/query=%ld  no read-ahead %.3f ms/query  read-ahead %d leaves %.3f ms/query  check=%s\n",
+                    mname, range_pct, width, cold_hits[0]/cold_num, cold_ms[0]/cold_num, prefetch, cold_ms[1]/cold_num,
+                    cold_hits[0] == cold_hits[1] ? "ok" : "BAD");
             }
-            PFStats avg={ tot_lr/rnum, tot_lw/rnum, tot_pr/rnum, tot_pw/rnum, tot_hit/rnum, tot_miss/rnum };
-            print_stats_line(mode? "build_sorted" : "build_incremental", "range_ge_le", width, total_hits/rnum, &avg, tot_ms/rnum, csv);
         }
 
-        PF_CloseFile(ifd);
+        /* Top-K: the K largest keys from a descending scan, which starts at
+           the rightmost leaf, against an ascending scan of every entry that
+           keeps the last K */
+        if (n>0){
+            const char *pp = topks;
+            while (*pp){
+                int k = atoi(pp), i, got, sd, rec;
+                while (*pp && *pp != ',') pp++;
+                if (*pp == ',') pp++;
+                if (k <= 0) continue;
+                int *asc = (int*)malloc(k*sizeof(int)), *desc = (int*)malloc(k*sizeof(int)); long seen = 0; double asc_ms, desc_ms; long asc_lr, desc_lr; int same = 1;
+                if (!asc || !desc){ fprintf(stderr,"oom\n"); return 1; }
+                PF_StatsReset(); t0 = now_us();
+                sd = AM_OpenIndexScan(ifd, INT_TYPE, sizeof(int), EQ_OP, NULL);
+                while ((rec=AM_FindNextEntry(sd))>=0){ AM_ScanKey(sd, (char*)&asc[seen % k]); seen++; }
+                AM_CloseIndexScan(sd);
+                asc_ms = (now_us()-t0)/1000.0; stats_get(&st); asc_lr = st.logical_reads;
+                print_stats_line(mname, "topk_asc", k, seen < k ? seen : k, &st, asc_ms, csv);
+                PF_StatsReset(); t0 = now_us();
+                sd = AM_OpenIndexScanDesc(ifd, INT_TYPE, sizeof(int), EQ_OP, NULL);
+                for (got=0; got<k && (rec=AM_FindNextEntry(sd))>=0; got++) AM_ScanKey(sd, (char*)&desc[got]);
+                AM_CloseIndexScan(sd);
+                desc_ms = (now_us()-t0)/1000.0; stats_get(&st); desc_lr = st.logical_reads;
+                print_stats_line(mname, "topk_desc", k, got, &st, desc_ms, csv);
+                /* the i-th largest is the i-th entry back from the last one seen */
+                if (got != (seen < k ? seen : k)) same = 0;
+                for (i=0;i<got && same;i++) if (desc[i] != asc[(seen-1-i) % k]) same = 0;
+                printf("mode=%s topk k=%d  ascending scan: lr=%ld %.3f ms  descending scan: lr=%ld %.3f ms  check=%s\n",
+                    mname, k, asc_lr, asc_ms, desc_lr, desc_ms, same ? "ok" : "BAD");
+                free(asc); free(desc);
+            }
+        }
+
+        /* Churn: delete half the entries, then scan what is left. Leaves
+           that empty out are merged and their pages freed unless MERGE_PCT=0 */
+        if (n>0 && churn){
+            long i, deleted=0, hits=0; AM_TREESTATS ts;
+            srand(4242);
+            PF_StatsReset(); t0 = now_us();
+            for (i=0;i<n;i++){
+                int key = pairs[i].key;
+                if (rand() & 1) continue;
+                if (AM_DeleteEntry(ifd, INT_TYPE, sizeof(int), (char*)&key, pairs[i].rid) != AME_OK){ AM_PrintError("delete"); break; }
+                deleted++;
+            }
+            ms = (now_us()-t0)/1000.0; stats_get(&st); print_stats_line(mname, "churn_delete", AM_MergePct, deleted, &st, ms, csv);
+            PF_StatsReset(); t0 = now_us();
+            { int sd = AM_OpenIndexScan(ifd, INT_TYPE, sizeof(int), EQ_OP, NULL); int rec; while ((rec=AM_FindNextEntry(sd))>=0) hits++; AM_CloseIndexScan(sd); }
+            ms = (now_us()-t0)/1000.0; stats_get(&st); print_stats_line(mname, "churn_scan", AM_MergePct, hits, &st, ms, csv);
+            if (AM_TreeStats(ifd, &ts) != AME_OK){ AM_PrintError("tree stats"); return 1; }
+            printf("mode=%s churn merge_pct=%d deleted=%ld left=%ld height=%d leaf_pages=%d int_pages=%d leaf_fill=%.1f%% scan=%.0f entries/s\n",
+                mname, AM_MergePct, deleted, hits, ts.height, ts.leafPages, ts.intPages,
+                ts.leafPages? 100.0*ts.leafBytes/((double)ts.leafPages*PF_PAGE_SIZE) : 0.0, ms > 0 ? hits/(ms/1000.0) : 0.0);
+            churn_pages = ts.leafPages + ts.intPages;
+        }
+
+        AM_CloseIndex(ifd);
+
+        /* the file does not shrink: freed pages go on the PF free list
+           for later inserts to reuse */
+        if (n>0 && churn){
+            char fname[256]; struct stat sb;
+            snprintf(fname, sizeof(fname), "%s.0", idxbase);
+            if (stat(fname, &sb) == 0)
+                printf("mode=%s churn file_kb=%ld tree_pages=%ld\n", mname, (long)sb.st_size/1024, churn_pages);
+        }
+    }
+
+    /* Hash index: the same pairs inserted into an extendible hash index,
+       then the point_eq keys looked up by equality scans against it */
+    if (n>0 && hash){
+        int hfd; long i; double ms; PFStats st; AM_HASHSTATS hs; unsigned long t0;
+        AM_DestroyIndex((char*)idxbase, 1);
+        if (AM_CreateHashIndex((char*)idxbase, 1, INT_TYPE, sizeof(int)) != AME_OK){ AM_PrintError("create hash index"); return 1; }
+        hfd = AM_OpenIndex((char*)idxbase, 1); if (hfd < 0){ AM_PrintError("open hash index"); return 1; }
+        if (pol && (pol[0]=='M' || pol[0]=='m')) PF_SetReplPolicy(hfd, PF_REPL_MRU); else PF_SetReplPolicy(hfd, PF_REPL_LRU);
+        PF_StatsReset(); t0 = now_us();
+        for (i=0;i<n;i++){ int key = pairs[i].key; if (AM_InsertEntry(hfd, INT_TYPE, sizeof(int), (char*)&key, pairs[i].rid) != AME_OK){ AM_PrintError("hash insert"); return 1; } }
+        ms = (now_us()-t0)/1000.0; stats_get(&st); print_stats_line("hash", "build", 0, n, &st, ms, csv);
+        if (AM_HashStats(hfd, &hs) != AME_OK){ AM_PrintError("hash stats"); return 1; }
+        printf("mode=hash depth=%d buckets=%d overflow_pages=%d dir_pages=%d pages=%d entries=%d build_rate=%.0f keys/s\n",
+            hs.depth, hs.buckets, hs.overflowPages, hs.dirPages, 1 + hs.dirPages + hs.buckets + hs.overflowPages, hs.numEntries,
+            ms > 0 ? n/(ms/1000.0) : 0.0);
+
+        /* the point_eq keys of the tree */
+        if (qnum>0){
+            int m = (qnum < n)? qnum : (int)n; int j, found = 0;
+            long tot_lr=0,tot_lw=0,tot_pr=0,tot_pw=0,tot_hit=0,tot_miss=0; double tot_ms=0.0;
+            srand(12345);
+            for (j=0;j<m;j++){
+                int idx = (int)((rand()/(double)RAND_MAX) * (n-1)); int key; if (idx<0) idx=0; if (idx>=(int)n) idx=(int)n-1;
+                key = pairs[idx].key;
+                PF_StatsReset(); t0 = now_us();
+                { int sd = AM_OpenIndexScan(hfd, INT_TYPE, sizeof(int), EQ_OP, (char*)&key); int rec; while ((rec=AM_FindNextEntry(sd))>=0){ found++; } AM_CloseIndexScan(sd); }
+                ms = (now_us()-t0)/1000.0; stats_get(&st);
+                tot_lr+=st.logical_reads; tot_lw+=st.logical_writes; tot_pr+=st.physical_reads; tot_pw+=st.physical_writes; tot_hit+=st.buffer_hits; tot_miss+=st.buffer_misses; tot_ms+=ms;
+            }
+            PFStats avg={ tot_lr/m, tot_lw/m, tot_pr/m, tot_pw/m, tot_hit/m, tot_miss/m };
+            print_stats_line("hash", "point_eq", m, n, &avg, tot_ms/m, csv);
+            printf("mode=hash lookup keys=%d  %s tree: %.2f lr/key %.2f pr/key %.4f ms/key found=%d  hash: %.2f lr/key %.2f pr/key %.4f ms/key found=%d check=%s\n",
+                m, mname, (double)tree_lr/m, (double)tree_pr/m, tree_ms/m, tree_found,
+                (double)tot_lr/m, (double)tot_pr/m, tot_ms/m, found, (tree_lr == 0 || found == tree_found) ? "ok" : "BAD");
+        }
+
+        /* delete the churn's half, then look up every pair: only the kept ones are found */
+        if (churn){
+            long deleted = 0, kept = 0, bad = 0;
+            srand(4242);
+            PF_StatsReset(); t0 = now_us();
+            for (i=0;i<n;i++){
+                int key = pairs[i].key;
+                if (rand() & 1) continue;
+                if (AM_DeleteEntry(hfd, INT_TYPE, sizeof(int), (char*)&key, pairs[i].rid) != AME_OK){ AM_PrintError("hash delete"); return 1; }
+                deleted++;
+            }
+            ms = (now_us()-t0)/1000.0; stats_get(&st); print_stats_line("hash", "churn_delete", 0, deleted, &st, ms, csv);
+            srand(4242);
+            for (i=0;i<n;i++){
+                int key = pairs[i].key, del = !(rand() & 1), sd, rec, hit = 0;
+                sd = AM_OpenIndexScan(hfd, INT_TYPE, sizeof(int), EQ_OP, (char*)&key);
+                while ((rec=AM_FindNextEntry(sd))>=0) if (rec == pairs[i].rid) hit = 1;
+                AM_CloseIndexScan(sd);
+                if (hit == del) bad++;
+                kept += !del;
+            }
+            AM_HashStats(hfd, &hs);
+            printf("mode=hash churn deleted=%ld left=%d buckets=%d overflow_pages=%d check=%s\n",
+                deleted, hs.numEntries, hs.buckets, hs.overflowPages, (bad == 0 && hs.numEntries == kept) ? "ok" : "BAD");
+        }
+        AM_CloseIndex(hfd);
     }
 
     SP_Close(spfd);
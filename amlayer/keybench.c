@@ -0,0 +1,138 @@
+/* keybench.c: a composite (dept, roll_no) index over the student file.
+   Answers "students of dept X ordered by roll" with one prefix scan per
+   dept and compares it against scanning the file, filtering and sorting.
+   Checks every dept's entries come back complete and in roll order. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+
+#define DEPTLEN 16
+
+typedef struct { char dept[DEPTLEN]; int roll; int rid; } Row;
+
+static int cmp_roll(const void *a, const void *b){ const Row *x=(const Row*)a, *y=(const Row*)b; return (x->roll>y->roll)-(x->roll<y->roll); }
+
+/* the loaded rows, and each dept with its count of rows */
+static Row *rows; static long n, cap;
+static char (*depts)[DEPTLEN]; static long *dcount; static int nd;
+
+static int load_row(char *state, SP_Record *r, SP_RID rid){
+    int d;
+    (void)state;
+    if (n == cap){ cap = cap? cap*2 : 8192; rows = (Row*)realloc(rows, cap*sizeof(Row)); if (!rows){ fprintf(stderr, "oom\n"); return -1; } }
+    memset(rows[n].dept, 0, DEPTLEN);
+    strncpy(rows[n].dept, r->dept ? r->dept : "", DEPTLEN);
+    rows[n].roll = (int)r->roll_no;
+    rows[n].rid = pack_rid(rid.page, rid.slot);
+    for (d = 0; d < nd; d++) if (memcmp(depts[d], rows[n].dept, DEPTLEN) == 0) break;
+    if (d == nd){
+        depts = realloc(depts, (nd+1)*DEPTLEN); dcount = realloc(dcount, (nd+1)*sizeof(long));
+        memcpy(depts[nd], rows[n].dept, DEPTLEN); dcount[nd] = 0; nd++;
+    }
+    dcount[d]++;
+    n++;
+    return 0;
+}
+
+int main(int argc, char **argv){
+    const char *spfile = (argc>1)? argv[1] : "../pflayer/students.spf";
+    const char *idxbase = (argc>2)? argv[2] : "studkey";
+    long max_rec = bench_max_rec();
+    AM_KEYDESC desc;
+    AM_TREESTATS ts; PFStats st;
+    long i;
+    int d;
+    int spfd, ifd, klen, plen, sd, rec;
+    char key[AM_MAXATTRLENGTH]; char *vals[2];
+    unsigned long t0; double build_ms, idx_ms, file_ms;
+    long idx_lr, file_lr, got = 0, bad = 0, lastroll;
+
+    bench_init();
+
+    if ((spfd = bench_open(spfile)) < 0) return 1;
+    if (bench_load(spfd, load_row, NULL) < 0) return 1;
+    printf("Loaded %ld records, %d depts from %s\n", n, nd, spfile);
+    if (n == 0){ fprintf(stderr, "no records\n"); return 1; }
+
+    desc.numCols = 2;
+    desc.colType[0] = 'c'; desc.colLength[0] = DEPTLEN;
+    desc.colType[1] = 'i'; desc.colLength[1] = 4;
+    AM_DestroyIndex((char*)idxbase, 0);
+    if (AM_CreateCompositeIndex((char*)idxbase, 0, &desc) != AME_OK){ AM_PrintError("create"); return 1; }
+    ifd = AM_OpenIndex((char*)idxbase, 0);
+    if (ifd < 0){ AM_PrintError("open"); return 1; }
+
+    klen = 0;
+    PF_StatsReset(); t0 = now_us();
+    for (i = 0; i < n; i++){
+        vals[0] = rows[i].dept; vals[1] = (char*)&rows[i].roll;
+        klen = AM_EncodeKey(ifd, vals, 2, key);
+        if (klen < 0 || AM_InsertEntry(ifd, 'k', klen, key, rows[i].rid) != AME_OK){ AM_PrintError("insert"); return 1; }
+    }
+    build_ms = (now_us()-t0)/1000.0;
+    AM_TreeStats(ifd, &ts);
+    printf("keybench build: key=%d bytes height=%d leaf_pages=%d int_pages=%d keys=%d recids=%d %.0f keys/s\n",
+        klen, ts.height, ts.leafPages, ts.intPages, ts.numKeys, ts.numRecIds, build_ms > 0 ? n/(build_ms/1000.0) : 0.0);
+
+    /* each dept by prefix scan; every record is fetched to check its dept and roll order */
+    PF_StatsReset(); t0 = now_us();
+    for (d = 0; d < nd; d++){
+        long cnt = 0;
+        vals[0] = depts[d];
+        plen = AM_EncodeKey(ifd, vals, 1, key);
+        sd = AM_OpenPrefixScan(ifd, 'k', klen, key, plen);
+        if (sd < 0){ AM_PrintError("prefix scan"); return 1; }
+        lastroll = -2147483647L - 1;
+        while ((rec = AM_FindNextEntry(sd)) >= 0){
+            SP_Record r; char buf[1024];
+            if (SP_Get(spfd, unpack_rid(rec), &r, buf, sizeof(buf)) != PFE_OK){ bad++; continue; }
+            if (strncmp(r.dept ? r.dept : "", depts[d], DEPTLEN) != 0 || r.roll_no < lastroll) bad++;
+            lastroll = r.roll_no;
+            cnt++;
+        }
+        AM_CloseIndexScan(sd);
+        if (cnt != dcount[d]) bad++;
+        got += cnt;
+    }
+    idx_ms = (now_us()-t0)/1000.0; PF_StatsGet(&st); idx_lr = st.logical_reads;
+
+    /* the same answer from the file: scan, keep the dept, sort by roll */
+    PF_StatsReset(); t0 = now_us();
+    for (d = 0; d < nd; d++){
+        SP_Scan scan; SP_Record r; SP_RID rid; char buf[1024];
+        Row *sel = (Row*)malloc((dcount[d] ? dcount[d] : 1)*sizeof(Row)); long m = 0;
+        SP_ScanOpen(spfd, &scan);
+        while (SP_ScanNext(&scan, &r, &rid, buf, sizeof(buf)) == PFE_OK){
+            if (max_rec && m >= dcount[d]) break;
+            if (strncmp(r.dept ? r.dept : "", depts[d], DEPTLEN) == 0){ sel[m].roll = (int)r.roll_no; sel[m].rid = pack_rid(rid.page, rid.slot); m++; }
+        }
+        SP_ScanClose(&scan);
+        qsort(sel, m, sizeof(Row), cmp_roll);
+        free(sel);
+    }
+    file_ms = (now_us()-t0)/1000.0; PF_StatsGet(&st); file_lr = st.logical_reads;
+
+    printf("keybench by dept: depts=%d rows=%ld  prefix scan: %.2f ms lr=%ld  file scan+sort: %.2f ms lr=%ld  check=%s\n",
+        nd, got, idx_ms, idx_lr, file_ms, file_lr, (bad == 0 && got == n) ? "ok" : "BAD");
+
+    /* full key lookups */
+    {
+        long hits = 0, q = n < 1000 ? n : 1000;
+        srand(99);
+        for (i = 0; i < q; i++){
+            Row *row = &rows[(long)((rand()/(double)RAND_MAX) * (n-1))];
+            vals[0] = row->dept; vals[1] = (char*)&row->roll;
+            AM_EncodeKey(ifd, vals, 2, key);
+            sd = AM_OpenIndexScan(ifd, 'k', klen, EQ_OP, key);
+            while ((rec = AM_FindNextEntry(sd)) >= 0) if (rec == row->rid) hits++;
+            AM_CloseIndexScan(sd);
+        }
+        printf("keybench point: lookups=%ld found=%ld\n", q, hits);
+    }
+
+    AM_CloseIndex(ifd);
+    SP_Close(spfd);
+    free(rows); free(depts); free(dcount);
+    return 0;
+}
@@ -0,0 +1,266 @@
+/* latchbench.c: inserts and lookups from several threads at once on one
+   roll_no index of the student file, with AM_InsertEntryLatched and
+   AM_LookupLatched. For each thread count it builds the index from
+   scratch (the rows shuffled and dealt out to the threads), looks random
+   rolls up, then runs inserts and lookups side by side on a half built
+   index. Checks every row can be found with its recId afterwards. Last,
+   several threads read one key with a posting list of DUPS recIds at
+   once. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "bench.h"
+
+#define MAXRIDS 64 /* recIds of one roll looked at */
+
+typedef struct { int roll; int rid; } Row;
+
+/* the loaded rows */
+static Row *rows; static long n, cap;
+
+static int load_row(char *state, SP_Record *r, SP_RID rid){
+    (void)state;
+    if (n == cap){ cap = cap? cap*2 : 8192; rows = (Row*)realloc(rows, cap*sizeof(Row)); if (!rows){ fprintf(stderr, "oom\n"); return -1; } }
+    rows[n].roll = (int)r->roll_no;
+    rows[n].rid = pack_rid(rid.page, rid.slot);
+    n++;
+    return 0;
+}
+
+/* what one thread does in a phase */
+typedef struct {
+    int fd, t, nthreads;
+    Row *rows; long lo, hi;		/* rows [lo,hi) are dealt out to the threads */
+    Row *known; long nknown;	/* rows already in the index, for lookups */
+    long lookups;			/* lookups of known rows, per thread */
+    long done, bad;
+} Work;
+
+static int has_rid(int fd, int roll, int rid){
+    int rids[MAXRIDS], n, k;
+    n = AM_LookupLatched(fd, 'i', sizeof(int), (char*)&roll, rids, MAXRIDS);
+    if (n < 0) return -1;
+    for (k = 0; k < n && k < MAXRIDS; k++) if (rids[k] == rid) return 1;
+    return 0;
+}
+
+/* inserts its share of [lo,hi); after each insert does lookups/(its share)
+   lookups of known rows, so a phase with both mixes them evenly */
+static void *worker(void *arg){
+    Work *w = (Work*)arg;
+    long i, q = 0, ins = 0, share = (w->hi - w->lo + w->nthreads - 1) / w->nthreads;
+    unsigned int seed = 7 + w->t;
+    Row *r;
+    for (i = w->lo + w->t; i < w->hi; i += w->nthreads){
+        if (AM_InsertEntryLatched(w->fd, 'i', sizeof(int), (char*)&w->rows[i].roll, w->rows[i].rid) != AME_OK){ w->bad++; break; }
+        w->done++; ins++;
+        for (; w->nknown && share && q < w->lookups * ins / share; q++){
+            r = &w->known[rand_r(&seed) % w->nknown];
+            if (has_rid(w->fd, r->roll, r->rid) != 1) w->bad++;
+            w->done++;
+        }
+    }
+    for (; w->nknown && q < w->lookups; q++){
+        r = &w->known[rand_r(&seed) % w->nknown];
+        if (has_rid(w->fd, r->roll, r->rid) != 1) w->bad++;
+        w->done++;
+    }
+    return NULL;
+}
+
+/* runs a phase on nthreads threads; returns ops/s and adds to *bad */
+static double run(int nthreads, int fd, Row *rows, long lo, long hi, Row *known, long nknown, long lookups, long *bad){
+    pthread_t tid[64]; Work w[64]; int t; long done = 0; unsigned long t0; double ms;
+    t0 = now_us();
+    for (t = 0; t < nthreads; t++){
+        w[t].fd = fd; w[t].t = t; w[t].nthreads = nthreads;
+        w[t].rows = rows; w[t].lo = lo; w[t].hi = hi;
+        w[t].known = known; w[t].nknown = nknown; w[t].lookups = lookups / nthreads;
+        w[t].done = 0; w[t].bad = 0;
+        pthread_create(&tid[t], NULL, worker, &w[t]);
+    }
+    for (t = 0; t < nthreads; t++){ pthread_join(tid[t], NULL); done += w[t].done; *bad += w[t].bad; }
+    ms = (now_us()-t0)/1000.0;
+    return ms > 0 ? done/(ms/1000.0) : 0.0;
+}
+
+/* holds all but SPARE buffers of the pool pinned, by shared latches on the
+   pages of another index, for HOLDUS microseconds */
+#define SPARE 2
+#define HOLDUS 1500000
+typedef struct {
+    int fd;
+    int pinned;
+    pthread_mutex_t mu; pthread_cond_t cv; int ready;
+} Ballast;
+
+static void *ballast(void *arg){
+    Ballast *b = (Ballast*)arg;
+    int *pages = NULL, cap = 0, np = 0, pg, e, k;
+    char *buf;
+    for (pg = 1; ; pg++){
+        e = PF_LatchPage(b->fd, pg, &buf, FALSE);
+        if (e != PFE_OK) break; /* out of buffers, or past the last page */
+        if (np == cap){ cap = cap? cap*2 : 64; pages = (int*)realloc(pages, cap*sizeof(int)); }
+        pages[np++] = pg;
+    }
+    for (k = 0; k < SPARE && np > 0; k++) PF_UnlatchPage(b->fd, pages[--np], FALSE);
+    pthread_mutex_lock(&b->mu); b->pinned = np; b->ready = 1; pthread_cond_signal(&b->cv); pthread_mutex_unlock(&b->mu);
+    usleep(HOLDUS);
+    while (np > 0) PF_UnlatchPage(b->fd, pages[--np], FALSE);
+    free(pages);
+    return NULL;
+}
+
+/* inserts keys into a new index while another thread leaves only SPARE
+   buffers free, too few for a split; the split must wait for the
+   buffers, or give up before it changes a page, and never lose a key */
+static long starved(const char *idxbase, long keys, double *ms){
+    Ballast b; pthread_t tid; long i, bad = 0; int ifd, roll; unsigned long t0;
+    AM_DestroyIndex((char*)idxbase, 0);
+    AM_DestroyIndex((char*)idxbase, 1);
+    if (AM_CreateIndex((char*)idxbase, 0, 'i', sizeof(int)) != AME_OK ||
+        AM_CreateIndex((char*)idxbase, 1, 'i', sizeof(int)) != AME_OK){ AM_PrintError("create"); exit(1); }
+    b.fd = AM_OpenIndex((char*)idxbase, 0);
+    ifd = AM_OpenIndex((char*)idxbase, 1);
+    if (b.fd < 0 || ifd < 0){ AM_PrintError("open"); exit(1); }
+    /* enough of index 0 to cover the pool */
+    for (i = 0; i < n; i++)
+        if (AM_InsertEntry(b.fd, 'i', sizeof(int), (char*)&rows[i].roll, rows[i].rid) != AME_OK){ AM_PrintError("insert"); exit(1); }
+    pthread_mutex_init(&b.mu, NULL); pthread_cond_init(&b.cv, NULL); b.ready = 0;
+    pthread_create(&tid, NULL, ballast, &b);
+    pthread_mutex_lock(&b.mu); while (!b.ready) pthread_cond_wait(&b.cv, &b.mu); pthread_mutex_unlock(&b.mu);
+    t0 = now_us();
+    for (i = 0; i < keys; i++){
+        roll = (int)i;
+        if (AM_InsertEntryLatched(ifd, 'i', sizeof(int), (char*)&roll, (int)i) != AME_OK){ bad++; break; }
+    }
+    *ms = (now_us()-t0)/1000.0;
+    pthread_join(tid, NULL);
+    for (i = 0; i < keys; i++) if (has_rid(ifd, (int)i, (int)i) != 1) bad++;
+    AM_CloseIndex(ifd); AM_CloseIndex(b.fd);
+    AM_DestroyIndex((char*)idxbase, 1);
+    printf("latchbench starved split: %d buffers pinned by another thread for %.1f s, %d free  inserts=%ld  %.0f ms  check=%s\n",
+        b.pinned, HOLDUS/1e6, SPARE, keys, *ms, bad == 0 ? "ok" : "BAD");
+    return bad;
+}
+
+/* looks the key with DUPS recIds up lookups times; each must give them all,
+   in ascending order */
+#define DUPS 500
+#define DUPTHREADS 4
+typedef struct { int fd; long lookups; long bad; } DupWork;
+
+static void *dup_reader(void *arg){
+    DupWork *w = (DupWork*)arg;
+    int rids[DUPS], key = 0, k, got;
+    long q;
+    for (q = 0; q < w->lookups; q++){
+        got = AM_LookupLatched(w->fd, 'i', sizeof(int), (char*)&key, rids, DUPS);
+        if (got != DUPS){ w->bad++; continue; }
+        for (k = 0; k < DUPS; k++) if (rids[k] != k){ w->bad++; break; }
+    }
+    return NULL;
+}
+
+static long dupkey(const char *idxbase, long lookups, double *ms){
+    pthread_t tid[DUPTHREADS]; DupWork w[DUPTHREADS]; int ifd, key = 0, t; long i, bad = 0; unsigned long t0;
+    AM_DestroyIndex((char*)idxbase, 1);
+    if (AM_CreateIndex((char*)idxbase, 1, 'i', sizeof(int)) != AME_OK){ AM_PrintError("create"); exit(1); }
+    ifd = AM_OpenIndex((char*)idxbase, 1);
+    if (ifd < 0){ AM_PrintError("open"); exit(1); }
+    for (i = 0; i < DUPS; i++)
+        if (AM_InsertEntryLatched(ifd, 'i', sizeof(int), (char*)&key, (int)i) != AME_OK){ AM_PrintError("insert"); exit(1); }
+    t0 = now_us();
+    for (t = 0; t < DUPTHREADS; t++){
+        w[t].fd = ifd; w[t].lookups = lookups / DUPTHREADS; w[t].bad = 0;
+        pthread_create(&tid[t], NULL, dup_reader, &w[t]);
+    }
+    for (t = 0; t < DUPTHREADS; t++){ pthread_join(tid[t], NULL); bad += w[t].bad; }
+    *ms = (now_us()-t0)/1000.0;
+    AM_CloseIndex(ifd);
+    AM_DestroyIndex((char*)idxbase, 1);
+    printf("latchbench duplicate key: %d threads read one key with %d recIds  lookups=%ld  failed=%ld  %.0f lookups/s  check=%s\n",
+        DUPTHREADS, DUPS, lookups, bad, *ms > 0 ? lookups/(*ms/1000.0) : 0.0, bad == 0 ? "ok" : "BAD");
+    return bad;
+}
+
+int main(int argc, char **argv){
+    const char *spfile = (argc>1)? argv[1] : "../pflayer/students.spf";
+    const char *idxbase = (argc>2)? argv[2] : "studlatch";
+    const char *threads = getenv("THREADS")? getenv("THREADS") : "1,2,4";
+    long lookups = getenv("LOOKUPS")? atol(getenv("LOOKUPS")) : 0;
+    Row tmp; long i, j, bad;
+    int spfd, ifd, nthreads;
+    const char *p;
+    double ins_rate, look_rate, mix_rate, ms;
+    unsigned long t0;
+    AM_TREESTATS ts;
+
+    bench_init();
+
+    if ((spfd = bench_open(spfile)) < 0) return 1;
+    if (bench_load(spfd, load_row, NULL) < 0) return 1;
+    SP_Close(spfd);
+    if (n == 0){ fprintf(stderr, "no records\n"); return 1; }
+    if (lookups <= 0) lookups = n;
+    srand(42);
+    for (i = n-1; i > 0; i--){ j = rand() % (i+1); tmp = rows[i]; rows[i] = rows[j]; rows[j] = tmp; }
+    printf("Loaded %ld records from %s, %ld cpus online\n", n, spfile, sysconf(_SC_NPROCESSORS_ONLN));
+
+    /* the single threaded insert, for reference */
+    AM_DestroyIndex((char*)idxbase, 0);
+    if (AM_CreateIndex((char*)idxbase, 0, 'i', sizeof(int)) != AME_OK){ AM_PrintError("create"); return 1; }
+    ifd = AM_OpenIndex((char*)idxbase, 0);
+    if (ifd < 0){ AM_PrintError("open"); return 1; }
+    t0 = now_us();
+    for (i = 0; i < n; i++)
+        if (AM_InsertEntry(ifd, 'i', sizeof(int), (char*)&rows[i].roll, rows[i].rid) != AME_OK){ AM_PrintError("insert"); return 1; }
+    ms = (now_us()-t0)/1000.0;
+    AM_CloseIndex(ifd);
+    printf("latchbench AM_InsertEntry: %.0f keys/s\n", ms > 0 ? n/(ms/1000.0) : 0.0);
+
+    PF_SetThreaded(TRUE);
+    for (p = threads; *p; ){
+        nthreads = atoi(p);
+        if (nthreads < 1) nthreads = 1;
+        if (nthreads > 64) nthreads = 64;
+        bad = 0;
+
+        /* build with every thread inserting, then look up from every thread */
+        AM_DestroyIndex((char*)idxbase, 0);
+        if (AM_CreateIndex((char*)idxbase, 0, 'i', sizeof(int)) != AME_OK){ AM_PrintError("create"); return 1; }
+        ifd = AM_OpenIndex((char*)idxbase, 0);
+        if (ifd < 0){ AM_PrintError("open"); return 1; }
+        ins_rate = run(nthreads, ifd, rows, 0, n, NULL, 0, 0, &bad);
+        look_rate = run(nthreads, ifd, rows, 0, 0, rows, n, lookups, &bad);
+        for (i = 0; i < n; i++) if (has_rid(ifd, rows[i].roll, rows[i].rid) != 1) bad++;
+        AM_TreeStats(ifd, &ts);
+        AM_CloseIndex(ifd);
+
+        /* half the rows in from one thread, then the other half goes in
+           while every thread looks up the first */
+        AM_DestroyIndex((char*)idxbase, 0);
+        AM_CreateIndex((char*)idxbase, 0, 'i', sizeof(int));
+        ifd = AM_OpenIndex((char*)idxbase, 0);
+        if (ifd < 0){ AM_PrintError("open"); return 1; }
+        run(1, ifd, rows, 0, n/2, NULL, 0, 0, &bad);
+        mix_rate = run(nthreads, ifd, rows, n/2, n, rows, n/2, n - n/2, &bad);
+        for (i = 0; i < n; i++) if (has_rid(ifd, rows[i].roll, rows[i].rid) != 1) bad++;
+        AM_CloseIndex(ifd);
+
+        printf("latchbench threads=%d: insert %.0f keys/s  lookup %.0f /s  mixed %.0f ops/s  height=%d leaf_pages=%d  check=%s\n",
+            nthreads, ins_rate, look_rate, mix_rate, ts.height, ts.leafPages, bad == 0 ? "ok" : "BAD");
+
+        while (*p && *p != ',') p++;
+        if (*p == ',') p++;
+    }
+    starved(idxbase, 2000, &ms);
+    dupkey(idxbase, lookups, &ms);
+    PF_SetThreaded(FALSE);
+    AM_DestroyIndex((char*)idxbase, 0);
+    free(rows);
+    return 0;
+}
@@ -0,0 +1,149 @@
+/* namebench.c: a B+ tree on student names, built with fixed-width char keys
+   (AM_FMT_FIXED) and with variable-length, prefix-compressed keys
+   (AM_FMT_VAR). Reports tree height, page counts and the logical reads of
+   point lookups for each, and checks both return the same entries. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+
+/* the loaded names and recIds, and the indexes of the rows in recId order */
+static char *names; static int *rids, *byrid; static int len; static long n, cap;
+
+static int load_name(char *state, SP_Record *r, SP_RID rid){
+    (void)state;
+    if (n == cap){
+        cap = cap? cap*2 : 8192;
+        names = (char*)realloc(names, cap*len); rids = (int*)realloc(rids, cap*sizeof(int));
+        if (!names || !rids){ fprintf(stderr, "oom\n"); return -1; }
+    }
+    memset(names + n*len, 0, len);
+    strncpy(names + n*len, r->name, len);
+    rids[n] = pack_rid(rid.page, rid.slot);
+    n++;
+    return 0;
+}
+
+static int cmp_int(const void *a, const void *b){ int x = *(const int*)a, y = *(const int*)b; return x < y ? -1 : x > y; }
+static int cmp_byrid(const void *a, const void *b){ return cmp_int(&rids[*(const int*)a], &rids[*(const int*)b]); }
+
+/* the name stored under recId rec, NULL if no row has it */
+static const char *name_of(int rec){
+    long lo = 0, hi = n - 1, mid;
+    while (lo <= hi){
+        mid = (lo + hi)/2;
+        if (rids[byrid[mid]] == rec) return names + (long)byrid[mid]*len;
+        if (rids[byrid[mid]] < rec) lo = mid + 1; else hi = mid - 1;
+    }
+    return NULL;
+}
+
+/* sorts the recIds of each run of equal names in seq. A split may leave
+   the recIds of a duplicate key in a different order, so two trees holding
+   the same entries only compare equal this way */
+static void sort_dups(int *seq, long cnt){
+    long i = 0, j;
+    const char *a, *b;
+    while (i < cnt){
+        a = name_of(seq[i]);
+        for (j = i + 1; j < cnt; j++){
+            b = name_of(seq[j]);
+            if (a == NULL || b == NULL || memcmp(a, b, len) != 0) break;
+        }
+        qsort(seq + i, j - i, sizeof(int), cmp_int);
+        i = j;
+    }
+}
+
+static int count_match(char *state, int keyNum, int recId){
+    (void)keyNum; (void)recId;
+    (*(long*)state)++;
+    return 0;
+}
+
+int main(int argc, char **argv){
+    const char *spfile = (argc>1)? argv[1] : "../pflayer/students.spf";
+    const char *idxbase = (argc>2)? argv[2] : "studname";
+    int qnum = getenv("QNUM")? atoi(getenv("QNUM")) : 1000;
+    int fmt, i, spfd;
+    int *order[2] = { NULL, NULL }; long norder[2] = { 0, 0 };
+
+    len = getenv("NAMELEN")? atoi(getenv("NAMELEN")) : 255; /* attrLength of the name key */
+    if (len < 1 || len > 255){ fprintf(stderr, "NAMELEN must be 1..255\n"); return 1; }
+    bench_init();
+
+    if ((spfd = bench_open(spfile)) < 0) return 1;
+    if (bench_load(spfd, load_name, NULL) < 0) return 1;
+    SP_Close(spfd);
+    printf("Loaded %ld names from %s, key length %d\n", n, spfile, len);
+    if (n == 0) return 0;
+    if (qnum > n) qnum = (int)n;
+    byrid = (int*)malloc(n*sizeof(int));
+    for (i = 0; i < n; i++) byrid[i] = i;
+    qsort(byrid, n, sizeof(int), cmp_byrid);
+
+    for (fmt = AM_FMT_FIXED; fmt <= AM_FMT_VAR; fmt++){
+        const char *fname = fmt == AM_FMT_VAR ? "var" : "fixed";
+        AM_TREESTATS ts; PFStats st; unsigned long t0; double build_ms, single_ms, batch_ms;
+        long single_lr, batch_lr, found = 0, bfound = 0, all = 0;
+        int ifd, sd, rec;
+        char *qkeys;
+
+        AM_DestroyIndex((char*)idxbase, fmt);
+        if (AM_CreateIndexEx((char*)idxbase, fmt, CHAR_TYPE, len, fmt) != AME_OK){ AM_PrintError("create"); return 1; }
+        ifd = AM_OpenIndex((char*)idxbase, fmt);
+        if (ifd < 0){ AM_PrintError("open"); return 1; }
+
+        PF_StatsReset(); t0 = now_us();
+        for (i = 0; i < n; i++)
+            if (AM_InsertEntry(ifd, CHAR_TYPE, len, names + (long)i*len, rids[i]) != AME_OK){ AM_PrintError("insert"); return 1; }
+        build_ms = (now_us()-t0)/1000.0; PF_StatsGet(&st);
+        if (AM_TreeStats(ifd, &ts) != AME_OK){ AM_PrintError("tree stats"); return 1; }
+        printf("namebench format=%s tree height=%d leaf_pages=%d int_pages=%d pages=%d keys=%d recids=%d leaf_fill=%.1f%% build: %.0f keys/s lr=%ld lw=%ld\n",
+            fname, ts.height, ts.leafPages, ts.intPages, ts.leafPages+ts.intPages, ts.numKeys, ts.numRecIds,
+            100.0*ts.leafBytes/((double)ts.leafPages*PF_PAGE_SIZE), build_ms > 0 ? n/(build_ms/1000.0) : 0.0,
+            st.logical_reads, st.logical_writes);
+
+        /* every entry in key order; the var tree must give the fixed tree's
+           keys in the same order, each with the same set of recIds */
+        sd = AM_OpenIndexScan(ifd, CHAR_TYPE, len, EQ_OP, NULL);
+        order[fmt] = (int*)malloc(n*sizeof(int));
+        while ((rec = AM_FindNextEntry(sd)) >= 0){
+            if (all < n) order[fmt][all] = rec;
+            all++;
+        }
+        AM_CloseIndexScan(sd);
+        norder[fmt] = all;
+        sort_dups(order[fmt], all < n ? all : n);
+
+        /* point lookups of names drawn from the file */
+        qkeys = (char*)malloc((long)qnum*len);
+        srand(4321);
+        for (i = 0; i < qnum; i++){
+            long idx = (long)((rand()/(double)RAND_MAX) * (n-1));
+            memcpy(qkeys + (long)i*len, names + idx*len, len);
+        }
+        single_lr = 0; t0 = now_us();
+        for (i = 0; i < qnum; i++){
+            PF_StatsReset();
+            sd = AM_OpenIndexScan(ifd, CHAR_TYPE, len, EQ_OP, qkeys + (long)i*len);
+            while (AM_FindNextEntry(sd) >= 0) found++;
+            AM_CloseIndexScan(sd);
+            PF_StatsGet(&st); single_lr += st.logical_reads;
+        }
+        single_ms = (now_us()-t0)/1000.0;
+        PF_StatsReset(); t0 = now_us();
+        if (AM_LookupBatch(ifd, CHAR_TYPE, len, qkeys, qnum, count_match, (char*)&bfound) < 0){ AM_PrintError("lookup batch"); return 1; }
+        batch_ms = (now_us()-t0)/1000.0; PF_StatsGet(&st); batch_lr = st.logical_reads;
+        printf("namebench format=%s lookup keys=%d single: %.2f lr/key %.0f lookups/s found=%ld  batched: %.2f lr/key %.0f lookups/s found=%ld  scan_all=%ld",
+            fname, qnum, (double)single_lr/qnum, single_ms > 0 ? qnum/(single_ms/1000.0) : 0.0, found,
+            (double)batch_lr/qnum, batch_ms > 0 ? qnum/(batch_ms/1000.0) : 0.0, bfound, all);
+        if (fmt == AM_FMT_VAR) printf(" same_as_fixed=%s", (norder[0] == norder[1] && norder[0] <= n &&
+            memcmp(order[0], order[1], norder[0]*sizeof(int)) == 0) ? "yes" : "NO");
+        printf("\n");
+        free(qkeys);
+        AM_CloseIndex(ifd);
+    }
+    free(order[0]); free(order[1]); free(byrid); free(names); free(rids);
+    return 0;
+}
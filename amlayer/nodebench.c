@@ -0,0 +1,107 @@
+/* nodebench.c: ns per probe of the in-node key search, AM_BinSearch on a full
+   internal node and AM_SearchLeaf on a full leaf, for int and float keys,
+   with the generic AM_Compare path and with the rank kernels */
+#include <stdio.h>
+#include <time.h>
+#include <stdlib.h>
+#include <string.h>
+#include "am.h"
+#include "pf.h"
+
+int AM_BinSearch(char *pageBuf, char attrType, int attrLength, char *value, int *indexPtr, AM_INTHEADER *header);
+int AM_SearchLeaf(char *pageBuf, char attrType, int attrLength, char *value, int *indexPtr, AM_LEAFHEADER *header);
+
+static unsigned long now_ns(){ struct timespec ts; clock_gettime(CLOCK_MONOTONIC, &ts); return (unsigned long)ts.tv_sec*1000000000ul + (unsigned long)ts.tv_nsec; }
+
+/* key number i of a node, as the page stores it: ints 2i, floats 2i + 0.5 */
+static void make_key(char type, int i, char *out){
+    if (type == 'i'){ int k = 2*i; memcpy(out, &k, 4); }
+    else { float f = 2*i + 0.5f; memcpy(out, &f, 4); }
+}
+
+/* fills a full internal node and a full leaf (room left for one recId per key) */
+static void build_nodes(char type, char *ipage, AM_INTHEADER *ih, char *lpage, AM_LEAFHEADER *lh){
+    int i, child; short null = 0;
+    memset(ih, 0, sizeof(*ih)); memset(lh, 0, sizeof(*lh));
+    ih->pageType = 'i'; ih->attrLength = 4;
+    ih->maxKeys = (PF_PAGE_SIZE - AM_sint - AM_si)/(AM_si + 4);
+    ih->numKeys = ih->maxKeys;
+    for (i = 0; i <= ih->numKeys; i++){
+        child = 1000 + i;
+        memcpy(ipage + AM_sint + i*(AM_si + 4), &child, AM_si);
+        if (i < ih->numKeys) make_key(type, i, ipage + AM_sint + AM_si + i*(AM_si + 4));
+    }
+    memcpy(ipage, ih, AM_sint);
+    lh->pageType = 'l'; lh->nextLeafPage = AM_NULL_PAGE; lh->prevLeafPage = AM_NULL_PAGE; lh->attrLength = 4;
+    lh->numKeys = (PF_PAGE_SIZE - AM_sl)/(4 + AM_ss + AM_si + AM_ss);
+    for (i = 0; i < lh->numKeys; i++){
+        make_key(type, i, lpage + AM_sl + i*(4 + AM_ss));
+        memcpy(lpage + AM_sl + i*(4 + AM_ss) + 4, &null, AM_ss);
+    }
+    lh->keyPtr = AM_sl + lh->numKeys*(4 + AM_ss); lh->recIdPtr = PF_PAGE_SIZE;
+    memcpy(lpage, lh, AM_sl);
+}
+
+/* probes cover the key range and a little beyond; about half miss */
+static void make_probes(char type, int numKeys, int n, char *out){
+    int i; unsigned int st = 777u;
+    for (i = 0; i < n; i++){
+        st = st*1103515245u + 12345u;
+        int k = (int)((st >> 8) % (unsigned)(2*numKeys + 4)) - 2;
+        if (type == 'i') memcpy(out + 4*i, &k, 4);
+        else { float f = k * 0.5f + 0.25f*(k & 1); memcpy(out + 4*i, &f, 4); }
+    }
+}
+
+static double run(int internal, char type, char *page, void *hdr, char *probes, int n, int reps, long *sum){
+    int r, i, idx; unsigned long t0; long s = 0;
+    t0 = now_ns();
+    for (r = 0; r < reps; r++)
+        for (i = 0; i < n; i++){
+            if (internal) s += AM_BinSearch(page, type, 4, probes + 4*i, &idx, (AM_INTHEADER*)hdr);
+            else s += AM_SearchLeaf(page, type, 4, probes + 4*i, &idx, (AM_LEAFHEADER*)hdr);
+            s += idx;
+        }
+    *sum = s;
+    return (double)(now_ns() - t0) / ((double)n * reps);
+}
+
+/* probes on which the kernel and the generic search disagree */
+static int mismatches(int internal, char type, char *page, void *hdr, char *probes, int n){
+    int i, r0, r1, i0, i1, bad = 0;
+    for (i = 0; i < n; i++){
+        AM_SearchKernels = 0;
+        r0 = internal ? AM_BinSearch(page, type, 4, probes + 4*i, &i0, (AM_INTHEADER*)hdr) : AM_SearchLeaf(page, type, 4, probes + 4*i, &i0, (AM_LEAFHEADER*)hdr);
+        AM_SearchKernels = 1;
+        r1 = internal ? AM_BinSearch(page, type, 4, probes + 4*i, &i1, (AM_INTHEADER*)hdr) : AM_SearchLeaf(page, type, 4, probes + 4*i, &i1, (AM_LEAFHEADER*)hdr);
+        if (r0 != r1 || i0 != i1) bad++;
+    }
+    return bad;
+}
+
+int main(){
+    static const char types[] = { 'i', 'f' };
+    int nprobes = getenv("PROBES")? atoi(getenv("PROBES")) : 4096;
+    int reps = getenv("REPS")? atoi(getenv("REPS")) : 200;
+    char ipage[PF_PAGE_SIZE], lpage[PF_PAGE_SIZE]; AM_INTHEADER ih; AM_LEAFHEADER lh;
+    char *probes = (char*)malloc(4*nprobes);
+    int t, internal;
+    if (!probes){ fprintf(stderr, "oom\n"); return 1; }
+    for (t = 0; t < 2; t++){
+        build_nodes(types[t], ipage, &ih, lpage, &lh);
+        for (internal = 1; internal >= 0; internal--){
+            make_probes(types[t], internal ? ih.numKeys : lh.numKeys, nprobes, probes);
+            long s0, s1; double generic, kernel; int bad;
+            bad = mismatches(internal, types[t], internal ? ipage : lpage, internal ? (void*)&ih : (void*)&lh, probes, nprobes);
+            AM_SearchKernels = 0;
+            generic = run(internal, types[t], internal ? ipage : lpage, internal ? (void*)&ih : (void*)&lh, probes, nprobes, reps, &s0);
+            AM_SearchKernels = 1;
+            kernel = run(internal, types[t], internal ? ipage : lpage, internal ? (void*)&ih : (void*)&lh, probes, nprobes, reps, &s1);
+            printf("nodebench type=%s node=%s keys=%d generic=%.1f ns/probe kernel=%.1f ns/probe speedup=%.2fx mismatches=%d\n",
+                types[t]=='i' ? "int" : "float", internal ? "internal" : "leaf", internal ? ih.numKeys : lh.numKeys,
+                generic, kernel, kernel > 0 ? generic/kernel : 0.0, bad + (s0 != s1));
+        }
+    }
+    free(probes);
+    return 0;
+}
@@ -35,6 +35,6 @@
 #define PF_PAGE_SIZE	1020
 
 /* externs from the PF layer */
-extern int PFerrno;		/* error number of last error */
+extern __thread int PFerrno;	/* error number of last error, per thread */
 extern void PF_Init();
 extern void PF_PrintError();
@@ -20,6 +20,17 @@ with open(csv_path, 'r') as f:
 # Helper to filter rows
 rows = lambda mode, op: [r for r in data if r['mode']==mode and r['op']==op]
 
+# Build modes present in the CSV, in indexbench mode order
+modes = [m for m in ['build_incremental','build_sorted','build_bulk'] if any(r['mode']==m for r in data)]
+
+def bars(values, metrics):
+    x = range(len(metrics))
+    width = 0.8 / max(len(modes), 1)
+    for j, m in enumerate(modes):
+        off = (j - (len(modes)-1)/2) * width
+        plt.bar([i + off for i in x], [values[m][met] for met in metrics], width, label=m)
+    plt.xticks(list(x), metrics)
+
 def to_int(r, k):
     try:
         return int(float(r[k]))
@@ -27,7 +38,6 @@ def to_int(r, k):
         return 0
 
 def plot_build_compare():
-    modes = ['build_incremental','build_sorted']
     metrics = ['lr','lw','pr','pw','hit','miss']
     values = {m: {met:0 for met in metrics} for m in modes}
     for m in modes:
@@ -36,12 +46,8 @@ def plot_build_compare():
             r = r[-1]  # last occurrence
             for met in metrics:
                 values[m][met] = to_int(r, met)
-    x = range(len(metrics))
-    width = 0.35
     plt.figure(figsize=(10,6))
-    plt.bar([i - width/2 for i in x], [values[modes[0]][met] for met in metrics], width, label=modes[0])
-    plt.bar([i + width/2 for i in x], [values[modes[1]][met] for met in metrics], width, label=modes[1])
-    plt.xticks(list(x), metrics)
+    bars(values, metrics)
     plt.ylabel('Count')
     plt.title('Index build statistics comparison')
     plt.grid(True, linestyle='--', alpha=0.4, axis='y')
@@ -54,7 +60,6 @@ def plot_build_compare():
 
 
 def plot_scan_compare(op):
-    modes = ['build_incremental','build_sorted']
     metrics = ['lr','hit','miss','ms']
     vals = {m: {met:0.0 for met in metrics} for m in modes}
     for m in modes:
@@ -63,12 +68,8 @@ def plot_scan_compare(op):
             r = r[-1]
             for met in metrics:
                 vals[m][met] = float(r[met])
-    x = range(len(metrics))
-    width = 0.35
     plt.figure(figsize=(10,6))
-    plt.bar([i - width/2 for i in x], [vals[modes[0]][met] for met in metrics], width, label=modes[0])
-    plt.bar([i + width/2 for i in x], [vals[modes[1]][met] for met in metrics], width, label=modes[1])
-    plt.xticks(list(x), metrics)
+    bars(vals, metrics)
     plt.ylabel('Value')
     plt.title(f'Scan ({op}) statistics comparison')
     plt.grid(True, linestyle='--', alpha=0.4, axis='y')
@@ -82,3 +83,5 @@ def plot_scan_compare(op):
 plot_build_compare()
 plot_scan_compare('scan_all')
 plot_scan_compare('point_eq')
+if any(r['op']=='point_batch' for r in data):
+    plot_scan_compare('point_batch')
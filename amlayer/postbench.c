@@ -0,0 +1,212 @@
+/* postbench.c: an index on the dept column of the student file, a handful
+   of keys with thousands of recIds each. Builds it with posting lists by
+   inserts and by AM_BulkLoad, and the (dept, roll_no) composite index a
+   dept lookup needed before, and compares their size and the time and page
+   reads of fetching every dept. Deletes a third of the rows from the dept
+   index and puts them back, checking every dept's recIds each time. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bench.h"
+
+#define DEPTLEN 16
+#define BATCH 256
+
+typedef struct { char dept[DEPTLEN]; int roll; int rid; int d; } Row;
+
+static Row *rows; static long n, cap;
+static char (*depts)[DEPTLEN]; static int nd;
+static int **want; static long *nwant;	/* rows of each dept, by recId */
+static int *got; static long capgot;
+
+static int cmp_uint(const void *a, const void *b){ unsigned x = *(const unsigned*)a, y = *(const unsigned*)b; return (x > y) - (x < y); }
+static int cmp_row(const void *a, const void *b){
+    const Row *x = (const Row*)a, *y = (const Row*)b; int c = memcmp(x->dept, y->dept, DEPTLEN);
+    return c ? c : cmp_uint(&x->rid, &y->rid);
+}
+static int cmp_byrid(const void *a, const void *b){ return cmp_uint(&rows[*(const int*)a].rid, &rows[*(const int*)b].rid); }
+
+static int load_row(char *state, SP_Record *r, SP_RID rid){
+    int d;
+    (void)state;
+    if (n == cap){ cap = cap? cap*2 : 8192; rows = (Row*)realloc(rows, cap*sizeof(Row)); if (!rows){ fprintf(stderr, "oom\n"); return -1; } }
+    memset(rows[n].dept, 0, DEPTLEN);
+    strncpy(rows[n].dept, r->dept ? r->dept : "", DEPTLEN);
+    rows[n].roll = (int)r->roll_no;
+    rows[n].rid = pack_rid(rid.page, rid.slot);
+    for (d = 0; d < nd; d++) if (memcmp(depts[d], rows[n].dept, DEPTLEN) == 0) break;
+    if (d == nd){ depts = realloc(depts, (nd+1)*DEPTLEN); memcpy(depts[nd], rows[n].dept, DEPTLEN); nd++; }
+    rows[n].d = d;
+    n++;
+    return 0;
+}
+
+/* the rows sorted by dept, for AM_BulkLoad */
+typedef struct { Row *rows; long i, n; } Iter;
+static int next_row(char *state, char *value, int *recId){
+    Iter *it = (Iter*)state;
+    if (it->i >= it->n) return 0;
+    memcpy(value, it->rows[it->i].dept, DEPTLEN); *recId = it->rows[it->i].rid; it->i++;
+    return 1;
+}
+
+/* compares the recIds a scan gave for dept d, m of them in got, with those
+   the dept should have; present[] says which rows are in the index */
+static long check_dept(int d, long m, const char *present){
+    long i, k = 0;
+    qsort(got, m, sizeof(int), cmp_uint);
+    for (i = 0; i < nwant[d]; i++){
+        if (present && !present[want[d][i]]) continue;
+        if (k >= m || got[k] != rows[want[d][i]].rid) return 1;
+        k++;
+    }
+    return k != m;
+}
+
+/* every dept by an equality scan, read in batches or one at a time; the
+   recIds of dept d are left in got */
+static long scan_depts(int fd, char type, int len, int prefix, int batched, const char *present, long *total){
+    long bad = 0, m; int d, sd, k, r; char key[AM_MAXATTRLENGTH]; char *vals[1];
+    *total = 0;
+    for (d = 0; d < nd; d++){
+        if (prefix){
+            vals[0] = depts[d];
+            k = AM_EncodeKey(fd, vals, 1, key);
+            sd = AM_OpenPrefixScan(fd, type, len, key, k);
+        } else sd = AM_OpenIndexScan(fd, type, len, EQ_OP, depts[d]);
+        if (sd < 0){ AM_PrintError("scan"); exit(1); }
+        m = 0;
+        for (;;){
+            if (m + BATCH > capgot){ capgot = 2*(m + BATCH); got = (int*)realloc(got, capgot*sizeof(int)); }
+            if (batched){
+                k = AM_FindNextEntries(sd, got + m, NULL, BATCH);
+                if (k < 0) break;
+                m += k;
+            } else {
+                if ((r = AM_FindNextEntry(sd)) < 0) break;
+                got[m++] = r;
+            }
+        }
+        AM_CloseIndexScan(sd);
+        bad += check_dept(d, m, present);
+        *total += m;
+    }
+    return bad;
+}
+
+static void size_line(const char *what, int fd, double ms){
+    AM_TREESTATS ts; int pages;
+    AM_TreeStats(fd, &ts);
+    pages = ts.leafPages + ts.intPages + ts.postPages;
+    printf("postbench %s: height=%d leaf_pages=%d int_pages=%d post_pages=%d  %.1f KB, %.2f bytes/row",
+        what, ts.height, ts.leafPages, ts.intPages, ts.postPages, pages*PF_PAGE_SIZE/1024.0,
+        n ? (double)pages*PF_PAGE_SIZE/n : 0.0);
+    if (ms > 0) printf("  %.0f rows/s", n/(ms/1000.0));
+    printf("\n");
+}
+
+int main(int argc, char **argv){
+    const char *spfile = (argc>1)? argv[1] : "../pflayer/students.spf";
+    const char *idxbase = (argc>2)? argv[2] : "studpost";
+    long i, total, bad;
+    int spfd, ifd, bfd, cfd, d, klen, e;
+    char *present;
+    char key[AM_MAXATTRLENGTH]; char *vals[2];
+    AM_KEYDESC desc; AM_ITERATOR iter; Iter it; Row *sorted;
+    PFStats st; unsigned long t0; double ms;
+    double post_ms, one_ms, comp_ms; long post_lr, one_lr, comp_lr;
+
+    bench_init();
+
+    if ((spfd = bench_open(spfile)) < 0) return 1;
+    if (bench_load(spfd, load_row, NULL) < 0) return 1;
+    SP_Close(spfd);
+    if (n == 0){ fprintf(stderr, "no records\n"); return 1; }
+    want = (int**)calloc(nd, sizeof(int*)); nwant = (long*)calloc(nd, sizeof(long));
+    for (i = 0; i < n; i++){ d = rows[i].d; want[d] = (int*)realloc(want[d], (nwant[d]+1)*sizeof(int)); want[d][nwant[d]++] = (int)i; }
+    for (d = 0; d < nd; d++) qsort(want[d], nwant[d], sizeof(int), cmp_byrid);
+    printf("Loaded %ld records, %d depts from %s, posting lists past %d recIds\n", n, nd, spfile, AM_PostingMin);
+
+    /* the dept index by inserts in file order */
+    AM_DestroyIndex((char*)idxbase, 0);
+    if (AM_CreateIndex((char*)idxbase, 0, 'c', DEPTLEN) != AME_OK){ AM_PrintError("create"); return 1; }
+    ifd = AM_OpenIndex((char*)idxbase, 0);
+    if (ifd < 0){ AM_PrintError("open"); return 1; }
+    t0 = now_us();
+    for (i = 0; i < n; i++)
+        if (AM_InsertEntry(ifd, 'c', DEPTLEN, rows[i].dept, rows[i].rid) != AME_OK){ AM_PrintError("insert"); return 1; }
+    ms = (now_us()-t0)/1000.0;
+    size_line("dept inserts", ifd, ms);
+
+    /* the dept index by bulk load */
+    sorted = (Row*)malloc(n*sizeof(Row)); memcpy(sorted, rows, n*sizeof(Row));
+    qsort(sorted, n, sizeof(Row), cmp_row);
+    AM_DestroyIndex((char*)idxbase, 1);
+    AM_CreateIndex((char*)idxbase, 1, 'c', DEPTLEN);
+    bfd = AM_OpenIndex((char*)idxbase, 1);
+    if (bfd < 0){ AM_PrintError("open"); return 1; }
+    it.rows = sorted; it.i = 0; it.n = n; iter.next = next_row; iter.state = (char*)&it;
+    t0 = now_us();
+    if ((e = AM_BulkLoad(bfd, 'c', DEPTLEN, &iter)) != AME_OK){ AM_PrintError("bulk load"); return 1; }
+    ms = (now_us()-t0)/1000.0;
+    size_line("dept bulk load", bfd, ms);
+
+    /* (dept, roll_no): one entry per row */
+    desc.numCols = 2;
+    desc.colType[0] = 'c'; desc.colLength[0] = DEPTLEN;
+    desc.colType[1] = 'i'; desc.colLength[1] = 4;
+    AM_DestroyIndex((char*)idxbase, 2);
+    if (AM_CreateCompositeIndex((char*)idxbase, 2, &desc) != AME_OK){ AM_PrintError("create"); return 1; }
+    cfd = AM_OpenIndex((char*)idxbase, 2);
+    if (cfd < 0){ AM_PrintError("open"); return 1; }
+    klen = 0;
+    t0 = now_us();
+    for (i = 0; i < n; i++){
+        vals[0] = rows[i].dept; vals[1] = (char*)&rows[i].roll;
+        klen = AM_EncodeKey(cfd, vals, 2, key);
+        if (klen < 0 || AM_InsertEntry(cfd, 'k', klen, key, rows[i].rid) != AME_OK){ AM_PrintError("insert"); return 1; }
+    }
+    ms = (now_us()-t0)/1000.0;
+    size_line("(dept,roll) inserts", cfd, ms);
+
+    /* every dept, three ways */
+    bad = 0;
+    PF_StatsReset(); t0 = now_us();
+    bad += scan_depts(ifd, 'c', DEPTLEN, 0, 1, NULL, &total);
+    post_ms = (now_us()-t0)/1000.0; PF_StatsGet(&st); post_lr = st.logical_reads;
+    if (total != n) bad++;
+    PF_StatsReset(); t0 = now_us();
+    bad += scan_depts(ifd, 'c', DEPTLEN, 0, 0, NULL, &total);
+    one_ms = (now_us()-t0)/1000.0; PF_StatsGet(&st); one_lr = st.logical_reads;
+    if (total != n) bad++;
+    bad += scan_depts(bfd, 'c', DEPTLEN, 0, 1, NULL, &total);
+    if (total != n) bad++;
+    PF_StatsReset(); t0 = now_us();
+    bad += scan_depts(cfd, 'k', klen, 1, 1, NULL, &total);
+    comp_ms = (now_us()-t0)/1000.0; PF_StatsGet(&st); comp_lr = st.logical_reads;
+    if (total != n) bad++;
+    printf("postbench by dept: depts=%d rows=%ld  posting: %.2f ms lr=%ld (one at a time %.2f ms lr=%ld)  (dept,roll) prefix: %.2f ms lr=%ld  check=%s\n",
+        nd, n, post_ms, post_lr, one_ms, one_lr, comp_ms, comp_lr, bad == 0 ? "ok" : "BAD");
+
+    /* a third of the rows out and back in */
+    present = (char*)malloc(n);
+    for (i = 0; i < n; i++) present[i] = 1;
+    for (i = 0; i < n; i += 3){
+        if (AM_DeleteEntry(ifd, 'c', DEPTLEN, rows[i].dept, rows[i].rid) != AME_OK){ AM_PrintError("delete"); return 1; }
+        present[i] = 0;
+    }
+    bad = scan_depts(ifd, 'c', DEPTLEN, 0, 1, present, &total);
+    if (AM_DeleteEntry(ifd, 'c', DEPTLEN, rows[0].dept, rows[0].rid) != AME_NOTFOUND) bad++;
+    for (i = 0; i < n; i += 3)
+        if (AM_InsertEntry(ifd, 'c', DEPTLEN, rows[i].dept, rows[i].rid) != AME_OK){ AM_PrintError("insert"); return 1; }
+    bad += scan_depts(ifd, 'c', DEPTLEN, 0, 1, NULL, &total);
+    if (total != n) bad++;
+    size_line("dept after churn", ifd, 0.0);
+    printf("postbench churn: deleted and reinserted %ld rows  check=%s\n", (n + 2)/3, bad == 0 ? "ok" : "BAD");
+
+    AM_CloseIndex(ifd); AM_CloseIndex(bfd); AM_CloseIndex(cfd);
+    AM_DestroyIndex((char*)idxbase, 0); AM_DestroyIndex((char*)idxbase, 1); AM_DestroyIndex((char*)idxbase, 2);
+    for (d = 0; d < nd; d++) free(want[d]);
+    free(want); free(nwant); free(got); free(present); free(sorted); free(rows); free(depts);
+    return 0;
+}
@@ -0,0 +1,154 @@
+/* test4.c: test wide record ids. Builds a heap file of more than 100k
+pages, two records to a page, indexes it with a wide index and checks that
+every record id comes back whole, page numbers past 65535 included */
+#include <stdio.h>
+#include "am.h"
+#include "pf.h"
+#include "testam.h"
+
+#define HEAPNAME "testheap"	/* heap file */
+#define NUMPAGES 102400	/* pages of the heap file */
+#define PERPAGE	2	/* records on a page */
+#define NUMRECS	(NUMPAGES*PERPAGE)
+#define FNAME_LENGTH 80	/* file name size */
+
+/* record of the heap file, PERPAGE of them at the start of a page */
+typedef struct heaprec {
+	int key;
+	int page;
+	int slot;
+} heaprec;
+
+main()
+{
+int fd;	/* file descriptor for the index */
+int hfd;	/* file descriptor for the heap file */
+char fname[FNAME_LENGTH];	/* file name */
+char *pagebuf;
+heaprec rec;
+AM_RID rid;
+int pagenum,slot,key,lastkey;
+int sd;	/* scan descriptor */
+int numrec;	/* # of records retrieved in a scan */
+int numhigh;	/* of them, on pages past 65535 */
+int errval;
+
+	/* init */
+	printf("initializing\n");
+	PF_Init();
+
+	/* the heap file; keys are a permutation of the record numbers */
+	printf("creating heap file of %d pages\n",NUMPAGES);
+	PF_DestroyFile(HEAPNAME);
+	if (PF_CreateFile(HEAPNAME) != PFE_OK){
+		printf("PF_CreateFile(%s) failed\n",HEAPNAME);
+		exit(1);
+	}
+	hfd = xPF_OpenFile(HEAPNAME);
+	for (pagenum=0; pagenum < NUMPAGES; pagenum++){
+		if ((errval=PF_AllocPage(hfd,&key,&pagebuf)) != PFE_OK ||
+		    key != pagenum){
+			printf("PF_AllocPage failed: %d\n",errval);
+			exit(1);
+		}
+		for (slot=0; slot < PERPAGE; slot++){
+			rec.key = ((pagenum*PERPAGE + slot)*37) % NUMRECS;
+			rec.page = pagenum;
+			rec.slot = slot;
+			bcopy((char *)&rec,pagebuf + slot*sizeof(heaprec),
+				sizeof(heaprec));
+		}
+		PF_UnfixPage(hfd,pagenum,TRUE);
+	}
+
+	/* index it */
+	printf("creating wide index\n");
+	AM_DestroyIndex(RELNAME,0);
+	if ((errval=AM_CreateWideIndex(RELNAME,0,INT_TYPE,sizeof(int),0))
+			!= AME_OK){
+		printf("AM_CreateWideIndex failed: %d\n",errval);
+		exit(1);
+	}
+	fd = AM_OpenIndex(RELNAME,0);
+	if (fd < 0){
+		printf("AM_OpenIndex failed: %d\n",fd);
+		exit(1);
+	}
+
+	printf("inserting %d records\n",NUMRECS);
+	for (pagenum=0; pagenum < NUMPAGES; pagenum++)
+		for (slot=0; slot < PERPAGE; slot++){
+			key = ((pagenum*PERPAGE + slot)*37) % NUMRECS;
+			if ((errval=AM_InsertEntryRid(fd,INT_TYPE,sizeof(int),
+				(char *)&key,AM_RidMake(pagenum,slot),NULL))
+					!= AME_OK){
+				printf("AM_InsertEntryRid failed: %d\n",errval);
+				exit(1);
+			}
+		}
+
+	/* every rid must lead to its record, in key order */
+	printf("scanning index and fetching records\n");
+	sd = xAM_OpenIndexScan(fd,INT_TYPE,sizeof(int),EQ_OP,NULL);
+	numrec = numhigh = 0;
+	lastkey = -1;
+	while ((errval=AM_FindNextRid(sd,&rid,NULL)) == AME_OK){
+		pagenum = AM_RidPage(rid);
+		slot = AM_RidSlot(rid);
+		if (PF_GetThisPage(hfd,pagenum,&pagebuf) != PFE_OK){
+			printf("bad rid: page %d\n",pagenum);
+			exit(1);
+		}
+		bcopy(pagebuf + slot*sizeof(heaprec),(char *)&rec,
+			sizeof(heaprec));
+		PF_UnfixPage(hfd,pagenum,FALSE);
+		if (rec.page != pagenum || rec.slot != slot ||
+		    rec.key != lastkey + 1){
+			printf("rid (%d,%d) has record (%d,%d) key %d after %d\n",
+				pagenum,slot,rec.page,rec.slot,rec.key,lastkey);
+			exit(1);
+		}
+		lastkey = rec.key;
+		numrec++;
+		if (pagenum > 0xFFFF) numhigh++;
+	}
+	xAM_CloseIndexScan(sd);
+	printf("retrieved %d records, %d on pages past 65535\n",numrec,numhigh);
+
+	/* delete the records of the last pages and look them up again */
+	printf("deleting the records of pages %d and up\n",NUMPAGES - 100);
+	for (pagenum=NUMPAGES - 100; pagenum < NUMPAGES; pagenum++)
+		for (slot=0; slot < PERPAGE; slot++){
+			key = ((pagenum*PERPAGE + slot)*37) % NUMRECS;
+			if ((errval=AM_DeleteEntryRid(fd,INT_TYPE,sizeof(int),
+				(char *)&key,AM_RidMake(pagenum,slot))) != AME_OK){
+				printf("AM_DeleteEntryRid failed: %d\n",errval);
+				exit(1);
+			}
+		}
+	numrec = 0;
+	for (pagenum=NUMPAGES - 200; pagenum < NUMPAGES; pagenum++){
+		key = ((pagenum*PERPAGE)*37) % NUMRECS;
+		sd = xAM_OpenIndexScan(fd,INT_TYPE,sizeof(int),EQ_OP,
+			(char *)&key);
+		while (AM_FindNextRid(sd,&rid,NULL) == AME_OK){
+			if (rid != AM_RidMake(pagenum,0)){
+				printf("key %d has rid (%d,%d)\n",key,
+					AM_RidPage(rid),AM_RidSlot(rid));
+				exit(1);
+			}
+			numrec++;
+		}
+		xAM_CloseIndexScan(sd);
+	}
+	printf("found %d of the last 200 pages' first records\n",numrec);
+
+	/* destroy everything */
+	printf("closing down\n");
+	AM_CloseIndex(fd);
+	xPF_CloseFile(hfd);
+	xAM_DestroyIndex(RELNAME,0);
+	PF_DestroyFile(HEAPNAME);
+
+	printf("test4 done!\n");
+}
@@ -0,0 +1,148 @@
+/* test5.c: test many open scans. Opens 10000 scans of one index with
+every operator, advances them a few entries at a time in turn, and closes
+and reopens a third of them between rounds so that descriptors are
+reused while the others are positioned all over the leaves */
+#include <stdio.h>
+#include "am.h"
+#include "pf.h"
+#include "testam.h"
+
+#define NUMKEYS	20000	/* keys 0 .. NUMKEYS-1, recId = key */
+#define NUMSCANS 10000	/* scans open at once */
+#define ROUNDS	8	/* rounds of advancing every scan */
+#define STEPS	3	/* entries a scan returns in a round */
+#define NUMOPS	7	/* ALL, then EQ_OP .. NE_OP */
+
+/* one open scan and what it should return next */
+typedef struct scanstate {
+	int sd;	/* scan descriptor */
+	int op;	/* 0 for a scan of all keys */
+	int key;	/* value scanned for */
+	int n;	/* entries returned so far */
+} scanstate;
+
+scanstate scans[NUMSCANS];
+
+/* the n-th recId a scan of op, key returns, or AME_EOF */
+expected(op,key,n)
+int op,key,n;
+{
+int v;
+
+	v = NUMKEYS;
+	switch(op){
+	case 0:		v = n; break;
+	case EQ_OP:	v = (n == 0) ? key : NUMKEYS; break;
+	case LT_OP:	v = (n < key) ? n : NUMKEYS; break;
+	case LE_OP:	v = (n <= key) ? n : NUMKEYS; break;
+	case GT_OP:	v = key + 1 + n; break;
+	case GE_OP:	v = key + n; break;
+	case NE_OP:	v = (n < key) ? n : n + 1; break;
+	}
+	return((v < NUMKEYS) ? v : AME_EOF);
+}
+
+/* opens scan i on the index fd */
+openscan(fd,i,seed)
+int fd,i,seed;
+{
+scanstate *s;
+
+	s = &scans[i];
+	s->op = (i + seed) % NUMOPS;
+	s->key = ((i + seed)*7919) % NUMKEYS;
+	s->n = 0;
+	s->sd = xAM_OpenIndexScan(fd,INT_TYPE,sizeof(int),
+		(s->op == 0) ? EQ_OP : s->op,
+		(s->op == 0) ? NULL : (char *)&s->key);
+	return(s->sd);
+}
+
+main()
+{
+int fd;	/* file descriptor for the index */
+int i,key,round,step;
+int recid,want;
+int maxsd;	/* largest descriptor handed out */
+int numopen;	/* scans opened in all */
+int numrec;	/* entries checked */
+scanstate *s;
+
+	/* init */
+	printf("initializing\n");
+	PF_Init();
+
+	/* an index of NUMKEYS keys, inserted out of order */
+	printf("creating index of %d keys\n",NUMKEYS);
+	AM_DestroyIndex(RELNAME,0);
+	xAM_CreateIndex(RELNAME,0,INT_TYPE,sizeof(int));
+	fd = AM_OpenIndex(RELNAME,0);
+	if (fd < 0){
+		printf("AM_OpenIndex failed: %d\n",fd);
+		exit(1);
+	}
+	for (i=0; i < NUMKEYS; i++){
+		key = (i*37) % NUMKEYS;
+		xAM_InsertEntry(fd,INT_TYPE,sizeof(int),(char *)&key,key);
+	}
+
+	/* open them all before any is advanced */
+	printf("opening %d scans\n",NUMSCANS);
+	maxsd = -1;
+	for (i=0; i < NUMSCANS; i++){
+		openscan(fd,i,0);
+		if (scans[i].sd > maxsd) maxsd = scans[i].sd;
+	}
+	numopen = NUMSCANS;
+
+	/* advance them in turn, replacing a third of them after each round */
+	printf("advancing them %d entries a round for %d rounds\n",STEPS,ROUNDS);
+	numrec = 0;
+	for (round=0; round < ROUNDS; round++){
+		for (i=0; i < NUMSCANS; i++){
+			s = &scans[i];
+			for (step=0; step < STEPS; step++){
+				recid = RecIdToInt(xAM_FindNextEntry(s->sd));
+				want = expected(s->op,s->key,s->n);
+				if (recid != want){
+					printf("scan %d (op %d key %d) entry %d: got %d want %d\n",
+						s->sd,s->op,s->key,s->n,recid,want);
+					exit(1);
+				}
+				if (recid == AME_EOF) break;
+				s->n++;
+				numrec++;
+			}
+		}
+		for (i=round % 3; i < NUMSCANS; i += 3)
+			xAM_CloseIndexScan(scans[i].sd);
+		for (i=round % 3; i < NUMSCANS; i += 3){
+			openscan(fd,i,round + 1);
+			if (scans[i].sd > maxsd) maxsd = scans[i].sd;
+			numopen++;
+		}
+	}
+	printf("checked %d entries of %d scans, largest descriptor %d\n",
+		numrec,numopen,maxsd);
+	if (maxsd >= 2*NUMSCANS){
+		printf("closed descriptors are not reused\n");
+		exit(1);
+	}
+
+	/* a closed descriptor is rejected */
+	xAM_CloseIndexScan(scans[0].sd);
+	if (AM_CloseIndexScan(scans[0].sd) != AME_INVALID_SCANDESC ||
+	    AM_FindNextEntry(scans[0].sd) != AME_INVALID_SCANDESC){
+		printf("closed scan %d still accepted\n",scans[0].sd);
+		exit(1);
+	}
+	for (i=1; i < NUMSCANS; i++)
+		xAM_CloseIndexScan(scans[i].sd);
+
+	/* destroy everything */
+	printf("closing down\n");
+	AM_CloseIndex(fd);
+	xAM_DestroyIndex(RELNAME,0);
+
+	printf("test5 done!\n");
+}
@@ -1,6 +1,6 @@
 /* buf.c: buffer management routines. The interface routines are:
-PFbufGet(), PFbufUnfix(), PFbufAlloc(), PFbufReleaseFile(), PFbufUsed() and
-PFbufPrint() */
+PFbufGet(), PFbufUnfix(), PFbufAlloc(), PFbufReleaseFile(), PFbufUsed(),
+PFbufPin(), PFbufUnpin() and PFbufPrint() */
 #include <stdio.h>
 #include <stdlib.h>
 #include "pf.h"
@@ -78,13 +78,14 @@ PFbpage *tbpage; int error;
 		if ((*bpage=(PFbpage *)malloc(sizeof(PFbpage)))==NULL){
 			*bpage = NULL; PFerrno = PFE_NOMEM; return(PFerrno);
 		}
+		(*bpage)->pins = 0; (*bpage)->slot = PFnumbpage;
 		PFnumbpage++;
 	}
 	else {
 		/* pick victim from tail (global order list) */
 		*bpage = NULL;
 		for (tbpage=PFlastbpage; tbpage!=NULL; tbpage=tbpage->prevpage){
-			if (!tbpage->fixed) break; /* found victim */
+			if (!tbpage->fixed && tbpage->pins == 0) break; /* found victim */
 		}
 		if (tbpage == NULL){ PFerrno = PFE_NOBUF; return(PFerrno); }
 		/* write victim if dirty */
@@ -164,7 +165,7 @@ PFbpage *bpage; PFbpage *temppage; int error;
 	bpage = PFfirstbpage;
 	while (bpage != NULL){
 		if (bpage->fd == fd){
-			if (bpage->fixed){ PFerrno = PFE_PAGEFIXED; return(PFerrno);} 
+			if (bpage->fixed || bpage->pins > 0){ PFerrno = PFE_PAGEFIXED; return(PFerrno);} 
 			if (bpage->dirty && (error=(*writefcn)(fd,bpage->page,&bpage->fpage))!=PFE_OK) return(error);
 			bpage->dirty = FALSE;
 			if ((error=PFhashDelete(fd,bpage->page))!=PFE_OK){ printf("Internal error:PFbufReleaseFile()\n"); exit(1);} 
@@ -175,6 +176,41 @@ PFbpage *bpage; PFbpage *temppage; int error;
 	return(PFE_OK);
 }
 
+/* Pins page pagenum of fd, reading it in on a miss. Unlike PFbufGet any
+number of callers may pin a page, fixed or not; PF_LatchPage serializes
+them with the buffer's latch. */
+PFbufPin(fd,pagenum,bpage,readfcn,writefcn)
+int fd; int pagenum; PFbpage **bpage; int (*readfcn)(); int (*writefcn)(); {
+PFbpage *tbpage; int error; int policy;
+	policy = PF_GetReplPolicy(fd);
+	if ((tbpage=PFhashFind(fd,pagenum)) == NULL){
+		if ((error=PFbufInternalAlloc(&tbpage,writefcn))!= PFE_OK){ *bpage=NULL; return(error);} 
+		if ((error=(*readfcn)(fd,pagenum,&tbpage->fpage))!= PFE_OK){ PFbufUnlink(tbpage); PFbufInsertFree(tbpage); *bpage=NULL; return(error);} 
+		if ((error=PFhashInsert(fd,pagenum,tbpage))!=PFE_OK){ PFbufUnlink(tbpage); PFbufInsertFree(tbpage); *bpage=NULL; return(error);} 
+		tbpage->fd = fd; tbpage->page = pagenum; tbpage->dirty = FALSE; tbpage->fixed = FALSE;
+		if (policy==PF_REPL_MRU){ PFbufUnlink(tbpage); PFbufLinkTail(tbpage);} 
+		PF_StatsBufferMiss();
+	}
+	else {
+		PF_StatsBufferHit();
+		PFbufUnlink(tbpage);
+		if (policy==PF_REPL_MRU) PFbufLinkTail(tbpage); else PFbufLinkHead(tbpage);
+	}
+	tbpage->pins++;
+	*bpage = tbpage; return(PFE_OK);
+}
+
+PFbufUnpin(fd,pagenum,dirty)
+int fd; int pagenum; int dirty; {
+PFbpage *bpage; int policy;
+	if ((bpage= PFhashFind(fd,pagenum))==NULL){ PFerrno = PFE_PAGENOTINBUF; return(PFerrno);} 
+	if (bpage->pins == 0){ PFerrno = PFE_PAGEUNFIXED; return(PFerrno);} 
+	if (dirty) bpage->dirty = TRUE; bpage->pins--; policy = PF_GetReplPolicy(fd);
+	PFbufUnlink(bpage);
+	if (policy==PF_REPL_MRU) PFbufLinkTail(bpage); else PFbufLinkHead(bpage);
+	return(PFE_OK);
+}
+
 PFbufUsed(fd,pagenum)
 int fd; int pagenum; {
 PFbpage *bpage; int policy = PF_GetReplPolicy(fd);
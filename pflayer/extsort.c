@@ -0,0 +1,242 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include "pf.h"
+#include "pftypes.h"
+#include "extsort.h"
+
+/* A run page is a record count followed by packed records. Runs are
+   contiguous page ranges of one temp file; a merge pass that cannot reach
+   the final answer writes its longer runs into the other temp file. */
+#define ES_HDR ((int)sizeof(int))
+
+#define ES_PUTTING 0
+#define ES_MEMORY 1     /* everything fit: stream the sorted buffer */
+#define ES_MERGING 2
+#define ES_DONE 3
+
+#define ES_REC(s, i) ((s)->src[i].buf + ES_HDR + (long)(s)->src[i].idx * (s)->recsize)
+#define ES_EMPTY(s, i) ((s)->src[i].idx >= (s)->src[i].n)
+
+static int es_per_page(const ES_Sort *s){ return (PF_PAGE_SIZE - ES_HDR) / s->recsize; }
+
+/* (re)create temp file w, empty */
+static int es_reset_file(ES_Sort *s, int w){
+    int rc;
+    if (s->fd[w] >= 0){ PF_CloseFile(s->fd[w]); s->fd[w] = -1; }
+    PF_DestroyFile(s->name[w]);
+    if ((rc = PF_CreateFile(s->name[w])) != PFE_OK) return rc;
+    if ((s->fd[w] = PF_OpenFile(s->name[w])) < 0) return s->fd[w];
+    s->npages[w] = 0;
+    return PFE_OK;
+}
+
+/* appends page (count header filled in) to temp file w */
+static int es_write_page(ES_Sort *s, int w, const char *page){
+    int rc, pno; char *pbuf;
+    if ((rc = PF_AllocPage(s->fd[w], &pno, &pbuf)) != PFE_OK) return rc;
+    memcpy(pbuf, page, PF_PAGE_SIZE);
+    s->npages[w]++; s->stats.pages_written++;
+    return PF_UnfixPage(s->fd[w], pno, TRUE);
+}
+
+static int es_add_run(ES_Sort *s, int start){
+    if (s->nruns + 2 > s->runcap){
+        int nc = s->runcap ? 2 * s->runcap : 64;
+        int *tmp = (int*)realloc(s->runs, nc * sizeof(int));
+        if (!tmp) return PFE_NOMEM;
+        s->runs = tmp; s->runcap = nc;
+    }
+    s->runs[s->nruns++] = start;
+    return PFE_OK;
+}
+
+/* sorts the run buffer and writes it out as one run */
+static int es_write_run(ES_Sort *s){
+    int rc, per = es_per_page(s), cnt; long i; char page[PF_PAGE_SIZE];
+    if (s->fd[0] < 0 && (rc = es_reset_file(s, 0)) != PFE_OK) return rc;
+    qsort(s->buf, (size_t)s->n, (size_t)s->recsize, s->cmp);
+    if ((rc = es_add_run(s, s->npages[0])) != PFE_OK) return rc;
+    for (i = 0; i < s->n; i += cnt){
+        cnt = (s->n - i < per) ? (int)(s->n - i) : per;
+        memcpy(page, &cnt, ES_HDR);
+        memcpy(page + ES_HDR, s->buf + i * s->recsize, (size_t)cnt * s->recsize);
+        if ((rc = es_write_page(s, 0, page)) != PFE_OK) return rc;
+    }
+    s->runs[s->nruns] = s->npages[0];
+    s->stats.runs++;
+    s->n = 0;
+    return PFE_OK;
+}
+
+/* copies the next page of source i into its buffer, or marks it empty */
+static int es_load(ES_Sort *s, int i){
+    ES_Source *src = &s->src[i]; int rc; char *pbuf;
+    src->idx = 0; src->n = 0;
+    if (src->page >= src->end) return PFE_OK;
+    if ((rc = PF_GetThisPage(s->fd[s->cur], src->page, &pbuf)) != PFE_OK) return rc;
+    memcpy(src->buf, pbuf, PF_PAGE_SIZE);
+    memcpy(&src->n, src->buf, ES_HDR);
+    src->page++; s->stats.pages_read++;
+    return PF_UnfixPage(s->fd[s->cur], src->page - 1, FALSE);
+}
+
+/* source a's record goes first; an empty source loses to everything and
+   ties go to the earlier run */
+static int es_less(ES_Sort *s, int a, int b){
+    int c;
+    if (ES_EMPTY(s, a)) return 0;
+    if (ES_EMPTY(s, b)) return 1;
+    c = s->cmp(ES_REC(s, a), ES_REC(s, b));
+    return c < 0 || (c == 0 && a < b);
+}
+
+/* replays source i's path to the root: each node keeps the loser and the
+   winner moves up. Nodes still -1 (while building) take i and stop. */
+static void es_adjust(ES_Sort *s, int i){
+    int t = (i + s->k) / 2, tmp;
+    while (t > 0){
+        if (s->tree[t] < 0){ s->tree[t] = i; return; }
+        if (es_less(s, s->tree[t], i)){ tmp = s->tree[t]; s->tree[t] = i; i = tmp; }
+        t /= 2;
+    }
+    s->tree[0] = i;
+}
+
+/* sets up a k-way merge of runs first .. first+k-1 of the current file */
+static int es_merge_start(ES_Sort *s, int first, int k){
+    int i, rc;
+    s->k = k;
+    for (i = 0; i < k; i++){
+        s->src[i].page = s->runs[first + i];
+        s->src[i].end = s->runs[first + i + 1];
+        s->src[i].buf = s->buf + (long)i * PF_PAGE_SIZE;
+        if ((rc = es_load(s, i)) != PFE_OK) return rc;
+        s->tree[i] = -1;
+    }
+    for (i = 0; i < k; i++) es_adjust(s, i);
+    return PFE_OK;
+}
+
+/* smallest record of the merge, NULL when all sources are empty */
+static char *es_merge_top(ES_Sort *s){
+    int w = s->tree[0];
+    return ES_EMPTY(s, w) ? NULL : ES_REC(s, w);
+}
+
+static int es_merge_pop(ES_Sort *s){
+    int w = s->tree[0], rc;
+    if (++s->src[w].idx >= s->src[w].n && (rc = es_load(s, w)) != PFE_OK) return rc;
+    es_adjust(s, w);
+    return PFE_OK;
+}
+
+/* one merge pass: groups of fanin runs become single runs in the other file */
+static int es_merge_pass(ES_Sort *s){
+    int out = 1 - s->cur, per = es_per_page(s), rc, g, k, cnt, nnew = 0;
+    int *newruns; char *page, *rec;
+    if ((rc = es_reset_file(s, out)) != PFE_OK) return rc;
+    newruns = (int*)malloc((s->nruns / s->fanin + 2) * sizeof(int));
+    if (!newruns) return PFE_NOMEM;
+    page = s->buf + (long)s->fanin * PF_PAGE_SIZE;
+    for (g = 0; g < s->nruns; g += s->fanin){
+        k = (s->nruns - g < s->fanin) ? s->nruns - g : s->fanin;
+        newruns[nnew++] = s->npages[out];
+        if ((rc = es_merge_start(s, g, k)) != PFE_OK) break;
+        cnt = 0;
+        while ((rec = es_merge_top(s)) != NULL){
+            memcpy(page + ES_HDR + cnt * s->recsize, rec, (size_t)s->recsize);
+            if (++cnt == per){
+                memcpy(page, &cnt, ES_HDR);
+                if ((rc = es_write_page(s, out, page)) != PFE_OK) break;
+                cnt = 0;
+            }
+            if ((rc = es_merge_pop(s)) != PFE_OK) break;
+        }
+        if (rc != PFE_OK) break;
+        if (cnt > 0){
+            memcpy(page, &cnt, ES_HDR);
+            if ((rc = es_write_page(s, out, page)) != PFE_OK) break;
+        }
+    }
+    if (rc != PFE_OK){ free(newruns); return rc; }
+    newruns[nnew] = s->npages[out];
+    memcpy(s->runs, newruns, (nnew + 1) * sizeof(int));
+    free(newruns);
+    s->nruns = nnew;
+    s->cur = out;
+    s->stats.passes++;
+    return PFE_OK;
+}
+
+int ES_Open(ES_Sort *s, int recsize, ES_Cmp cmp, long mem_bytes, const char *tmpname){
+    memset(s, 0, sizeof(*s));
+    s->fd[0] = s->fd[1] = -1;
+    if (recsize <= 0 || recsize > PF_PAGE_SIZE - ES_HDR || !cmp || !tmpname ||
+        strlen(tmpname) + 5 > sizeof(s->name[0])) return PFE_FD;
+    /* the merge needs two input pages and an output page */
+    if (mem_bytes < 3L * PF_PAGE_SIZE) mem_bytes = 3L * PF_PAGE_SIZE;
+    s->recsize = recsize; s->cmp = cmp; s->mem = mem_bytes;
+    s->cap = mem_bytes / recsize;
+    s->fanin = (int)(mem_bytes / PF_PAGE_SIZE) - 1;
+    sprintf(s->name[0], "%s.es0", tmpname);
+    sprintf(s->name[1], "%s.es1", tmpname);
+    s->buf = (char*)malloc((size_t)mem_bytes);
+    s->src = (ES_Source*)malloc(s->fanin * sizeof(ES_Source));
+    s->tree = (int*)malloc(s->fanin * sizeof(int));
+    if (!s->buf || !s->src || !s->tree){ ES_Close(s); return PFE_NOMEM; }
+    s->state = ES_PUTTING;
+    return PFE_OK;
+}
+
+int ES_Put(ES_Sort *s, const void *rec){
+    int rc;
+    if (s->state != ES_PUTTING) return PFE_FD;
+    if (s->n == s->cap && (rc = es_write_run(s)) != PFE_OK) return rc;
+    memcpy(s->buf + s->n * s->recsize, rec, (size_t)s->recsize);
+    s->n++; s->stats.records++;
+    return PFE_OK;
+}
+
+int ES_Finish(ES_Sort *s){
+    int rc;
+    if (s->state != ES_PUTTING) return PFE_FD;
+    if (s->nruns == 0){
+        qsort(s->buf, (size_t)s->n, (size_t)s->recsize, s->cmp);
+        s->pos = 0; s->state = ES_MEMORY;
+        return PFE_OK;
+    }
+    if (s->n > 0 && (rc = es_write_run(s)) != PFE_OK) return rc;
+    while (s->nruns > s->fanin)
+        if ((rc = es_merge_pass(s)) != PFE_OK) return rc;
+    if ((rc = es_merge_start(s, 0, s->nruns)) != PFE_OK) return rc;
+    s->stats.passes++;
+    s->state = ES_MERGING;
+    return PFE_OK;
+}
+
+int ES_Next(ES_Sort *s, void *rec){
+    char *top; int rc;
+    if (s->state == ES_MEMORY){
+        if (s->pos >= s->n){ s->state = ES_DONE; return 0; }
+        memcpy(rec, s->buf + s->pos * s->recsize, (size_t)s->recsize);
+        s->pos++;
+        return 1;
+    }
+    if (s->state != ES_MERGING) return s->state == ES_DONE ? 0 : PFE_FD;
+    if ((top = es_merge_top(s)) == NULL){ s->state = ES_DONE; return 0; }
+    memcpy(rec, top, (size_t)s->recsize);
+    if ((rc = es_merge_pop(s)) != PFE_OK) return rc;
+    return 1;
+}
+
+int ES_Close(ES_Sort *s){
+    int w;
+    for (w = 0; w < 2; w++){
+        if (s->fd[w] >= 0){ PF_CloseFile(s->fd[w]); PF_DestroyFile(s->name[w]); s->fd[w] = -1; }
+    }
+    free(s->buf); free(s->src); free(s->tree); free(s->runs);
+    s->buf = NULL; s->src = NULL; s->tree = NULL; s->runs = NULL;
+    s->state = ES_DONE;
+    return PFE_OK;
+}
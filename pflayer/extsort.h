@@ -0,0 +1,56 @@
+#ifndef EXTSORT_H
+#define EXTSORT_H
+
+/* External merge sort of fixed-size records on top of the PF layer.
+   Records are buffered up to a memory budget, sorted into runs written to
+   a PF temp file, and merged with a tournament (loser) tree. Input that fits
+   in the budget never touches disk. Usage:
+       ES_Open, ES_Put per record, ES_Finish, ES_Next until 0, ES_Close */
+
+typedef int (*ES_Cmp)(const void *a, const void *b);
+
+typedef struct {
+    long records;       /* records put */
+    int runs;           /* initial runs written */
+    int passes;         /* merge passes, the final streamed one included */
+    long pages_written; /* temp-file pages */
+    long pages_read;
+} ES_Stats;
+
+/* One run being merged; its current page is copied into buf */
+typedef struct {
+    int page;       /* next page to load */
+    int end;        /* first page past the run */
+    int n;          /* records in the loaded page */
+    int idx;        /* next record in it */
+    char *buf;      /* page-sized slice of the sort buffer */
+} ES_Source;
+
+typedef struct {
+    int recsize;
+    ES_Cmp cmp;
+    long mem;           /* memory budget in bytes */
+    char *buf;          /* the run buffer; page buffers during the merge */
+    long cap, n;        /* records the run buffer holds, records in it */
+    long pos;           /* next record when the input fit in memory */
+    int fanin;          /* runs merged at once */
+    char name[2][256];  /* temp files; runs live in name[cur] */
+    int fd[2];
+    int npages[2];
+    int cur;
+    int *runs;          /* first page of each run, runs[nruns] = end */
+    int nruns, runcap;
+    ES_Source *src;     /* merge inputs and their loser tree */
+    int *tree;
+    int k;
+    int state;
+    ES_Stats stats;
+} ES_Sort;
+
+int ES_Open(ES_Sort *s, int recsize, ES_Cmp cmp, long mem_bytes, const char *tmpname);
+int ES_Put(ES_Sort *s, const void *rec);
+int ES_Finish(ES_Sort *s);             /* end of input */
+int ES_Next(ES_Sort *s, void *rec);    /* 1 = record copied out, 0 = end, < 0 = PF error */
+int ES_Close(ES_Sort *s);              /* frees memory and removes the temp files */
+
+#endif
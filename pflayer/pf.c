@@ -1,10 +1,13 @@
 /* pf.c: Paged File Interface Routines+ support routines */
+#define _POSIX_C_SOURCE 200112L	/* posix_fadvise, pthread rwlocks */
 #include <stdio.h>
 #include <sys/types.h>
 #include <fcntl.h>
 #include <sys/file.h>
 #include <string.h>
 #include <stdlib.h>
+#include <pthread.h>
+#include <time.h>
 #include "pf.h"
 #include "pftypes.h"
 
@@ -13,7 +16,7 @@
 #define L_SET 0
 #endif
 
-int PFerrno = PFE_OK;	/* last error message */
+__thread int PFerrno = PFE_OK;	/* last error message, one per thread */
 
 /* runtime configurable buffer pool size (<= PF_MAX_BUFS) */
 int PF_max_bufs = PF_MAX_BUFS;
@@ -23,6 +26,7 @@ static PFStats PFstats = {0, 0, 0, 0, 0, 0};
 
 /* Default replacement policy for newly opened files */
 static int PF_default_repl_policy = PF_REPL_LRU;
+static int PF_open_serial = 0; /* last serial handed to PF_OpenFile */
 
 /* Stats helper functions for buffer manager */
 void PF_StatsBufferHit() { PFstats.buffer_hits++; }
@@ -30,6 +34,23 @@ void PF_StatsBufferMiss() { PFstats.buffer_misses++; }
 
 static PFftab_ele PFftab[PF_FTAB_SIZE]; /* table of opened files */
 
+/* Threaded use (PF_SetThreaded): one mutex guards the file table, the
+buffer pool and the stats for the length of each page call, and every
+buffer has a latch that PF_LatchPage holders keep across calls. */
+static int PFthreaded = FALSE;
+static pthread_mutex_t PFmutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t PFunpinned = PTHREAD_COND_INITIALIZER; /* a buffer
+					may have become replaceable */
+static pthread_rwlock_t PFlatch[PF_MAX_BUFS]; /* indexed by PFbpage.slot */
+static int PFlatchInit = FALSE;
+static __thread int PFlatched = 0; /* latches this thread holds */
+
+#define PFlock() (PFthreaded ? pthread_mutex_lock(&PFmutex) : 0)
+#define PFunlock() (PFthreaded ? pthread_mutex_unlock(&PFmutex) : 0)
+
+#define PF_LATCHWAIT 1	/* seconds a thread holding latches waits for a
+			   buffer before it gives up */
+
 /* true if file descriptor fd is invaild */
 #define PFinvalidFd(fd) ((fd) < 0 || (fd) >= PF_FTAB_SIZE \
 				|| PFftab[fd].fname == NULL)
@@ -181,6 +202,40 @@ int error;
 }
 
 
+static PFwaitBuf(deadline)
+struct timespec *deadline;	/* zero on the first call of a wait */
+/****************************************************************************
+SPECIFICATIONS:
+	In threaded use, wait with the pool mutex held for a buffer to
+	be unpinned or unfixed. A thread holding latches waits at most
+	PF_LATCHWAIT seconds in all: the buffers may be held by threads
+	waiting on its latches.
+
+RETURN VALUE:
+	TRUE	if the caller should try again
+	FALSE	if it should fail with PFE_NOBUF
+*****************************************************************************/
+{
+struct timespec now;
+
+	if (!PFthreaded)
+		return(FALSE);
+	if (PFlatched == 0){
+		pthread_cond_wait(&PFunpinned,&PFmutex);
+		return(TRUE);
+	}
+	clock_gettime(CLOCK_REALTIME,&now);
+	if (deadline->tv_sec == 0){
+		*deadline = now;
+		deadline->tv_sec += PF_LATCHWAIT;
+	}
+	else if (now.tv_sec > deadline->tv_sec || (now.tv_sec ==
+		deadline->tv_sec && now.tv_nsec >= deadline->tv_nsec))
+		return(FALSE);
+	pthread_cond_timedwait(&PFunpinned,&PFmutex,deadline);
+	return(TRUE);
+}
+
 /************************* Interface Routines ****************************/
 
 void PF_Init()
@@ -202,6 +257,13 @@ char *env;
 	/* init the hash table */
 	PFhashInit();
 
+	/* init the buffer latches, once */
+	if (!PFlatchInit){
+		for (i=0; i < PF_MAX_BUFS; i++)
+			pthread_rwlock_init(&PFlatch[i],NULL);
+		PFlatchInit = TRUE;
+	}
+
 	/* init the file table to be not used*/
 	for (i=0; i < PF_FTAB_SIZE; i++){
 		PFftab[i].fname = NULL;
@@ -361,6 +423,7 @@ int fd; /* file descriptor */
 
 	/* apply current default policy */
 	PFftab[fd].repl_policy = PF_default_repl_policy;
+	PFftab[fd].serial = ++PF_open_serial;
 	return(fd);
 }
 
@@ -541,7 +604,7 @@ PFfpage *fpage;	/* pointer to file page */
 
 }
 
-PF_GetThisPage(fd,pagenum,pagebuf)
+static PFgetThisPage(fd,pagenum,pagebuf)
 int fd;		/* file descriptor */
 int pagenum;	/* page number to read */
 char **pagebuf;	/* pointer to pointer to page data */
@@ -597,7 +660,7 @@ PFfpage *fpage;
 	}
 }
 
-PF_AllocPage(fd,pagenum,pagebuf)
+static PFallocPage(fd,pagenum,pagebuf)
 int fd;		/* file descriptor */
 int *pagenum;	/* page number */
 char **pagebuf;	/* pointer to pointer to page buffer*/
@@ -671,7 +734,7 @@ int error;
 	return(PFE_OK);
 }
 
-PF_DisposePage(fd,pagenum)
+static PFdisposePage(fd,pagenum)
 int fd;		/* file descriptor */
 int pagenum;	/* page number */
 /****************************************************************************
@@ -726,7 +789,7 @@ int error;
 	return(PFbufUnfix(fd,pagenum,TRUE));
 }
 
-PF_UnfixPage(fd,pagenum,dirty)
+static PFunfixPage(fd,pagenum,dirty)
 int fd;	/* file descriptor */
 int pagenum;	/* page number */
 int dirty;	/* true if file is dirty */
@@ -762,6 +825,188 @@ RETURN VALUE:
 	return(PFbufUnfix(fd,pagenum,dirty));
 }
 
+/* The page calls above, each under the pool mutex in threaded use. */
+PF_GetThisPage(fd,pagenum,pagebuf)
+int fd;
+int pagenum;
+char **pagebuf;
+{
+int error;
+struct timespec deadline;
+
+	deadline.tv_sec = 0;
+	PFlock();
+	error = PFgetThisPage(fd,pagenum,pagebuf);
+	while (error == PFE_NOBUF && PFwaitBuf(&deadline))
+		error = PFgetThisPage(fd,pagenum,pagebuf);
+	PFunlock();
+	return(error);
+}
+
+PF_AllocPage(fd,pagenum,pagebuf)
+int fd;
+int *pagenum;
+char **pagebuf;
+{
+int error;
+struct timespec deadline;
+
+	deadline.tv_sec = 0;
+	PFlock();
+	error = PFallocPage(fd,pagenum,pagebuf);
+	while (error == PFE_NOBUF && PFwaitBuf(&deadline))
+		error = PFallocPage(fd,pagenum,pagebuf);
+	PFunlock();
+	return(error);
+}
+
+PF_DisposePage(fd,pagenum)
+int fd;
+int pagenum;
+{
+int error;
+
+	PFlock();
+	error = PFdisposePage(fd,pagenum);
+	if (PFthreaded) pthread_cond_broadcast(&PFunpinned);
+	PFunlock();
+	return(error);
+}
+
+PF_UnfixPage(fd,pagenum,dirty)
+int fd;
+int pagenum;
+int dirty;
+{
+int error;
+
+	PFlock();
+	error = PFunfixPage(fd,pagenum,dirty);
+	if (PFthreaded) pthread_cond_broadcast(&PFunpinned);
+	PFunlock();
+	return(error);
+}
+
+/* Turns the pool mutex on (TRUE) or off. Call it before the threads start
+and after they are done: PF_GetThisPage, PF_AllocPage, PF_DisposePage,
+PF_UnfixPage, PF_MarkDirty, PF_PrefetchPage and the latch calls may then be
+made from any thread, and wait for a buffer rather than fail with
+PFE_NOBUF (but see PFwaitBuf and PF_LatchPage). Opening, closing and scanning files stay
+single threaded. */
+void PF_SetThreaded(on)
+int on;
+{
+	PFthreaded = on;
+}
+
+PF_LatchPage(fd,pagenum,pagebuf,exclusive)
+int fd;		/* file descriptor */
+int pagenum;	/* page number to latch */
+char **pagebuf;	/* pointer to pointer to page data */
+int exclusive;	/* TRUE to write the page, FALSE to read it */
+/****************************************************************************
+SPECIFICATIONS:
+	Pin page "pagenum" of file "fd" in the buffer and latch it,
+	shared or exclusive, waiting for the holders of a conflicting
+	latch. Any number of threads may pin a page; a pinned page is
+	not replaced. The holder of an exclusive latch may also fix the
+	page with PF_GetThisPage, say to hand it to code that unfixes it.
+	Nobody else may fix a page that can be latched shared: a page
+	is fixed once at a time, so readers that fix it collide with
+	PFE_PAGEFIXED.
+	Only a thread holding no latch waits for a free buffer: one
+	that holds some gets PFE_NOBUF, and should let go of them and
+	start over, since the buffers it waits for may be the ones that
+	threads waiting on its latches hold.
+
+RETURN VALUE:
+	PFE_OK	if no error.
+	PFE_INVALIDPAGE if invalid page number is specified.
+	PFE_NOBUF if every buffer is in use and the thread holds latches.
+	other PF error codes if other error encountered.
+*****************************************************************************/
+{
+PFbpage *bpage;
+int error;
+struct timespec deadline;
+
+	deadline.tv_sec = 0;
+	PFlock();
+	if (PFinvalidFd(fd)){
+		PFunlock();
+		return(PFerrno = PFE_FD);
+	}
+	if (PFinvalidPagenum(fd,pagenum)){
+		PFunlock();
+		return(PFerrno = PFE_INVALIDPAGE);
+	}
+	error = PFbufPin(fd,pagenum,&bpage,PFreadfcn,PFwritefcn);
+	while (error == PFE_NOBUF && PFlatched == 0 && PFwaitBuf(&deadline))
+		error = PFbufPin(fd,pagenum,&bpage,PFreadfcn,PFwritefcn);
+	if (error != PFE_OK){
+		PFunlock();
+		return(error);
+	}
+	if (bpage->fpage.nextfree != PF_PAGE_USED){
+		/* invalid page */
+		PFbufUnpin(fd,pagenum,FALSE);
+		PFunlock();
+		return(PFerrno = PFE_INVALIDPAGE);
+	}
+	PFstats.logical_reads++;
+	PFunlock();
+
+	/* wait for the latch outside the mutex */
+	if (exclusive)
+		pthread_rwlock_wrlock(&PFlatch[bpage->slot]);
+	else	pthread_rwlock_rdlock(&PFlatch[bpage->slot]);
+	PFlatched++;
+	*pagebuf = bpage->fpage.pagebuf;
+	return(PFE_OK);
+}
+
+PF_UnlatchPage(fd,pagenum,dirty)
+int fd;		/* file descriptor */
+int pagenum;	/* page number */
+int dirty;	/* TRUE if the page was modified */
+/****************************************************************************
+SPECIFICATIONS:
+	Release the latch PF_LatchPage took on page "pagenum" of file
+	"fd" and unpin the page. Set "dirty" to TRUE if the page has
+	been modified under an exclusive latch.
+
+RETURN VALUE:
+	PFE_OK	if no error.
+	PF error code if error.
+*****************************************************************************/
+{
+PFbpage *bpage;
+int error;
+
+	PFlock();
+	if (PFinvalidFd(fd)){
+		PFunlock();
+		return(PFerrno = PFE_FD);
+	}
+	if ((bpage=PFhashFind(fd,pagenum)) == NULL || bpage->pins == 0){
+		PFunlock();
+		return(PFerrno = PFE_PAGEUNFIXED);
+	}
+	PFunlock();
+
+	/* the pin keeps bpage in place until PFbufUnpin */
+	pthread_rwlock_unlock(&PFlatch[bpage->slot]);
+	PFlatched--;
+
+	PFlock();
+	if (dirty)
+		PFstats.logical_writes++;
+	error = PFbufUnpin(fd,pagenum,dirty);
+	if (PFthreaded) pthread_cond_broadcast(&PFunpinned);
+	PFunlock();
+	return(error);
+}
+
 /* New APIs */
 int PF_SetReplPolicy(int fd, int policy) {
 	if (fd < 0 || fd >= PF_FTAB_SIZE || PFftab[fd].fname == NULL)
@@ -778,6 +1023,43 @@ int PF_GetReplPolicy(int fd) {
 	return PFftab[fd].repl_policy;
 }
 
+/* Serial number of the open behind fd: layers above that keep per-fd state
+   use it to notice the fd was closed and reopened on another file. */
+int PF_FileSerial(int fd) {
+	if (fd < 0 || fd >= PF_FTAB_SIZE || PFftab[fd].fname == NULL)
+		return (PFerrno = PFE_FD);
+	return PFftab[fd].serial;
+}
+
+/* Hint that pagenum of fd will be read soon: the OS starts reading it in
+   the background so that the PF_GetThisPage to come does not wait on the
+   disk. Pages already in the buffer pool are skipped; nothing is fixed. */
+int PF_PrefetchPage(int fd, int pagenum) {
+	int unixfd;
+
+	PFlock();
+	if (PFinvalidFd(fd)) {
+		PFunlock();
+		return (PFerrno = PFE_FD);
+	}
+	if (PFinvalidPagenum(fd,pagenum)) {
+		PFunlock();
+		return (PFerrno = PFE_INVALIDPAGE);
+	}
+	if (PFhashFind(fd, pagenum) != NULL) {
+		PFunlock();
+		return PFE_OK;
+	}
+	unixfd = PFftab[fd].unixfd;
+	PFunlock();
+#ifdef POSIX_FADV_WILLNEED
+	posix_fadvise(unixfd,
+		(off_t)pagenum*sizeof(PFfpage)+PF_HDR_SIZE,
+		(off_t)sizeof(PFfpage), POSIX_FADV_WILLNEED);
+#endif
+	return PFE_OK;
+}
+
 int PF_SetBufferPoolSize(int n) {
 	if (n <= 0 || n > PF_MAX_BUFS)
 		return (PFerrno = PFE_NOBUF);
@@ -787,12 +1069,17 @@ int PF_SetBufferPoolSize(int n) {
 
 int PF_MarkDirty(int fd, int pagenum) {
 	/* set dirty without reordering; page must be fixed or present */
-	PFbpage *b = PFhashFind(fd, pagenum);
+	PFbpage *b;
+
+	PFlock();
+	b = PFhashFind(fd, pagenum);
 	if (!b) {
+		PFunlock();
 		PFerrno = PFE_PAGENOTINBUF;
 		return PFerrno;
 	}
 	b->dirty = TRUE;
+	PFunlock();
 	/* Do not bump logical_writes here; it's accounted on Unfix/Alloc/Dispose */
 	return PFE_OK;
 }
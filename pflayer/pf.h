@@ -49,7 +49,7 @@ typedef struct PFStats {
 } PFStats;
 
 /* externs from the PF layer */
-extern int PFerrno;		/* error number of last error */
+extern __thread int PFerrno;	/* error number of last error, per thread */
 extern void PF_Init();
 extern void PF_PrintError();
 
@@ -58,6 +58,18 @@ extern int PF_SetReplPolicy(int fd, int policy);
 extern int PF_GetReplPolicy(int fd);
 extern int PF_SetBufferPoolSize(int n);
 extern int PF_MarkDirty(int fd, int pagenum);
+extern int PF_FileSerial(int fd);
+extern int PF_PrefetchPage(int fd, int pagenum);
+
+/* Threaded use: a pool mutex, and page latches held across calls. A page
+   can be fixed by one caller at a time, so PF_GetThisPage must not be
+   called on a page that other threads may hold under a shared latch: the
+   second reader would get PFE_PAGEFIXED. Read such pages with
+   PF_LatchPage(fd, page, &buf, FALSE); only the holder of an exclusive
+   latch may also fix its page. */
+extern void PF_SetThreaded();
+extern int PF_LatchPage();
+extern int PF_UnlatchPage();
 
 /* Global default replacement policy (applies to subsequently opened files) */
 extern int PF_SetDefaultReplPolicy(int policy);
@@ -32,6 +32,7 @@ typedef struct PFftab_ele {
 	PFhdr_str hdr;	/* file header */
 	short hdrchanged; /* TRUE if file header has changed */
 	short repl_policy; /* replacement policy: PF_REPL_LRU (default) or PF_REPL_MRU */
+	int serial;	/* numbers each open, so a reused fd can be told apart */
 } PFftab_ele;
 
 /************************** Buffer Page Decls *********************/
@@ -48,6 +49,9 @@ typedef struct PFbpage {
 					of buffer pages */
 	unsigned short dirty:1,		/* TRUE if page is dirty */
 		fixed:1;		/* TRUE if page is fixed in buffer*/
+	short	pins;			/* # of PF_LatchPage holders; a pinned
+					page is never replaced */
+	short	slot;			/* index of this buffer's latch in pf.c */
 	int	page;			/* page number of this page */
 	int	fd;			/* file desciptor of this page */
 	PFfpage fpage; /* page data from the file */
@@ -82,3 +86,5 @@ extern int PFbufGet();
 extern int PFbufUnfix();
 extern int PFbufAlloc();
 extern int PFbufReleaseFile();
+extern int PFbufPin();
+extern int PFbufUnpin();
@@ -5,24 +5,112 @@
 #include "pftypes.h"
 #include "slotted.h"
 
-#define SP_MAGIC 0x53504631u /* 'SPF1' */
+#define SP_MAGIC 0x53504632u /* 'SPF2' */
+#define SP_PAX_MAGIC 0x53505831u /* 'SPX1' */
+#define SP_ZMAGIC 0x53505a32u /* 'SPZ2' */
+#define SP_OMAGIC 0x53504f31u /* 'SPO1' */
 
+/* row pages written before the header grew (see sp_upgrade_page) */
+#define SP_MAGIC_V1 0x53504631u /* 'SPF1' */
+#define SP_ZMAGIC_V1 0x53505a31u /* 'SPZ1' */
 typedef struct {
     unsigned long magic;
     unsigned short free_off;
     unsigned short free_bytes;
     unsigned short nslots;
     unsigned short _pad;
+} SP_PageHdrV1;
+
+typedef struct {
+    unsigned long magic;
+    unsigned short free_off;
+    unsigned short free_bytes;  /* contiguous gap between free_off and the slot directory */
+    unsigned short nslots;
+    unsigned short frag_bytes;  /* bytes held by deleted records, reclaimed by sp_compact */
+    unsigned short free_slot;   /* head of the dead-slot list, SP_NOSLOT if empty */
+    unsigned short _pad;
 } SP_PageHdr;
 
+/* A dead slot has len 0 and its off holds the next dead slot in the list.
+   The top bits of len flag records moved by SP_Update: the home slot keeps
+   a forwarding stub (SP_SLOT_FWD) naming the slot of the moved copy
+   (SP_SLOT_MOVED), so the RID handed out by SP_Insert stays valid. */
 typedef struct {
     unsigned short off;
     unsigned short len;
 } SP_Slot;
 
+#define SP_NOSLOT 0xFFFF
+#define SP_SLOT_FWD 0x8000
+#define SP_SLOT_MOVED 0x4000
+#define SP_LEN_MASK 0x1FFF
+#define SP_LEN(s) ((s)->len & SP_LEN_MASK)
+#define SP_STUB_SIZE 6      /* forwarding stub: page int32, slot u16 */
+
+/* A record with a note ends in a note trailer: len(u32) page(int32) and the
+   first bytes of the note. Records whose encoding would pass SP_INLINE_MAX
+   keep only SP_OVF_PREFIX note bytes inline; the rest lives in a chain of
+   overflow pages starting at page (-1 when the whole note is inline). */
+#define SP_NOTE_HDR 8
+#define SP_INLINE_MAX 1024
+#define SP_OVF_PREFIX 128
+
+typedef struct { long len; int page; int inl; const char *data; } SP_NoteRef;
+
+/* overflow page: header then up to SP_OVF_DATA note bytes */
+typedef struct {
+    unsigned long magic;
+    int next;               /* next overflow page, -1 at the end of the chain */
+    unsigned short used;
+    unsigned short _pad;
+} SP_OvfHdr;
+
+#define SP_OVF_DATA (PF_PAGE_SIZE - (int)sizeof(SP_OvfHdr))
+
 #define SP_HDR_SIZE ((int)sizeof(SP_PageHdr))
 #define SP_SLOT_SIZE ((int)sizeof(SP_Slot))
 
+/* Compressed row pages ('SPZ1') reserve a dictionary area right after the
+   header: ndict, used, then entries of [len u8][bytes]. Entry 0 is the
+   front-coding base (the first name stored on the page, truncated to
+   SP_FRONT_MAX); the others hold dept/level strings, referenced from records
+   by their entry number. A compressed record is
+     roll(int32) | lcp(u8) sfxlen(u8, or 0xFF + u16) suffix | dept | level
+   where dept/level are a dictionary code (u8), or SP_DICT_LIT + u16 length +
+   bytes when the string is not in the page dictionary. */
+#define SP_DICT_SIZE 96
+#define SP_DICT_LIT 0xFF
+#define SP_FRONT_MAX 32
+#define SP_ZREC_SLACK 4 /* most a compressed record outgrows its plain encoding */
+#define SP_DATA_START(pagebuf) (SP_HDR_SIZE + (sp_hdr(pagebuf)->magic == SP_ZMAGIC ? SP_DICT_SIZE : 0))
+
+/* PAX page: the header is followed by one minipage per column, each holding
+   cap entries: roll[cap] (int32), then offset[cap] (u16) for each
+   variable-length column (name, dept, level), then length[cap] (u8) for each
+   of them, then live[cap] (u8). Strings longer than 255 bytes do not fit.
+   The string bytes live in a heap that grows down from the end of the page. */
+typedef struct {
+    unsigned long magic;
+    unsigned short cap;      /* records the minipages are sized for; 0 = not sized yet */
+    unsigned short nslots;   /* slots handed out so far (<= cap) */
+    unsigned short nlive;    /* live records */
+    unsigned short heap_off; /* start of the string heap */
+    unsigned short garbage;  /* heap bytes owned by deleted records */
+    unsigned short _pad;
+} SP_PaxHdr;
+
+#define SP_PAX_HDR_SIZE ((int)sizeof(SP_PaxHdr))
+#define SP_PAX_NVAR 3       /* variable-length columns */
+#define SP_PAX_NAME 0
+#define SP_PAX_DEPT 1
+#define SP_PAX_LEVEL 2
+#define SP_PAX_FIXED (4 + SP_PAX_NVAR*3 + 1) /* minipage bytes per record */
+#define SP_PAX_MAXSTR 255
+#define SP_PAX_MAXCAP ((PF_PAGE_SIZE - SP_PAX_HDR_SIZE) / (SP_PAX_FIXED + 1))
+
+/* per open file: format and running string-size average used to size PAX minipages */
+static struct { int fmt; long recs; long varbytes; } sp_ftab[PF_FTAB_SIZE];
+
 static SP_PageHdr *sp_hdr(char *pagebuf){ return (SP_PageHdr*)pagebuf; }
 static SP_Slot *sp_slot(char *pagebuf, int idx){
     /* fixed slot address independent of nslots */
@@ -35,38 +123,240 @@ static void sp_init_page(char *pagebuf){
     h->free_off = (unsigned short)SP_HDR_SIZE;
     h->nslots = 0;
     h->free_bytes = (unsigned short)(PF_PAGE_SIZE - SP_HDR_SIZE);
+    h->frag_bytes = 0;
+    h->free_slot = SP_NOSLOT;
     h->_pad = 0;
 }
 
+static void sp_init_zpage(char *pagebuf){
+    SP_PageHdr *h = sp_hdr(pagebuf);
+    sp_init_page(pagebuf);
+    h->magic = SP_ZMAGIC;
+    h->free_off = (unsigned short)(SP_HDR_SIZE + SP_DICT_SIZE);
+    h->free_bytes = (unsigned short)(PF_PAGE_SIZE - SP_HDR_SIZE - SP_DICT_SIZE);
+    memset(pagebuf + SP_HDR_SIZE, 0, SP_DICT_SIZE);
+}
+
+static int sp_is_row(char *pagebuf){ unsigned long m = sp_hdr(pagebuf)->magic; return m == SP_MAGIC || m == SP_ZMAGIC; }
+
+/* bytes an insert of rlen needs on this page, counting a new directory
+   entry only when there is no dead slot to reuse */
+static int sp_row_need(char *pagebuf, int rlen){
+    return rlen + (sp_hdr(pagebuf)->free_slot == SP_NOSLOT ? SP_SLOT_SIZE : 0);
+}
+
+static int sp_row_room(char *pagebuf){ SP_PageHdr *h = sp_hdr(pagebuf); return h->free_bytes + h->frag_bytes; }
+
+/* pop a dead slot, or grow the directory; caller has made the space */
 static int sp_ensure_slot(char *pagebuf){
     SP_PageHdr *h = sp_hdr(pagebuf);
-    int i;
-    for (i=0;i<h->nslots;i++){
-        SP_Slot *s = sp_slot(pagebuf, i);
-        if (s->len == 0) return i;
+    SP_Slot *ns;
+    if (h->free_slot != SP_NOSLOT){
+        int i = h->free_slot;
+        h->free_slot = sp_slot(pagebuf, i)->off;
+        return i;
     }
     if (h->free_bytes < SP_SLOT_SIZE) return -1;
     h->free_bytes -= SP_SLOT_SIZE;
-    /* zero-initialize the new slot */
-    {
-        SP_Slot *ns = sp_slot(pagebuf, h->nslots);
-        ns->off = 0; ns->len = 0;
-    }
+    ns = sp_slot(pagebuf, h->nslots);
+    ns->off = 0; ns->len = 0;
     h->nslots++;
     return h->nslots - 1;
 }
 
+/* Mark slot i dead. Only the record at the top of the data area is given
+   back to the gap directly; anything else becomes fragmented space. */
+static void sp_drop_bytes(char *pagebuf, SP_Slot *s){
+    SP_PageHdr *h = sp_hdr(pagebuf); int len = SP_LEN(s);
+    if (s->off + len == h->free_off){ h->free_off -= len; h->free_bytes += len; }
+    else h->frag_bytes += len;
+    s->len = 0;
+}
+
+static void sp_kill_slot(char *pagebuf, int i){
+    SP_PageHdr *h = sp_hdr(pagebuf);
+    SP_Slot *s = sp_slot(pagebuf, i);
+    sp_drop_bytes(pagebuf, s);
+    s->off = h->free_slot; h->free_slot = (unsigned short)i;
+}
+
+/* Slide live records down over the holes. Records are moved in address
+   order since reused slots need not be in address order. */
 static void sp_compact(char *pagebuf){
+    static unsigned short order[PF_PAGE_SIZE / sizeof(SP_Slot)];
     SP_PageHdr *h = sp_hdr(pagebuf);
-    int i; unsigned short off = (unsigned short)SP_HDR_SIZE;
+    int i, j, n = 0; unsigned short off = (unsigned short)SP_DATA_START(pagebuf);
     for (i=0;i<h->nslots;i++){
-        SP_Slot *s = sp_slot(pagebuf, i);
-        if (s->len == 0) continue;
-        if (s->off != off){ memmove(pagebuf + off, pagebuf + s->off, s->len); s->off = off; }
-        off += s->len;
+        unsigned short so;
+        if (sp_slot(pagebuf, i)->len == 0) continue;
+        so = sp_slot(pagebuf, i)->off;
+        for (j=n; j>0 && sp_slot(pagebuf, order[j-1])->off > so; j--) order[j] = order[j-1];
+        order[j] = (unsigned short)i; n++;
+    }
+    for (j=0;j<n;j++){
+        SP_Slot *s = sp_slot(pagebuf, order[j]);
+        if (s->off != off){ memmove(pagebuf + off, pagebuf + s->off, SP_LEN(s)); s->off = off; }
+        off += SP_LEN(s);
     }
     h->free_off = off;
     h->free_bytes = (unsigned short)(PF_PAGE_SIZE - off - h->nslots*SP_SLOT_SIZE);
+    h->frag_bytes = 0;
+}
+
+/* whether a version 1 row page has room for the current, bigger header */
+static int sp_upgrade_fits(char *pagebuf){
+    SP_PageHdrV1 *oh = (SP_PageHdrV1*)pagebuf; int i, live = 0;
+    for (i=0;i<oh->nslots;i++) live += sp_slot(pagebuf, i)->len;
+    return SP_HDR_SIZE + (oh->magic == SP_ZMAGIC_V1 ? SP_DICT_SIZE : 0) + live + oh->nslots*SP_SLOT_SIZE <= PF_PAGE_SIZE;
+}
+
+/* Rewrite a version 1 row page that sp_upgrade_fits in the current layout:
+   the dictionary (if any) moves up behind the bigger header, live records
+   are packed after it and dead slots go on the free list. Slot numbers do
+   not change. */
+static void sp_upgrade_page(char *pagebuf){
+    static char tmp[PF_PAGE_SIZE];
+    SP_PageHdrV1 *oh = (SP_PageHdrV1*)tmp; SP_PageHdr *h = sp_hdr(pagebuf);
+    int z, i;
+    memcpy(tmp, pagebuf, PF_PAGE_SIZE);
+    z = oh->magic == SP_ZMAGIC_V1;
+    if (z){ sp_init_zpage(pagebuf); memcpy(pagebuf + SP_HDR_SIZE, tmp + (int)sizeof(SP_PageHdrV1), SP_DICT_SIZE); }
+    else sp_init_page(pagebuf);
+    h->nslots = oh->nslots; h->free_bytes -= (unsigned short)(oh->nslots*SP_SLOT_SIZE);
+    for (i=oh->nslots-1;i>=0;i--){
+        SP_Slot *os = sp_slot(tmp, i), *s = sp_slot(pagebuf, i);
+        if (os->len == 0){ s->len = 0; s->off = h->free_slot; h->free_slot = (unsigned short)i; continue; }
+        memcpy(pagebuf + h->free_off, tmp + os->off, os->len);
+        s->off = h->free_off; s->len = os->len;
+        h->free_off += os->len; h->free_bytes -= os->len;
+    }
+}
+
+static SP_PaxHdr *sp_pax_hdr(char *pagebuf){ return (SP_PaxHdr*)pagebuf; }
+static int *sp_pax_roll(char *pagebuf){ return (int*)(pagebuf + SP_PAX_HDR_SIZE); }
+static unsigned short *sp_pax_off(char *pagebuf, int col){
+    int cap = sp_pax_hdr(pagebuf)->cap;
+    return (unsigned short*)(pagebuf + SP_PAX_HDR_SIZE + 4*cap + col*2*cap);
+}
+static unsigned char *sp_pax_len(char *pagebuf, int col){
+    int cap = sp_pax_hdr(pagebuf)->cap;
+    return (unsigned char*)(pagebuf + SP_PAX_HDR_SIZE + (4 + SP_PAX_NVAR*2)*cap + col*cap);
+}
+static unsigned char *sp_pax_live(char *pagebuf){
+    int cap = sp_pax_hdr(pagebuf)->cap;
+    return (unsigned char*)(pagebuf + SP_PAX_HDR_SIZE + (4 + SP_PAX_NVAR*3)*cap);
+}
+static int sp_pax_heap_free(char *pagebuf){
+    SP_PaxHdr *h = sp_pax_hdr(pagebuf);
+    return h->heap_off - (SP_PAX_HDR_SIZE + SP_PAX_FIXED*h->cap);
+}
+
+static void sp_pax_init_page(char *pagebuf){
+    SP_PaxHdr *h = sp_pax_hdr(pagebuf);
+    h->magic = SP_PAX_MAGIC;
+    h->cap = 0; h->nslots = 0; h->nlive = 0; h->garbage = 0; h->_pad = 0;
+    h->heap_off = (unsigned short)PF_PAGE_SIZE;
+}
+
+/* size the minipages of an empty PAX page for records averaging avg string bytes */
+static void sp_pax_size_page(char *pagebuf, int avg){
+    int cap = (PF_PAGE_SIZE - SP_PAX_HDR_SIZE) / (SP_PAX_FIXED + (avg > 0 ? avg : 1));
+    if (cap < 1) cap = 1;
+    if (cap > SP_PAX_MAXCAP) cap = SP_PAX_MAXCAP;
+    sp_pax_hdr(pagebuf)->cap = (unsigned short)cap;
+}
+
+/* repack the string heap so the bytes of deleted records become free again */
+static void sp_pax_compact(char *pagebuf){
+    SP_PaxHdr *h = sp_pax_hdr(pagebuf);
+    char tmp[PF_PAGE_SIZE];
+    unsigned char *live = sp_pax_live(pagebuf);
+    int i, c; unsigned short off = (unsigned short)PF_PAGE_SIZE;
+    for (i=0;i<h->nslots;i++){
+        if (!live[i]) continue;
+        for (c=0;c<SP_PAX_NVAR;c++){
+            unsigned short *o = sp_pax_off(pagebuf, c); unsigned char *l = sp_pax_len(pagebuf, c);
+            off -= l[i]; memcpy(tmp + off, pagebuf + o[i], l[i]); o[i] = off;
+        }
+    }
+    memcpy(pagebuf + off, tmp + off, PF_PAGE_SIZE - off);
+    h->heap_off = off; h->garbage = 0;
+}
+
+static int sp_pax_fits(char *pagebuf, int varlen){
+    SP_PaxHdr *h = sp_pax_hdr(pagebuf);
+    if (h->cap == 0 || h->nlive == 0) return 1;   /* sp_pax_insert can lay it out again */
+    if (h->nslots >= h->cap && h->nlive >= h->nslots) return 0;
+    return sp_pax_heap_free(pagebuf) + h->garbage >= varlen;
+}
+
+/* place r on a PAX page; returns the slot or -1 if it does not fit. A page
+   is sized for at least r's own strings, so r always fits a page without
+   live records: one laid out for smaller records is laid out again */
+static int sp_pax_insert(char *pagebuf, const SP_Record *r, int avg){
+    SP_PaxHdr *h = sp_pax_hdr(pagebuf);
+    const char *v[SP_PAX_NVAR]; int vl[SP_PAX_NVAR]; int c, var = 0, slot;
+    unsigned char *live;
+    v[SP_PAX_NAME] = r->name; v[SP_PAX_DEPT] = r->dept; v[SP_PAX_LEVEL] = r->level;
+    for (c=0;c<SP_PAX_NVAR;c++){ vl[c] = v[c] ? (int)strlen(v[c]) : 0; if (vl[c] > SP_PAX_MAXSTR) return -1; var += vl[c]; }
+    if (h->cap != 0 && h->nlive == 0 && sp_pax_heap_free(pagebuf) + h->garbage < var) sp_pax_init_page(pagebuf);
+    if (h->cap == 0) sp_pax_size_page(pagebuf, avg > var ? avg : var);
+    live = sp_pax_live(pagebuf);
+    if (h->nslots < h->cap) slot = h->nslots;
+    else { unsigned char *d = (unsigned char*)memchr(live, 0, h->nslots); if (!d) return -1; slot = (int)(d - live); }
+    if (sp_pax_heap_free(pagebuf) < var){
+        if (sp_pax_heap_free(pagebuf) + h->garbage < var) return -1;
+        sp_pax_compact(pagebuf);
+    }
+    for (c=0;c<SP_PAX_NVAR;c++){
+        h->heap_off -= (unsigned short)vl[c];
+        if (vl[c]) memcpy(pagebuf + h->heap_off, v[c], vl[c]);
+        sp_pax_off(pagebuf, c)[slot] = h->heap_off; sp_pax_len(pagebuf, c)[slot] = (unsigned char)vl[c];
+    }
+    sp_pax_roll(pagebuf)[slot] = (int)r->roll_no;
+    live[slot] = 1;
+    if (slot == h->nslots) h->nslots++;
+    h->nlive++;
+    return slot;
+}
+
+/* rewrite a live PAX slot: strings that shrink are overwritten in place,
+   the others are re-appended to the heap. PAX pages have no forwarding, so
+   this fails (-1, page untouched) if the new strings do not fit the page. */
+static int sp_pax_update(char *pagebuf, int slot, const SP_Record *r){
+    SP_PaxHdr *h = sp_pax_hdr(pagebuf);
+    const char *v[SP_PAX_NVAR]; int vl[SP_PAX_NVAR]; int c, var = 0, old = 0, grow = 0;
+    v[SP_PAX_NAME] = r->name; v[SP_PAX_DEPT] = r->dept; v[SP_PAX_LEVEL] = r->level;
+    for (c=0;c<SP_PAX_NVAR;c++){ vl[c] = v[c] ? (int)strlen(v[c]) : 0; if (vl[c] > SP_PAX_MAXSTR) return -1; var += vl[c]; old += sp_pax_len(pagebuf, c)[slot]; }
+    if (sp_pax_heap_free(pagebuf) + h->garbage + old < var) return -1;
+    for (c=0;c<SP_PAX_NVAR;c++){
+        unsigned char *l = &sp_pax_len(pagebuf, c)[slot];
+        h->garbage += *l;
+        if (vl[c] <= *l){ if (vl[c]) memmove(pagebuf + sp_pax_off(pagebuf, c)[slot], v[c], vl[c]); h->garbage -= vl[c]; *l = (unsigned char)vl[c]; vl[c] = -1; }
+        else { *l = 0; grow += vl[c]; }
+    }
+    if (sp_pax_heap_free(pagebuf) < grow) sp_pax_compact(pagebuf);
+    for (c=0;c<SP_PAX_NVAR;c++){
+        if (vl[c] < 0) continue;
+        h->heap_off -= (unsigned short)vl[c];
+        memcpy(pagebuf + h->heap_off, v[c], vl[c]);
+        sp_pax_off(pagebuf, c)[slot] = h->heap_off; sp_pax_len(pagebuf, c)[slot] = (unsigned char)vl[c];
+    }
+    sp_pax_roll(pagebuf)[slot] = (int)r->roll_no;
+    return 0;
+}
+
+static int sp_pax_get(char *pagebuf, int slot, SP_Record *out, char *buf, int cap){
+    const char **dst[SP_PAX_NVAR]; int c;
+    dst[SP_PAX_NAME] = &out->name; dst[SP_PAX_DEPT] = &out->dept; dst[SP_PAX_LEVEL] = &out->level;
+    out->roll_no = sp_pax_roll(pagebuf)[slot];
+    for (c=0;c<SP_PAX_NVAR;c++){
+        int len = sp_pax_len(pagebuf, c)[slot];
+        if (len+1 > cap) return -1;
+        memcpy(buf, pagebuf + sp_pax_off(pagebuf, c)[slot], len); buf[len] = '\0';
+        *dst[c] = buf; buf += len+1; cap -= len+1;
+    }
+    return 0;
 }
 
 static int sp_serialize(const SP_Record *r, char *dst, int cap){
@@ -89,91 +379,744 @@ static int sp_serialize(const SP_Record *r, char *dst, int cap){
     return need;
 }
 
+/* decodes the fixed fields; returns the bytes consumed or -1 */
 static int sp_deserialize(const char *src, int len, SP_Record *out, char *buf, int cap){
     unsigned short nlen, dlen, llen; int off;
     if (len < 4+2+2+2) return -1;
-    off=0; memcpy(&out->roll_no, src+off, 4); off+=4;
+    off=0; { int rn; memcpy(&rn, src+off, 4); out->roll_no = rn; } off+=4;
     memcpy(&nlen, src+off, 2); off+=2; if (nlen+1 > cap) return -1; memcpy(buf, src+off, nlen); buf[nlen]='\0'; out->name = buf; off+=nlen; buf+=nlen+1; cap-=nlen+1;
     memcpy(&dlen, src+off, 2); off+=2; if (dlen+1 > cap) return -1; memcpy(buf, src+off, dlen); buf[dlen]='\0'; out->dept = buf; off+=dlen; buf+=dlen+1; cap-=dlen+1;
-    memcpy(&llen, src+off, 2); off+=2; if (llen+1 > cap) return -1; memcpy(buf, src+off, llen); buf[llen]='\0'; out->level = buf; (void)off;
+    memcpy(&llen, src+off, 2); off+=2; if (llen+1 > cap) return -1; memcpy(buf, src+off, llen); buf[llen]='\0'; out->level = buf; off+=llen;
+    return off;
+}
+
+/* dictionary entry i of a compressed page; returns its length */
+static int sp_dict_entry(char *pagebuf, int idx, const char **str){
+    unsigned char *d = (unsigned char*)pagebuf + SP_HDR_SIZE + 2;
+    int i;
+    for (i=0;i<idx;i++) d += 1 + d[0];
+    *str = (const char*)d + 1;
+    return d[0];
+}
+
+/* code for s in the page dictionary, adding it if it fits; SP_DICT_LIT if
+   it is not (and cannot be) in the dictionary */
+static int sp_dict_code(char *pagebuf, const char *s, int len){
+    unsigned char *nd = (unsigned char*)pagebuf + SP_HDR_SIZE, *used = nd + 1;
+    unsigned char *d = nd + 2;
+    int i;
+    for (i=1;i<nd[0];i++){
+        const char *e; int elen = sp_dict_entry(pagebuf, i, &e);
+        if (elen == len && memcmp(e, s, len) == 0) return i;
+    }
+    if (nd[0] == 0 || nd[0] >= SP_DICT_LIT || *used + 1 + len > SP_DICT_SIZE - 2) return SP_DICT_LIT;
+    d[*used] = (unsigned char)len; memcpy(d + *used + 1, s, len); *used += (unsigned char)(1 + len);
+    return nd[0]++;
+}
+
+static int sp_zput_len(char *dst, int len){
+    unsigned short t;
+    if (len < 0xFF){ if (dst) dst[0] = (char)len; return 1; }
+    if (dst){ dst[0] = (char)0xFF; t = (unsigned short)len; memcpy(dst+1, &t, 2); }
+    return 3;
+}
+
+static int sp_zput_str(char *pagebuf, char *dst, const char *s){
+    int len = s ? (int)strlen(s) : 0;
+    int code = sp_dict_code(pagebuf, s ? s : "", len);
+    unsigned short t;
+    if (code != SP_DICT_LIT){ if (dst) dst[0] = (char)code; return 1; }
+    if (dst){ dst[0] = (char)SP_DICT_LIT; t = (unsigned short)len; memcpy(dst+1, &t, 2); if (len) memcpy(dst+3, s, len); }
+    return 3 + len;
+}
+
+/* Size of r encoded for this compressed page (dst == NULL), or encode it into
+   dst, adding any new dictionary entries. The sizing pass runs against a copy
+   of the dictionary so that both passes make exactly the same choices. */
+static int sp_zserialize(char *pagebuf, const SP_Record *r, char *dst){
+    char tmp[SP_HDR_SIZE + SP_DICT_SIZE];
+    unsigned char *nd;
+    int nlen = r->name ? (int)strlen(r->name) : 0;
+    int off, lcp = 0, blen;
+    const char *base;
+    if (!dst){ memcpy(tmp, pagebuf, sizeof(tmp)); pagebuf = tmp; }
+    nd = (unsigned char*)pagebuf + SP_HDR_SIZE;
+    if (nd[0] == 0){
+        /* first record on the page: its name becomes the front-coding base */
+        unsigned char *d = nd + 2;
+        blen = nlen < SP_FRONT_MAX ? nlen : SP_FRONT_MAX;
+        d[0] = (unsigned char)blen; if (blen) memcpy(d+1, r->name, blen); nd[1] = (unsigned char)(1 + blen); nd[0] = 1;
+        lcp = blen;
+    }
+    else {
+        blen = sp_dict_entry(pagebuf, 0, &base);
+        while (lcp < blen && lcp < nlen && base[lcp] == r->name[lcp]) lcp++;
+    }
+    if (dst){ int rn = (int)r->roll_no; memcpy(dst, &rn, 4); dst[4] = (char)lcp; }
+    off = 5;
+    off += sp_zput_len(dst ? dst + off : NULL, nlen - lcp);
+    if (dst && nlen > lcp) memcpy(dst + off, r->name + lcp, nlen - lcp);
+    off += nlen - lcp;
+    off += sp_zput_str(pagebuf, dst ? dst + off : NULL, r->dept);
+    off += sp_zput_str(pagebuf, dst ? dst + off : NULL, r->level);
+    return off;
+}
+
+/* decode one dept/level field at src into buf; returns bytes consumed or -1 */
+static int sp_zget_str(char *pagebuf, const char *src, const char **out, char **buf, int *cap){
+    const char *s; int len, used;
+    unsigned char code = (unsigned char)src[0];
+    if (code == SP_DICT_LIT){ unsigned short t; memcpy(&t, src+1, 2); len = t; s = src + 3; used = 3 + len; }
+    else { len = sp_dict_entry(pagebuf, code, &s); used = 1; }
+    if (len+1 > *cap) return -1;
+    memcpy(*buf, s, len); (*buf)[len] = '\0'; *out = *buf; *buf += len+1; *cap -= len+1;
+    return used;
+}
+
+static int sp_zdeserialize(char *pagebuf, const char *src, SP_Record *out, char *buf, int cap){
+    const char *base; int lcp, sfx, off, n;
+    { int rn; memcpy(&rn, src, 4); out->roll_no = rn; }
+    lcp = (unsigned char)src[4]; off = 5;
+    if ((unsigned char)src[off] == 0xFF){ unsigned short t; memcpy(&t, src+off+1, 2); sfx = t; off += 3; } else sfx = (unsigned char)src[off++];
+    if (lcp + sfx + 1 > cap) return -1;
+    sp_dict_entry(pagebuf, 0, &base);
+    memcpy(buf, base, lcp); memcpy(buf + lcp, src + off, sfx); buf[lcp+sfx] = '\0';
+    out->name = buf; buf += lcp+sfx+1; cap -= lcp+sfx+1; off += sfx;
+    if ((n = sp_zget_str(pagebuf, src + off, &out->dept, &buf, &cap)) < 0) return -1;
+    off += n;
+    if ((n = sp_zget_str(pagebuf, src + off, &out->level, &buf, &cap)) < 0) return -1;
+    return off + n;
+}
+
+static int sp_note_size(const SP_NoteRef *nr){ return (nr && nr->len > 0) ? SP_NOTE_HDR + nr->inl : 0; }
+
+static void sp_note_write(const SP_NoteRef *nr, char *dst){
+    unsigned int len; int pg;
+    if (!nr || nr->len <= 0) return;
+    len = (unsigned int)nr->len; pg = nr->page;
+    memcpy(dst, &len, 4); memcpy(dst+4, &pg, 4); if (nr->inl) memcpy(dst+SP_NOTE_HDR, nr->data, nr->inl);
+}
+
+/* record size / encode / decode for either row page flavour; the note
+   trailer (if any) follows the fixed fields in both */
+static int sp_rec_size(char *pagebuf, const SP_Record *r, const SP_NoteRef *nr){
+    return (sp_hdr(pagebuf)->magic == SP_ZMAGIC ? sp_zserialize(pagebuf, r, NULL) : sp_serialize(r, NULL, 0)) + sp_note_size(nr);
+}
+static void sp_rec_write(char *pagebuf, const SP_Record *r, const SP_NoteRef *nr, char *dst, int cap){
+    int n;
+    if (sp_hdr(pagebuf)->magic == SP_ZMAGIC) n = sp_zserialize(pagebuf, r, dst); else n = sp_serialize(r, dst, cap);
+    sp_note_write(nr, dst + n);
+}
+
+/* note trailer of the record in slot s: fills nr, returns the inline bytes */
+static const char *sp_note_find(char *pagebuf, SP_Slot *s, int fixed, SP_NoteRef *nr){
+    const char *t = pagebuf + s->off + fixed; unsigned int len;
+    nr->len = 0; nr->page = -1; nr->inl = 0; nr->data = NULL;
+    if (SP_LEN(s) - fixed < SP_NOTE_HDR) return NULL;
+    memcpy(&len, t, 4); memcpy(&nr->page, t+4, 4);
+    nr->len = (long)len; nr->inl = SP_LEN(s) - fixed - SP_NOTE_HDR; nr->data = t + SP_NOTE_HDR;
+    return nr->data;
+}
+
+/* the fixed fields only; a note is read with SP_NoteOpen/SP_NoteRead */
+static int sp_rec_read(char *pagebuf, SP_Slot *s, SP_Record *out, char *buf, int cap){
+    int fixed;
+    if (sp_hdr(pagebuf)->magic == SP_ZMAGIC) fixed = sp_zdeserialize(pagebuf, pagebuf + s->off, out, buf, cap);
+    else fixed = sp_deserialize(pagebuf + s->off, SP_LEN(s), out, buf, cap);
+    return fixed < 0 ? -1 : 0;
+}
+
+/* fixed-field length of the record in slot s (for finding its trailer) */
+static int sp_rec_fixed(char *pagebuf, SP_Slot *s){
+    static char tmp[PF_PAGE_SIZE]; SP_Record r;
+    if (sp_hdr(pagebuf)->magic == SP_ZMAGIC) return sp_zdeserialize(pagebuf, pagebuf + s->off, &r, tmp, sizeof(tmp));
+    return sp_deserialize(pagebuf + s->off, SP_LEN(s), &r, tmp, sizeof(tmp));
+}
+
+/* first overflow page of the record in slot s, -1 if none */
+static int sp_rec_ovf(char *pagebuf, SP_Slot *s){
+    SP_NoteRef nr; int fixed = sp_rec_fixed(pagebuf, s);
+    if (fixed < 0 || (s->len & SP_SLOT_FWD)) return -1;
+    sp_note_find(pagebuf, s, fixed, &nr);
+    return nr.len > 0 ? nr.page : -1;
+}
+
+/* write len bytes of data to a fresh chain of overflow pages */
+static int sp_ovf_write(int fd, const char *data, long len, int *first){
+    int rc, pno, prev = -1; char *pbuf, *prevbuf = NULL; SP_OvfHdr *oh;
+    *first = -1;
+    while (len > 0){
+        int n = len > SP_OVF_DATA ? SP_OVF_DATA : (int)len;
+        if ((rc = PF_AllocPage(fd, &pno, &pbuf)) != PFE_OK){ if (prevbuf) PF_UnfixPage(fd, prev, TRUE); return rc; }
+        oh = (SP_OvfHdr*)pbuf; oh->magic = SP_OMAGIC; oh->next = -1; oh->used = (unsigned short)n; oh->_pad = 0;
+        memcpy(pbuf + sizeof(SP_OvfHdr), data, n);
+        if (prevbuf){ ((SP_OvfHdr*)prevbuf)->next = pno; if ((rc = PF_UnfixPage(fd, prev, TRUE)) != PFE_OK){ PF_UnfixPage(fd, pno, TRUE); return rc; } }
+        else *first = pno;
+        prev = pno; prevbuf = pbuf; data += n; len -= n;
+    }
+    return prevbuf ? PF_UnfixPage(fd, prev, TRUE) : PFE_OK;
+}
+
+static int sp_ovf_free(int fd, int pno){
+    int rc, next; char *pbuf;
+    while (pno >= 0){
+        if ((rc = PF_GetThisPage(fd, pno, &pbuf)) != PFE_OK) return rc;
+        next = ((SP_OvfHdr*)pbuf)->magic == SP_OMAGIC ? ((SP_OvfHdr*)pbuf)->next : -1;
+        if ((rc = PF_UnfixPage(fd, pno, FALSE)) != PFE_OK) return rc;
+        if ((rc = PF_DisposePage(fd, pno)) != PFE_OK) return rc;
+        pno = next;
+    }
+    return PFE_OK;
+}
+
+/* decide where r's note goes: inline, or a prefix inline and the rest in a
+   new overflow chain (which the caller frees if the insert then fails) */
+static int sp_note_prepare(int fd, const SP_Record *r, const char *note, long note_len, SP_NoteRef *nr){
+    nr->len = note ? note_len : 0; nr->page = -1; nr->inl = (int)nr->len; nr->data = note;
+    if (nr->len <= 0){ nr->len = 0; nr->inl = 0; return PFE_OK; }
+    if (sp_serialize(r, NULL, 0) + SP_NOTE_HDR + nr->len <= SP_INLINE_MAX) return PFE_OK;
+    nr->inl = SP_OVF_PREFIX;
+    return sp_ovf_write(fd, note + SP_OVF_PREFIX, nr->len - SP_OVF_PREFIX, &nr->page);
+}
+
+/* Put rec into existing slot i of this (fixed) row page, keeping the slot's
+   flag bits: over the old bytes if it is no longer, otherwise appended after
+   releasing them. Returns -1 with the page untouched if it does not fit. */
+static int sp_row_rewrite(char *pagebuf, int i, const SP_Record *rec, const SP_NoteRef *nr){
+    SP_PageHdr *h = sp_hdr(pagebuf); SP_Slot *s = sp_slot(pagebuf, i);
+    unsigned short flags = (unsigned short)(s->len & ~SP_LEN_MASK);
+    int old = SP_LEN(s), rlen = sp_rec_size(pagebuf, rec, nr);
+    if (rlen <= old){
+        sp_rec_write(pagebuf, rec, nr, pagebuf + s->off, old);
+        if (s->off + old == h->free_off){ h->free_off -= (unsigned short)(old - rlen); h->free_bytes += (unsigned short)(old - rlen); }
+        else h->frag_bytes += (unsigned short)(old - rlen);
+        s->len = (unsigned short)(rlen | flags);
+        return 0;
+    }
+    if (sp_row_room(pagebuf) + old < rlen) return -1;
+    sp_drop_bytes(pagebuf, s);
+    if (h->free_bytes < rlen) sp_compact(pagebuf);
+    sp_rec_write(pagebuf, rec, nr, pagebuf + h->free_off, h->free_bytes);
+    s->off = h->free_off; s->len = (unsigned short)(rlen | flags);
+    h->free_off += (unsigned short)rlen; h->free_bytes -= (unsigned short)rlen;
     return 0;
 }
 
+/* turn home slot i into a forwarding stub for rid (the stub is never
+   longer than the record bytes it replaces) */
+static void sp_write_stub(char *pagebuf, int i, SP_RID rid){
+    SP_PageHdr *h = sp_hdr(pagebuf); SP_Slot *s = sp_slot(pagebuf, i);
+    int pg = rid.page; unsigned short sl = (unsigned short)rid.slot;
+    h->frag_bytes += (unsigned short)(SP_LEN(s) - SP_STUB_SIZE);
+    memcpy(pagebuf + s->off, &pg, 4); memcpy(pagebuf + s->off + 4, &sl, 2);
+    s->len = (unsigned short)(SP_STUB_SIZE | SP_SLOT_FWD);
+}
+
+static SP_RID sp_stub_target(char *pagebuf, SP_Slot *s){
+    SP_RID t; int pg; unsigned short sl;
+    memcpy(&pg, pagebuf + s->off, 4); memcpy(&sl, pagebuf + s->off + 4, 2);
+    t.page = pg; t.slot = sl; return t;
+}
+
+static int sp_old_magic(unsigned long m){ return m == SP_MAGIC_V1 || m == SP_ZMAGIC_V1; }
+static int sp_known_magic(unsigned long m){ return m == SP_MAGIC || m == SP_PAX_MAGIC || m == SP_ZMAGIC || m == SP_OMAGIC || sp_old_magic(m); }
+static unsigned long sp_fmt_magic(int fmt){ return fmt == SP_FMT_PAX ? SP_PAX_MAGIC : (fmt == SP_FMT_ZROW ? SP_ZMAGIC : SP_MAGIC); }
+static int sp_fmt_of(int fd){ return (fd >= 0 && fd < PF_FTAB_SIZE) ? sp_ftab[fd].fmt : SP_FMT_ROW; }
+
 int SP_Create(const char *fname){ return PF_CreateFile((char*)fname); }
-int SP_Open(const char *fname){ int fd = PF_OpenFile((char*)fname); return fd; }
-int SP_Close(int fd){ return PF_CloseFile(fd); }
 
-static int sp_find_page(int fd, int need_bytes){
-    int rc, pno; char *pbuf;
+/* PAX and compressed files are created with an empty first page of their
+   format, which is how SP_Open recognizes it later. Row files keep the plain
+   SP_Create layout. */
+int SP_CreateEx(const char *fname, int format){
+    int rc, fd, pno; char *pbuf;
+    if (format != SP_FMT_ROW && format != SP_FMT_PAX && format != SP_FMT_ZROW) return PFE_FD;
+    if ((rc = PF_CreateFile((char*)fname)) != PFE_OK || format == SP_FMT_ROW) return rc;
+    if ((fd = PF_OpenFile((char*)fname)) < 0) return fd;
+    if ((rc = PF_AllocPage(fd, &pno, &pbuf)) != PFE_OK){ PF_CloseFile(fd); return rc; }
+    if (format == SP_FMT_PAX) sp_pax_init_page(pbuf); else sp_init_zpage(pbuf);
+    if ((rc = PF_UnfixPage(fd, pno, TRUE)) != PFE_OK){ PF_CloseFile(fd); return rc; }
+    return PF_CloseFile(fd);
+}
+
+/* Bring every version 1 row page of fd up to the current layout. The first
+   pass only checks, so a file with a page too full for the bigger header
+   is left entirely as it was and refused with PFE_INVALIDPAGE. */
+static int sp_upgrade_file(int fd){
+    int rc, pno, pass, old; char *pbuf;
+    for (pass=0;pass<2;pass++){
+        rc = PF_GetFirstPage(fd, &pno, &pbuf);
+        while (rc == PFE_OK){
+            old = sp_old_magic(sp_hdr(pbuf)->magic);
+            if (old && pass == 0 && !sp_upgrade_fits(pbuf)){ PF_UnfixPage(fd, pno, FALSE); return PFE_INVALIDPAGE; }
+            if (old && pass == 1) sp_upgrade_page(pbuf);
+            if ((rc = PF_UnfixPage(fd, pno, old && pass == 1)) != PFE_OK) return rc;
+            rc = PF_GetNextPage(fd, &pno, &pbuf);
+        }
+        if (rc != PFE_EOF) return rc;
+    }
+    return PFE_OK;
+}
+
+/* A file whose first page still has a version 1 row header was written
+   with the old layout and is converted when it is opened; record calls
+   refuse version 1 pages. */
+int SP_Open(const char *fname){
+    int fd = PF_OpenFile((char*)fname); int pno, rc, old = 0; char *pbuf;
+    if (fd < 0) return fd;
+    sp_ftab[fd].fmt = SP_FMT_ROW; sp_ftab[fd].recs = 0; sp_ftab[fd].varbytes = 0;
+    if (PF_GetFirstPage(fd, &pno, &pbuf) == PFE_OK){
+        unsigned long m = sp_hdr(pbuf)->magic;
+        if (m == SP_PAX_MAGIC) sp_ftab[fd].fmt = SP_FMT_PAX;
+        else if (m == SP_ZMAGIC || m == SP_ZMAGIC_V1) sp_ftab[fd].fmt = SP_FMT_ZROW;
+        old = sp_old_magic(m);
+        PF_UnfixPage(fd, pno, FALSE);
+    }
+    if (old && (rc = sp_upgrade_file(fd)) != PFE_OK){ PF_CloseFile(fd); return rc; }
+    return fd;
+}
+int SP_Close(int fd){ if (fd >= 0 && fd < PF_FTAB_SIZE) sp_ftab[fd].fmt = SP_FMT_ROW; return PF_CloseFile(fd); }
+int SP_Format(int fd){ return sp_fmt_of(fd); }
+
+/* first page of format fmt with room for need_bytes (row: record bytes, PAX:
+   string bytes); compressed pages size rec against their own dictionary */
+static int sp_find_page(int fd, int fmt, int need_bytes, const SP_Record *rec, const SP_NoteRef *nr){
+    int rc, pno; char *pbuf; unsigned long magic = sp_fmt_magic(fmt);
     rc = PF_GetFirstPage(fd, &pno, &pbuf);
     while (rc == PFE_OK){
         SP_PageHdr *h = sp_hdr(pbuf);
-        if (h->magic != SP_MAGIC){ sp_init_page(pbuf); if (PF_UnfixPage(fd, pno, TRUE) != PFE_OK) return -1; return pno; }
-        if (h->free_bytes >= (unsigned short)need_bytes){ PF_UnfixPage(fd, pno, FALSE); return pno; }
+        if (!sp_known_magic(h->magic)){
+            if (fmt == SP_FMT_PAX) sp_pax_init_page(pbuf); else if (fmt == SP_FMT_ZROW) sp_init_zpage(pbuf); else sp_init_page(pbuf);
+            if (PF_UnfixPage(fd, pno, TRUE) != PFE_OK) return -1;
+            return pno;
+        }
+        if (h->magic == magic){
+            int fits;
+            if (fmt == SP_FMT_PAX) fits = sp_pax_fits(pbuf, need_bytes);
+            else if (fmt == SP_FMT_ZROW) fits = sp_row_room(pbuf) >= sp_row_need(pbuf, sp_rec_size(pbuf, rec, nr));
+            else fits = sp_row_room(pbuf) >= sp_row_need(pbuf, need_bytes);
+            if (fits){ PF_UnfixPage(fd, pno, FALSE); return pno; }
+        }
         PF_UnfixPage(fd, pno, FALSE);
         rc = PF_GetNextPage(fd, &pno, &pbuf);
     }
     return -1;
 }
 
-int SP_Insert(int fd, const SP_Record *rec, SP_RID *rid_out){
-    int rlen = sp_serialize(rec, NULL, 0);
+static int sp_pax_insert_rec(int fd, const SP_Record *rec, SP_RID *rid_out){
+    int var = (rec->name ? (int)strlen(rec->name) : 0) + (rec->dept ? (int)strlen(rec->dept) : 0) + (rec->level ? (int)strlen(rec->level) : 0);
+    int avg = sp_ftab[fd].recs ? (int)(sp_ftab[fd].varbytes / sp_ftab[fd].recs) : var;
+    int pno, rc, slot; char *pbuf;
+    if ((rec->name && strlen(rec->name) > SP_PAX_MAXSTR) || (rec->dept && strlen(rec->dept) > SP_PAX_MAXSTR)
+        || (rec->level && strlen(rec->level) > SP_PAX_MAXSTR)) return PFE_NOBUF;
+    pno = sp_find_page(fd, SP_FMT_PAX, var, rec, NULL);
+    if (pno < 0){ rc = PF_AllocPage(fd, &pno, &pbuf); if (rc != PFE_OK) return rc; sp_pax_init_page(pbuf); }
+    else { rc = PF_GetThisPage(fd, pno, &pbuf); if (rc != PFE_OK) return rc; }
+    slot = sp_pax_insert(pbuf, rec, avg);
+    if (slot < 0){
+        /* the page chosen could not take it after all: a fresh page can */
+        if ((rc = PF_UnfixPage(fd, pno, FALSE)) != PFE_OK) return rc;
+        if ((rc = PF_AllocPage(fd, &pno, &pbuf)) != PFE_OK) return rc;
+        sp_pax_init_page(pbuf);
+        if ((slot = sp_pax_insert(pbuf, rec, avg)) < 0){ PF_UnfixPage(fd, pno, TRUE); return PFE_NOBUF; }
+    }
+    sp_ftab[fd].recs++; sp_ftab[fd].varbytes += var;
+    if (rid_out){ rid_out->page = pno; rid_out->slot = slot; }
+    return PF_UnfixPage(fd, pno, TRUE);
+}
+
+/* insert rec on some row page with the given slot flags */
+static int sp_row_insert(int fd, int fmt, const SP_Record *rec, const SP_NoteRef *nr, unsigned short flags, SP_RID *rid_out){
+    int rlen = sp_serialize(rec, NULL, 0) + sp_note_size(nr);
     int need; int pno; char *pbuf; int rc; SP_PageHdr *h; int slot; SP_Slot *s; char *dst;
-    if (rlen <= 0 || rlen > PF_PAGE_SIZE - SP_HDR_SIZE - SP_SLOT_SIZE) return PFE_NOBUF;
-    need = rlen + SP_SLOT_SIZE;
-    pno = sp_find_page(fd, need);
-    if (pno < 0){ rc = PF_AllocPage(fd, &pno, &pbuf); if (rc != PFE_OK) return rc; sp_init_page(pbuf); }
+    int max = PF_PAGE_SIZE - SP_HDR_SIZE - SP_SLOT_SIZE - (fmt == SP_FMT_ZROW ? SP_DICT_SIZE + SP_ZREC_SLACK : 0);
+    if (rlen <= 0 || rlen > max) return PFE_NOBUF;
+    pno = sp_find_page(fd, fmt, rlen, rec, nr);
+    if (pno < 0){ rc = PF_AllocPage(fd, &pno, &pbuf); if (rc != PFE_OK) return rc; if (fmt == SP_FMT_ZROW) sp_init_zpage(pbuf); else sp_init_page(pbuf); }
     else { rc = PF_GetThisPage(fd, pno, &pbuf); if (rc != PFE_OK) return rc; }
-    h = sp_hdr(pbuf); if (h->magic != SP_MAGIC){ sp_init_page(pbuf); }
+    h = sp_hdr(pbuf); if (!sp_is_row(pbuf)){ sp_init_page(pbuf); }
+    rlen = sp_rec_size(pbuf, rec, nr); need = sp_row_need(pbuf, rlen);
+    if (sp_row_room(pbuf) < need){ PF_UnfixPage(fd, pno, FALSE); return PFE_NOBUF; }
+    /* compact only when the contiguous gap is too small for this record */
+    if (h->free_bytes < need) sp_compact(pbuf);
     slot = sp_ensure_slot(pbuf);
-    if (slot < 0){ sp_compact(pbuf); slot = sp_ensure_slot(pbuf); if (slot < 0){ PF_UnfixPage(fd, pno, FALSE); return PFE_NOBUF; } }
-    if (h->free_bytes < (unsigned short)rlen){ sp_compact(pbuf); if (h->free_bytes < (unsigned short)rlen){ PF_UnfixPage(fd, pno, FALSE); return PFE_NOBUF; } }
-    dst = pbuf + h->free_off; sp_serialize(rec, dst, h->free_bytes);
-    s = sp_slot(pbuf, slot); s->off = h->free_off; s->len = (unsigned short)rlen; h->free_off += (unsigned short)rlen; h->free_bytes -= (unsigned short)rlen;
+    dst = pbuf + h->free_off; sp_rec_write(pbuf, rec, nr, dst, h->free_bytes);
+    s = sp_slot(pbuf, slot); s->off = h->free_off; s->len = (unsigned short)(rlen | flags); h->free_off += (unsigned short)rlen; h->free_bytes -= (unsigned short)rlen;
     if (rid_out){ rid_out->page = pno; rid_out->slot = slot; }
     return PF_UnfixPage(fd, pno, TRUE);
 }
 
+int SP_Insert(int fd, const SP_Record *rec, SP_RID *rid_out){ return SP_InsertNote(fd, rec, NULL, 0, rid_out); }
+
+/* PAX pages have no room for notes: a record with one is refused there */
+int SP_InsertNote(int fd, const SP_Record *rec, const char *note, long note_len, SP_RID *rid_out){
+    int fmt = sp_fmt_of(fd), rc; SP_NoteRef nr;
+    if (fmt == SP_FMT_PAX) return (note && note_len > 0) ? PFE_NOBUF : sp_pax_insert_rec(fd, rec, rid_out);
+    if ((rc = sp_note_prepare(fd, rec, note, note_len, &nr)) != PFE_OK) return rc;
+    if ((rc = sp_row_insert(fd, fmt, rec, &nr, 0, rid_out)) != PFE_OK) sp_ovf_free(fd, nr.page);
+    return rc;
+}
+
+/* drop the moved copy a forwarding stub points at (not its overflow chain) */
+static int sp_drop_moved(int fd, SP_RID t){
+    char *pbuf; int rc = PF_GetThisPage(fd, t.page, &pbuf);
+    if (rc != PFE_OK) return rc;
+    sp_kill_slot(pbuf, t.slot);
+    return PF_UnfixPage(fd, t.page, TRUE);
+}
+
+/* overflow chain of the record at rid, following a forwarding stub */
+static int sp_body_ovf(int fd, SP_RID rid){
+    char *pbuf; SP_Slot *s; int ovf;
+    if (PF_GetThisPage(fd, rid.page, &pbuf) != PFE_OK) return -1;
+    s = sp_slot(pbuf, rid.slot);
+    if (s->len & SP_SLOT_FWD){ SP_RID t = sp_stub_target(pbuf, s); PF_UnfixPage(fd, rid.page, FALSE); return sp_body_ovf(fd, t); }
+    ovf = sp_rec_ovf(pbuf, s);
+    PF_UnfixPage(fd, rid.page, FALSE);
+    return ovf;
+}
+
+/* Move rec into the row record at rid, whose home page is fixed in pbuf.
+   The new version goes, in order of preference, over the old bytes / onto
+   the home page, onto the page already holding a moved copy, or to a fresh
+   moved copy on another page with the home slot left as a forwarding stub.
+   Stubs always point straight at the current copy, so reads take at most
+   one extra hop. */
+static int sp_row_update(int fd, int fmt, SP_RID rid, char *pbuf, const SP_Record *rec, const SP_NoteRef *nr){
+    int rc, fwd; SP_Slot *s = sp_slot(pbuf, rid.slot); SP_RID t, nt;
+    fwd = (s->len & SP_SLOT_FWD) != 0;
+    if (fwd) t = sp_stub_target(pbuf, s);
+    if (sp_row_rewrite(pbuf, rid.slot, rec, nr) == 0){
+        /* fits at home: a forwarded record moves back and its copy goes */
+        s->len &= (unsigned short)~SP_SLOT_FWD;
+        if ((rc = PF_UnfixPage(fd, rid.page, TRUE)) != PFE_OK) return rc;
+        return fwd ? sp_drop_moved(fd, t) : PFE_OK;
+    }
+    if ((rc = PF_UnfixPage(fd, rid.page, FALSE)) != PFE_OK) return rc;
+    if (fwd){
+        if ((rc = PF_GetThisPage(fd, t.page, &pbuf)) != PFE_OK) return rc;
+        if (sp_row_rewrite(pbuf, t.slot, rec, nr) == 0) return PF_UnfixPage(fd, t.page, TRUE);
+        if ((rc = PF_UnfixPage(fd, t.page, FALSE)) != PFE_OK) return rc;
+    }
+    /* place the new copy before touching the home page: the page search
+       must be able to fix every page */
+    if ((rc = sp_row_insert(fd, fmt, rec, nr, SP_SLOT_MOVED, &nt)) != PFE_OK) return rc;
+    if (fwd && (rc = sp_drop_moved(fd, t)) != PFE_OK) return rc;
+    if ((rc = PF_GetThisPage(fd, rid.page, &pbuf)) != PFE_OK) return rc;
+    sp_write_stub(pbuf, rid.slot, nt);
+    return PF_UnfixPage(fd, rid.page, TRUE);
+}
+
+int SP_Update(int fd, SP_RID rid, const SP_Record *rec){ return SP_UpdateNote(fd, rid, rec, NULL, 0); }
+
+/* Update the record at rid, keeping rid valid (see sp_row_update). A note's
+   overflow chain is rewritten with the record and the old one freed. PAX
+   pages have no stubs or notes: they update within the page or fail. */
+int SP_UpdateNote(int fd, SP_RID rid, const SP_Record *rec, const char *note, long note_len){
+    char *pbuf; int rc, old_ovf; SP_PageHdr *h; SP_Slot *s; SP_NoteRef nr;
+    if ((rc = PF_GetThisPage(fd, rid.page, &pbuf)) != PFE_OK) return rc;
+    h = sp_hdr(pbuf);
+    if (h->magic == SP_PAX_MAGIC){
+        SP_PaxHdr *ph = sp_pax_hdr(pbuf);
+        if (rid.slot<0 || rid.slot>=ph->nslots){ PF_UnfixPage(fd,rid.page,FALSE); return PFE_INVALIDPAGE; }
+        if (!sp_pax_live(pbuf)[rid.slot]){ PF_UnfixPage(fd,rid.page,FALSE); return PFE_PAGEFREE; }
+        if ((note && note_len > 0) || sp_pax_update(pbuf, rid.slot, rec) < 0){ PF_UnfixPage(fd,rid.page,FALSE); return PFE_NOBUF; }
+        return PF_UnfixPage(fd, rid.page, TRUE);
+    }
+    if (!sp_is_row(pbuf) || rid.slot<0 || rid.slot>=h->nslots){ PF_UnfixPage(fd,rid.page,FALSE); return PFE_INVALIDPAGE; }
+    s = sp_slot(pbuf, rid.slot);
+    if (s->len == 0){ PF_UnfixPage(fd,rid.page,FALSE); return PFE_PAGEFREE; }
+    if (s->len & SP_SLOT_MOVED){ PF_UnfixPage(fd,rid.page,FALSE); return PFE_INVALIDPAGE; }
+    old_ovf = (s->len & SP_SLOT_FWD) ? sp_body_ovf(fd, sp_stub_target(pbuf, s)) : sp_rec_ovf(pbuf, s);
+    if ((rc = sp_note_prepare(fd, rec, note, note_len, &nr)) != PFE_OK){ PF_UnfixPage(fd,rid.page,FALSE); return rc; }
+    if ((rc = sp_row_update(fd, sp_fmt_of(fd), rid, pbuf, rec, &nr)) != PFE_OK){ sp_ovf_free(fd, nr.page); return rc; }
+    return sp_ovf_free(fd, old_ovf);
+}
+
 int SP_Get(int fd, SP_RID rid, SP_Record *rec_out, char *buf, int bufcap){
     char *pbuf; int rc = PF_GetThisPage(fd, rid.page, &pbuf); SP_PageHdr *h; SP_Slot *s; int ret;
-    if (rc!=PFE_OK) return rc; h = sp_hdr(pbuf); if (h->magic != SP_MAGIC || rid.slot<0 || rid.slot>=h->nslots){ PF_UnfixPage(fd,rid.page,FALSE); return PFE_INVALIDPAGE; }
+    if (rc!=PFE_OK) return rc; h = sp_hdr(pbuf);
+    if (h->magic == SP_PAX_MAGIC){
+        SP_PaxHdr *ph = sp_pax_hdr(pbuf);
+        if (rid.slot<0 || rid.slot>=ph->nslots){ PF_UnfixPage(fd,rid.page,FALSE); return PFE_INVALIDPAGE; }
+        if (!sp_pax_live(pbuf)[rid.slot]){ PF_UnfixPage(fd,rid.page,FALSE); return PFE_PAGEFREE; }
+        ret = sp_pax_get(pbuf, rid.slot, rec_out, buf, bufcap); PF_UnfixPage(fd, rid.page, FALSE); return (ret==0)?PFE_OK:PFE_NOBUF;
+    }
+    if (!sp_is_row(pbuf) || rid.slot<0 || rid.slot>=h->nslots){ PF_UnfixPage(fd,rid.page,FALSE); return PFE_INVALIDPAGE; }
     s = sp_slot(pbuf, rid.slot); if (s->len==0){ PF_UnfixPage(fd,rid.page,FALSE); return PFE_PAGEFREE; }
-    ret = sp_deserialize(pbuf + s->off, s->len, rec_out, buf, bufcap); PF_UnfixPage(fd, rid.page, FALSE); return (ret==0)?PFE_OK:PFE_NOBUF;
+    if (s->len & SP_SLOT_FWD){ SP_RID t = sp_stub_target(pbuf, s); PF_UnfixPage(fd, rid.page, FALSE); return SP_Get(fd, t, rec_out, buf, bufcap); }
+    ret = sp_rec_read(pbuf, s, rec_out, buf, bufcap); PF_UnfixPage(fd, rid.page, FALSE); return (ret==0)?PFE_OK:PFE_NOBUF;
 }
 
 int SP_Delete(int fd, SP_RID rid){
     char *pbuf; int rc = PF_GetThisPage(fd, rid.page, &pbuf); SP_PageHdr *h; SP_Slot *s;
-    if (rc!=PFE_OK) return rc; h = sp_hdr(pbuf); if (h->magic != SP_MAGIC || rid.slot<0 || rid.slot>=h->nslots){ PF_UnfixPage(fd,rid.page,FALSE); return PFE_INVALIDPAGE; }
+    if (rc!=PFE_OK) return rc; h = sp_hdr(pbuf);
+    if (h->magic == SP_PAX_MAGIC){
+        SP_PaxHdr *ph = sp_pax_hdr(pbuf); unsigned char *live; int c;
+        if (rid.slot<0 || rid.slot>=ph->nslots){ PF_UnfixPage(fd,rid.page,FALSE); return PFE_INVALIDPAGE; }
+        live = sp_pax_live(pbuf); if (!live[rid.slot]){ PF_UnfixPage(fd,rid.page,FALSE); return PFE_PAGEFREE; }
+        for (c=0;c<SP_PAX_NVAR;c++) ph->garbage += sp_pax_len(pbuf, c)[rid.slot];
+        live[rid.slot] = 0; ph->nlive--; return PF_UnfixPage(fd, rid.page, TRUE);
+    }
+    if (!sp_is_row(pbuf) || rid.slot<0 || rid.slot>=h->nslots){ PF_UnfixPage(fd,rid.page,FALSE); return PFE_INVALIDPAGE; }
     s = sp_slot(pbuf, rid.slot); if (s->len==0){ PF_UnfixPage(fd,rid.page,FALSE); return PFE_PAGEFREE; }
-    s->len = 0; s->off = 0; sp_compact(pbuf); return PF_UnfixPage(fd, rid.page, TRUE);
+    /* moved copies are only reachable (and deleted) through their home RID */
+    if (s->len & SP_SLOT_MOVED){ PF_UnfixPage(fd,rid.page,FALSE); return PFE_INVALIDPAGE; }
+    if (s->len & SP_SLOT_FWD){
+        SP_RID t = sp_stub_target(pbuf, s); int ovf = sp_body_ovf(fd, t);
+        sp_kill_slot(pbuf, rid.slot);
+        if ((rc = PF_UnfixPage(fd, rid.page, TRUE)) != PFE_OK) return rc;
+        if ((rc = sp_drop_moved(fd, t)) != PFE_OK) return rc;
+        return sp_ovf_free(fd, ovf);
+    }
+    {
+        int ovf = sp_rec_ovf(pbuf, s);
+        sp_kill_slot(pbuf, rid.slot);
+        if ((rc = PF_UnfixPage(fd, rid.page, TRUE)) != PFE_OK) return rc;
+        return sp_ovf_free(fd, ovf);
+    }
+}
+
+/* find the live record body for rid (following a stub) and its trailer;
+   on success the body's page is left fixed */
+static int sp_note_locate(int fd, SP_RID *rid, char **pbuf, const char **inl, SP_NoteRef *nr){
+    int rc, fixed; SP_Slot *s; SP_PageHdr *h;
+    if ((rc = PF_GetThisPage(fd, rid->page, pbuf)) != PFE_OK) return rc;
+    h = sp_hdr(*pbuf);
+    if (!sp_is_row(*pbuf) || rid->slot<0 || rid->slot>=h->nslots){ PF_UnfixPage(fd, rid->page, FALSE); return PFE_INVALIDPAGE; }
+    s = sp_slot(*pbuf, rid->slot);
+    if (s->len == 0){ PF_UnfixPage(fd, rid->page, FALSE); return PFE_PAGEFREE; }
+    if (s->len & SP_SLOT_FWD){
+        SP_RID t = sp_stub_target(*pbuf, s);
+        PF_UnfixPage(fd, rid->page, FALSE); *rid = t;
+        if ((rc = PF_GetThisPage(fd, rid->page, pbuf)) != PFE_OK) return rc;
+        s = sp_slot(*pbuf, rid->slot);
+        if (s->len == 0){ PF_UnfixPage(fd, rid->page, FALSE); return PFE_PAGEFREE; }
+    }
+    if ((fixed = sp_rec_fixed(*pbuf, s)) < 0){ PF_UnfixPage(fd, rid->page, FALSE); return PFE_NOBUF; }
+    *inl = sp_note_find(*pbuf, s, fixed, nr);
+    return PFE_OK;
+}
+
+int SP_NoteOpen(int fd, SP_RID rid, SP_NoteStream *ns){
+    char *pbuf; const char *inl; SP_NoteRef nr; int rc;
+    if ((rc = sp_note_locate(fd, &rid, &pbuf, &inl, &nr)) != PFE_OK) return rc;
+    ns->fd = fd; ns->rid = rid; ns->len = nr.len; ns->pos = 0; ns->inl = nr.inl;
+    ns->page = nr.page; ns->page_pos = 0;
+    return PF_UnfixPage(fd, rid.page, FALSE);
+}
+
+/* Copy up to n further note bytes into buf. Returns the count, 0 at the
+   end of the note, or a PF error code. */
+int SP_NoteRead(SP_NoteStream *ns, char *buf, int n){
+    char *pbuf; const char *inl; SP_NoteRef nr; int rc, got = 0;
+    if (ns->pos < ns->inl && n > 0){
+        SP_RID rid = ns->rid; int k = ns->inl - (int)ns->pos;
+        if ((rc = sp_note_locate(ns->fd, &rid, &pbuf, &inl, &nr)) != PFE_OK) return rc;
+        if (k > n) k = n;
+        memcpy(buf, inl + ns->pos, k);
+        if ((rc = PF_UnfixPage(ns->fd, rid.page, FALSE)) != PFE_OK) return rc;
+        got += k; ns->pos += k;
+    }
+    while (got < n && ns->pos < ns->len && ns->page >= 0){
+        SP_OvfHdr *oh; int k;
+        if ((rc = PF_GetThisPage(ns->fd, ns->page, &pbuf)) != PFE_OK) return rc;
+        oh = (SP_OvfHdr*)pbuf;
+        if (oh->magic != SP_OMAGIC){ PF_UnfixPage(ns->fd, ns->page, FALSE); return PFE_INVALIDPAGE; }
+        k = oh->used - ns->page_pos; if (k > n - got) k = n - got;
+        memcpy(buf + got, pbuf + sizeof(SP_OvfHdr) + ns->page_pos, k);
+        got += k; ns->pos += k; ns->page_pos += k;
+        if (ns->page_pos >= oh->used){ int next = oh->next; PF_UnfixPage(ns->fd, ns->page, FALSE); ns->page = next; ns->page_pos = 0; }
+        else PF_UnfixPage(ns->fd, ns->page, FALSE);
+    }
+    return got;
+}
+
+int SP_NoteClose(SP_NoteStream *ns){ ns->fd = -1; ns->page = -1; return PFE_OK; }
+
+int SP_ScanOpen(int fd, SP_Scan *scan){
+    scan->fd=fd; scan->page=-1; scan->slot=-1;
+    scan->fwd=NULL; scan->nfwd=0; scan->capfwd=0; scan->ifwd=-1;
+    return PFE_OK;
+}
+
+/* remember a stub for the end of the scan; 0 if there is no memory for it */
+static int sp_scan_defer(SP_Scan *scan, int pno, int i, SP_RID t){
+    if (scan->nfwd == scan->capfwd){
+        int cap = scan->capfwd ? scan->capfwd*2 : 64;
+        SP_ScanFwd *f = (SP_ScanFwd*)realloc(scan->fwd, cap*sizeof(SP_ScanFwd));
+        if (!f) return 0;
+        scan->fwd = f; scan->capfwd = cap;
+    }
+    scan->fwd[scan->nfwd].home.page = pno; scan->fwd[scan->nfwd].home.slot = i;
+    scan->fwd[scan->nfwd].copy = t; scan->nfwd++;
+    return 1;
 }
 
-int SP_ScanOpen(int fd, SP_Scan *scan){ scan->fd=fd; scan->page=-1; scan->slot=-1; return PFE_OK; }
+static int sp_fwd_by_copy(const void *a, const void *b){
+    const SP_ScanFwd *x = (const SP_ScanFwd*)a, *y = (const SP_ScanFwd*)b;
+    if (x->copy.page != y->copy.page) return x->copy.page < y->copy.page ? -1 : 1;
+    return (x->copy.slot > y->copy.slot) - (x->copy.slot < y->copy.slot);
+}
+
+/* Records come back page by page, at their home RID. A forwarding stub is
+   not followed where it is met: the scan notes it and, after the last page,
+   returns the moved copies in the order of their pages, so each of those
+   pages is read about once rather than once per record on it. */
 int SP_ScanNext(SP_Scan *scan, SP_Record *rec_out, SP_RID *rid_out, char *buf, int bufcap){
     int fd = scan->fd; char *pbuf; int pno; int rc; SP_PageHdr *h; int start, i;
-    if (scan->page < 0) rc = PF_GetFirstPage(fd, &pno, &pbuf); else { pno = scan->page; rc = PF_GetThisPage(fd, pno, &pbuf); }
-    while (rc == PFE_OK){
-        h = sp_hdr(pbuf);
-        if (h->magic != SP_MAGIC){
-            PF_UnfixPage(fd,pno,FALSE);
-            rc = PF_GetNextPage(fd, &pno, &pbuf);
-            continue;
-        }
-        start = (scan->page==pno)? (scan->slot+1) : 0;
-        for (i=start;i<h->nslots;i++){
-            SP_Slot *s = sp_slot(pbuf, i);
-            if (s->len==0) continue;
-            if (sp_deserialize(pbuf + s->off, s->len, rec_out, buf, bufcap)==0){ if (rid_out){ rid_out->page=pno; rid_out->slot=i; } scan->page = pno; scan->slot = i; PF_UnfixPage(fd, pno, FALSE); return PFE_OK; }
+    if (scan->ifwd < 0){
+        if (scan->page < 0) rc = PF_GetFirstPage(fd, &pno, &pbuf); else { pno = scan->page; rc = PF_GetThisPage(fd, pno, &pbuf); }
+        while (rc == PFE_OK){
+            h = sp_hdr(pbuf);
+            start = (scan->page==pno)? (scan->slot+1) : 0;
+            if (h->magic == SP_PAX_MAGIC){
+                unsigned char *live = sp_pax_live(pbuf);
+                for (i=start;i<sp_pax_hdr(pbuf)->nslots;i++){
+                    if (!live[i]) continue;
+                    if (sp_pax_get(pbuf, i, rec_out, buf, bufcap)==0){ if (rid_out){ rid_out->page=pno; rid_out->slot=i; } scan->page = pno; scan->slot = i; PF_UnfixPage(fd, pno, FALSE); return PFE_OK; }
+                }
+                PF_UnfixPage(fd, pno, FALSE); rc = PF_GetNextPage(fd, &pno, &pbuf); scan->slot = -1;
+                continue;
+            }
+            if (!sp_is_row(pbuf)){
+                PF_UnfixPage(fd,pno,FALSE);
+                rc = PF_GetNextPage(fd, &pno, &pbuf);
+                continue;
+            }
+            for (i=start;i<h->nslots;i++){
+                SP_Slot *s = sp_slot(pbuf, i);
+                /* a moved copy is returned with its stub, after the pages */
+                if (s->len==0 || (s->len & SP_SLOT_MOVED)) continue;
+                if (s->len & SP_SLOT_FWD){
+                    SP_RID t = sp_stub_target(pbuf, s);
+                    if (sp_scan_defer(scan, pno, i, t)) continue;
+                    /* no memory to put it off: follow it now */
+                    scan->page = pno; scan->slot = i; PF_UnfixPage(fd, pno, FALSE);
+                    if (SP_Get(fd, t, rec_out, buf, bufcap) == PFE_OK){ if (rid_out){ rid_out->page=pno; rid_out->slot=i; } return PFE_OK; }
+                    if ((rc = PF_GetThisPage(fd, pno, &pbuf)) != PFE_OK) return rc;
+                    h = sp_hdr(pbuf); continue;
+                }
+                if (sp_rec_read(pbuf, s, rec_out, buf, bufcap)==0){ if (rid_out){ rid_out->page=pno; rid_out->slot=i; } scan->page = pno; scan->slot = i; PF_UnfixPage(fd, pno, FALSE); return PFE_OK; }
+            }
+            PF_UnfixPage(fd, pno, FALSE); rc = PF_GetNextPage(fd, &pno, &pbuf); scan->slot = -1;
         }
-        PF_UnfixPage(fd, pno, FALSE); rc = PF_GetNextPage(fd, &pno, &pbuf); scan->slot = -1;
+        if (rc != PFE_EOF) return rc;
+        if (scan->nfwd > 1) qsort(scan->fwd, scan->nfwd, sizeof(SP_ScanFwd), sp_fwd_by_copy);
+        scan->ifwd = 0;
+    }
+    while (scan->ifwd < scan->nfwd){
+        SP_ScanFwd *f = &scan->fwd[scan->ifwd++];
+        if (SP_Get(fd, f->copy, rec_out, buf, bufcap) == PFE_OK){ if (rid_out) *rid_out = f->home; return PFE_OK; }
     }
     return PFE_EOF;
 }
-int SP_ScanClose(SP_Scan *scan){ scan->fd=-1; scan->page=-1; scan->slot=-1; return PFE_OK; }
+int SP_ScanClose(SP_Scan *scan){
+    free(scan->fwd);
+    scan->fd=-1; scan->page=-1; scan->slot=-1;
+    scan->fwd=NULL; scan->nfwd=0; scan->capfwd=0; scan->ifwd=-1;
+    return PFE_OK;
+}
 
 int SP_Utilization(int fd, int *pages_out, int *bytes_used_out){
     int rc, pno, pages=0, bytes=0; char *pbuf; SP_PageHdr *h; int i;
     rc = PF_GetFirstPage(fd, &pno, &pbuf);
-    while (rc == PFE_OK){ h = sp_hdr(pbuf); if (h->magic == SP_MAGIC){ pages++; for (i=0;i<h->nslots;i++){ SP_Slot *s = sp_slot(pbuf,i); bytes += s->len; } } PF_UnfixPage(fd,pno,FALSE); rc = PF_GetNextPage(fd,&pno,&pbuf); }
+    while (rc == PFE_OK){
+        h = sp_hdr(pbuf);
+        if (sp_is_row(pbuf)){ pages++; for (i=0;i<h->nslots;i++){ SP_Slot *s = sp_slot(pbuf,i); bytes += SP_LEN(s); } }
+        else if (h->magic == SP_PAX_MAGIC){
+            /* live data bytes: the int32 roll plus the string bytes of each record */
+            SP_PaxHdr *ph = sp_pax_hdr(pbuf); pages++;
+            bytes += 4*ph->nlive + (PF_PAGE_SIZE - ph->heap_off) - ph->garbage;
+        }
+        PF_UnfixPage(fd,pno,FALSE); rc = PF_GetNextPage(fd,&pno,&pbuf);
+    }
     if (pages_out) *pages_out = pages; if (bytes_used_out) *bytes_used_out = bytes; return PFE_OK;
 }
+
+/* One pass over the contiguous roll minipage, with the live minipage as the
+   mask. Dead slots stand in as the largest int for the min and the smallest for
+   the max, leaving plain min/max/sum reductions that gcc vectorizes (see
+   make vecinfo). */
+static long sp_pax_roll_agg(const int *roll, const unsigned char *live, int n, int *mn, int *mx){
+    int i, lo = *mn, hi = *mx, cnt = 0;
+    for (i=0;i<n;i++){
+        int v = roll[i], ok = live[i] != 0, m = -ok;
+        int a = (v & m) | (0x7fffffff & ~m), b = (v & m) | ((-0x7fffffff - 1) & ~m);
+        cnt += ok;
+        lo = a < lo ? a : lo;
+        hi = b > hi ? b : hi;
+    }
+    *mn = lo; *mx = hi; return cnt;
+}
+
+int SP_RollStats(int fd, long *count_out, long *min_out, long *max_out){
+    int rc, pno, i; char *pbuf; long cnt = 0; int mn = 0x7fffffff, mx = -0x7fffffff - 1;
+    rc = PF_GetFirstPage(fd, &pno, &pbuf);
+    while (rc == PFE_OK){
+        SP_PageHdr *h = sp_hdr(pbuf);
+        if (h->magic == SP_PAX_MAGIC && sp_pax_hdr(pbuf)->cap > 0)
+            cnt += sp_pax_roll_agg(sp_pax_roll(pbuf), sp_pax_live(pbuf), sp_pax_hdr(pbuf)->nslots, &mn, &mx);
+        else if (sp_is_row(pbuf)){
+            for (i=0;i<h->nslots;i++){
+                SP_Slot *s = sp_slot(pbuf, i); int v;
+                if (s->len == 0 || (s->len & SP_SLOT_FWD)) continue;
+                memcpy(&v, pbuf + s->off, 4); cnt++;
+                if (v < mn) mn = v; if (v > mx) mx = v;
+            }
+        }
+        PF_UnfixPage(fd, pno, FALSE); rc = PF_GetNextPage(fd, &pno, &pbuf);
+    }
+    if (rc != PFE_EOF) return rc;
+    if (count_out) *count_out = cnt;
+    if (min_out) *min_out = cnt ? mn : 0;
+    if (max_out) *max_out = cnt ? mx : 0;
+    return PFE_OK;
+}
+
+static int sp_dept_add(SP_DeptCount *out, int cap, int *n, const char *d, int dlen){
+    int j;
+    if (dlen > (int)sizeof(out->dept) - 1) dlen = (int)sizeof(out->dept) - 1;
+    for (j=0;j<*n;j++) if ((int)strlen(out[j].dept) == dlen && memcmp(out[j].dept, d, dlen) == 0){ out[j].count++; return 0; }
+    if (*n >= cap) return -1;
+    memcpy(out[*n].dept, d, dlen); out[*n].dept[dlen] = '\0'; out[*n].count = 1; (*n)++;
+    return 0;
+}
+
+int SP_DeptCounts(int fd, SP_DeptCount *out, int cap, int *n_out){
+    int rc, pno, i, n = 0, full = 0; char *pbuf;
+    rc = PF_GetFirstPage(fd, &pno, &pbuf);
+    while (rc == PFE_OK){
+        SP_PageHdr *h = sp_hdr(pbuf);
+        if (h->magic == SP_PAX_MAGIC && sp_pax_hdr(pbuf)->cap > 0){
+            unsigned short *off = sp_pax_off(pbuf, SP_PAX_DEPT); unsigned char *len = sp_pax_len(pbuf, SP_PAX_DEPT);
+            unsigned char *live = sp_pax_live(pbuf); int ns = sp_pax_hdr(pbuf)->nslots;
+            for (i=0;i<ns && !full;i++) if (live[i]) full = sp_dept_add(out, cap, &n, pbuf + off[i], len[i]) < 0;
+        }
+        else if (h->magic == SP_ZMAGIC){
+            for (i=0;i<h->nslots && !full;i++){
+                SP_Slot *s = sp_slot(pbuf, i); unsigned short t; int sfx, dlen; char *p; const char *d;
+                if (s->len == 0 || (s->len & SP_SLOT_FWD)) continue;
+                p = pbuf + s->off + 5;
+                if ((unsigned char)*p == 0xFF){ memcpy(&t, p+1, 2); sfx = t; p += 3; } else sfx = (unsigned char)*p++;
+                p += sfx;
+                if ((unsigned char)*p == SP_DICT_LIT){ memcpy(&t, p+1, 2); dlen = t; d = p + 3; }
+                else dlen = sp_dict_entry(pbuf, (unsigned char)*p, &d);
+                full = sp_dept_add(out, cap, &n, d, dlen) < 0;
+            }
+        }
+        else if (h->magic == SP_MAGIC){
+            for (i=0;i<h->nslots && !full;i++){
+                SP_Slot *s = sp_slot(pbuf, i); unsigned short nlen, dlen; char *p;
+                if (s->len == 0 || (s->len & SP_SLOT_FWD)) continue;
+                p = pbuf + s->off + 4; memcpy(&nlen, p, 2); p += 2 + nlen; memcpy(&dlen, p, 2);
+                full = sp_dept_add(out, cap, &n, p + 2, dlen) < 0;
+            }
+        }
+        PF_UnfixPage(fd, pno, FALSE);
+        if (full) return PFE_NOBUF;
+        rc = PF_GetNextPage(fd, &pno, &pbuf);
+    }
+    if (n_out) *n_out = n;
+    return (rc == PFE_EOF) ? PFE_OK : rc;
+}
\ No newline at end of file
@@ -15,22 +15,63 @@ typedef struct {
     const char *level;  /* "UG" or "PG" */
 } SP_Record;
 
+/* a forwarding stub a scan passed: the record's RID and where its copy is */
+typedef struct { SP_RID home; SP_RID copy; } SP_ScanFwd;
+
 /* Opaque scan handle */
 typedef struct {
     int fd;         /* PF file descriptor */
     int page;       /* current page */
     int slot;       /* current slot index */
+    SP_ScanFwd *fwd; /* stubs passed, returned after the last page; malloc'd */
+    int nfwd, capfwd;
+    int ifwd;       /* next of them to return, -1 while pages remain */
 } SP_Scan;
 
+/* Streaming reader for a record's note (see SP_NoteOpen) */
+typedef struct {
+    int fd;
+    SP_RID rid;     /* where the record body lives */
+    long len;       /* note length */
+    long pos;       /* bytes read so far */
+    int inl;        /* note bytes stored in the record itself */
+    int page;       /* current overflow page, -1 if none */
+    int page_pos;   /* offset within that page's data */
+} SP_NoteStream;
+
+/* Page formats, chosen when the file is created */
+#define SP_FMT_ROW 0    /* row-wise slotted pages (default) */
+#define SP_FMT_PAX 1    /* PAX: each page stores its records column by column in minipages */
+#define SP_FMT_ZROW 2   /* row pages with a per-page dictionary (dept/level) and front-coded names */
+
+/* Per-dept counter filled by SP_DeptCounts */
+typedef struct {
+    char dept[16];
+    long count;
+} SP_DeptCount;
+
 /* File operations */
 int SP_Create(const char *fname);
+int SP_CreateEx(const char *fname, int format);
 int SP_Open(const char *fname);
 int SP_Close(int fd);
+int SP_Format(int fd);
 
 /* Record operations */
 int SP_Insert(int fd, const SP_Record *rec, SP_RID *rid_out);
 int SP_Get(int fd, SP_RID rid, SP_Record *rec_out, char *buf, int bufcap);
 int SP_Delete(int fd, SP_RID rid);
+int SP_Update(int fd, SP_RID rid, const SP_Record *rec);  /* rid stays valid */
+
+/* Notes: optional free text of any length kept with a record. SP_Insert and
+   SP_Update store a record without one (SP_Update drops any it had). Notes
+   too long to keep inline spill into overflow pages; SP_Get/SP_ScanNext
+   leave them out and they are streamed back. PAX files reject notes. */
+int SP_InsertNote(int fd, const SP_Record *rec, const char *note, long note_len, SP_RID *rid_out);
+int SP_UpdateNote(int fd, SP_RID rid, const SP_Record *rec, const char *note, long note_len);
+int SP_NoteOpen(int fd, SP_RID rid, SP_NoteStream *ns);
+int SP_NoteRead(SP_NoteStream *ns, char *buf, int n);  /* bytes read, 0 at end */
+int SP_NoteClose(SP_NoteStream *ns);
 
 /* Scan operations */
 int SP_ScanOpen(int fd, SP_Scan *scan);
@@ -40,4 +81,8 @@ int SP_ScanClose(SP_Scan *scan);
 /* Utilization */
 int SP_Utilization(int fd, int *pages_out, int *bytes_used_out);
 
+/* Column aggregates (run on the contiguous minipages for PAX files) */
+int SP_RollStats(int fd, long *count_out, long *min_out, long *max_out);
+int SP_DeptCounts(int fd, SP_DeptCount *out, int cap, int *n_out);
+
 #endif /* SLOTTED_H */
@@ -3,6 +3,8 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdint.h>
+#include <time.h>
+#include <sys/stat.h>
 #include "pf.h"
 #include "pftypes.h"
 #include "slotted.h"
@@ -62,6 +64,349 @@ static int parse_student(const char *line, SP_Record *r,
     return 0;
 }
 
+static int bench_format(void){
+    const char *f = getenv("FORMAT");
+    if (f && (f[0]=='p' || f[0]=='P')) return SP_FMT_PAX;
+    if (f && (f[0]=='z' || f[0]=='Z')) return SP_FMT_ZROW;
+    return SP_FMT_ROW;
+}
+
+/* insert 50 records, delete the evens and check a scan sees the rest */
+static void run_unit(int format, const char *tag){
+    const char *uf = "unit.spf";
+    int ufd, i, cnt = 0, rc;
+    SP_RID rids[50]; char buf[64]; SP_Record rec;
+    /* ensure clean file */
+    PF_DestroyFile((char*)uf);
+    if (SP_CreateEx(uf, format) != PFE_OK) { PF_PrintError("unit SP_Create"); return; }
+    ufd = SP_Open(uf);
+    if (ufd < 0) { PF_PrintError("unit SP_Open"); return; }
+    for (i=0;i<50;i++){
+        char name[32]; char dept[8] = "BE"; char lvl[4] = "UG";
+        sprintf(name, "S%03d", i);
+        rec.roll_no = i; rec.name = name; rec.dept = dept; rec.level = lvl;
+        if (SP_Insert(ufd, &rec, &rids[i])!=PFE_OK){ PF_PrintError("unit insert"); break; }
+    }
+    /* delete evens */
+    for (i=0;i<50;i+=2){ rc = SP_Delete(ufd, rids[i]); if (rc!=PFE_OK){ fprintf(stderr, "unit delete rc=%d at i=%d page=%d slot=%d\n", rc, i, rids[i].page, rids[i].slot); break; } }
+    /* scan count */
+    {
+        SP_Scan sc; SP_Record rr; SP_RID rid;
+        SP_ScanOpen(ufd, &sc);
+        while ((rc=SP_ScanNext(&sc,&rr,&rid,buf,sizeof(buf)))==PFE_OK) cnt++;
+        SP_ScanClose(&sc);
+        printf("%s: expected=25 scanned=%d\n", tag, cnt);
+    }
+    /* column aggregates over the odd survivors 1..49 */
+    {
+        long c, mn, mx; SP_DeptCount dc[4]; int nd = 0;
+        SP_RollStats(ufd, &c, &mn, &mx);
+        SP_DeptCounts(ufd, dc, 4, &nd);
+        printf("%s: rollstats count=%ld min=%ld max=%ld (expected 25 1 49) depts=%d %s=%ld\n",
+            tag, c, mn, mx, nd, nd ? dc[0].dept : "-", nd ? dc[0].count : 0L);
+    }
+    /* grow the survivors past the page (row pages forward them), then shrink
+       every other one back; RIDs must keep working and scans see each once */
+    {
+        char big[256]; char dept[8] = "BE"; char lvl[4] = "UG"; char rb[512];
+        SP_Record rr; SP_Scan sc; int upd = 0, ok = 0, j;
+        for (i=1;i<50;i+=2){
+            memset(big, 'x', 200); sprintf(big + 200, "%03d", i);
+            rec.roll_no = i; rec.name = big; rec.dept = dept; rec.level = lvl;
+            if (SP_Update(ufd, rids[i], &rec) == PFE_OK) upd++;
+        }
+        for (i=1;i<50;i+=4){
+            sprintf(big, "S%03d", i); rec.roll_no = i; rec.name = big; rec.dept = dept; rec.level = lvl;
+            if (SP_Update(ufd, rids[i], &rec) != PFE_OK) upd--;
+        }
+        for (i=1;i<50;i+=2){
+            if (SP_Get(ufd, rids[i], &rr, rb, sizeof(rb)) != PFE_OK || rr.roll_no != i) continue;
+            j = (int)strlen(rr.name);
+            if ((j == 4 || j == 203) && atoi(rr.name + j - 3) == i) ok++;
+        }
+        cnt = 0; SP_ScanOpen(ufd, &sc);
+        while (SP_ScanNext(&sc, &rr, NULL, rb, sizeof(rb)) == PFE_OK) cnt++;
+        SP_ScanClose(&sc);
+        printf("%s: updated=%d verified=%d scanned=%d\n", tag, upd, ok, cnt);
+    }
+    /* a note too long for a page goes to overflow pages and streams back;
+       updating it to a short inline note and deleting frees the chain */
+    if (format != SP_FMT_PAX){
+        static char note[10000]; char rb[256]; SP_NoteStream ns; SP_RID nrid; SP_Record rr;
+        long got = 0, bad = 0; int k, ok = 1;
+        for (k=0;k<(int)sizeof(note);k++) note[k] = (char)('a' + k % 26);
+        rec.roll_no = 99; rec.name = "NOTE"; rec.dept = "BE"; rec.level = "UG";
+        if (SP_InsertNote(ufd, &rec, note, sizeof(note), &nrid) != PFE_OK) ok = 0;
+        if (ok && SP_NoteOpen(ufd, nrid, &ns) == PFE_OK){
+            while ((k = SP_NoteRead(&ns, rb, 97)) > 0){ int j; for (j=0;j<k;j++) if (rb[j] != note[got+j]) bad++; got += k; }
+            SP_NoteClose(&ns);
+        }
+        if (SP_UpdateNote(ufd, nrid, &rec, "short", 5) != PFE_OK || SP_Get(ufd, nrid, &rr, rb, sizeof(rb)) != PFE_OK
+            || SP_NoteOpen(ufd, nrid, &ns) != PFE_OK || ns.len != 5 || SP_NoteRead(&ns, rb, sizeof(rb)) != 5 || memcmp(rb, "short", 5) != 0) ok = 0;
+        SP_NoteClose(&ns);
+        /* a plain update drops the note */
+        if (SP_Update(ufd, nrid, &rec) != PFE_OK || SP_NoteOpen(ufd, nrid, &ns) != PFE_OK || ns.len != 0) ok = 0;
+        SP_NoteClose(&ns);
+        if (SP_Delete(ufd, nrid) != PFE_OK) ok = 0;
+        printf("%s: note streamed=%ld bad=%ld inline-update=%s\n", tag, got, bad, ok ? "ok" : "FAIL");
+    }
+    SP_Close(ufd);
+}
+
+/* The RUN_UNIT delete path at scale: fill n records, then for each round
+   delete every other live record and insert the same number back, so pages
+   keep cycling through delete -> reuse. Reports delete and refill rates. */
+static void run_delbench(int format, long n, int rounds){
+    const char *fn = "delbench.spf";
+    SP_RID *rids = (SP_RID*)malloc(n * sizeof(SP_RID));
+    long i, dels = 0, ins = 0; int r, fd, pages, bytes; clock_t t0; double del_s = 0, ins_s = 0;
+    char name[32]; char dept[8] = "BE"; char lvl[4] = "UG"; SP_Record rec;
+    if (!rids) return;
+    PF_DestroyFile((char*)fn);
+    if (SP_CreateEx(fn, format) != PFE_OK || (fd = SP_Open(fn)) < 0){ PF_PrintError("delbench open"); free(rids); return; }
+    rec.name = name; rec.dept = dept; rec.level = lvl;
+    for (i=0;i<n;i++){
+        sprintf(name, "S%07ld", i); rec.roll_no = (int)i;
+        if (SP_Insert(fd, &rec, &rids[i]) != PFE_OK){ PF_PrintError("delbench insert"); n = i; break; }
+    }
+    for (r=0;r<rounds;r++){
+        t0 = clock();
+        for (i=r&1;i<n;i+=2){ if (SP_Delete(fd, rids[i]) != PFE_OK){ PF_PrintError("delbench delete"); break; } dels++; }
+        del_s += (double)(clock() - t0) / CLOCKS_PER_SEC;
+        t0 = clock();
+        for (i=r&1;i<n;i+=2){
+            sprintf(name, "R%07ld", i); rec.roll_no = (int)i;
+            if (SP_Insert(fd, &rec, &rids[i]) != PFE_OK){ PF_PrintError("delbench reinsert"); break; }
+            ins++;
+        }
+        ins_s += (double)(clock() - t0) / CLOCKS_PER_SEC;
+    }
+    SP_Utilization(fd, &pages, &bytes);
+    printf("delbench format=%d records=%ld rounds=%d pages=%d delete=%.0f rec/s reinsert=%.0f rec/s\n",
+        format, n, rounds, pages, del_s > 0 ? dels/del_s : 0.0, ins_s > 0 ? ins/ins_s : 0.0);
+    SP_Close(fd);
+    PF_DestroyFile((char*)fn);
+    free(rids);
+}
+
+/* Mixed record sizes: most records carry a ~100 B note, every big_every-th a
+   64 KB one that spills into overflow pages. Reports insert rate, file size,
+   full-scan rate, and the rate of streaming all notes back in 4 KB reads. */
+static void run_notebench(int format, long n, int big_every){
+    const char *fn = "notebench.spf";
+    static char big[65536]; char small[100]; char name[32]; char dept[8] = "BTECH"; char lvl[4] = "UG";
+    char buf[1024]; char rb[4096];
+    long i, note_len, nbig = 0, notebytes = 0, streamed = 0, bad = 0, seen = 0; int fd, pages, bytes, k;
+    clock_t t0; double ins_s, scan_s, read_s; SP_Record rec, rr; SP_RID rid; SP_Scan sc; SP_NoteStream ns;
+    struct stat stt;
+    for (k=0;k<(int)sizeof(big);k++) big[k] = (char)('A' + k % 23);
+    memset(small, 'n', sizeof(small));
+    PF_DestroyFile((char*)fn);
+    if (SP_CreateEx(fn, format) != PFE_OK || (fd = SP_Open(fn)) < 0){ PF_PrintError("notebench open"); return; }
+    PF_SetReplPolicy(fd, PF_REPL_MRU);
+    rec.name = name; rec.dept = dept; rec.level = lvl;
+    t0 = clock();
+    for (i=0;i<n;i++){
+        int isbig = big_every > 0 && i % big_every == 0;
+        sprintf(name, "S%07ld", i); rec.roll_no = (int)i;
+        note_len = isbig ? (long)sizeof(big) : 100 - (long)(10 + strlen(name) + strlen(dept) + strlen(lvl) + 8);
+        if (SP_InsertNote(fd, &rec, isbig ? big : small, note_len, &rid) != PFE_OK){ PF_PrintError("notebench insert"); n = i; break; }
+        nbig += isbig; notebytes += note_len;
+    }
+    ins_s = (double)(clock() - t0) / CLOCKS_PER_SEC;
+    SP_Utilization(fd, &pages, &bytes);
+    t0 = clock();
+    SP_ScanOpen(fd, &sc); while (SP_ScanNext(&sc, &rr, &rid, buf, sizeof(buf)) == PFE_OK) seen++; SP_ScanClose(&sc);
+    scan_s = (double)(clock() - t0) / CLOCKS_PER_SEC;
+    t0 = clock();
+    SP_ScanOpen(fd, &sc);
+    while (SP_ScanNext(&sc, &rr, &rid, buf, sizeof(buf)) == PFE_OK){
+        long pos = 0;
+        if (SP_NoteOpen(fd, rid, &ns) != PFE_OK) continue;
+        while ((k = SP_NoteRead(&ns, rb, sizeof(rb))) > 0){
+            if (ns.len == (long)sizeof(big) && memcmp(rb, big + pos, k) != 0) bad++;
+            pos += k;
+        }
+        SP_NoteClose(&ns);
+        streamed += pos;
+    }
+    SP_ScanClose(&sc);
+    read_s = (double)(clock() - t0) / CLOCKS_PER_SEC;
+    SP_Close(fd);
+    stat(fn, &stt);
+    printf("notebench records=%ld big=%ld note_bytes=%ld file=%ldKB record_pages=%d insert=%.0f rec/s (%.1f MB/s)\n",
+        n, nbig, notebytes, (long)stt.st_size / 1024, pages, ins_s > 0 ? n/ins_s : 0.0, ins_s > 0 ? notebytes/ins_s/1e6 : 0.0);
+    printf("notebench scan=%.0f rec/s seen=%ld stream=%.1f MB/s streamed=%ld bad=%ld%s\n",
+        scan_s > 0 ? seen/scan_s : 0.0, seen, read_s > 0 ? streamed/read_s/1e6 : 0.0, streamed, bad, streamed == notebytes ? "" : " MISMATCH");
+    PF_DestroyFile((char*)fn);
+}
+
+/* load up to max_rec students from the text file into an open slotted file */
+static long load_students(const char *in, int fd, long max_rec){
+    FILE *f = fopen(in, "r"); char line[4096]; long n = 0;
+    if (!f){ perror("open data"); return -1; }
+    if (!fgets(line, sizeof(line), f)) { fclose(f); return 0; }
+    while (fgets(line, sizeof(line), f)){
+        SP_Record rec; char name[512]; char dept[64]; char lvl[8]; SP_RID rid;
+        if (parse_student(line, &rec, name, sizeof(name), dept, sizeof(dept), lvl) != 0) continue;
+        if (SP_Insert(fd, &rec, &rid)!=PFE_OK){ PF_PrintError("insert"); break; }
+        n++;
+        if (max_rec && n>=max_rec) break;
+    }
+    fclose(f);
+    return n;
+}
+
+/* count-by-dept and min/max roll_no over the same data in both page formats */
+static void run_colbench(const char *in, long max_rec, int reps){
+    const char *files[2]; int fmts[2]; const char *names[2]; int k;
+    files[0] = "colbench_row.spf"; fmts[0] = SP_FMT_ROW; names[0] = "row";
+    files[1] = "colbench_pax.spf"; fmts[1] = SP_FMT_PAX; names[1] = "pax";
+    for (k=0;k<2;k++){
+        int fd, pages, bytes, r, nd = 0; long n, cnt = 0, mn = 0, mx = 0; clock_t t0; double roll_s, dept_s;
+        SP_DeptCount dc[64]; PFStats st;
+        PF_DestroyFile((char*)files[k]);
+        if (SP_CreateEx(files[k], fmts[k]) != PFE_OK || (fd = SP_Open(files[k])) < 0){ PF_PrintError("colbench open"); return; }
+        PF_SetReplPolicy(fd, PF_REPL_MRU);
+        n = load_students(in, fd, max_rec);
+        SP_Utilization(fd, &pages, &bytes);
+        PF_StatsReset(); t0 = clock();
+        for (r=0;r<reps;r++) SP_RollStats(fd, &cnt, &mn, &mx);
+        roll_s = (double)(clock() - t0) / CLOCKS_PER_SEC; PF_StatsGet(&st);
+        t0 = clock();
+        for (r=0;r<reps;r++) SP_DeptCounts(fd, dc, 64, &nd);
+        dept_s = (double)(clock() - t0) / CLOCKS_PER_SEC;
+        printf("colbench format=%s records=%ld pages=%d recs/page=%.1f count=%ld min=%ld max=%ld depts=%d\n",
+            names[k], n, pages, pages ? (double)n/pages : 0.0, cnt, mn, mx, nd);
+        printf("colbench format=%s minmax_roll=%.0f rec/s count_by_dept=%.0f rec/s pr/pass=%ld\n", names[k],
+            roll_s > 0 ? (double)n*reps/roll_s : 0.0, dept_s > 0 ? (double)n*reps/dept_s : 0.0, st.physical_reads/reps);
+        fflush(stdout);
+        SP_Close(fd);
+    }
+}
+
+/* students held in memory so the same input can be loaded in several orders */
+typedef struct { int roll; char *name; char *dept; char *level; } ZStudent;
+
+static int zstudent_by_name(const void *a, const void *b){
+    return strcmp(((const ZStudent*)a)->name, ((const ZStudent*)b)->name);
+}
+
+static char *zdup(const char *s){
+    char *d = (char*)malloc(strlen(s) + 1);
+    if (d) strcpy(d, s);
+    return d;
+}
+
+static ZStudent *read_students(const char *in, long max_rec, long *n_out){
+    FILE *f = fopen(in, "r"); char line[4096]; long n = 0, cap = 1024;
+    ZStudent *v;
+    *n_out = 0;
+    if (!f){ perror("open data"); return NULL; }
+    v = (ZStudent*)malloc(cap * sizeof(ZStudent));
+    if (!v || !fgets(line, sizeof(line), f)){ fclose(f); return v; }
+    while (fgets(line, sizeof(line), f)){
+        SP_Record rec; char name[512]; char dept[64]; char lvl[8];
+        if (parse_student(line, &rec, name, sizeof(name), dept, sizeof(dept), lvl) != 0) continue;
+        if (n == cap){ cap *= 2; v = (ZStudent*)realloc(v, cap * sizeof(ZStudent)); if (!v) break; }
+        v[n].roll = rec.roll_no; v[n].name = zdup(name); v[n].dept = zdup(dept); v[n].level = zdup(lvl);
+        n++;
+        if (max_rec && n>=max_rec) break;
+    }
+    fclose(f);
+    *n_out = n;
+    return v;
+}
+
+/* density and full-scan cost of plain vs compressed row pages, for the input
+   order and for name-sorted input (front coding depends on neighbours) */
+static void run_zbench(const char *in, long max_rec, int reps){
+    long n, i; int k, o, r; ZStudent *v = read_students(in, max_rec, &n);
+    int fmts[2]; const char *names[2];
+    fmts[0] = SP_FMT_ROW; names[0] = "row"; fmts[1] = SP_FMT_ZROW; names[1] = "zrow";
+    if (!v) return;
+    for (o=0;o<2;o++){
+        if (o == 1) qsort(v, n, sizeof(ZStudent), zstudent_by_name);
+        for (k=0;k<2;k++){
+            const char *fn = "zbench.spf"; int fd, pages, bytes; long seen = 0; clock_t t0; double scan_s;
+            PFStats st; SP_Scan sc; SP_Record rr; SP_RID rid; char buf[1024];
+            PF_DestroyFile((char*)fn);
+            if (SP_CreateEx(fn, fmts[k]) != PFE_OK || (fd = SP_Open(fn)) < 0){ PF_PrintError("zbench open"); break; }
+            PF_SetReplPolicy(fd, PF_REPL_MRU);
+            for (i=0;i<n;i++){
+                SP_Record rec; rec.roll_no = v[i].roll; rec.name = v[i].name; rec.dept = v[i].dept; rec.level = v[i].level;
+                if (SP_Insert(fd, &rec, &rid) != PFE_OK){ PF_PrintError("zbench insert"); break; }
+            }
+            SP_Utilization(fd, &pages, &bytes);
+            PF_StatsReset(); t0 = clock();
+            for (r=0;r<reps;r++){
+                SP_ScanOpen(fd, &sc);
+                while (SP_ScanNext(&sc, &rr, &rid, buf, sizeof(buf)) == PFE_OK) seen++;
+                SP_ScanClose(&sc);
+            }
+            scan_s = (double)(clock() - t0) / CLOCKS_PER_SEC; PF_StatsGet(&st);
+            printf("zbench format=%s order=%s records=%ld pages=%d recs/page=%.1f bytes/rec=%.1f scan=%.0f rec/s pr/pass=%ld%s\n",
+                names[k], o ? "name" : "input", n, pages, pages ? (double)n/pages : 0.0, n ? (double)bytes/n : 0.0,
+                scan_s > 0 ? (double)seen/scan_s : 0.0, st.physical_reads/reps, seen == n*reps ? "" : " MISMATCH");
+            fflush(stdout);
+            SP_Close(fd);
+            PF_DestroyFile((char*)fn);
+        }
+    }
+    for (i=0;i<n;i++){ free(v[i].name); free(v[i].dept); free(v[i].level); }
+    free(v);
+}
+
+/* Update throughput: every record's name grows by grow bytes and then shrinks
+   back, round after round. Growth that no longer fits the page forwards the
+   record; the full-scan rate afterwards shows what the extra hop costs. */
+static void run_updbench(const char *in, int format, long max_rec, int rounds, int grow){
+    const char *fn = "updbench.spf";
+    long n, i, upds = 0, nofit = 0, seen = 0; int r, fd, pages0, pages1, bytes; clock_t t0; double upd_s = 0, scan0, scan1;
+    ZStudent *v = read_students(in, max_rec, &n);
+    SP_RID *rids; char name[600]; SP_Record rec, rr; SP_Scan sc; char buf[1024]; PFStats st0, st1;
+    if (!v) return;
+    rids = (SP_RID*)malloc((n ? n : 1) * sizeof(SP_RID));
+    PF_DestroyFile((char*)fn);
+    if (!rids || SP_CreateEx(fn, format) != PFE_OK || (fd = SP_Open(fn)) < 0){ PF_PrintError("updbench open"); free(v); free(rids); return; }
+    PF_SetReplPolicy(fd, PF_REPL_MRU);
+    for (i=0;i<n;i++){
+        rec.roll_no = v[i].roll; rec.name = v[i].name; rec.dept = v[i].dept; rec.level = v[i].level;
+        if (SP_Insert(fd, &rec, &rids[i]) != PFE_OK){ PF_PrintError("updbench insert"); n = i; break; }
+    }
+    SP_Utilization(fd, &pages0, &bytes);
+    PF_StatsReset(); t0 = clock();
+    SP_ScanOpen(fd, &sc); while (SP_ScanNext(&sc, &rr, NULL, buf, sizeof(buf)) == PFE_OK) seen++; SP_ScanClose(&sc);
+    scan0 = (double)(clock() - t0) / CLOCKS_PER_SEC; PF_StatsGet(&st0);
+    for (r=0;r<rounds;r++){
+        t0 = clock();
+        for (i=0;i<n;i++){
+            size_t nl = strlen(v[i].name);
+            if (nl > sizeof(name) - grow - 1) nl = sizeof(name) - grow - 1;
+            memcpy(name, v[i].name, nl);
+            if (r % 2 == 0){ memset(name + nl, '+', grow); nl += grow; }
+            name[nl] = '\0';
+            rec.roll_no = v[i].roll; rec.name = name; rec.dept = v[i].dept; rec.level = v[i].level;
+            /* PAX pages cannot forward, so growth that does not fit fails */
+            if (SP_Update(fd, rids[i], &rec) != PFE_OK) nofit++;
+            upds++;
+        }
+        upd_s += (double)(clock() - t0) / CLOCKS_PER_SEC;
+    }
+    SP_Utilization(fd, &pages1, &bytes);
+    seen = 0; PF_StatsReset(); t0 = clock();
+    SP_ScanOpen(fd, &sc); while (SP_ScanNext(&sc, &rr, NULL, buf, sizeof(buf)) == PFE_OK) seen++; SP_ScanClose(&sc);
+    scan1 = (double)(clock() - t0) / CLOCKS_PER_SEC; PF_StatsGet(&st1);
+    printf("updbench format=%d records=%ld rounds=%d grow=%d update=%.0f rec/s nofit=%ld pages=%d->%d\n",
+        format, n, rounds, grow, upd_s > 0 ? upds/upd_s : 0.0, nofit, pages0, pages1);
+    printf("updbench scan before=%.0f rec/s pr=%ld after=%.0f rec/s pr=%ld seen=%ld%s\n",
+        scan0 > 0 ? n/scan0 : 0.0, st0.physical_reads, scan1 > 0 ? seen/scan1 : 0.0, st1.physical_reads, seen, seen == n ? "" : " MISMATCH");
+    SP_Close(fd);
+    PF_DestroyFile((char*)fn);
+    for (i=0;i<n;i++){ free(v[i].name); free(v[i].dept); free(v[i].level); }
+    free(v); free(rids);
+}
+
 int main(int argc, char **argv){
     const char *in = (argc>1)?argv[1]:"../data/student.txt";
     const char *out = (argc>2)?argv[2]:"students.spf";
@@ -71,39 +416,58 @@ int main(int argc, char **argv){
 
     /* Optional unit test mode */
     if (getenv("RUN_UNIT")){
-        const char *uf = "unit.spf";
-        /* ensure clean file */
-        PF_DestroyFile((char*)uf);
-        if (SP_Create(uf) != PFE_OK) { PF_PrintError("unit SP_Create"); return 1; }
-        {
-            int ufd = SP_Open(uf);
-            if (ufd < 0) { PF_PrintError("unit SP_Open"); return 1; }
-            SP_RID rids[50]; int i; char buf[64]; SP_Record rec;
-            for (i=0;i<50;i++){
-                char name[32]; char dept[8] = "BE"; char lvl[4] = "UG";
-                sprintf(name, "S%03d", i);
-                rec.roll_no = i; rec.name = name; rec.dept = dept; rec.level = lvl;
-                if (SP_Insert(ufd, &rec, &rids[i])!=PFE_OK){ PF_PrintError("unit insert"); break; }
-            }
-            /* delete evens */
-            for (i=0;i<50;i+=2){ int rc = SP_Delete(ufd, rids[i]); if (rc!=PFE_OK){ fprintf(stderr, "unit delete rc=%d at i=%d page=%d slot=%d\n", rc, i, rids[i].page, rids[i].slot); break; } }
-            /* scan count */
-            {
-                SP_Scan sc; SP_Record rr; SP_RID rid; int cnt=0; int rc;
-                SP_ScanOpen(ufd, &sc);
-                while ((rc=SP_ScanNext(&sc,&rr,&rid,buf,sizeof(buf)))==PFE_OK) cnt++;
-                SP_ScanClose(&sc);
-                printf("UNIT: expected=25 scanned=%d\n", cnt);
-            }
-            SP_Close(ufd);
-        }
+        run_unit(SP_FMT_ROW, "UNIT");
+        run_unit(SP_FMT_PAX, "UNIT(pax)");
+        run_unit(SP_FMT_ZROW, "UNIT(zrow)");
+        return 0;
+    }
+
+    /* Update throughput, with growth that forces forwarding */
+    if (getenv("UPDBENCH")){
+        const char *max_env = getenv("MAX_REC");
+        int rounds = getenv("UPDROUNDS") ? atoi(getenv("UPDROUNDS")) : 3;
+        int grow = getenv("UPDGROW") ? atoi(getenv("UPDGROW")) : 16;
+        run_updbench(in, bench_format(), max_env ? atol(max_env) : 0, rounds > 0 ? rounds : 1, grow > 0 ? grow : 0);
+        return 0;
+    }
+
+    /* Mixed 100 B / 64 KB records through overflow pages */
+    if (getenv("NOTEBENCH")){
+        const char *max_env = getenv("MAX_REC");
+        int every = getenv("BIG_EVERY") ? atoi(getenv("BIG_EVERY")) : 10;
+        run_notebench(bench_format(), max_env ? atol(max_env) : 2000, every);
+        return 0;
+    }
+
+    /* Delete-heavy churn over the unit-test workload */
+    if (getenv("DELBENCH")){
+        const char *max_env = getenv("MAX_REC");
+        int rounds = getenv("DELROUNDS") ? atoi(getenv("DELROUNDS")) : 4;
+        run_delbench(bench_format(), max_env ? atol(max_env) : 20000, rounds > 0 ? rounds : 1);
+        return 0;
+    }
+
+    /* Column-aggregate benchmark: same data loaded row-wise and as PAX */
+    if (getenv("COLBENCH")){
+        const char *max_env = getenv("MAX_REC");
+        int reps = getenv("COLREPS") ? atoi(getenv("COLREPS")) : 20;
+        run_colbench(in, max_env ? atol(max_env) : 0, reps > 0 ? reps : 1);
+        return 0;
+    }
+
+    /* Compression benchmark: plain vs dictionary/front-coded row pages */
+    if (getenv("ZBENCH")){
+        const char *max_env = getenv("MAX_REC");
+        int reps = getenv("ZREPS") ? atoi(getenv("ZREPS")) : 10;
+        run_zbench(in, max_env ? atol(max_env) : 0, reps > 0 ? reps : 1);
         return 0;
     }
 
     fprintf(stderr, "slotted_bench: input=%s output=%s\n", in, out);
 
-    /* create slotted file */
-    if (SP_Create(out) != PFE_OK) { PF_PrintError("SP_Create"); return 1; }
+    /* create slotted file (FORMAT=pax selects the column-within-page layout,
+       FORMAT=zrow the compressed row layout) */
+    if (SP_CreateEx(out, bench_format()) != PFE_OK) { PF_PrintError("SP_Create"); return 1; }
     {
         int fd = SP_Open(out);
         if (fd < 0) { PF_PrintError("SP_Open"); return 1; }
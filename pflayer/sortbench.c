@@ -0,0 +1,99 @@
+/* sortbench.c: external sort throughput at 1x/4x/16x the memory budget, and a
+   sorted scan of a slotted file (records visited in roll_no order) */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "pf.h"
+#include "pftypes.h"
+#include "slotted.h"
+#include "extsort.h"
+
+/* records start with an unsigned key; the rest is filler plus a sequence
+   number used to check that nothing was lost or duplicated */
+static int cmp_key(const void *a, const void *b){
+    unsigned int ka, kb;
+    memcpy(&ka, a, sizeof(ka)); memcpy(&kb, b, sizeof(kb));
+    return (ka > kb) - (ka < kb);
+}
+
+static unsigned int lcg_next(unsigned int *st){ *st = *st * 1103515245u + 12345u; return *st ^ (*st >> 16); }
+
+static void run_throughput(long mem, int recsize, int factor){
+    ES_Sort es; char rec[PF_PAGE_SIZE]; unsigned int st = 4242u + factor, key, prev = 0;
+    long n = factor * (mem / recsize), i, seq, got = 0, bad = 0; double sum = 0, want = 0;
+    clock_t t0; double secs; int rc;
+    memset(rec, 'x', sizeof(rec));
+    if ((rc = ES_Open(&es, recsize, cmp_key, mem, "sortbench")) != PFE_OK){ PFerrno = rc; PF_PrintError("sortbench open"); return; }
+    t0 = clock();
+    for (i = 0; i < n; i++){
+        key = lcg_next(&st);
+        memcpy(rec, &key, sizeof(key)); memcpy(rec + sizeof(key), &i, sizeof(i));
+        if ((rc = ES_Put(&es, rec)) != PFE_OK) break;
+    }
+    if (rc == PFE_OK) rc = ES_Finish(&es);
+    while (rc == PFE_OK && (rc = ES_Next(&es, rec)) == 1){
+        memcpy(&key, rec, sizeof(key)); memcpy(&seq, rec + sizeof(key), sizeof(seq));
+        if (got > 0 && key < prev) bad++;
+        prev = key; sum += seq; got++;
+        rc = PFE_OK;
+    }
+    secs = (double)(clock() - t0) / CLOCKS_PER_SEC;
+    if (rc < 0){ PFerrno = rc; PF_PrintError("sortbench"); }
+    want = (double)n * (n - 1) / 2;
+    printf("sortbench mem=%ld recsize=%d factor=%d records=%ld runs=%d passes=%d pages_w=%ld pages_r=%ld sort=%.0f rec/s %s\n",
+        mem, recsize, factor, n, es.stats.runs, es.stats.passes, es.stats.pages_written, es.stats.pages_read,
+        secs > 0 ? got / secs : 0.0, (got == n && bad == 0 && sum == want) ? "ok" : "MISMATCH");
+    ES_Close(&es);
+}
+
+/* (roll_no, rid) sorted through the external sort, then each record fetched */
+typedef struct { long roll; int page, slot; } RollRid;
+
+static int cmp_roll(const void *a, const void *b){
+    const RollRid *x = (const RollRid*)a, *y = (const RollRid*)b;
+    return (x->roll > y->roll) - (x->roll < y->roll);
+}
+
+static void run_sortscan(const char *spfile, long mem){
+    ES_Sort es; SP_Scan sc; SP_Record r; SP_RID rid; RollRid rr; char buf[1024];
+    long n = 0, got = 0, bad = 0, prev = 0; int fd, rc; clock_t t0; double secs;
+    if ((fd = SP_Open(spfile)) < 0){ printf("sortscan: no %s, skipped\n", spfile); return; }
+    if ((rc = ES_Open(&es, sizeof(RollRid), cmp_roll, mem, "sortscan")) != PFE_OK){ SP_Close(fd); return; }
+    t0 = clock();
+    SP_ScanOpen(fd, &sc);
+    while (SP_ScanNext(&sc, &r, &rid, buf, sizeof(buf)) == PFE_OK){
+        rr.roll = r.roll_no; rr.page = rid.page; rr.slot = rid.slot;
+        if ((rc = ES_Put(&es, &rr)) != PFE_OK) break;
+        n++;
+    }
+    SP_ScanClose(&sc);
+    if (rc == PFE_OK) rc = ES_Finish(&es);
+    while (rc == PFE_OK && (rc = ES_Next(&es, &rr)) == 1){
+        rid.page = rr.page; rid.slot = rr.slot;
+        if (SP_Get(fd, rid, &r, buf, sizeof(buf)) != PFE_OK || r.roll_no != rr.roll || (got > 0 && r.roll_no < prev)) bad++;
+        prev = r.roll_no; got++;
+        rc = PFE_OK;
+    }
+    secs = (double)(clock() - t0) / CLOCKS_PER_SEC;
+    printf("sortscan file=%s mem=%ld records=%ld runs=%d passes=%d pages_w=%ld %.0f rec/s %s\n",
+        spfile, mem, got, es.stats.runs, es.stats.passes, es.stats.pages_written,
+        secs > 0 ? got / secs : 0.0, (got == n && bad == 0) ? "ok" : "MISMATCH");
+    ES_Close(&es);
+    SP_Close(fd);
+}
+
+int main(int argc, char **argv){
+    const char *spfile = (argc>1) ? argv[1] : "students.spf";
+    long mem = getenv("MEM") ? atol(getenv("MEM")) : 256L * 1024;
+    int recsize = getenv("RECSIZE") ? atoi(getenv("RECSIZE")) : 32;
+    static const int factors[] = { 1, 4, 16 };
+    int i;
+
+    PF_Init();
+    if (recsize < 16) recsize = 16; /* key and sequence number */
+    for (i = 0; i < (int)(sizeof(factors)/sizeof(factors[0])); i++)
+        run_throughput(mem, recsize, factors[i]);
+    run_sortscan(spfile, mem);
+    return 0;
+}